@@ -0,0 +1,413 @@
+//
+//  TalkBoard Benchmarks
+//
+//  Audio paths under load: the external source ring buffer, the 17-speaker
+//  mix and voice activity detection.
+//
+
+#include "Benchmark.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "AudioMixer.h"
+#include "AudioRingBuffer.h"
+#include "ScalarAudioMixer.h"
+#include "VoiceActivityDetector.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+const int kSampleRate = 48000;
+const int kChannels = 2;
+/** One 10 ms pushAudioFrame call. */
+const int kSamplesPerCall = kSampleRate / 100;
+/** Largest chunk the stress producer writes at once. */
+const int kMaxProducerChunk = 2 * kSamplesPerCall;
+/** A full board session: the host and 16 speakers. */
+const int kMixStreams = 17;
+/** Mix cycles compared between the SIMD and scalar mixers. */
+const int kMixCheckCycles = 400;
+/** Ticks in one cycle of the synthetic board session's talk schedule. */
+const int kTalkCycleTicks = 250;
+/** Ticks of speech in each cycle. */
+const int kTalkTicks = 150;
+/** Ticks of the session the detector is checked on. */
+const int kVadCheckTicks = 2000;
+
+typedef agora::media::IAudioFrameObserver::AudioFrame AudioFrame;
+
+/** Sample of frame `sequence` on the left channel; never 0, so padding silence stands out. */
+inline int16_t sequenceSample(uint32_t sequence)
+{
+    return (int16_t)(1 + sequence % 32000);
+}
+
+/** Writes a numbered sample sequence in chunks of varying size as fast as
+ the ring takes it, advancing only past the frames that were stored. */
+class SequenceProducer
+{
+public:
+    explicit SequenceProducer(media::AudioRingBuffer& ring)
+        : m_ring(ring)
+        , m_written(0)
+    {
+        m_stop.store(false);
+        m_thread = std::thread(&SequenceProducer::run, this);
+    }
+
+    ~SequenceProducer() { stop(); }
+
+    void stop()
+    {
+        m_stop.store(true);
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    uint32_t written() const { return m_written; }
+
+private:
+    void run()
+    {
+        std::vector<int16_t> chunk(kMaxProducerChunk * kChannels);
+        uint32_t random = 12345;
+        while (!m_stop.load(std::memory_order_relaxed)) {
+            random = random * 1664525u + 1013904223u;
+            int frames = 1 + (int)(random >> 16) % kMaxProducerChunk;
+            for (int i = 0; i < frames; ++i) {
+                int16_t sample = sequenceSample(m_written + i);
+                chunk[i * kChannels] = sample;
+                chunk[i * kChannels + 1] = (int16_t)-sample;
+            }
+            int stored = m_ring.write(&chunk[0], frames);
+            m_written += stored;
+            if (stored < frames)
+                std::this_thread::yield();
+        }
+    }
+
+    media::AudioRingBuffer& m_ring;
+    uint32_t m_written;
+    std::atomic<bool> m_stop;
+    std::thread m_thread;
+};
+
+// A producer thread against the reading audio thread. Every read must
+// continue the producer's sequence exactly and pad the rest with silence.
+void BM_AudioRingBuffer_stress(State& state)
+{
+    media::AudioRingBuffer ring(kSampleRate, kChannels, 40);
+    std::vector<int16_t> out(kSamplesPerCall * kChannels);
+    uint32_t expected = 0;
+    {
+        SequenceProducer producer(ring);
+        while (state.keepRunning()) {
+            int frames = ring.read(&out[0], kSamplesPerCall);
+            for (int i = 0; i < kSamplesPerCall; ++i) {
+                int16_t left = i < frames ? sequenceSample(expected + i) : 0;
+                if (out[i * kChannels] != left || out[i * kChannels + 1] != (int16_t)-left) {
+                    fprintf(stderr, "AudioRingBuffer: frame %u of the sequence read as %d/%d\n", expected + i,
+                            out[i * kChannels], out[i * kChannels + 1]);
+                    abort();
+                }
+            }
+            expected += frames;
+        }
+        producer.stop();
+        if (expected > producer.written()) {
+            fprintf(stderr, "AudioRingBuffer: read %u frames, %u written\n", expected, producer.written());
+            abort();
+        }
+    }
+    uint64_t reads = 0;
+    for (int i = 0; i < media::AudioRingBuffer::LATENCY_BUCKETS; ++i)
+        reads += ring.latencyCount(i);
+    if (reads != state.iterations()) {
+        fprintf(stderr, "AudioRingBuffer: %llu reads in the latency histogram, %llu made\n",
+                (unsigned long long)reads, (unsigned long long)state.iterations());
+        abort();
+    }
+    state.setBytesProcessed(state.iterations() * out.size() * sizeof(int16_t));
+}
+TALKBOARD_BENCHMARK(BM_AudioRingBuffer_stress);
+
+/** Every third speaker sends mono, so both channel conversions are mixed. */
+inline int mixInputChannels(int stream)
+{
+    return stream % 3 == 0 ? 1 : 2;
+}
+
+/** Fills `pcm` with noise at `amplitude` (at most 32767). */
+void fillNoise(std::vector<int16_t>& pcm, uint32_t seed, int amplitude)
+{
+    uint32_t state = 0x9e3779b9u * (seed + 1);
+    for (size_t i = 0; i < pcm.size(); ++i) {
+        state = state * 1664525u + 1013904223u;
+        pcm[i] = (int16_t)((int32_t)(state >> 16) % (amplitude + 1) * ((state & 1) ? 1 : -1));
+    }
+}
+
+AudioFrame mixFrame(std::vector<int16_t>& pcm, int frames, int channels)
+{
+    AudioFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = agora::media::IAudioFrameObserver::FRAME_TYPE_PCM16;
+    frame.samples = frames;
+    frame.bytesPerSample = 2;
+    frame.channels = channels;
+    frame.samplesPerSec = kSampleRate;
+    frame.buffer = &pcm[0];
+    return frame;
+}
+
+template <typename Mixer>
+void setMixGains(Mixer& mixer)
+{
+    mixer.setGain(1000, 0);
+    mixer.setGain(1003, 0.25f);
+    mixer.setGain(1007, 1.5f);
+    mixer.setGain(1011, Mixer::MAX_GAIN);
+}
+
+void failMix(const char* what, int outputChannels, int cycle)
+{
+    fprintf(stderr, "AudioMixer: %s, %d channel output, cycle %d\n", what, outputChannels, cycle);
+    abort();
+}
+
+// The SIMD mixer against the scalar build, for both output layouts. Cycles
+// vary the frame count (480 and 441 frames, and a speaker that sends a short
+// frame) and the level, so the limiter engages, and must match sample for
+// sample; a cycle must also report its own length, not a longer earlier one.
+void checkMixerAgainstScalar()
+{
+    for (int outputChannels = 1; outputChannels <= 2; ++outputChannels) {
+        media::AudioMixer simd(outputChannels);
+        media::ScalarAudioMixer scalar(outputChannels);
+        setMixGains(simd);
+        setMixGains(scalar);
+        std::vector<int16_t> input(kSamplesPerCall * 2);
+        std::vector<int16_t> simdOut(kSamplesPerCall * 2), scalarOut(kSamplesPerCall * 2);
+        for (int cycle = 0; cycle < kMixCheckCycles; ++cycle) {
+            int frames = cycle % 4 == 3 ? 441 : kSamplesPerCall;
+            int amplitude = cycle % 5 == 0 ? 32767 : 4000;
+            for (int i = 0; i < kMixStreams; ++i) {
+                fillNoise(input, cycle * kMixStreams + i, amplitude);
+                int inputFrames = i == 5 && cycle % 7 == 0 ? frames / 2 : frames;
+                AudioFrame frame = mixFrame(input, inputFrames, mixInputChannels(i));
+                if (simd.addFrame(1000 + i, frame) != 0 || scalar.addFrame(1000 + i, frame) != 0)
+                    failMix("addFrame failed", outputChannels, cycle);
+            }
+            memset(&simdOut[0], 0x55, simdOut.size() * sizeof(int16_t));
+            memset(&scalarOut[0], 0x55, scalarOut.size() * sizeof(int16_t));
+            AudioFrame simdFrame = mixFrame(simdOut, kSamplesPerCall, outputChannels);
+            AudioFrame scalarFrame = mixFrame(scalarOut, kSamplesPerCall, outputChannels);
+            int simdStreams = simd.mixTo(simdFrame);
+            int scalarStreams = scalar.mixTo(scalarFrame);
+            if (simdStreams != kMixStreams - 1 || scalarStreams != simdStreams)
+                failMix("wrong stream count", outputChannels, cycle);
+            if (simdFrame.samples != frames || scalarFrame.samples != frames)
+                failMix("wrong frame count", outputChannels, cycle);
+            if (memcmp(&simdOut[0], &scalarOut[0], simdOut.size() * sizeof(int16_t)) != 0)
+                failMix("SIMD and scalar mixes differ", outputChannels, cycle);
+        }
+    }
+}
+
+// 17 speakers mixed into stereo per 10 ms period.
+void BM_AudioMixer_mix17(State& state)
+{
+    static bool checked = false;
+    if (!checked) {
+        checkMixerAgainstScalar();
+        checked = true;
+    }
+
+    media::AudioMixer mixer(kChannels);
+    setMixGains(mixer);
+    std::vector<std::vector<int16_t> > inputs;
+    std::vector<AudioFrame> frames;
+    for (int i = 0; i < kMixStreams; ++i) {
+        inputs.push_back(std::vector<int16_t>(kSamplesPerCall * mixInputChannels(i)));
+        fillNoise(inputs[i], i, 4000);
+    }
+    for (int i = 0; i < kMixStreams; ++i)
+        frames.push_back(mixFrame(inputs[i], kSamplesPerCall, mixInputChannels(i)));
+    std::vector<int16_t> mix(kSamplesPerCall * kChannels);
+
+    while (state.keepRunning()) {
+        for (int i = 0; i < kMixStreams; ++i)
+            mixer.addFrame(1000 + i, frames[i]);
+        AudioFrame out = mixFrame(mix, kSamplesPerCall, kChannels);
+        mixer.mixTo(out);
+        doNotOptimize(mix[0]);
+    }
+    state.setItemsProcessed(state.iterations() * kMixStreams);
+    state.setBytesProcessed(state.iterations() * kSamplesPerCall * kChannels * sizeof(int16_t));
+}
+TALKBOARD_BENCHMARK(BM_AudioMixer_mix17);
+
+/** One remote stream of a synthetic board session, 10 ms at a time.
+
+ Speakers talk for kTalkTicks of every kTalkCycleTicks, with a harmonic
+ voice under a syllable envelope over a quiet room; noise streams are
+ steady broadband noise as loud as the voices (a fan or a street next to
+ the microphone); the rest are muted microphones that only carry hiss.
+ */
+class SyntheticStream
+{
+public:
+    enum Kind { SPEAKER, NOISE, HISS };
+
+    SyntheticStream(Kind kind, int index)
+        : m_kind(kind)
+        , m_index(index)
+        , m_random(0x9e3779b9u * (index + 1))
+    {}
+
+    Kind kind() const { return m_kind; }
+
+    bool talking(int tick) const
+    {
+        return m_kind == SPEAKER && (tick + m_index * 37) % kTalkCycleTicks < kTalkTicks;
+    }
+
+    /** Writes tick `tick` as kSamplesPerCall stereo frames. */
+    void render(int tick, int16_t* out)
+    {
+        double f0 = 100 + 12 * m_index;
+        for (int i = 0; i < kSamplesPerCall; ++i) {
+            double t = ((double)tick * kSamplesPerCall + i) / kSampleRate;
+            double sample = noise() * (m_kind == NOISE ? 5000 : 6);
+            if (talking(tick)) {
+                double syllable = 0.55 + 0.45 * sin(2 * M_PI * 4.3 * t + m_index);
+                double phase = 2 * M_PI * f0 * (t + 0.002 * sin(2 * M_PI * 5 * t));
+                double voice = 0;
+                for (int k = 1; k <= 24; ++k)
+                    voice += sin(k * phase + k * k) / k;
+                sample += 2500 * syllable * voice;
+            }
+            int16_t value = (int16_t)(sample > 32767 ? 32767 : sample < -32768 ? -32768 : sample);
+            out[2 * i] = value;
+            out[2 * i + 1] = value;
+        }
+    }
+
+private:
+    /** Uniform noise in [-1, 1]. */
+    double noise()
+    {
+        m_random = m_random * 1664525u + 1013904223u;
+        return (double)(int32_t)m_random / 2147483648.0;
+    }
+
+    Kind m_kind;
+    int m_index;
+    uint32_t m_random;
+};
+
+std::vector<SyntheticStream> boardSessionStreams()
+{
+    std::vector<SyntheticStream> streams;
+    for (int i = 0; i < kMixStreams; ++i)
+        streams.push_back(SyntheticStream(i < 8 ? SyntheticStream::SPEAKER : i < 13 ? SyntheticStream::NOISE
+                                                                                  : SyntheticStream::HISS, i));
+    return streams;
+}
+
+// Runs kVadCheckTicks of the session through the detector. A speaker must be
+// reported speaking from attackMs (plus two frames of flatness smoothing)
+// after they start talking until they stop, and not speaking from releaseMs
+// after they stop until they start again; noise and hiss must never be
+// reported speaking, and activeSpeaker() must always be someone talking.
+void checkVoiceActivityDetector()
+{
+    media::VoiceActivityConfig config;
+    media::VoiceActivityDetector detector(config);
+    std::vector<SyntheticStream> streams = boardSessionStreams();
+    std::vector<int16_t> pcm(kSamplesPerCall * kChannels);
+    const int attackTicks = config.attackMs / 10 + 2;
+    const int releaseTicks = config.releaseMs / 10 + 2;
+    int speakingTicks = 0;
+    for (int tick = 0; tick < kVadCheckTicks; ++tick) {
+        for (int i = 0; i < kMixStreams; ++i) {
+            SyntheticStream& stream = streams[i];
+            stream.render(tick, &pcm[0]);
+            AudioFrame frame = mixFrame(pcm, kSamplesPerCall, kChannels);
+            int speaking = detector.process(1000 + i, frame);
+            if (speaking < 0) {
+                fprintf(stderr, "VoiceActivityDetector: process failed with %d\n", speaking);
+                abort();
+            }
+            bool settled = tick >= releaseTicks;
+            for (int back = 1; back <= releaseTicks && settled; ++back)
+                settled = stream.talking(tick) == stream.talking(tick - back)
+                    || (stream.talking(tick) && back > attackTicks);
+            if (settled && (speaking != 0) != stream.talking(tick)) {
+                fprintf(stderr, "VoiceActivityDetector: stream %d (%s) %s at %d ms\n", i,
+                        stream.kind() == SyntheticStream::SPEAKER ? "speaker"
+                            : stream.kind() == SyntheticStream::NOISE ? "noise" : "hiss",
+                        speaking ? "speaking" : "silent", tick * 10);
+                abort();
+            }
+            speakingTicks += speaking;
+        }
+        agora::rtc::uid_t active = detector.activeSpeaker();
+        if (active && !detector.isSpeaking(active)) {
+            fprintf(stderr, "VoiceActivityDetector: active speaker %u is not speaking at %d ms\n", active, tick * 10);
+            abort();
+        }
+        if (active && streams[active - 1000].kind() != SyntheticStream::SPEAKER) {
+            fprintf(stderr, "VoiceActivityDetector: stream %u chosen as active speaker at %d ms\n", active - 1000,
+                    tick * 10);
+            abort();
+        }
+    }
+    if (!speakingTicks) {
+        fprintf(stderr, "VoiceActivityDetector: nobody spoke\n");
+        abort();
+    }
+}
+
+// Every stream of a 17-user board session through the detector per 10 ms tick.
+void BM_VoiceActivityDetector_board17(State& state)
+{
+    static bool checked = false;
+    if (!checked) {
+        checkVoiceActivityDetector();
+        checked = true;
+    }
+
+    std::vector<SyntheticStream> streams = boardSessionStreams();
+    const size_t tickSamples = kSamplesPerCall * kChannels;
+    std::vector<std::vector<int16_t> > session(kMixStreams, std::vector<int16_t>(kTalkCycleTicks * tickSamples));
+    for (int i = 0; i < kMixStreams; ++i) {
+        for (int tick = 0; tick < kTalkCycleTicks; ++tick)
+            streams[i].render(tick, &session[i][tick * tickSamples]);
+    }
+    media::VoiceActivityDetector detector;
+    std::vector<int16_t> scratch(1);
+    int tick = 0;
+    int speaking = 0;
+    while (state.keepRunning()) {
+        for (int i = 0; i < kMixStreams; ++i) {
+            AudioFrame frame = mixFrame(scratch, kSamplesPerCall, kChannels);
+            frame.buffer = &session[i][tick * tickSamples];
+            speaking += detector.process(1000 + i, frame);
+        }
+        tick = (tick + 1) % kTalkCycleTicks;
+    }
+    doNotOptimize(speaking);
+    state.setItemsProcessed(state.iterations() * kMixStreams);
+}
+TALKBOARD_BENCHMARK(BM_VoiceActivityDetector_board17);
+
+} // namespace
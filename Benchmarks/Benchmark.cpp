@@ -0,0 +1,284 @@
+//
+//  TalkBoard Benchmarks
+//
+
+#include "Benchmark.h"
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#include "JsonWriter.h"
+
+namespace talkboard {
+namespace bench {
+
+namespace {
+
+/** Scale of the MAD that makes it estimate the standard deviation of normal data. */
+const double kMadToSigma = 1.4826;
+/** Largest batch calibrate() tries, so a benchmark that does nothing still ends. */
+const uint64_t kMaxIterations = 1ULL << 32;
+
+struct Entry
+{
+    std::string name;
+    BenchmarkFunction function;
+};
+
+std::vector<Entry>& registry()
+{
+    static std::vector<Entry> entries;
+    return entries;
+}
+
+uint64_t nowNs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+State runBatch(BenchmarkFunction function, uint64_t iterations)
+{
+    State state(iterations);
+    function(state);
+    // A function that never calls keepRunning() reports 0 ns rather than its setup time.
+    return state;
+}
+
+/** Number of iterations that makes one batch last about `batchNs`. */
+uint64_t calibrate(BenchmarkFunction function, uint64_t batchNs)
+{
+    uint64_t iterations = 1;
+    for (;;) {
+        State state = runBatch(function, iterations);
+        uint64_t elapsed = state.elapsedNs();
+        if (elapsed >= batchNs / 10 || iterations >= kMaxIterations) {
+            double scaled = elapsed ? (double)iterations * batchNs / elapsed : (double)kMaxIterations;
+            return (uint64_t)std::max(1.0, std::min(scaled, (double)kMaxIterations));
+        }
+        iterations *= elapsed ? std::min<uint64_t>(10, batchNs / 10 / elapsed + 1) : 10;
+    }
+}
+
+double median(std::vector<double> values)
+{
+    if (values.empty())
+        return 0;
+    size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    double upper = values[middle];
+    if (values.size() % 2)
+        return upper;
+    double lower = *std::max_element(values.begin(), values.begin() + middle);
+    return (lower + upper) / 2;
+}
+
+Result summarize(const std::string& name, uint64_t iterations, uint64_t items, uint64_t bytes,
+                 const std::vector<double>& samples, double threshold)
+{
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.itemsPerBatch = items;
+
+    double center = median(samples);
+    std::vector<double> deviations(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i)
+        deviations[i] = fabs(samples[i] - center);
+    double mad = median(deviations);
+
+    // With a MAD of 0 (most batches identical) every other sample would have
+    // an infinite score; keep them all rather than reject real variation.
+    std::vector<double> kept;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        if (mad == 0 || 0.6745 * deviations[i] / mad <= threshold)
+            kept.push_back(samples[i]);
+    }
+
+    double sum = 0;
+    for (size_t i = 0; i < kept.size(); ++i)
+        sum += kept[i];
+    double mean = kept.empty() ? 0 : sum / kept.size();
+    double squares = 0;
+    for (size_t i = 0; i < kept.size(); ++i)
+        squares += (kept[i] - mean) * (kept[i] - mean);
+
+    result.samples = (int)kept.size();
+    result.outliers = (int)(samples.size() - kept.size());
+    result.median = median(kept);
+    result.mean = mean;
+    result.stddev = kept.size() > 1 ? sqrt(squares / (kept.size() - 1)) : 0;
+    result.min = kept.empty() ? 0 : *std::min_element(kept.begin(), kept.end());
+    result.max = kept.empty() ? 0 : *std::max_element(kept.begin(), kept.end());
+    result.mad = mad * kMadToSigma;
+    result.itemsPerSecond = result.median > 0 ? 1e9 / result.median : 0;
+    result.bytesPerSecond = result.median > 0 && items ? 1e9 / result.median * bytes / items : 0;
+    return result;
+}
+
+} // namespace
+
+void State::start()
+{
+    m_started = true;
+    m_startNs = nowNs();
+}
+
+void State::stop()
+{
+    if (m_started && !m_elapsedNs)
+        m_elapsedNs = nowNs() - m_startNs;
+}
+
+void State::pauseTiming()
+{
+    m_pausedNs = nowNs();
+}
+
+void State::resumeTiming()
+{
+    // Moving the start forward leaves the paused time out of the total.
+    m_startNs += nowNs() - m_pausedNs;
+}
+
+Registration::Registration(const char* name, BenchmarkFunction function)
+{
+    Entry entry;
+    // Drop the conventional BM_ prefix from the reported name.
+    entry.name = strncmp(name, "BM_", 3) == 0 ? name + 3 : name;
+    entry.function = function;
+    registry().push_back(entry);
+}
+
+std::vector<std::string> benchmarkNames()
+{
+    std::vector<std::string> names;
+    for (size_t i = 0; i < registry().size(); ++i)
+        names.push_back(registry()[i].name);
+    return names;
+}
+
+int pinToCpu(int cpu)
+{
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+        return -1;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0 ? 0 : -1;
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+std::vector<Result> runBenchmarks(const RunOptions& options, FILE* progress)
+{
+    std::vector<Result> results;
+    const uint64_t batchNs = (uint64_t)std::max(1, options.batchMs) * 1000000;
+    const uint64_t warmupNs = (uint64_t)std::max(0, options.warmupMs) * 1000000;
+
+    for (size_t i = 0; i < registry().size(); ++i) {
+        const Entry& entry = registry()[i];
+        if (!options.filter.empty() && entry.name.find(options.filter) == std::string::npos)
+            continue;
+
+        uint64_t iterations = calibrate(entry.function, batchNs);
+        uint64_t warmupStart = nowNs();
+        while (nowNs() - warmupStart < warmupNs)
+            runBatch(entry.function, iterations);
+
+        std::vector<double> samples;
+        uint64_t items = 0;
+        uint64_t bytes = 0;
+        for (int r = 0; r < std::max(1, options.repetitions); ++r) {
+            State state = runBatch(entry.function, iterations);
+            items = state.items();
+            bytes = state.bytes();
+            samples.push_back((double)state.elapsedNs() / items);
+        }
+
+        Result result = summarize(entry.name, iterations, items, bytes, samples, options.outlierThreshold);
+        results.push_back(result);
+        if (progress) {
+            fprintf(progress, "%-40s %12.1f ns/item  +-%5.1f%%  %2d outliers  %llu items/batch\n",
+                    result.name.c_str(), result.median,
+                    result.median > 0 ? 100 * result.mad / result.median : 0,
+                    result.outliers, (unsigned long long)items);
+            fflush(progress);
+        }
+    }
+    return results;
+}
+
+void writeJson(const std::vector<Result>& results, const RunOptions& options, bool pinned, FILE* out)
+{
+    char date[32] = "";
+    time_t now = time(NULL);
+    struct tm utc;
+#if defined(_WIN32)
+    gmtime_s(&utc, &now);
+#else
+    gmtime_r(&now, &utc);
+#endif
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    char host[256] = "";
+#if defined(__unix__) || defined(__APPLE__)
+    if (gethostname(host, sizeof(host) - 1) != 0)
+        host[0] = 0;
+#endif
+
+    util::JsonWriter<8192> json;
+    json.beginObject();
+    json.beginObject("context")
+        .member("date", date)
+        .member("host", host)
+#if defined(__VERSION__)
+        .member("compiler", __VERSION__)
+#endif
+        .member("cpu", options.cpu)
+        .member("pinned", pinned)
+        .member("warmupMs", options.warmupMs)
+        .member("batchMs", options.batchMs)
+        .member("repetitions", options.repetitions)
+        .member("outlierThreshold", options.outlierThreshold)
+        .member("timeUnit", "ns")
+        .endObject();
+    json.beginArray("benchmarks");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        json.beginObject()
+            .member("name", result.name.c_str())
+            .member("iterations", (unsigned long long)result.iterations)
+            .member("itemsPerBatch", (unsigned long long)result.itemsPerBatch)
+            .member("samples", result.samples)
+            .member("outliers", result.outliers)
+            .member("median", result.median)
+            .member("mean", result.mean)
+            .member("stddev", result.stddev)
+            .member("min", result.min)
+            .member("max", result.max)
+            .member("mad", result.mad)
+            .member("itemsPerSecond", result.itemsPerSecond)
+            .member("bytesPerSecond", result.bytesPerSecond)
+            .endObject();
+    }
+    json.endArray();
+    json.endObject();
+    fprintf(out, "%s\n", json.c_str());
+}
+
+} // namespace bench
+} // namespace talkboard
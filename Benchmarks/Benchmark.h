@@ -0,0 +1,185 @@
+//
+//  TalkBoard Benchmarks
+//
+//  Minimal microbenchmark harness: registration, timing, outlier rejection.
+//
+
+#ifndef TALKBOARD_BENCHMARK_H
+#define TALKBOARD_BENCHMARK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace talkboard {
+namespace bench {
+
+/** Passed to a benchmark function, which runs its measured loop as
+
+ @code
+ void BM_setInt(State& state)
+ {
+     ... setup, not timed ...
+     while (state.keepRunning())
+         parameters.setInt("che.video.lowBitRateStreamParameter", 1);
+     state.setItemsProcessed(state.iterations());
+ }
+ @endcode
+
+ The clock starts at the first keepRunning() and stops when it returns
+ false, so setup and teardown outside the loop are not measured.
+ */
+class State
+{
+public:
+    explicit State(uint64_t iterations)
+        : m_iterations(iterations)
+        , m_remaining(iterations)
+        , m_startNs(0)
+        , m_pausedNs(0)
+        , m_elapsedNs(0)
+        , m_items(0)
+        , m_bytes(0)
+        , m_started(false)
+    {}
+
+    bool keepRunning()
+    {
+        if (m_remaining) {
+            if (!m_started)
+                start();
+            --m_remaining;
+            return true;
+        }
+        stop();
+        return false;
+    }
+
+    /** Stop and restart the clock around work in the loop that is not measured. */
+    void pauseTiming();
+    void resumeTiming();
+
+    uint64_t iterations() const { return m_iterations; }
+    /** Units of work per batch when one iteration is not one unit, e.g. frames or events. */
+    void setItemsProcessed(uint64_t items) { m_items = items; }
+    void setBytesProcessed(uint64_t bytes) { m_bytes = bytes; }
+
+    uint64_t elapsedNs() const { return m_elapsedNs; }
+    uint64_t items() const { return m_items ? m_items : m_iterations; }
+    uint64_t bytes() const { return m_bytes; }
+
+private:
+    void start();
+    void stop();
+
+    uint64_t m_iterations;
+    uint64_t m_remaining;
+    uint64_t m_startNs;
+    uint64_t m_pausedNs;
+    uint64_t m_elapsedNs;
+    uint64_t m_items;
+    uint64_t m_bytes;
+    bool m_started;
+};
+
+typedef void (*BenchmarkFunction)(State& state);
+
+/** Registers `function` under `name` from a static initializer; see TALKBOARD_BENCHMARK. */
+struct Registration
+{
+    Registration(const char* name, BenchmarkFunction function);
+};
+
+#define TALKBOARD_BENCHMARK_CONCAT2(a, b) a##b
+#define TALKBOARD_BENCHMARK_CONCAT(a, b) TALKBOARD_BENCHMARK_CONCAT2(a, b)
+#define TALKBOARD_BENCHMARK(function) \
+    static ::talkboard::bench::Registration TALKBOARD_BENCHMARK_CONCAT(s_registration_, __LINE__)(#function, function)
+
+/** Keeps the compiler from discarding the computation of `value`. */
+template <class T>
+inline void doNotOptimize(T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : "+m"(value) : : "memory");
+#else
+    static volatile char sink;
+    sink = *reinterpret_cast<volatile char*>(&value);
+#endif
+}
+
+/** Forces pending writes to memory, e.g. after filling a buffer that is never read. */
+inline void clobberMemory()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#endif
+}
+
+struct RunOptions
+{
+    /** Substring a benchmark name must contain; empty runs everything. */
+    std::string filter;
+    /** Time spent running a benchmark before measuring it. */
+    int warmupMs;
+    /** Target duration of one measured batch. */
+    int batchMs;
+    /** Measured batches per benchmark. */
+    int repetitions;
+    /** CPU to pin the process to; -1 leaves scheduling alone. */
+    int cpu;
+    /** Samples whose modified z-score (0.6745 * |x - median| / MAD) exceeds
+     this are rejected as outliers. */
+    double outlierThreshold;
+
+    RunOptions()
+        : warmupMs(100)
+        , batchMs(10)
+        , repetitions(25)
+        , cpu(-1)
+        , outlierThreshold(3.5)
+    {}
+};
+
+/** Statistics of one benchmark over the batches that were kept. Times are
+ nanoseconds per item. */
+struct Result
+{
+    std::string name;
+    uint64_t iterations;
+    uint64_t itemsPerBatch;
+    int samples;
+    int outliers;
+    double median;
+    double mean;
+    double stddev;
+    double min;
+    double max;
+    /** Median absolute deviation, the robust counterpart of stddev. */
+    double mad;
+    double itemsPerSecond;
+    /** 0 unless the benchmark reported bytes. */
+    double bytesPerSecond;
+};
+
+/** Names of the registered benchmarks, in registration order. */
+std::vector<std::string> benchmarkNames();
+
+/** Pins the calling thread to `cpu`.
+
+ @return 0, or -1 where pinning is not supported or `cpu` does not exist.
+ */
+int pinToCpu(int cpu);
+
+/** Runs every registered benchmark matching `options.filter`; `progress`
+ (may be NULL) gets one human-readable line per benchmark. */
+std::vector<Result> runBenchmarks(const RunOptions& options, FILE* progress);
+
+/** Writes `results` and the run configuration as one JSON document. */
+void writeJson(const std::vector<Result>& results, const RunOptions& options, bool pinned, FILE* out);
+
+} // namespace bench
+} // namespace talkboard
+
+#endif
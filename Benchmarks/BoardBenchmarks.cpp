@@ -0,0 +1,489 @@
+//
+//  TalkBoard Benchmarks
+//
+//  Board strokes: encoding a stroke for the wire and decoding it again,
+//  indexing them with a recording and replaying recorded strokes.
+//
+
+#include "Benchmark.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "JsonWriter.h"
+#include "SessionRecorder.h"
+#include "SessionTimeline.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+/** Points of one stroke; a quick underline is ~30, a sketched shape a few hundred. */
+const int kStrokePoints = 200;
+/** Points per second while the finger moves. */
+const int kPointRateHz = 60;
+/** Length of the recorded session replayed by the timeline benchmarks. */
+const int64_t kSessionMs = 60 * 60 * 1000;
+/** Length of the session the recorder benchmark records, and its video. */
+const int64_t kRecordedMs = 10 * 1000;
+const int kRecordedWidth = 320;
+const int kRecordedHeight = 180;
+const int kRecordedFrameRate = 15;
+/** Local monotonic time the recorded session starts at. */
+const int64_t kRecordingOriginMs = 5000000;
+
+struct StrokePoint
+{
+    int x;
+    int y;
+    int64_t t;
+};
+
+std::vector<StrokePoint> makeStroke(int points)
+{
+    std::vector<StrokePoint> stroke;
+    int64_t t = 1520000000000LL;
+    for (int i = 0; i < points; ++i) {
+        StrokePoint p = { 120 + (i * 7) % 900, 80 + (i * 13) % 600, t };
+        stroke.push_back(p);
+        t += 1000 / kPointRateHz;
+    }
+    return stroke;
+}
+
+// The SNSPath.serialize() document, {"color":1,"points":[{"x":..,"y":..,"t":..},..]}, built with snprintf.
+void BM_Stroke_encodeSnprintf(State& state)
+{
+    std::vector<StrokePoint> stroke = makeStroke(kStrokePoints);
+    std::string json;
+    char point[96];
+    size_t bytes = 0;
+    while (state.keepRunning()) {
+        json.assign("{\"color\":1,\"points\":[");
+        for (size_t i = 0; i < stroke.size(); ++i) {
+            int n = snprintf(point, sizeof(point), "%s{\"x\":%d,\"y\":%d,\"t\":%lld}",
+                             i ? "," : "", stroke[i].x, stroke[i].y, (long long)stroke[i].t);
+            json.append(point, n);
+        }
+        json.append("]}");
+        bytes = json.size();
+        doNotOptimize(bytes);
+    }
+    state.setItemsProcessed(state.iterations() * kStrokePoints);
+    state.setBytesProcessed(state.iterations() * bytes);
+}
+TALKBOARD_BENCHMARK(BM_Stroke_encodeSnprintf);
+
+/** SNSPath.serialize(): {"color":1,"points":[{"x":..,"y":..,"t":..},..]}, "t" only if known. */
+template <size_t N>
+void encodeStroke(const std::vector<StrokePoint>& stroke, util::JsonWriter<N>& json)
+{
+    json.clear();
+    json.beginObject().member("color", 1);
+    json.beginArray("points");
+    for (size_t i = 0; i < stroke.size(); ++i) {
+        json.beginObject().member("x", stroke[i].x).member("y", stroke[i].y);
+        if (stroke[i].t >= 0)
+            json.member("t", (long long)stroke[i].t);
+        json.endObject();
+    }
+    json.endArray().endObject();
+}
+
+void BM_Stroke_encodeJsonWriter(State& state)
+{
+    std::vector<StrokePoint> stroke = makeStroke(kStrokePoints);
+    util::JsonWriter<8192> json;
+    size_t bytes = 0;
+    while (state.keepRunning()) {
+        encodeStroke(stroke, json);
+        bytes = json.size();
+        doNotOptimize(bytes);
+    }
+    state.setItemsProcessed(state.iterations() * kStrokePoints);
+    state.setBytesProcessed(state.iterations() * bytes);
+}
+TALKBOARD_BENCHMARK(BM_Stroke_encodeJsonWriter);
+
+/** Moves `p` past `literal` if the text continues with it. */
+bool expect(const char*& p, const char* end, const char* literal)
+{
+    size_t length = strlen(literal);
+    if ((size_t)(end - p) < length || memcmp(p, literal, length) != 0)
+        return false;
+    p += length;
+    return true;
+}
+
+bool readInteger(const char*& p, const char* end, int64_t& value)
+{
+    bool negative = p < end && *p == '-';
+    if (negative)
+        ++p;
+    if (p == end || *p < '0' || *p > '9')
+        return false;
+    uint64_t magnitude = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        magnitude = magnitude * 10 + (uint64_t)(*p - '0');
+    value = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+    return true;
+}
+
+/** Reads an SNSPath.serialize() document back into points, as a receiving
+ client does. Points from older clients have no "t"; they get t = -1.
+
+ @return false if `json` is not such a document.
+ */
+bool decodeStroke(const char* json, size_t length, int& color, std::vector<StrokePoint>& stroke)
+{
+    const char* p = json;
+    const char* end = json + length;
+    int64_t value;
+    stroke.clear();
+    if (!expect(p, end, "{\"color\":") || !readInteger(p, end, value) || !expect(p, end, ",\"points\":["))
+        return false;
+    color = (int)value;
+    if (expect(p, end, "]}"))
+        return p == end;
+    for (;;) {
+        StrokePoint point;
+        if (!expect(p, end, "{\"x\":") || !readInteger(p, end, value))
+            return false;
+        point.x = (int)value;
+        if (!expect(p, end, ",\"y\":") || !readInteger(p, end, value))
+            return false;
+        point.y = (int)value;
+        point.t = -1;
+        if (expect(p, end, ",\"t\":") && !readInteger(p, end, point.t))
+            return false;
+        if (!expect(p, end, "}"))
+            return false;
+        stroke.push_back(point);
+        if (expect(p, end, "]}"))
+            return p == end;
+        if (!expect(p, end, ","))
+            return false;
+    }
+}
+
+// Every point must come back as encoded, with and without times, and
+// documents cut short or otherwise damaged must be rejected.
+void checkStrokeDecode()
+{
+    std::vector<StrokePoint> stroke = makeStroke(kStrokePoints);
+    for (size_t i = 0; i < stroke.size(); i += 3)
+        stroke[i].t = -1;
+    util::JsonWriter<8192> json;
+    encodeStroke(stroke, json);
+    std::vector<StrokePoint> decoded;
+    int color = 0;
+    bool same = decodeStroke(json.c_str(), json.size(), color, decoded) && color == 1 && decoded.size() == stroke.size();
+    for (size_t i = 0; same && i < stroke.size(); ++i)
+        same = decoded[i].x == stroke[i].x && decoded[i].y == stroke[i].y && decoded[i].t == stroke[i].t;
+    if (!same) {
+        fprintf(stderr, "Stroke: %zu of %zu points decoded\n", decoded.size(), stroke.size());
+        abort();
+    }
+
+    static const char* const kDamaged[] = {
+        "", "{\"color\":1,\"points\":[", "{\"color\":1,\"points\":[{\"x\":1,\"y\":2}",
+        "{\"color\":1,\"points\":[{\"x\":1}]}", "{\"color\":1,\"points\":[{\"x\":1,\"y\":2},]}",
+        "{\"color\":1,\"points\":[{\"x\":a,\"y\":2}]}", "{\"color\":1,\"points\":[]}x",
+    };
+    for (size_t i = 0; i < sizeof(kDamaged) / sizeof(kDamaged[0]); ++i) {
+        if (decodeStroke(kDamaged[i], strlen(kDamaged[i]), color, decoded)) {
+            fprintf(stderr, "Stroke: decoded the damaged document %s\n", kDamaged[i]);
+            abort();
+        }
+    }
+}
+
+// A received stroke: the document parsed back into points.
+void BM_Stroke_decode(State& state)
+{
+    static bool checked = false;
+    if (!checked) {
+        checkStrokeDecode();
+        checked = true;
+    }
+
+    util::JsonWriter<8192> json;
+    encodeStroke(makeStroke(kStrokePoints), json);
+    std::vector<StrokePoint> stroke;
+    int color = 0;
+    int64_t checksum = 0;
+    while (state.keepRunning()) {
+        decodeStroke(json.c_str(), json.size(), color, stroke);
+        checksum += stroke.back().t;
+    }
+    doNotOptimize(checksum);
+    state.setItemsProcessed(state.iterations() * kStrokePoints);
+    state.setBytesProcessed(state.iterations() * json.size());
+}
+TALKBOARD_BENCHMARK(BM_Stroke_decode);
+
+/** An hour of board points at kPointRateHz with 20 ms audio and 66 ms video frames. */
+const media::SessionTimeline& recordedSession()
+{
+    static media::SessionTimeline timeline;
+    if (timeline.count(media::TIMELINE_TRACK_AUDIO) == 0) {
+        uint64_t point = 0;
+        for (int64_t t = 0; t < kSessionMs; t += 1000 / kPointRateHz) {
+            media::TimelineEvent board = { t, media::TIMELINE_TRACK_BOARD, point++, 0 };
+            timeline.append(board);
+        }
+        for (int64_t t = 0; t < kSessionMs; t += 20) {
+            media::TimelineEvent audio = { t, media::TIMELINE_TRACK_AUDIO, (uint64_t)t * 8, 160 };
+            timeline.append(audio);
+        }
+        for (int64_t t = 0; t < kSessionMs; t += 66) {
+            media::TimelineEvent video = { t, media::TIMELINE_TRACK_VIDEO, (uint64_t)t * 100, 4000 };
+            timeline.append(video);
+        }
+    }
+    return timeline;
+}
+
+/** Folds the board points into a checksum, as redrawing the canvas would visit them. */
+class BoardSink : public media::TimelinePlayer::Sink
+{
+public:
+    BoardSink()
+        : events(0)
+        , checksum(0)
+    {}
+
+    uint64_t events;
+    uint64_t checksum;
+
+    virtual void onTimelineEvent(const media::TimelineEvent& event)
+    {
+        ++events;
+        if (event.track == media::TIMELINE_TRACK_BOARD)
+            checksum += event.payload;
+    }
+};
+
+// Playback: one display frame of events at a time.
+void BM_SessionTimeline_playFrame(State& state)
+{
+    const media::SessionTimeline& timeline = recordedSession();
+    media::TimelinePlayer player(timeline);
+    BoardSink sink;
+    int64_t position = 0;
+    while (state.keepRunning()) {
+        position += 16;
+        if (position >= kSessionMs) {
+            position = 0;
+            player.seek(0);
+        }
+        player.advance(position, sink);
+    }
+    doNotOptimize(sink.checksum);
+    state.setItemsProcessed(sink.events ? sink.events : state.iterations());
+}
+TALKBOARD_BENCHMARK(BM_SessionTimeline_playFrame);
+
+// Scrubbing: seek anywhere in the hour and find the strokes to redraw.
+void BM_SessionTimeline_seek(State& state)
+{
+    const media::SessionTimeline& timeline = recordedSession();
+    media::TimelinePlayer player(timeline);
+    uint32_t random = 12345;
+    size_t strokes = 0;
+    while (state.keepRunning()) {
+        random = random * 1664525u + 1013904223u;
+        int64_t target = (int64_t)(random % (uint32_t)kSessionMs);
+        player.seek(target);
+        strokes += timeline.lowerBound(media::TIMELINE_TRACK_BOARD, target);
+    }
+    doNotOptimize(strokes);
+}
+TALKBOARD_BENCHMARK(BM_SessionTimeline_seek);
+
+std::string recordingPath(const char* name)
+{
+    const char* dir = getenv("TMPDIR");
+    std::string path = dir && *dir ? dir : "/tmp";
+    return path + "/" + name;
+}
+
+/** What a recording of the board session accepted, to check its timeline against. */
+struct RecordedSession
+{
+    std::vector<int> audioFrames;
+    std::vector<int> videoFrames;
+    int boardPoints;
+};
+
+/** Records kRecordedMs of 10 ms 48 kHz stereo audio, kRecordedFrameRate video
+ and kPointRateHz board points, as fast as the recorder takes them. The first
+ sample of audio frame i and every luma byte of video frame i encode i. */
+RecordedSession recordBoardSession(media::SessionRecorder& recorder, media::SessionTimeline& timeline)
+{
+    media::SessionRecorderConfig config;
+    config.width = kRecordedWidth;
+    config.height = kRecordedHeight;
+    config.frameRate = kRecordedFrameRate;
+    timeline.clear();
+    recorder.setTimeline(&timeline, media::SessionClock(kRecordingOriginMs));
+    if (recorder.start(recordingPath("talkboard_session.wav").c_str(), recordingPath("talkboard_session.y4m").c_str(),
+                       config) != 0) {
+        fprintf(stderr, "SessionRecorder: cannot record to %s\n", recordingPath("talkboard_session.*").c_str());
+        abort();
+    }
+
+    std::vector<int16_t> pcm(480 * 2);
+    agora::media::IAudioFrameObserver::AudioFrame audio;
+    memset(&audio, 0, sizeof(audio));
+    audio.type = agora::media::IAudioFrameObserver::FRAME_TYPE_PCM16;
+    audio.samples = 480;
+    audio.bytesPerSample = 2;
+    audio.channels = 2;
+    audio.samplesPerSec = 48000;
+    audio.buffer = &pcm[0];
+
+    const int chroma = (kRecordedWidth / 2) * (kRecordedHeight / 2);
+    std::vector<uint8_t> luma(kRecordedWidth * kRecordedHeight);
+    std::vector<uint8_t> u(chroma, 128), v(chroma, 128);
+    agora::media::IVideoFrameObserver::VideoFrame video;
+    memset(&video, 0, sizeof(video));
+    video.type = agora::media::IVideoFrameObserver::FRAME_TYPE_YUV420;
+    video.width = kRecordedWidth;
+    video.height = kRecordedHeight;
+    video.yStride = kRecordedWidth;
+    video.uStride = video.vStride = kRecordedWidth / 2;
+    video.yBuffer = &luma[0];
+    video.uBuffer = &u[0];
+    video.vBuffer = &v[0];
+
+    RecordedSession session;
+    session.boardPoints = 0;
+    int videoFrame = 0;
+    for (int64_t t = 0; t < kRecordedMs; t += 10) {
+        int audioFrame = (int)(t / 10);
+        pcm[0] = (int16_t)audioFrame;
+        audio.renderTimeMs = kRecordingOriginMs + t;
+        if (recorder.writeAudio(audio) == 0)
+            session.audioFrames.push_back(audioFrame);
+        if (t >= (int64_t)videoFrame * 1000 / kRecordedFrameRate) {
+            memset(&luma[0], videoFrame & 0xff, luma.size());
+            video.renderTimeMs = kRecordingOriginMs + t;
+            if (recorder.writeVideo(video) == 0)
+                session.videoFrames.push_back(videoFrame);
+            ++videoFrame;
+        }
+        while ((int64_t)session.boardPoints * 1000 / kPointRateHz <= t) {
+            int64_t boardMs = kRecordingOriginMs + (int64_t)session.boardPoints * 1000 / kPointRateHz;
+            if (recorder.writeBoardEvent(boardMs, session.boardPoints) != 0) {
+                fprintf(stderr, "SessionRecorder: board point %d dropped\n", session.boardPoints);
+                abort();
+            }
+            ++session.boardPoints;
+        }
+    }
+    if (recorder.stop() != 0) {
+        fprintf(stderr, "SessionRecorder: recording failed with errno %d\n", recorder.stats().ioError);
+        abort();
+    }
+    return session;
+}
+
+void failTimeline(const char* what, int track, size_t index)
+{
+    fprintf(stderr, "SessionRecorder: %s, track %d event %zu\n", what, track, index);
+    abort();
+}
+
+// Every accepted frame and board point must be in the timeline at its
+// session time, and the audio and video entries must point at the frame in
+// the file.
+void checkRecordedTimeline(const RecordedSession& session, const media::SessionTimeline& timeline)
+{
+    if (timeline.count(media::TIMELINE_TRACK_AUDIO) != session.audioFrames.size()
+        || timeline.count(media::TIMELINE_TRACK_VIDEO) != session.videoFrames.size()
+        || timeline.count(media::TIMELINE_TRACK_BOARD) != (size_t)session.boardPoints) {
+        fprintf(stderr, "SessionRecorder: timeline has %zu/%zu/%zu events for %zu/%zu/%d recorded\n",
+                timeline.count(media::TIMELINE_TRACK_AUDIO), timeline.count(media::TIMELINE_TRACK_VIDEO),
+                timeline.count(media::TIMELINE_TRACK_BOARD), session.audioFrames.size(), session.videoFrames.size(),
+                session.boardPoints);
+        abort();
+    }
+
+    int fd = open(recordingPath("talkboard_session.wav").c_str(), O_RDONLY);
+    for (size_t i = 0; i < session.audioFrames.size(); ++i) {
+        const media::TimelineEvent& event = timeline.at(media::TIMELINE_TRACK_AUDIO, i);
+        int16_t first = -1;
+        if (event.timeMs != session.audioFrames[i] * 10 || event.size != 480 * 2 * 2)
+            failTimeline("wrong audio time or size", event.track, i);
+        if (pread(fd, &first, sizeof(first), (off_t)event.payload) != sizeof(first)
+            || first != (int16_t)session.audioFrames[i])
+            failTimeline("audio offset does not point at the frame", event.track, i);
+    }
+    close(fd);
+
+    fd = open(recordingPath("talkboard_session.y4m").c_str(), O_RDONLY);
+    for (size_t i = 0; i < session.videoFrames.size(); ++i) {
+        const media::TimelineEvent& event = timeline.at(media::TIMELINE_TRACK_VIDEO, i);
+        char frame[7] = { 0 };
+        int64_t expectedMs = ((int64_t)session.videoFrames[i] * 1000 / kRecordedFrameRate + 9) / 10 * 10;
+        if (event.timeMs != expectedMs)
+            failTimeline("wrong video time", event.track, i);
+        if (pread(fd, frame, sizeof(frame), (off_t)event.payload) != sizeof(frame) || memcmp(frame, "FRAME\n", 6)
+            || (uint8_t)frame[6] != (session.videoFrames[i] & 0xff))
+            failTimeline("video offset does not point at the frame", event.track, i);
+    }
+    close(fd);
+
+    for (int i = 0; i < session.boardPoints; ++i) {
+        const media::TimelineEvent& event = timeline.at(media::TIMELINE_TRACK_BOARD, i);
+        if (event.payload != (uint64_t)i || event.timeMs != (int64_t)i * 1000 / kPointRateHz)
+            failTimeline("wrong board point", event.track, i);
+    }
+
+    media::TimelinePlayer player(timeline);
+    media::TimelineEvent event;
+    int64_t last = 0;
+    size_t played = 0;
+    while (player.next(kRecordedMs, event)) {
+        if (event.timeMs < last)
+            failTimeline("played out of order", event.track, played);
+        last = event.timeMs;
+        ++played;
+    }
+    if (played != session.audioFrames.size() + session.videoFrames.size() + session.boardPoints)
+        failTimeline("not every event played", -1, played);
+}
+
+// Ten seconds of a board session recorded with its timeline: audio, video
+// and board points indexed as they are written.
+void BM_SessionRecorder_boardSession10s(State& state)
+{
+    media::SessionRecorder recorder;
+    media::SessionTimeline timeline;
+    static bool checked = false;
+    if (!checked) {
+        checkRecordedTimeline(recordBoardSession(recorder, timeline), timeline);
+        checked = true;
+    }
+    size_t events = 0;
+    while (state.keepRunning()) {
+        RecordedSession session = recordBoardSession(recorder, timeline);
+        events += session.audioFrames.size() + session.videoFrames.size() + session.boardPoints;
+    }
+    if (recorder.stats().droppedTimelineEvents) {
+        fprintf(stderr, "SessionRecorder: %llu timeline events dropped\n",
+                (unsigned long long)recorder.stats().droppedTimelineEvents);
+        abort();
+    }
+    state.setItemsProcessed(events);
+}
+TALKBOARD_BENCHMARK(BM_SessionRecorder_boardSession10s);
+
+} // namespace
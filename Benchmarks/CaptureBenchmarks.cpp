@@ -0,0 +1,260 @@
+//
+//  TalkBoard Benchmarks
+//
+//  Packet capture: cost on the packet callback, and replay into the fake engine.
+//
+
+#include "Benchmark.h"
+#include "FakeEngine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PacketCapture.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+const size_t kVideoPacketBytes = 1200;
+/** The capture queue's default size. */
+const size_t kQueueRecords = 2048;
+/** The SDK delivers packets in bursts about this far apart. */
+const int kBurstMs = 10;
+/** Packets in one burst of a 9-user 720p room: nine video streams of about
+ 1.2 Mbit/s and nine audio streams, some 1600 packets a second. */
+const int kPacketsPerBurst = 16;
+/** Records in the file replayed by the replay benchmarks. */
+const int kReplayPackets = 2000;
+/** One board message every this many packets. */
+const int kPacketsPerMessage = 20;
+
+std::string capturePath()
+{
+    const char* dir = getenv("TMPDIR");
+    std::string path = dir && *dir ? dir : "/tmp";
+    return path + "/talkboard_capture_bench.tbpcap";
+}
+
+std::vector<unsigned char> makePacket(size_t size)
+{
+    std::vector<unsigned char> packet(size);
+    for (size_t i = 0; i < size; ++i)
+        packet[i] = (unsigned char)(i * 13 + 5);
+    return packet;
+}
+
+/** Stands in for the next observer in the chain, e.g. PacketCrypto. */
+class PassThroughObserver : public agora::rtc::IPacketObserver
+{
+public:
+    PassThroughObserver()
+        : bytes(0)
+    {}
+
+    uint64_t bytes;
+
+    virtual bool onSendAudioPacket(Packet& packet) { return count(packet); }
+    virtual bool onSendVideoPacket(Packet& packet) { return count(packet); }
+    virtual bool onReceiveAudioPacket(Packet& packet) { return count(packet); }
+    virtual bool onReceiveVideoPacket(Packet& packet) { return count(packet); }
+
+private:
+    bool count(const Packet& packet)
+    {
+        bytes += packet.size + packet.buffer[0];
+        return true;
+    }
+};
+
+class MessageHandler : public agora::rtc::IRtcEngineEventHandler
+{
+public:
+    MessageHandler()
+        : bytes(0)
+    {}
+
+    uint64_t bytes;
+
+    virtual void onStreamMessage(agora::rtc::uid_t, int, const char*, size_t length) { bytes += length; }
+};
+
+void startCapture(rtc::PacketCapture& capture)
+{
+    if (capture.start(capturePath().c_str()) != 0) {
+        fprintf(stderr, "cannot create %s\n", capturePath().c_str());
+        abort();
+    }
+}
+
+void checkNoDrops(const rtc::PacketCapture& capture, const char* what)
+{
+    if (capture.dropped()) {
+        fprintf(stderr, "PacketCapture: %s dropped %llu of %llu records\n", what,
+                (unsigned long long)capture.dropped(), (unsigned long long)(capture.dropped() + capture.captured()));
+        abort();
+    }
+}
+
+// One second of the room in real time must fit the default queue without a
+// drop, and a packet over MAX_DATA must come back cut, flagged and counted.
+void checkCapture()
+{
+    PassThroughObserver observer;
+    rtc::PacketCapture capture(kQueueRecords);
+    capture.setObserver(&observer);
+    std::vector<unsigned char> packet = makePacket(kVideoPacketBytes);
+    startCapture(capture);
+    const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int burst = 0; burst < 1000 / kBurstMs; ++burst) {
+        std::this_thread::sleep_until(begin + std::chrono::milliseconds(burst * kBurstMs));
+        for (int i = 0; i < kPacketsPerBurst; ++i) {
+            agora::rtc::IPacketObserver::Packet p = { &packet[0], (unsigned int)packet.size() };
+            capture.onReceiveVideoPacket(p);
+        }
+    }
+    capture.stop();
+    checkNoDrops(capture, "a paced second");
+    if (capture.captured() != (uint64_t)(1000 / kBurstMs * kPacketsPerBurst) || capture.truncated()) {
+        fprintf(stderr, "PacketCapture: a paced second captured %llu records, %llu cut\n",
+                (unsigned long long)capture.captured(), (unsigned long long)capture.truncated());
+        abort();
+    }
+
+    std::vector<unsigned char> jumbo = makePacket(rtc::CaptureRecord::MAX_DATA + 500);
+    startCapture(capture);
+    agora::rtc::IPacketObserver::Packet p = { &jumbo[0], (unsigned int)jumbo.size() };
+    capture.onReceiveVideoPacket(p);
+    capture.stop();
+    rtc::PacketReplay replay;
+    rtc::CaptureRecord record;
+    if (capture.truncated() != 1 || replay.open(capturePath().c_str()) != 0 || replay.next(record) != 1
+        || record.length != jumbo.size() || record.size != rtc::CaptureRecord::MAX_DATA
+        || memcmp(record.data, &jumbo[0], record.size) != 0) {
+        fprintf(stderr, "PacketCapture: a %zu-byte packet was not cut to %d bytes and flagged\n", jumbo.size(),
+                (int)rtc::CaptureRecord::MAX_DATA);
+        abort();
+    }
+}
+
+// Baseline: the chained observer called directly by the SDK.
+void BM_PacketObserver_direct1200(State& state)
+{
+    PassThroughObserver observer;
+    std::vector<unsigned char> packet = makePacket(kVideoPacketBytes);
+    while (state.keepRunning()) {
+        agora::rtc::IPacketObserver::Packet p = { &packet[0], (unsigned int)packet.size() };
+        observer.onSendVideoPacket(p);
+    }
+    doNotOptimize(observer.bytes);
+    state.setBytesProcessed(state.iterations() * kVideoPacketBytes);
+}
+TALKBOARD_BENCHMARK(BM_PacketObserver_direct1200);
+
+// PacketCapture registered but not recording.
+void BM_PacketCapture_idle1200(State& state)
+{
+    PassThroughObserver observer;
+    rtc::PacketCapture capture(kQueueRecords);
+    capture.setObserver(&observer);
+    std::vector<unsigned char> packet = makePacket(kVideoPacketBytes);
+    while (state.keepRunning()) {
+        agora::rtc::IPacketObserver::Packet p = { &packet[0], (unsigned int)packet.size() };
+        capture.onSendVideoPacket(p);
+    }
+    doNotOptimize(observer.bytes);
+    state.setBytesProcessed(state.iterations() * kVideoPacketBytes);
+}
+TALKBOARD_BENCHMARK(BM_PacketCapture_idle1200);
+
+// Recording in the room's bursts of packets, with the writer running. The
+// SDK thread gives up the CPU between bursts, untimed; checkCapture() runs
+// the bursts 10 ms apart in real time, which a timed loop cannot.
+void BM_PacketCapture_record1200(State& state)
+{
+    static bool checked = false;
+    if (!checked) {
+        checkCapture();
+        checked = true;
+    }
+
+    PassThroughObserver observer;
+    rtc::PacketCapture capture(kQueueRecords);
+    capture.setObserver(&observer);
+    std::vector<unsigned char> packet = makePacket(kVideoPacketBytes);
+    // A first capture touches every slot, so the measured one does not pay
+    // for faulting in the queue.
+    for (int pass = 0; pass < 2; ++pass) {
+        startCapture(capture);
+        for (size_t i = 0; pass == 0 && i < kQueueRecords; ++i) {
+            agora::rtc::IPacketObserver::Packet p = { &packet[0], (unsigned int)packet.size() };
+            capture.onSendVideoPacket(p);
+        }
+        if (pass == 0)
+            capture.stop();
+    }
+    int inBurst = 0;
+    while (state.keepRunning()) {
+        agora::rtc::IPacketObserver::Packet p = { &packet[0], (unsigned int)packet.size() };
+        capture.onSendVideoPacket(p);
+        if (++inBurst == kPacketsPerBurst) {
+            state.pauseTiming();
+            std::this_thread::yield();
+            state.resumeTiming();
+            inBurst = 0;
+        }
+    }
+    capture.stop();
+    checkNoDrops(capture, "recording");
+    doNotOptimize(observer.bytes);
+    state.setBytesProcessed(state.iterations() * kVideoPacketBytes);
+}
+TALKBOARD_BENCHMARK(BM_PacketCapture_record1200);
+
+void writeReplayFile()
+{
+    rtc::PacketCapture capture(kReplayPackets * 2);
+    startCapture(capture);
+    std::vector<unsigned char> packet = makePacket(kVideoPacketBytes);
+    const char message[] = "{\"type\":\"stroke\",\"points\":[12,34,56,78]}";
+    for (int i = 0; i < kReplayPackets; ++i) {
+        agora::rtc::IPacketObserver::Packet p = { &packet[0], (unsigned int)packet.size() };
+        capture.onReceiveVideoPacket(p);
+        if (i % kPacketsPerMessage == 0)
+            capture.captureStreamMessage(1000 + i % 4, 1, message, sizeof(message) - 1);
+    }
+    capture.stop();
+}
+
+// Replay as fast as possible into the observer and handler registered with the engine.
+void BM_PacketReplay_loopback(State& state)
+{
+    writeReplayFile();
+    FakeRtcEngine engine;
+    PassThroughObserver observer;
+    MessageHandler handler;
+    engine.registerPacketObserver(&observer);
+    engine.registerEventHandler(&handler);
+    rtc::PacketReplay replay;
+    int delivered = 0;
+    while (state.keepRunning()) {
+        replay.open(capturePath().c_str());
+        delivered = replay.run(engine.packetObserver, engine.handler, 0);
+    }
+    if (delivered != kReplayPackets + kReplayPackets / kPacketsPerMessage) {
+        fprintf(stderr, "replay delivered %d records\n", delivered);
+        abort();
+    }
+    doNotOptimize(observer.bytes);
+    doNotOptimize(handler.bytes);
+    state.setItemsProcessed(state.iterations() * delivered);
+}
+TALKBOARD_BENCHMARK(BM_PacketReplay_loopback);
+
+} // namespace
@@ -0,0 +1,168 @@
+//
+//  TalkBoard Benchmarks
+//
+//  Packet encryption: ChaCha20 on MTU-sized video packets and small audio packets.
+//
+
+#include "Benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "BufferPool.h"
+#include "ChaCha20.h"
+#include "PacketCrypto.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+/** A full video packet; the budget is 2 us per packet at this size. */
+const size_t kVideoPacketBytes = 1200;
+/** An Opus packet at about 48 kbps, 20 ms. */
+const size_t kAudioPacketBytes = 120;
+
+const unsigned char kKey[rtc::PacketCrypto::KEY_SIZE] = {
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+};
+
+/** The key kKey is rotated to and back in the rekeying check. */
+const unsigned char kNextKey[rtc::PacketCrypto::KEY_SIZE] = {
+    0x1f, 0x1e, 0x1d, 0x1c, 0x1b, 0x1a, 0x19, 0x18, 0x17, 0x16, 0x15, 0x14, 0x13, 0x12, 0x11, 0x10,
+    0x0f, 0x0e, 0x0d, 0x0c, 0x0b, 0x0a, 0x09, 0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00,
+};
+/** Key rotations while the sender thread runs. */
+const int kRekeys = 2000;
+
+std::vector<unsigned char> makePacket(size_t size)
+{
+    std::vector<unsigned char> packet(size);
+    for (size_t i = 0; i < size; ++i)
+        packet[i] = (unsigned char)(i * 13 + 5);
+    return packet;
+}
+
+// The cipher alone, in place.
+void BM_ChaCha20_1200(State& state)
+{
+    if (!util::ChaCha20::selfTest()) {
+        fprintf(stderr, "ChaCha20 known-answer test failed\n");
+        abort();
+    }
+    util::ChaCha20 cipher(kKey);
+    std::vector<unsigned char> packet = makePacket(kVideoPacketBytes);
+    unsigned char nonce[util::ChaCha20::NONCE_SIZE] = { 0 };
+    while (state.keepRunning()) {
+        ++nonce[0];
+        cipher.process(nonce, 1, &packet[0], &packet[0], packet.size());
+    }
+    doNotOptimize(packet);
+    state.setBytesProcessed(state.iterations() * kVideoPacketBytes);
+}
+TALKBOARD_BENCHMARK(BM_ChaCha20_1200);
+
+// onSendVideoPacket: nonce, pooled buffer, encryption.
+void BM_PacketCrypto_sendVideo1200(State& state)
+{
+    util::BufferPool pool;
+    rtc::PacketCrypto crypto(pool);
+    crypto.setKey(kKey, sizeof(kKey));
+    std::vector<unsigned char> packet = makePacket(kVideoPacketBytes);
+    unsigned int sent = 0;
+    while (state.keepRunning()) {
+        agora::rtc::IPacketObserver::Packet p = { &packet[0], (unsigned int)packet.size() };
+        crypto.onSendVideoPacket(p);
+        sent += p.size;
+    }
+    doNotOptimize(sent);
+    state.setBytesProcessed(state.iterations() * kVideoPacketBytes);
+}
+TALKBOARD_BENCHMARK(BM_PacketCrypto_sendVideo1200);
+
+// onReceiveVideoPacket of what the sender produced.
+void BM_PacketCrypto_receiveVideo1200(State& state)
+{
+    util::BufferPool pool;
+    rtc::PacketCrypto crypto(pool);
+    crypto.setKey(kKey, sizeof(kKey));
+    std::vector<unsigned char> plain = makePacket(kVideoPacketBytes);
+    std::vector<unsigned char> packet(kVideoPacketBytes + rtc::PacketCrypto::OVERHEAD);
+    crypto.encrypt(&plain[0], plain.size(), &packet[0]);
+    unsigned int received = 0;
+    while (state.keepRunning()) {
+        agora::rtc::IPacketObserver::Packet p = { &packet[0], (unsigned int)packet.size() };
+        crypto.onReceiveVideoPacket(p);
+        received += p.size;
+    }
+    doNotOptimize(received);
+    state.setBytesProcessed(state.iterations() * kVideoPacketBytes);
+}
+TALKBOARD_BENCHMARK(BM_PacketCrypto_receiveVideo1200);
+
+// Packets sent while the key is being replaced must each be encrypted with
+// the whole old key or the whole new one: decrypting with one of them must
+// give the packet back.
+void checkRekeyWhileSending()
+{
+    util::BufferPool pool;
+    rtc::PacketCrypto crypto(pool);
+    crypto.setKey(kKey, sizeof(kKey));
+    std::atomic<bool> stop(false);
+    std::thread sender([&crypto, &stop]() {
+        const util::ChaCha20 oldKey(kKey);
+        const util::ChaCha20 newKey(kNextKey);
+        const util::ChaCha20* keys[2] = { &oldKey, &newKey };
+        std::vector<unsigned char> plain = makePacket(kAudioPacketBytes);
+        std::vector<unsigned char> decrypted(kAudioPacketBytes);
+        while (!stop.load(std::memory_order_relaxed)) {
+            agora::rtc::IPacketObserver::Packet p = { &plain[0], (unsigned int)plain.size() };
+            crypto.onSendAudioPacket(p);
+            int k = 0;
+            for (; k < 2; ++k) {
+                keys[k]->process(p.buffer, 1, p.buffer + rtc::PacketCrypto::OVERHEAD, &decrypted[0], decrypted.size());
+                if (decrypted == plain)
+                    break;
+            }
+            if (k == 2) {
+                fprintf(stderr, "PacketCrypto: a packet sent during setKey() matches neither key\n");
+                abort();
+            }
+        }
+    });
+    for (int i = 0; i < kRekeys; ++i)
+        crypto.setKey(i & 1 ? kKey : kNextKey, sizeof(kKey));
+    stop.store(true, std::memory_order_relaxed);
+    sender.join();
+}
+
+// The smallest packets, where fetching the key weighs the most.
+void BM_PacketCrypto_sendAudio120(State& state)
+{
+    static bool checked = false;
+    if (!checked) {
+        checkRekeyWhileSending();
+        checked = true;
+    }
+
+    util::BufferPool pool;
+    rtc::PacketCrypto crypto(pool);
+    crypto.setKey(kKey, sizeof(kKey));
+    std::vector<unsigned char> packet = makePacket(kAudioPacketBytes);
+    unsigned int sent = 0;
+    while (state.keepRunning()) {
+        agora::rtc::IPacketObserver::Packet p = { &packet[0], (unsigned int)packet.size() };
+        crypto.onSendAudioPacket(p);
+        sent += p.size;
+    }
+    doNotOptimize(sent);
+    state.setBytesProcessed(state.iterations() * kAudioPacketBytes);
+}
+TALKBOARD_BENCHMARK(BM_PacketCrypto_sendAudio120);
+
+} // namespace
@@ -0,0 +1,269 @@
+//
+//  TalkBoard Benchmarks
+//
+//  IRtcEngineEventHandler delivery: direct calls and the event queue, alone
+//  and in a simulated 50-user room.
+//
+
+#include "Benchmark.h"
+#include "FakeEngine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "EngineEventQueue.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+/** Events posted between two drains, about one display frame of a busy room. */
+const int kEventsPerDrain = 64;
+const int kRemoteUids = 16;
+
+/** The simulated room of the stats delivery benchmarks: 50 remote users, of
+ whom kChurnPerSecond leave and are replaced every second. */
+const int kRoomUsers = 50;
+const int kChurnPerSecond = 5;
+const int kFramesPerSecond = 60;
+/** Per-uid stats arrive three times a second, volume indications five. */
+const int kStatsIntervalFrames = kFramesPerSecond / 3;
+const int kVolumeIntervalFrames = kFramesPerSecond / 5;
+
+/** Counts callbacks and touches their arguments like a UI handler would. */
+class CountingHandler : public agora::rtc::IRtcEngineEventHandler
+{
+public:
+    CountingHandler()
+        : events(0)
+        , checksum(0)
+    {}
+
+    uint64_t events;
+    uint64_t checksum;
+
+    virtual void onRemoteVideoStats(const agora::rtc::RemoteVideoStats& stats)
+    {
+        ++events;
+        checksum += stats.uid + stats.receivedBitrate;
+    }
+    virtual void onNetworkQuality(agora::rtc::uid_t uid, int txQuality, int rxQuality)
+    {
+        ++events;
+        checksum += uid + txQuality + rxQuality;
+    }
+    virtual void onRtcStats(const agora::rtc::RtcStats& stats)
+    {
+        ++events;
+        checksum += stats.rxKBitRate;
+    }
+    virtual void onStreamMessage(agora::rtc::uid_t uid, int streamId, const char* data, size_t length)
+    {
+        ++events;
+        checksum += uid + streamId + (length ? (unsigned char)data[0] : 0);
+    }
+};
+
+agora::rtc::RemoteVideoStats remoteVideoStats(int i)
+{
+    agora::rtc::RemoteVideoStats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.uid = 1000 + i % kRemoteUids;
+    stats.width = 640;
+    stats.height = 360;
+    stats.receivedBitrate = 400 + i;
+    stats.receivedFrameRate = 15;
+    stats.rxStreamType = agora::rtc::REMOTE_VIDEO_STREAM_LOW;
+    return stats;
+}
+
+/** The mix of callbacks the SDK sends: mostly stats, some network quality and board messages. */
+void postEvents(agora::rtc::IRtcEngineEventHandler& handler, int round)
+{
+    static const char kMessage[] = "{\"x\":412,\"y\":233,\"t\":1832}";
+    for (int i = 0; i < kEventsPerDrain; ++i) {
+        int n = round * kEventsPerDrain + i;
+        switch (i & 3) {
+        case 0:
+        case 1:
+            handler.onRemoteVideoStats(remoteVideoStats(n));
+            break;
+        case 2:
+            handler.onNetworkQuality(1000 + n % kRemoteUids, agora::rtc::QUALITY_GOOD, agora::rtc::QUALITY_EXCELLENT);
+            break;
+        default:
+            handler.onStreamMessage(1000 + n % kRemoteUids, 1, kMessage, sizeof(kMessage) - 1);
+            break;
+        }
+    }
+}
+
+// Baseline: the SDK calling the application's handler directly.
+void BM_EventHandler_direct(State& state)
+{
+    FakeRtcEngine engine;
+    CountingHandler handler;
+    engine.registerEventHandler(&handler);
+    int round = 0;
+    while (state.keepRunning())
+        postEvents(*engine.handler, round++);
+    doNotOptimize(handler.checksum);
+    state.setItemsProcessed(state.iterations() * kEventsPerDrain);
+}
+TALKBOARD_BENCHMARK(BM_EventHandler_direct);
+
+// Callbacks copied into the queue on the SDK side, replayed by drain().
+void BM_EngineEventQueue_postDrain(State& state)
+{
+    FakeRtcEngine engine;
+    rtc::EngineEventQueue queue(1024);
+    CountingHandler handler;
+    engine.registerEventHandler(&queue);
+    int round = 0;
+    while (state.keepRunning()) {
+        postEvents(*engine.handler, round++);
+        queue.drain(handler);
+    }
+    doNotOptimize(handler.checksum);
+    state.setItemsProcessed(state.iterations() * kEventsPerDrain);
+}
+TALKBOARD_BENCHMARK(BM_EngineEventQueue_postDrain);
+
+/** Takes the stats of the simulated room like the room's UI would. */
+class RoomHandler : public agora::rtc::IRtcEngineEventHandler
+{
+public:
+    RoomHandler()
+        : events(0)
+        , checksum(0)
+    {}
+
+    uint64_t events;
+    uint64_t checksum;
+
+    virtual void onRtcStats(const agora::rtc::RtcStats& stats)
+    {
+        ++events;
+        checksum += stats.rxKBitRate;
+    }
+    virtual void onAudioVolumeIndication(const agora::rtc::AudioVolumeInfo* speakers, unsigned int speakerNumber, int)
+    {
+        ++events;
+        for (unsigned int i = 0; i < speakerNumber; ++i)
+            checksum += speakers[i].uid + speakers[i].volume;
+    }
+    virtual void onNetworkQuality(agora::rtc::uid_t uid, int txQuality, int rxQuality)
+    {
+        ++events;
+        checksum += uid + txQuality + rxQuality;
+    }
+    virtual void onRemoteVideoStats(const agora::rtc::RemoteVideoStats& stats)
+    {
+        ++events;
+        checksum += stats.uid + stats.receivedBitrate;
+    }
+    virtual void onRemoteVideoTransportStats(agora::rtc::uid_t uid, unsigned short delay, unsigned short, unsigned short)
+    {
+        ++events;
+        checksum += uid + delay;
+    }
+};
+
+/** The SDK side of the simulated room: which uids are in it and what it reports each frame. */
+class SimulatedRoom
+{
+public:
+    explicit SimulatedRoom(agora::rtc::IRtcEngineEventHandler& sdkSide)
+        : m_sdkSide(sdkSide)
+        , m_nextUid(1000)
+        , m_frame(0)
+    {
+        for (int i = 0; i < kRoomUsers; ++i)
+            m_uids.push_back(join());
+    }
+
+    /** Posts one display frame of callbacks. */
+    void postFrame()
+    {
+        int frame = m_frame++ % kFramesPerSecond;
+        if (frame == 0) {
+            agora::rtc::RtcStats stats;
+            memset(&stats, 0, sizeof(stats));
+            stats.rxKBitRate = 2400;
+            m_sdkSide.onRtcStats(stats);
+        }
+        if (frame % kVolumeIntervalFrames == 0) {
+            agora::rtc::AudioVolumeInfo speakers[kRoomUsers];
+            for (int i = 0; i < kRoomUsers; ++i) {
+                speakers[i].uid = m_uids[i];
+                speakers[i].volume = (unsigned int)(m_frame + i) % 256;
+            }
+            m_sdkSide.onAudioVolumeIndication(speakers, kRoomUsers, 128);
+        }
+        // Each uid reports on its own phase, as the SDK spreads them out.
+        for (int i = frame % kStatsIntervalFrames; i < kRoomUsers; i += kStatsIntervalFrames) {
+            agora::rtc::uid_t uid = m_uids[i];
+            agora::rtc::RemoteVideoStats stats;
+            memset(&stats, 0, sizeof(stats));
+            stats.uid = uid;
+            stats.receivedBitrate = 300 + m_frame % 100;
+            m_sdkSide.onRemoteVideoStats(stats);
+            m_sdkSide.onNetworkQuality(uid, agora::rtc::QUALITY_GOOD, agora::rtc::QUALITY_GOOD);
+            m_sdkSide.onRemoteVideoTransportStats(uid, 40, 0, 300);
+        }
+        if (frame == kFramesPerSecond / 2) {
+            for (int c = 0; c < kChurnPerSecond; ++c) {
+                int i = (m_frame / kFramesPerSecond * kChurnPerSecond + c) % kRoomUsers;
+                m_sdkSide.onUserOffline(m_uids[i], agora::rtc::USER_OFFLINE_QUIT);
+                m_uids[i] = join();
+            }
+        }
+    }
+
+private:
+    agora::rtc::uid_t join()
+    {
+        agora::rtc::uid_t uid = m_nextUid++;
+        m_sdkSide.onUserJoined(uid, 0);
+        return uid;
+    }
+
+    agora::rtc::IRtcEngineEventHandler& m_sdkSide;
+    std::vector<agora::rtc::uid_t> m_uids;
+    agora::rtc::uid_t m_nextUid;
+    int m_frame;
+};
+
+/** One simulated second: the SDK side untimed, the main thread's drain timed. */
+void deliverSecond(SimulatedRoom& room, rtc::EngineEventQueue& queue, RoomHandler& handler, State& state)
+{
+    for (int frame = 0; frame < kFramesPerSecond; ++frame) {
+        state.pauseTiming();
+        room.postFrame();
+        state.resumeTiming();
+        queue.drain(handler);
+    }
+}
+
+// Main-thread time per simulated second of a 50-user room, with every
+// callback going through the queue.
+void BM_StatsDelivery_queue50(State& state)
+{
+    rtc::EngineEventQueue queue(4096);
+    RoomHandler handler;
+    SimulatedRoom room(queue);
+    queue.drain(handler);
+    while (state.keepRunning())
+        deliverSecond(room, queue, handler, state);
+    if (queue.dropped()) {
+        fprintf(stderr, "EngineEventQueue: %llu events dropped\n", (unsigned long long)queue.dropped());
+        abort();
+    }
+    doNotOptimize(handler.checksum);
+}
+TALKBOARD_BENCHMARK(BM_StatsDelivery_queue50);
+
+} // namespace
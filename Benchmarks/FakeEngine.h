@@ -0,0 +1,250 @@
+//
+//  TalkBoard Benchmarks
+//
+//  In-process stand-ins for IRtcEngine, IRtcEngineParameter and IMediaEngine.
+//
+
+#ifndef TALKBOARD_FAKE_ENGINE_H
+#define TALKBOARD_FAKE_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+#include <AgoraRtcEngineKit/IAgoraMediaEngine.h>
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+namespace talkboard {
+namespace bench {
+
+/** An IString on the heap, as the SDK returns them; release() deletes it. */
+class FakeString final : public agora::util::IString
+{
+public:
+    FakeString(const std::string& text, uint64_t& live)
+        : m_text(text)
+        , m_live(live)
+    {
+        ++m_live;
+    }
+
+    virtual bool empty() const { return m_text.empty(); }
+    virtual const char* c_str() { return m_text.c_str(); }
+    virtual const char* data() { return m_text.data(); }
+    virtual size_t length() { return m_text.size(); }
+    virtual void release()
+    {
+        --m_live;
+        delete this;
+    }
+
+private:
+    std::string m_text;
+    uint64_t& m_live;
+};
+
+/** Accepts every parameter and reads each string once, the least the SDK
+ does with it, so the benchmarks measure the caller's side. The string
+ getters return `text` for every key.
+ */
+class FakeParameter : public agora::rtc::IRtcEngineParameter
+{
+public:
+    FakeParameter()
+        : calls(0)
+        , bytes(0)
+        , liveStrings(0)
+    {}
+
+    /** Setter calls and string bytes received so far. */
+    uint64_t calls;
+    uint64_t bytes;
+    std::string text;
+    /** IStrings returned and not released yet. */
+    uint64_t liveStrings;
+
+    virtual void release() {}
+
+    virtual int setBool(const char* key, bool) { return take(key); }
+    virtual int setInt(const char* key, int) { return take(key); }
+    virtual int setUInt(const char* key, unsigned int) { return take(key); }
+    virtual int setNumber(const char* key, double) { return take(key); }
+    virtual int setString(const char* key, const char* value) { return take(key, value); }
+    virtual int setObject(const char* key, const char* value) { return take(key, value); }
+    virtual int getBool(const char*, bool& value) { value = false; return 0; }
+    virtual int getInt(const char*, int& value) { value = 0; return 0; }
+    virtual int getUInt(const char*, unsigned int& value) { value = 0; return 0; }
+    virtual int getNumber(const char*, double& value) { value = 0; return 0; }
+    virtual int getString(const char*, agora::util::AString& value) { return get(value); }
+    virtual int getObject(const char*, agora::util::AString& value) { return get(value); }
+    virtual int getArray(const char*, agora::util::AString& value) { return get(value); }
+    virtual int setParameters(const char* parameters) { return take(parameters); }
+    virtual int setProfile(const char* profile, bool) { return take(profile); }
+    virtual int convertPath(const char*, agora::util::AString&) { return -agora::ERR_NOT_SUPPORTED; }
+
+private:
+    int take(const char* key, const char* value = NULL)
+    {
+        ++calls;
+        bytes += strlen(key) + (value ? strlen(value) : 0);
+        return 0;
+    }
+
+    int get(agora::util::AString& value)
+    {
+        value.reset(new FakeString(text, liveStrings));
+        return 0;
+    }
+};
+
+/** Keeps the registered frame observers, which benchmarks drive in place
+ of the SDK's media threads, and counts pushed audio.
+ */
+class FakeMediaEngine : public agora::media::IMediaEngine
+{
+public:
+    FakeMediaEngine()
+        : audioObserver(NULL)
+        , videoObserver(NULL)
+        , pushedFrames(0)
+        , pushedSamples(0)
+    {}
+
+    agora::media::IAudioFrameObserver* audioObserver;
+    agora::media::IVideoFrameObserver* videoObserver;
+    uint64_t pushedFrames;
+    uint64_t pushedSamples;
+
+    virtual void release() {}
+    virtual int registerAudioFrameObserver(agora::media::IAudioFrameObserver* observer)
+    {
+        audioObserver = observer;
+        return 0;
+    }
+    virtual int registerVideoFrameObserver(agora::media::IVideoFrameObserver* observer)
+    {
+        videoObserver = observer;
+        return 0;
+    }
+    virtual int registerVideoRenderFactory(agora::media::IExternalVideoRenderFactory*) { return 0; }
+    virtual int pushAudioFrame(agora::media::MEDIA_SOURCE_TYPE, agora::media::IAudioFrameObserver::AudioFrame* frame,
+                               bool)
+    {
+        ++pushedFrames;
+        pushedSamples += frame->samples;
+        return 0;
+    }
+};
+
+/** An IRtcEngine whose only working parts are queryInterface() for the
+ parameter and media engine interfaces, which is all RtcEngineParameters
+ and the engine layer need, and the registered event handler and packet
+ observer, which PacketReplay drives in place of the network.
+ */
+class FakeRtcEngine : public agora::rtc::IRtcEngine
+{
+public:
+    FakeRtcEngine()
+        : handler(NULL)
+        , packetObserver(NULL)
+    {}
+
+    FakeParameter parameter;
+    FakeMediaEngine media;
+    agora::rtc::IRtcEngineEventHandler* handler;
+    agora::rtc::IPacketObserver* packetObserver;
+
+    virtual int queryInterface(agora::INTERFACE_ID_TYPE iid, void** inter)
+    {
+        if (!inter)
+            return -agora::ERR_INVALID_ARGUMENT;
+        if (iid == agora::AGORA_IID_RTC_ENGINE_PARAMETER)
+            *inter = static_cast<agora::rtc::IRtcEngineParameter*>(&parameter);
+        else if (iid == agora::AGORA_IID_MEDIA_ENGINE)
+            *inter = static_cast<agora::media::IMediaEngine*>(&media);
+        else
+            return -agora::ERR_NOT_SUPPORTED;
+        return 0;
+    }
+    virtual bool registerEventHandler(agora::rtc::IRtcEngineEventHandler* eventHandler)
+    {
+        handler = eventHandler;
+        return true;
+    }
+    virtual bool unregisterEventHandler(agora::rtc::IRtcEngineEventHandler* eventHandler)
+    {
+        if (handler != eventHandler)
+            return false;
+        handler = NULL;
+        return true;
+    }
+
+    virtual int initialize(const agora::rtc::RtcEngineContext&) { return 0; }
+    virtual void release(bool) {}
+    virtual int setChannelProfile(agora::rtc::CHANNEL_PROFILE_TYPE) { return 0; }
+    virtual int setClientRole(agora::rtc::CLIENT_ROLE_TYPE) { return 0; }
+    virtual int joinChannel(const char*, const char*, const char*, agora::rtc::uid_t) { return 0; }
+    virtual int leaveChannel() { return 0; }
+    virtual int renewToken(const char*) { return 0; }
+    virtual int startEchoTest() { return 0; }
+    virtual int stopEchoTest() { return 0; }
+    virtual int enableVideo() { return 0; }
+    virtual int disableVideo() { return 0; }
+    virtual int setVideoProfile(agora::rtc::VIDEO_PROFILE_TYPE, bool) { return 0; }
+    virtual int setVideoEncoderConfiguration(const agora::rtc::VideoEncoderConfiguration&) { return 0; }
+    virtual int setupLocalVideo(const agora::rtc::VideoCanvas&) { return 0; }
+    virtual int setupRemoteVideo(const agora::rtc::VideoCanvas&) { return 0; }
+    virtual int startPreview() { return 0; }
+    virtual int stopPreview() { return 0; }
+    virtual int enableAudio() { return 0; }
+    virtual int enableLocalAudio(bool) { return 0; }
+    virtual int disableAudio() { return 0; }
+    virtual int setAudioProfile(agora::rtc::AUDIO_PROFILE_TYPE, agora::rtc::AUDIO_SCENARIO_TYPE) { return 0; }
+#if defined(__APPLE__) || defined(_WIN32)
+    virtual int startScreenCapture(WindowIDType, int, const agora::rtc::Rect*, int) { return 0; }
+    virtual int stopScreenCapture() { return 0; }
+    virtual int updateScreenCaptureRegion(const agora::rtc::Rect*) { return 0; }
+#endif
+    virtual int getCallId(agora::util::AString&) { return -agora::ERR_NOT_SUPPORTED; }
+    virtual int rate(const char*, int, const char*) { return 0; }
+    virtual int complain(const char*, const char*) { return 0; }
+    virtual const char* getVersion(int* build)
+    {
+        if (build)
+            *build = 0;
+        return "fake";
+    }
+    virtual int enableLastmileTest() { return 0; }
+    virtual int disableLastmileTest() { return 0; }
+    virtual const char* getErrorDescription(int) { return ""; }
+    virtual int setEncryptionSecret(const char*) { return 0; }
+    virtual int setEncryptionMode(const char*) { return 0; }
+    virtual int registerPacketObserver(agora::rtc::IPacketObserver* observer)
+    {
+        packetObserver = observer;
+        return 0;
+    }
+    virtual int createDataStream(int* streamId, bool, bool)
+    {
+        if (streamId)
+            *streamId = 1;
+        return 0;
+    }
+    virtual int sendStreamMessage(int, const char*, size_t) { return 0; }
+    virtual int addPublishStreamUrl(const char*, bool) { return 0; }
+    virtual int removePublishStreamUrl(const char*) { return 0; }
+    virtual int setLiveTranscoding(const agora::rtc::LiveTranscoding&) { return 0; }
+    virtual int configPublisher(const agora::rtc::PublisherConfiguration&) { return 0; }
+    virtual int setVideoCompositingLayout(const agora::rtc::VideoCompositingLayout&) { return 0; }
+    virtual int clearVideoCompositingLayout() { return 0; }
+    virtual int addVideoWatermark(const agora::rtc::RtcImage&) { return 0; }
+    virtual int clearVideoWatermarks() { return 0; }
+    virtual int addInjectStreamUrl(const char*, const agora::rtc::InjectStreamConfig&) { return 0; }
+    virtual int removeInjectStreamUrl(const char*) { return 0; }
+};
+
+} // namespace bench
+} // namespace talkboard
+
+#endif
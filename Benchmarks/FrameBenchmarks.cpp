@@ -0,0 +1,448 @@
+//
+//  TalkBoard Benchmarks
+//
+//  Raw frame observers fed with synthetic frames: mixing, resampling, render pacing.
+//
+
+#include "Benchmark.h"
+#include "FakeEngine.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraMediaEngine.h>
+
+#include "AudioMixer.h"
+#include "BufferPool.h"
+#include "PolyphaseResampler.h"
+#include "RenderPacer.h"
+#include "VideoFramePacker.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+typedef agora::media::IAudioFrameObserver::AudioFrame AudioFrame;
+typedef agora::media::IVideoFrameObserver::VideoFrame VideoFrame;
+
+const int kSpeakers = 4;
+const int kSampleRate = 48000;
+const int kChannels = 2;
+/** One 10 ms callback period. */
+const int kFramesPerPeriod = kSampleRate / 100;
+const int kVideoWidth = 640;
+const int kVideoHeight = 360;
+/** Render callbacks arrive at 15 fps per uid. */
+const int kVideoIntervalMs = 66;
+
+/** Deterministic PCM16 that is neither silence nor full scale. */
+void fillPcm(std::vector<int16_t>& pcm, int seed)
+{
+    uint32_t state = 0x9e3779b9u * (seed + 1);
+    for (size_t i = 0; i < pcm.size(); ++i) {
+        state = state * 1664525u + 1013904223u;
+        pcm[i] = (int16_t)((int32_t)(state >> 16) - 32768) / 4;
+    }
+}
+
+AudioFrame audioFrame(std::vector<int16_t>& pcm, int frames, int rate)
+{
+    AudioFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = agora::media::IAudioFrameObserver::FRAME_TYPE_PCM16;
+    frame.samples = frames;
+    frame.bytesPerSample = 2;
+    frame.channels = kChannels;
+    frame.samplesPerSec = rate;
+    frame.buffer = &pcm[0];
+    return frame;
+}
+
+/** The playback path of the app: per-uid frames into the mixer, the mix out. */
+class MixingObserver : public agora::media::IAudioFrameObserver
+{
+public:
+    MixingObserver()
+        : m_mixer(kChannels)
+    {}
+
+    virtual bool onRecordAudioFrame(AudioFrame&) { return true; }
+    virtual bool onMixedAudioFrame(AudioFrame&) { return true; }
+    virtual bool onPlaybackAudioFrameBeforeMixing(unsigned int uid, AudioFrame& frame)
+    {
+        return m_mixer.addFrame(uid, frame) == 0;
+    }
+    virtual bool onPlaybackAudioFrame(AudioFrame& frame)
+    {
+        return m_mixer.mixTo(frame) >= 0;
+    }
+
+    media::AudioMixer& mixer() { return m_mixer; }
+
+private:
+    media::AudioMixer m_mixer;
+};
+
+// Four speakers mixed per 10 ms period, as the SDK's audio thread calls the observer.
+void BM_AudioFrameObserver_mix4(State& state)
+{
+    MixingObserver observer;
+    agora::media::IAudioFrameObserver& sdkSide = observer;
+    observer.mixer().setGain(1001, 0.5f);
+
+    std::vector<std::vector<int16_t> > inputs(kSpeakers, std::vector<int16_t>(kFramesPerPeriod * kChannels));
+    std::vector<AudioFrame> frames;
+    for (int i = 0; i < kSpeakers; ++i) {
+        fillPcm(inputs[i], i);
+        frames.push_back(audioFrame(inputs[i], kFramesPerPeriod, kSampleRate));
+    }
+    std::vector<int16_t> mix(kFramesPerPeriod * kChannels);
+
+    while (state.keepRunning()) {
+        for (int i = 0; i < kSpeakers; ++i)
+            sdkSide.onPlaybackAudioFrameBeforeMixing(1000 + i, frames[i]);
+        AudioFrame out = audioFrame(mix, kFramesPerPeriod, kSampleRate);
+        sdkSide.onPlaybackAudioFrame(out);
+        doNotOptimize(mix[0]);
+    }
+    state.setBytesProcessed(state.iterations() * kSpeakers * kFramesPerPeriod * kChannels * sizeof(int16_t));
+}
+TALKBOARD_BENCHMARK(BM_AudioFrameObserver_mix4);
+
+/** Tone of the THD+N check: 1 kHz at -6 dBFS, below every output rate's Nyquist. */
+const double kToneHz = 1000;
+const double kToneAmplitude = 16384;
+/** Worst THD+N any rate pair may have. 16-bit output alone limits a -6 dBFS
+ tone to about -92 dB. */
+const double kMaxThdPlusNoiseDb = -80;
+
+/** THD+N of the 1 kHz tone resampled from `inputRate` to `outputRate`, in dB. */
+double thdPlusNoiseDb(int inputRate, int outputRate)
+{
+    media::PolyphaseResampler resampler;
+    resampler.configure(inputRate, outputRate, 1);
+    const int chunk = inputRate / 100;
+    std::vector<int16_t> input(chunk);
+    std::vector<int16_t> output(resampler.maxOutputFrames(chunk));
+    std::vector<double> resampled;
+    for (int start = 0; start < inputRate; start += chunk) {
+        for (int i = 0; i < chunk; ++i)
+            input[i] = (int16_t)lrint(kToneAmplitude * sin(2 * M_PI * kToneHz * (start + i) / inputRate));
+        int written = resampler.process(&input[0], chunk, &output[0], (int)output.size());
+        resampled.insert(resampled.end(), output.begin(), output.begin() + written);
+    }
+
+    // Skip 100 ms of filter start-up, then fit the tone over half a second:
+    // a whole number of cycles at every rate, so sine, cosine and DC are
+    // orthogonal and the fit is three sums.
+    const size_t first = (size_t)outputRate / 10;
+    const size_t count = (size_t)outputRate / 2;
+    if (resampled.size() < first + count)
+        return 0;
+    double sinSum = 0, cosSum = 0, sum = 0;
+    for (size_t n = 0; n < count; ++n) {
+        double phase = 2 * M_PI * kToneHz * n / outputRate;
+        double x = resampled[first + n];
+        sinSum += x * sin(phase);
+        cosSum += x * cos(phase);
+        sum += x;
+    }
+    const double a = 2 * sinSum / count, b = 2 * cosSum / count, dc = sum / count;
+    double tone = 0, residual = 0;
+    for (size_t n = 0; n < count; ++n) {
+        double phase = 2 * M_PI * kToneHz * n / outputRate;
+        double fit = a * sin(phase) + b * cos(phase);
+        double error = resampled[first + n] - dc - fit;
+        tone += fit * fit;
+        residual += error * error;
+    }
+    return 10 * log10(residual / tone);
+}
+
+// Every pair of supported rates must keep the tone clean.
+void checkResamplerThdPlusNoise()
+{
+    const int rates[] = { 8000, 16000, 32000, 44100, 48000 };
+    for (int i = 0; i < 5; ++i) {
+        for (int o = 0; o < 5; ++o) {
+            if (i == o)
+                continue;
+            double db = thdPlusNoiseDb(rates[i], rates[o]);
+            if (!(db <= kMaxThdPlusNoiseDb)) {
+                fprintf(stderr, "PolyphaseResampler: THD+N %.1f dB from %d to %d Hz, limit %.0f dB\n", db,
+                        rates[i], rates[o], kMaxThdPlusNoiseDb);
+                abort();
+            }
+        }
+    }
+}
+
+// 44.1 kHz playback converted to the 48 kHz mixer rate in 10 ms frames; an
+// item is one channel-second, so ns/item is the CPU cost per channel-second.
+void BM_PolyphaseResampler_44100to48000(State& state)
+{
+    static bool checked = false;
+    if (!checked) {
+        checkResamplerThdPlusNoise();
+        checked = true;
+    }
+
+    media::PolyphaseResampler resampler;
+    resampler.configure(44100, kSampleRate, kChannels);
+    const int inputFrames = 441;
+    std::vector<int16_t> input(inputFrames * kChannels);
+    fillPcm(input, 7);
+    std::vector<int16_t> output(resampler.maxOutputFrames(inputFrames) * kChannels);
+
+    while (state.keepRunning()) {
+        for (int frame = 0; frame < 100; ++frame) {
+            int written = resampler.process(&input[0], inputFrames, &output[0], (int)output.size() / kChannels);
+            doNotOptimize(written);
+        }
+    }
+    state.setItemsProcessed(state.iterations() * kChannels);
+}
+TALKBOARD_BENCHMARK(BM_PolyphaseResampler_44100to48000);
+
+/** Counts presented frames and reads one pixel of each, as an upload would. */
+class CountingRenderer : public media::RenderPacer::Renderer
+{
+public:
+    CountingRenderer()
+        : presented(0)
+        , checksum(0)
+    {}
+
+    uint64_t presented;
+    uint64_t checksum;
+
+    virtual void onPresentFrame(agora::rtc::uid_t, const media::PackedVideoFrame& frame)
+    {
+        ++presented;
+        checksum += frame.planes[0][0];
+    }
+};
+
+/** The render path of the app: every remote frame is paced before display. */
+class PacingObserver : public agora::media::IVideoFrameObserver
+{
+public:
+    explicit PacingObserver(media::VideoFramePacker& packer)
+        : nowMs(0)
+        , m_pacer(packer)
+    {}
+
+    /** Local clock the SDK "delivers" at. */
+    int64_t nowMs;
+
+    virtual bool onCaptureVideoFrame(VideoFrame&) { return true; }
+    virtual bool onRenderVideoFrame(unsigned int uid, VideoFrame& frame)
+    {
+        return m_pacer.enqueue(uid, frame, nowMs) == 0;
+    }
+
+    int tick(int64_t vsyncMs, media::RenderPacer::Renderer& renderer) { return m_pacer.tick(vsyncMs, renderer); }
+    std::vector<media::RenderPacerStats> stats() const { return m_pacer.stats(); }
+    void removeUid(agora::rtc::uid_t uid) { m_pacer.removeUid(uid); }
+
+private:
+    media::RenderPacer m_pacer;
+};
+
+// Four remote 640x360 I420 streams copied into pooled buffers and presented on the next refresh.
+void BM_VideoFrameObserver_pace4(State& state)
+{
+    const int chromaWidth = kVideoWidth / 2;
+    const int chromaHeight = kVideoHeight / 2;
+    std::vector<unsigned char> y(kVideoWidth * kVideoHeight, 0x80);
+    std::vector<unsigned char> u(chromaWidth * chromaHeight, 0x40);
+    std::vector<unsigned char> v(chromaWidth * chromaHeight, 0xc0);
+
+    VideoFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = agora::media::IVideoFrameObserver::FRAME_TYPE_YUV420;
+    frame.width = kVideoWidth;
+    frame.height = kVideoHeight;
+    frame.yStride = kVideoWidth;
+    frame.uStride = chromaWidth;
+    frame.vStride = chromaWidth;
+    frame.yBuffer = &y[0];
+    frame.uBuffer = &u[0];
+    frame.vBuffer = &v[0];
+
+    util::BufferPool pool(64, 32);
+    media::VideoFramePacker packer(pool);
+    PacingObserver observer(packer);
+    agora::media::IVideoFrameObserver& sdkSide = observer;
+    CountingRenderer renderer;
+    media::RenderPacerConfig config;
+
+    while (state.keepRunning()) {
+        frame.renderTimeMs = observer.nowMs;
+        for (int i = 0; i < kSpeakers; ++i)
+            sdkSide.onRenderVideoFrame(1000 + i, frame);
+        observer.tick(observer.nowMs + config.latencyTargetMs, renderer);
+        observer.nowMs += kVideoIntervalMs;
+    }
+    doNotOptimize(renderer.checksum);
+    state.setItemsProcessed(state.iterations() * kSpeakers);
+    state.setBytesProcessed(state.iterations() * kSpeakers * (y.size() + u.size() + v.size()));
+}
+TALKBOARD_BENCHMARK(BM_VideoFrameObserver_pace4);
+
+/** Frames of one uid through the loopback engine: frame i is rendered at
+ i * 33 ms and reaches the render callback `transit(i)` ms later. */
+struct PacingScenario
+{
+    const char* name;
+    int frames;
+    int64_t (*transit)(int frame);
+};
+
+int64_t steadyTransit(int)
+{
+    return 80;
+}
+
+/** The network queue slowly builds up: +1 ms every 10 frames, 80 ms to 380 ms. */
+int64_t driftingTransit(int frame)
+{
+    return 80 + frame / 10;
+}
+
+/** A 200 ms stall at frame 150; the frames held back arrive in one burst. */
+int64_t burstTransit(int frame)
+{
+    const int64_t stallEndMs = 150 * 33 + 80 + 200;
+    int64_t arrival = frame * 33 + 80;
+    return (arrival > 150 * 33 + 80 && arrival < stallEndMs ? stallEndMs : arrival) - frame * 33;
+}
+
+/** Records the presentation latency of every frame. */
+class LatencyRenderer : public media::RenderPacer::Renderer
+{
+public:
+    LatencyRenderer()
+        : vsyncMs(0)
+    {}
+
+    int64_t vsyncMs;
+    /** renderTimeMs and vsync - renderTimeMs of each presented frame. */
+    std::vector<std::pair<int64_t, int64_t> > presented;
+
+    virtual void onPresentFrame(agora::rtc::uid_t, const media::PackedVideoFrame& frame)
+    {
+        presented.push_back(std::make_pair(frame.timestampMs, vsyncMs - frame.timestampMs));
+    }
+};
+
+void failPacing(const PacingScenario& scenario, const char* what, int64_t value)
+{
+    fprintf(stderr, "RenderPacer %s: %s (%lld)\n", scenario.name, what, (long long)value);
+    abort();
+}
+
+/** Runs `scenario` through the video observer registered with `engine` at a
+ 60 Hz refresh and checks the presentation it produced. */
+void runPacingScenario(FakeRtcEngine& engine, PacingObserver& observer, const PacingScenario& scenario,
+                       agora::media::IVideoFrameObserver::VideoFrame& frame)
+{
+    const agora::rtc::uid_t uid = 1000;
+    const int frameIntervalMs = 33;
+    media::RenderPacerConfig config;
+    LatencyRenderer renderer;
+
+    int next = 0;
+    for (int tick = 0; next < scenario.frames || tick * config.refreshIntervalMs < next * frameIntervalMs + 1000;
+         ++tick) {
+        int64_t vsyncMs = (int64_t)(tick * config.refreshIntervalMs);
+        while (next < scenario.frames && next * frameIntervalMs + scenario.transit(next) <= vsyncMs) {
+            frame.renderTimeMs = next * frameIntervalMs;
+            observer.nowMs = frame.renderTimeMs + scenario.transit(next);
+            engine.media.videoObserver->onRenderVideoFrame(uid, frame);
+            ++next;
+        }
+        renderer.vsyncMs = vsyncMs;
+        observer.tick(vsyncMs, renderer);
+    }
+
+    std::vector<media::RenderPacerStats> stats = observer.stats();
+    if (stats.size() != 1 || stats[0].presented + stats[0].dropped != (uint64_t)scenario.frames)
+        failPacing(scenario, "frames lost", stats.empty() ? 0 : (int64_t)(stats[0].presented + stats[0].dropped));
+
+    // A frame is on time if it is presented within a refresh of its
+    // renderTimeMs + transit + latency target.
+    int64_t slack = (int64_t)config.refreshIntervalMs + 1;
+    for (size_t i = 0; i < renderer.presented.size(); ++i) {
+        int index = (int)(renderer.presented[i].first / frameIntervalMs);
+        int64_t expected = scenario.transit(index) + config.latencyTargetMs;
+        int64_t latency = renderer.presented[i].second;
+        if (scenario.transit == steadyTransit && (latency < expected - slack || latency > expected + slack))
+            failPacing(scenario, "latency off target", latency);
+        // Rising transit is followed with a lag of up to 256 frames' worth of
+        // drift, 26 ms here, which comes out of the latency target.
+        if (scenario.transit == driftingTransit && index > 1000 && (latency < expected - 30 - slack || latency > expected + slack))
+            failPacing(scenario, "drift not followed", latency);
+        // The burst must not push the frames after it back.
+        if (scenario.transit == burstTransit && index > 170 && (latency < expected - slack || latency > expected + 10))
+            failPacing(scenario, "burst moved the offset", latency);
+    }
+    if (scenario.transit != burstTransit && stats[0].dropped)
+        failPacing(scenario, "frames dropped", (int64_t)stats[0].dropped);
+    if (scenario.transit == driftingTransit && stats[0].late > 10)
+        failPacing(scenario, "frames late", (int64_t)stats[0].late);
+    observer.removeUid(uid);
+}
+
+// A synthetic source through the loopback engine: steady transit, slowly
+// rising transit and one delayed burst, each checked after the run.
+void BM_RenderPacer_loopback(State& state)
+{
+    static const PacingScenario kScenarios[] = {
+        { "steady offset", 600, steadyTransit },
+        { "upward drift", 3000, driftingTransit },
+        { "delayed burst", 600, burstTransit },
+    };
+    const int scenarioCount = (int)(sizeof(kScenarios) / sizeof(kScenarios[0]));
+
+    // Small frames keep the copy out of the way of the pacing logic.
+    const int width = 64;
+    const int height = 36;
+    std::vector<unsigned char> y(width * height, 0x80);
+    std::vector<unsigned char> uv(width * height / 4, 0x80);
+    VideoFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = agora::media::IVideoFrameObserver::FRAME_TYPE_YUV420;
+    frame.width = width;
+    frame.height = height;
+    frame.yStride = width;
+    frame.uStride = width / 2;
+    frame.vStride = width / 2;
+    frame.yBuffer = &y[0];
+    frame.uBuffer = &uv[0];
+    frame.vBuffer = &uv[0];
+
+    FakeRtcEngine engine;
+    agora::media::IMediaEngine* mediaEngine = NULL;
+    engine.queryInterface(agora::AGORA_IID_MEDIA_ENGINE, reinterpret_cast<void**>(&mediaEngine));
+    util::BufferPool pool(64, 16);
+    media::VideoFramePacker packer(pool);
+    PacingObserver observer(packer);
+    mediaEngine->registerVideoFrameObserver(&observer);
+
+    int frames = 0;
+    while (state.keepRunning()) {
+        for (int i = 0; i < scenarioCount; ++i) {
+            runPacingScenario(engine, observer, kScenarios[i], frame);
+            frames += kScenarios[i].frames;
+        }
+    }
+    state.setItemsProcessed(frames);
+}
+TALKBOARD_BENCHMARK(BM_RenderPacer_loopback);
+
+} // namespace
@@ -0,0 +1,139 @@
+//
+//  TalkBoard Benchmarks
+//
+//  Tile layout for a 100-participant room: full relayouts, incremental ones, CDN regions.
+//
+
+#include "Benchmark.h"
+
+#include <vector>
+
+#include "TileLayout.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+const int kParticipants = 100;
+
+std::vector<agora::rtc::uid_t> roomUids()
+{
+    std::vector<agora::rtc::uid_t> uids;
+    for (int i = 0; i < kParticipants; ++i)
+        uids.push_back(1000 + i);
+    return uids;
+}
+
+media::TileLayoutConfig phoneConfig(media::TILE_LAYOUT_MODE mode)
+{
+    media::TileLayoutConfig config;
+    config.mode = mode;
+    config.width = 375;
+    config.height = 667;
+    return config;
+}
+
+// Rotation: every tile moves, so every tile is reported.
+void BM_TileLayout_grid100_rotate(State& state)
+{
+    std::vector<agora::rtc::uid_t> uids = roomUids();
+    media::TileLayout layout;
+    media::TileLayoutConfig portrait = phoneConfig(media::TILE_LAYOUT_GRID);
+    media::TileLayoutConfig landscape = portrait;
+    landscape.width = portrait.height;
+    landscape.height = portrait.width;
+    int changes = 0;
+    bool flip = false;
+    while (state.keepRunning()) {
+        changes += layout.update(flip ? landscape : portrait, &uids[0], uids.size());
+        flip = !flip;
+    }
+    doNotOptimize(changes);
+}
+TALKBOARD_BENCHMARK(BM_TileLayout_grid100_rotate);
+
+// The same room laid out again, e.g. after a stats-driven updateInterface: nothing to report.
+void BM_TileLayout_grid100_unchanged(State& state)
+{
+    std::vector<agora::rtc::uid_t> uids = roomUids();
+    media::TileLayout layout;
+    media::TileLayoutConfig config = phoneConfig(media::TILE_LAYOUT_GRID);
+    layout.update(config, &uids[0], uids.size());
+    int changes = 0;
+    while (state.keepRunning())
+        changes += layout.update(config, &uids[0], uids.size());
+    doNotOptimize(changes);
+}
+TALKBOARD_BENCHMARK(BM_TileLayout_grid100_unchanged);
+
+// Someone in the middle leaves and rejoins at the end: the uid index path.
+void BM_TileLayout_grid100_leaveJoin(State& state)
+{
+    std::vector<agora::rtc::uid_t> uids = roomUids();
+    media::TileLayout layout;
+    media::TileLayoutConfig config = phoneConfig(media::TILE_LAYOUT_GRID);
+    layout.update(config, &uids[0], uids.size());
+    int changes = 0;
+    while (state.keepRunning()) {
+        agora::rtc::uid_t leaving = uids[kParticipants / 2];
+        uids.erase(uids.begin() + kParticipants / 2);
+        changes += layout.update(config, &uids[0], uids.size());
+        uids.push_back(leaving);
+        changes += layout.update(config, &uids[0], uids.size());
+    }
+    doNotOptimize(changes);
+    state.setItemsProcessed(state.iterations() * 2);
+}
+TALKBOARD_BENCHMARK(BM_TileLayout_grid100_leaveJoin);
+
+// Swiping between pages of 16: two pages' tiles change visibility, all tiles move.
+void BM_TileLayout_paged100_swipe(State& state)
+{
+    std::vector<agora::rtc::uid_t> uids = roomUids();
+    media::TileLayout layout;
+    media::TileLayoutConfig config = phoneConfig(media::TILE_LAYOUT_PAGED);
+    config.pageSize = 16;
+    int changes = 0;
+    while (state.keepRunning()) {
+        config.page = (config.page + 1) % 7;
+        changes += layout.update(config, &uids[0], uids.size());
+    }
+    doNotOptimize(changes);
+}
+TALKBOARD_BENCHMARK(BM_TileLayout_paged100_swipe);
+
+// Scrolling the speaker strip by one thumbnail.
+void BM_TileLayout_speaker100_scroll(State& state)
+{
+    std::vector<agora::rtc::uid_t> uids = roomUids();
+    media::TileLayout layout;
+    media::TileLayoutConfig config = phoneConfig(media::TILE_LAYOUT_SPEAKER);
+    config.speaker = uids[0];
+    int changes = 0;
+    while (state.keepRunning()) {
+        config.stripOffset = (config.stripOffset + config.stripTileSize + config.spacing) % 9000;
+        changes += layout.update(config, &uids[0], uids.size());
+    }
+    doNotOptimize(changes);
+}
+TALKBOARD_BENCHMARK(BM_TileLayout_speaker100_scroll);
+
+// The CDN side of a relayout: LiveTranscoding users for a 1280x720 canvas.
+void BM_TileLayout_grid100_transcodingUsers(State& state)
+{
+    std::vector<agora::rtc::uid_t> uids = roomUids();
+    media::TileLayout layout;
+    media::TileLayoutConfig config = phoneConfig(media::TILE_LAYOUT_GRID);
+    config.width = 1280;
+    config.height = 720;
+    layout.update(config, &uids[0], uids.size());
+    std::vector<agora::rtc::TranscodingUser> users;
+    int count = 0;
+    while (state.keepRunning())
+        count += layout.transcodingUsers(1280, 720, users);
+    doNotOptimize(count);
+}
+TALKBOARD_BENCHMARK(BM_TileLayout_grid100_transcodingUsers);
+
+} // namespace
@@ -0,0 +1,351 @@
+//
+//  TalkBoard Benchmarks
+//
+//  Engine parameter setters: the SDK's RtcEngineParameters against the engine
+//  layer. And string getters: AString against ParameterStrings.
+//
+
+#include "Benchmark.h"
+#include "FakeEngine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "EngineHandle.h"
+#include "EngineParameters.h"
+#include "ParameterCache.h"
+#include "ParameterStrings.h"
+#include "ParameterTransaction.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+/** Remote uids of a busy room; a transaction stages one update per uid. */
+const int kRoomUids = 16;
+/** Remote uids of the full-screen toggle benchmarks. */
+const int kToggleUids = 50;
+
+/** Sets the stream types of one layout pass: `fullUid` high, everyone else low. */
+template <typename Setter>
+void applyLayout(Setter& setter, agora::rtc::uid_t fullUid)
+{
+    for (int i = 0; i < kToggleUids; ++i) {
+        agora::rtc::uid_t uid = 1000 + i;
+        setter.setRemoteVideoStreamType(uid, uid == fullUid ? agora::rtc::REMOTE_VIDEO_STREAM_HIGH
+                                                            : agora::rtc::REMOTE_VIDEO_STREAM_LOW);
+    }
+}
+
+/** Toggle `round`: even rounds put a user full screen, odd rounds go back to the grid. */
+agora::rtc::uid_t toggledFullUid(int round)
+{
+    return round & 1 ? 0 : 1000 + (round / 2) % kToggleUids;
+}
+
+void checkEngineCalls(const char* name, const FakeParameter& parameter, uint64_t expected)
+{
+    if (parameter.calls != expected) {
+        fprintf(stderr, "%s: %llu engine calls, expected %llu\n", name, (unsigned long long)parameter.calls,
+                (unsigned long long)expected);
+        abort();
+    }
+}
+
+// A scalar setter: one setBool, no JSON on either side.
+void BM_RtcEngineParameters_muteLocalAudioStream(State& state)
+{
+    FakeRtcEngine engine;
+    agora::rtc::RtcEngineParameters parameters(engine);
+    bool mute = false;
+    while (state.keepRunning()) {
+        parameters.muteLocalAudioStream(mute);
+        mute = !mute;
+    }
+}
+TALKBOARD_BENCHMARK(BM_RtcEngineParameters_muteLocalAudioStream);
+
+// The SDK formats {"uid":%u,"mute":%s} with vsnprintf.
+void BM_RtcEngineParameters_muteRemoteVideoStream(State& state)
+{
+    FakeRtcEngine engine;
+    agora::rtc::RtcEngineParameters parameters(engine);
+    agora::rtc::uid_t uid = 0;
+    while (state.keepRunning())
+        parameters.muteRemoteVideoStream(1000 + (uid++ & 15), true);
+}
+TALKBOARD_BENCHMARK(BM_RtcEngineParameters_muteRemoteVideoStream);
+
+void BM_EngineParameters_muteRemoteVideoStream(State& state)
+{
+    FakeRtcEngine engine;
+    rtc::EngineParameters parameters(engine);
+    agora::rtc::uid_t uid = 0;
+    while (state.keepRunning())
+        parameters.muteRemoteVideoStream(1000 + (uid++ & 15), true);
+}
+TALKBOARD_BENCHMARK(BM_EngineParameters_muteRemoteVideoStream);
+
+void BM_RtcEngineParameters_startAudioMixing(State& state)
+{
+    FakeRtcEngine engine;
+    agora::rtc::RtcEngineParameters parameters(engine);
+    while (state.keepRunning())
+        parameters.startAudioMixing("/var/mobile/Containers/Data/Application/Documents/board-ambience.m4a", false, false, 1);
+}
+TALKBOARD_BENCHMARK(BM_RtcEngineParameters_startAudioMixing);
+
+void BM_EngineParameters_startAudioMixing(State& state)
+{
+    FakeRtcEngine engine;
+    rtc::EngineParameters parameters(engine);
+    while (state.keepRunning())
+        parameters.startAudioMixing("/var/mobile/Containers/Data/Application/Documents/board-ambience.m4a", false, false, 1);
+}
+TALKBOARD_BENCHMARK(BM_EngineParameters_startAudioMixing);
+
+// A layout change: every uid gets a stream type, one setParameters call each.
+void BM_RtcEngineParameters_streamTypes16(State& state)
+{
+    FakeRtcEngine engine;
+    agora::rtc::RtcEngineParameters parameters(engine);
+    int round = 0;
+    while (state.keepRunning()) {
+        for (int i = 0; i < kRoomUids; ++i) {
+            agora::rtc::REMOTE_VIDEO_STREAM_TYPE type = i == (round & 15)
+                ? agora::rtc::REMOTE_VIDEO_STREAM_HIGH : agora::rtc::REMOTE_VIDEO_STREAM_LOW;
+            parameters.setRemoteVideoStreamType(1000 + i, type);
+        }
+        ++round;
+    }
+    checkEngineCalls("RtcEngineParameters", engine.parameter, state.iterations() * kRoomUids);
+    state.setItemsProcessed(state.iterations() * kRoomUids);
+}
+TALKBOARD_BENCHMARK(BM_RtcEngineParameters_streamTypes16);
+
+// The same pass staged and committed: nothing to drop, and the per-uid
+// objects share a key, so still one call per uid. Must not cost more.
+void BM_ParameterTransaction_streamTypes16(State& state)
+{
+    FakeRtcEngine engine;
+    rtc::ParameterTransaction transaction(engine);
+    int round = 0;
+    while (state.keepRunning()) {
+        for (int i = 0; i < kRoomUids; ++i) {
+            agora::rtc::REMOTE_VIDEO_STREAM_TYPE type = i == (round & 15)
+                ? agora::rtc::REMOTE_VIDEO_STREAM_HIGH : agora::rtc::REMOTE_VIDEO_STREAM_LOW;
+            transaction.setRemoteVideoStreamType(1000 + i, type);
+        }
+        transaction.commit();
+        ++round;
+    }
+    checkEngineCalls("ParameterTransaction", engine.parameter, state.iterations() * kRoomUids);
+    state.setItemsProcessed(state.iterations() * kRoomUids);
+}
+TALKBOARD_BENCHMARK(BM_ParameterTransaction_streamTypes16);
+
+// Same layout again and again: the shadow cache drops every update.
+void BM_ParameterTransaction_cachedStreamTypes16(State& state)
+{
+    FakeRtcEngine engine;
+    rtc::ParameterCache cache;
+    rtc::ParameterTransaction transaction(engine);
+    transaction.setCache(&cache);
+    while (state.keepRunning()) {
+        for (int i = 0; i < kRoomUids; ++i)
+            transaction.setRemoteVideoStreamType(1000 + i, i ? agora::rtc::REMOTE_VIDEO_STREAM_LOW : agora::rtc::REMOTE_VIDEO_STREAM_HIGH);
+        transaction.commit();
+    }
+    state.setItemsProcessed(state.iterations() * kRoomUids);
+}
+TALKBOARD_BENCHMARK(BM_ParameterTransaction_cachedStreamTypes16);
+
+// A user toggling full screen with 50 remote users. One tap lays the
+// sessions out twice (sessions and fullSession both change); without a
+// transaction each pass sends every stream type.
+void BM_RtcEngineParameters_fullScreenToggle50(State& state)
+{
+    FakeRtcEngine engine;
+    agora::rtc::RtcEngineParameters parameters(engine);
+    int round = 0;
+    while (state.keepRunning()) {
+        agora::rtc::uid_t fullUid = toggledFullUid(round++);
+        applyLayout(parameters, fullUid);
+        applyLayout(parameters, fullUid);
+    }
+    checkEngineCalls("RtcEngineParameters", engine.parameter, state.iterations() * 2 * kToggleUids);
+    state.setBytesProcessed(engine.parameter.bytes);
+}
+TALKBOARD_BENCHMARK(BM_RtcEngineParameters_fullScreenToggle50);
+
+// The same toggle staged twice and committed once per run loop pass.
+void BM_ParameterTransaction_fullScreenToggle50(State& state)
+{
+    FakeRtcEngine engine;
+    rtc::ParameterTransaction transaction(engine);
+    int round = 0;
+    while (state.keepRunning()) {
+        agora::rtc::uid_t fullUid = toggledFullUid(round++);
+        applyLayout(transaction, fullUid);
+        applyLayout(transaction, fullUid);
+        transaction.commit();
+    }
+    // One call per uid: the per-uid updates share a key.
+    checkEngineCalls("ParameterTransaction", engine.parameter, state.iterations() * kToggleUids);
+    state.setBytesProcessed(engine.parameter.bytes);
+}
+TALKBOARD_BENCHMARK(BM_ParameterTransaction_fullScreenToggle50);
+
+/** One toggle as LiveRoomViewController commits it: the tap's two layout
+ passes, a relayout that changes nothing (e.g. a rotation settling) and the
+ mute button re-sending its state, each in its own run loop pass. */
+void toggleWithRedundantUpdates(rtc::ParameterTransaction& transaction, int round)
+{
+    agora::rtc::uid_t fullUid = toggledFullUid(round);
+    applyLayout(transaction, fullUid);
+    applyLayout(transaction, fullUid);
+    transaction.commit();
+    applyLayout(transaction, fullUid);
+    transaction.commit();
+    transaction.muteLocalAudioStream(false);
+    transaction.commit();
+}
+
+void BM_ParameterTransaction_uncachedToggle50(State& state)
+{
+    FakeRtcEngine engine;
+    rtc::ParameterTransaction transaction(engine);
+    int round = 0;
+    while (state.keepRunning())
+        toggleWithRedundantUpdates(transaction, round++);
+    checkEngineCalls("ParameterTransaction", engine.parameter, state.iterations() * (2 * kToggleUids + 1));
+    state.setBytesProcessed(engine.parameter.bytes);
+}
+TALKBOARD_BENCHMARK(BM_ParameterTransaction_uncachedToggle50);
+
+// With the shadow cache only the uid whose stream type changed reaches the engine.
+void BM_ParameterTransaction_cachedToggle50(State& state)
+{
+    FakeRtcEngine engine;
+    rtc::ParameterCache cache;
+    rtc::ParameterTransaction transaction(engine);
+    transaction.setCache(&cache);
+    int round = 0;
+    while (state.keepRunning())
+        toggleWithRedundantUpdates(transaction, round++);
+    // The first toggle fills the cache: every uid and the mute state.
+    checkEngineCalls("ParameterTransaction with cache", engine.parameter, kToggleUids + 1 + state.iterations() - 1);
+    state.setBytesProcessed(engine.parameter.bytes);
+}
+TALKBOARD_BENCHMARK(BM_ParameterTransaction_cachedToggle50);
+
+/** Keys a stats overlay polls on every refresh and keeps until the next. */
+const char* const kPolledKeys[] = {
+    "rtc.connection_state", "rtc.video.remote_stats", "rtc.audio.remote_stats", "che.video.encoder_info",
+    "che.audio.codec_info", "rtc.network_type", "rtc.call_id", "che.video.decoder_info",
+};
+const int kPolledKeyCount = sizeof(kPolledKeys) / sizeof(kPolledKeys[0]);
+/** What the fake engine returns for each of them: an object past any small-string buffer. */
+const char kPolledValue[] = "{\"uid\":1007,\"state\":3,\"reason\":0,\"width\":640,\"height\":360,"
+                            "\"bitrate\":412,\"fps\":15,\"codec\":\"H264\",\"decoder\":\"hardware\"}";
+
+static_assert(std::is_nothrow_move_constructible<util::Handle<agora::util::IString> >::value
+              && std::is_nothrow_move_assignable<util::Handle<agora::util::IString> >::value,
+              "std::vector would not move Handles");
+
+void checkLiveStrings(const FakeParameter& parameter, uint64_t expected, const char* when)
+{
+    if (parameter.liveStrings != expected) {
+        fprintf(stderr, "%s: %llu IStrings alive, expected %llu\n", when,
+                (unsigned long long)parameter.liveStrings, (unsigned long long)expected);
+        abort();
+    }
+}
+
+// The adapter must copy the text and release the IString before returning;
+// handles in a vector must release each IString once, however the vector
+// moves them.
+void checkStringGetters()
+{
+    FakeRtcEngine engine;
+    engine.parameter.text = kPolledValue;
+    rtc::ParameterHandle parameter = rtc::queryParameter(&engine);
+    std::string value;
+    if (!parameter || rtc::getString(parameter.get(), "rtc.call_id", value) != 0 || value != kPolledValue
+        || rtc::getArray(parameter.get(), "rtc.call_id", value) != 0 || value != kPolledValue) {
+        fprintf(stderr, "ParameterStrings: got \"%s\"\n", value.c_str());
+        abort();
+    }
+    checkLiveStrings(engine.parameter, 0, "ParameterStrings");
+    if (rtc::getObject(NULL, "rtc.call_id", value) != -agora::ERR_NOT_INITIALIZED) {
+        fprintf(stderr, "ParameterStrings: no error without a parameter interface\n");
+        abort();
+    }
+
+    {
+        std::vector<util::Handle<agora::util::IString> > held;
+        for (int i = 0; i < 100; ++i) {
+            agora::util::AString string;
+            parameter->getObject(kPolledKeys[i % kPolledKeyCount], string);
+            held.push_back(util::Handle<agora::util::IString>(string));
+        }
+        checkLiveStrings(engine.parameter, 100, "Handle");
+        held.erase(held.begin(), held.begin() + 50);
+        checkLiveStrings(engine.parameter, 50, "Handle");
+    }
+    checkLiveStrings(engine.parameter, 0, "Handle");
+}
+
+// One overlay refresh through AString: the results are kept in handles, so
+// every key holds an SDK string until the next refresh replaces it.
+void BM_AString_pollObjects8(State& state)
+{
+    static bool checked = false;
+    if (!checked) {
+        checkStringGetters();
+        checked = true;
+    }
+
+    FakeRtcEngine engine;
+    engine.parameter.text = kPolledValue;
+    rtc::ParameterHandle parameter = rtc::queryParameter(&engine);
+    std::vector<util::Handle<agora::util::IString> > values(kPolledKeyCount);
+    uint64_t checksum = 0;
+    while (state.keepRunning()) {
+        for (int i = 0; i < kPolledKeyCount; ++i) {
+            agora::util::AString string;
+            parameter->getObject(kPolledKeys[i], string);
+            values[i] = util::Handle<agora::util::IString>(string);
+            checksum += values[i]->length();
+        }
+    }
+    doNotOptimize(checksum);
+    state.setItemsProcessed(state.iterations() * kPolledKeyCount);
+}
+TALKBOARD_BENCHMARK(BM_AString_pollObjects8);
+
+// The same refresh copied into reused strings; the SDK's are released at once.
+void BM_ParameterStrings_pollObjects8(State& state)
+{
+    FakeRtcEngine engine;
+    engine.parameter.text = kPolledValue;
+    rtc::ParameterHandle parameter = rtc::queryParameter(&engine);
+    std::vector<std::string> values(kPolledKeyCount);
+    uint64_t checksum = 0;
+    while (state.keepRunning()) {
+        for (int i = 0; i < kPolledKeyCount; ++i) {
+            rtc::getObject(parameter.get(), kPolledKeys[i], values[i]);
+            checksum += values[i].size();
+        }
+    }
+    checkLiveStrings(engine.parameter, 0, "ParameterStrings");
+    doNotOptimize(checksum);
+    state.setItemsProcessed(state.iterations() * kPolledKeyCount);
+}
+TALKBOARD_BENCHMARK(BM_ParameterStrings_pollObjects8);
+
+} // namespace
@@ -0,0 +1,9 @@
+//
+//  TalkBoard Benchmarks
+//
+
+#include "ScalarAudioMixer.h"
+
+#define TALKBOARD_MIXER_SCALAR 1
+#define AudioMixer ScalarAudioMixer
+#include "AudioMixer.cpp"
@@ -0,0 +1,18 @@
+//
+//  TalkBoard Benchmarks
+//
+//  The AudioMixer built with TALKBOARD_MIXER_SCALAR, as ScalarAudioMixer,
+//  to check the SIMD build against.
+//
+
+#ifndef TALKBOARD_BENCH_SCALAR_AUDIO_MIXER_H
+#define TALKBOARD_BENCH_SCALAR_AUDIO_MIXER_H
+
+#include "AudioMixer.h"
+
+#undef TALKBOARD_AUDIO_MIXER_H
+#define AudioMixer ScalarAudioMixer
+#include "AudioMixer.h"
+#undef AudioMixer
+
+#endif
@@ -0,0 +1,196 @@
+//
+//  TalkBoard Benchmarks
+//
+//  A 200-user join storm: session lookups by uid, and how often the room is laid out.
+//
+
+#include "Benchmark.h"
+
+#include <utility>
+#include <vector>
+
+#include "SessionRegistry.h"
+#include "TileLayout.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+const int kStormUsers = 200;
+
+/** Stands in for the VideoSession object a slot holds. */
+typedef const void* Session;
+
+agora::rtc::uid_t stormUid(int i)
+{
+    // Server-assigned uids are scattered, not dense.
+    return 0x10000000u + (agora::rtc::uid_t)i * 2654435761u % 0x0fffffffu;
+}
+
+/** The array LiveRoomViewController used to keep, with its linear fetchSession(ofUid:). */
+class SessionList
+{
+public:
+    Session* find(agora::rtc::uid_t uid)
+    {
+        for (size_t i = 0; i < m_sessions.size(); ++i) {
+            if (m_sessions[i].first == uid)
+                return &m_sessions[i].second;
+        }
+        return NULL;
+    }
+
+    void append(agora::rtc::uid_t uid, Session session) { m_sessions.push_back(std::make_pair(uid, session)); }
+
+    bool remove(agora::rtc::uid_t uid)
+    {
+        for (size_t i = 0; i < m_sessions.size(); ++i) {
+            if (m_sessions[i].first == uid) {
+                m_sessions.erase(m_sessions.begin() + i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clear() { m_sessions.clear(); }
+
+private:
+    std::vector<std::pair<agora::rtc::uid_t, Session> > m_sessions;
+};
+
+// didJoinedOfUid for 200 users against the linear array: fetch, then append.
+void BM_SessionList_joinStorm200(State& state)
+{
+    SessionList list;
+    int found = 0;
+    while (state.keepRunning()) {
+        list.clear();
+        for (int i = 0; i < kStormUsers; ++i) {
+            agora::rtc::uid_t uid = stormUid(i);
+            if (list.find(uid))
+                ++found;
+            else
+                list.append(uid, &list);
+        }
+    }
+    doNotOptimize(found);
+    state.setItemsProcessed(state.iterations() * kStormUsers);
+}
+TALKBOARD_BENCHMARK(BM_SessionList_joinStorm200);
+
+// The same storm against the registry.
+void BM_SessionRegistry_joinStorm200(State& state)
+{
+    rtc::SessionRegistry<Session> registry;
+    int found = 0;
+    while (state.keepRunning()) {
+        registry.clear();
+        for (int i = 0; i < kStormUsers; ++i) {
+            agora::rtc::uid_t uid = stormUid(i);
+            if (registry.find(uid))
+                ++found;
+            else
+                registry.insert(uid, &registry);
+        }
+    }
+    doNotOptimize(found);
+    state.setItemsProcessed(state.iterations() * kStormUsers);
+}
+TALKBOARD_BENCHMARK(BM_SessionRegistry_joinStorm200);
+
+// Everyone leaves, oldest first, as when a class ends.
+void BM_SessionList_leaveStorm200(State& state)
+{
+    SessionList list;
+    int removed = 0;
+    while (state.keepRunning()) {
+        for (int i = 0; i < kStormUsers; ++i)
+            list.append(stormUid(i), &list);
+        for (int i = 0; i < kStormUsers; ++i)
+            removed += list.remove(stormUid(i));
+    }
+    doNotOptimize(removed);
+    state.setItemsProcessed(state.iterations() * kStormUsers);
+}
+TALKBOARD_BENCHMARK(BM_SessionList_leaveStorm200);
+
+void BM_SessionRegistry_leaveStorm200(State& state)
+{
+    rtc::SessionRegistry<Session> registry;
+    int removed = 0;
+    while (state.keepRunning()) {
+        for (int i = 0; i < kStormUsers; ++i)
+            registry.insert(stormUid(i), &registry);
+        for (int i = 0; i < kStormUsers; ++i)
+            removed += registry.remove(stormUid(i));
+    }
+    doNotOptimize(removed);
+    state.setItemsProcessed(state.iterations() * kStormUsers);
+}
+TALKBOARD_BENCHMARK(BM_SessionRegistry_leaveStorm200);
+
+std::vector<agora::rtc::uid_t> registeredUids(const rtc::SessionRegistry<Session>& registry)
+{
+    std::vector<agora::rtc::uid_t> uids;
+    registry.forEach([&uids](agora::rtc::uid_t uid, Session) { uids.push_back(uid); });
+    return uids;
+}
+
+media::TileLayoutConfig pagedConfig()
+{
+    media::TileLayoutConfig config;
+    config.mode = media::TILE_LAYOUT_PAGED;
+    config.width = 375;
+    config.height = 667;
+    config.pageSize = 16;
+    return config;
+}
+
+// The join storm as the didSet on videoSessions handled it: a relayout per join.
+void BM_JoinStorm200_relayoutPerJoin(State& state)
+{
+    rtc::SessionRegistry<Session> registry;
+    media::TileLayout layout;
+    media::TileLayoutConfig config = pagedConfig();
+    int changes = 0;
+    while (state.keepRunning()) {
+        registry.clear();
+        layout.reset();
+        for (int i = 0; i < kStormUsers; ++i) {
+            registry.insert(stormUid(i), &registry);
+            std::vector<agora::rtc::uid_t> uids = registeredUids(registry);
+            changes += layout.update(config, &uids[0], uids.size());
+        }
+    }
+    doNotOptimize(changes);
+    state.setItemsProcessed(state.iterations() * kStormUsers);
+}
+TALKBOARD_BENCHMARK(BM_JoinStorm200_relayoutPerJoin);
+
+// The storm with scheduleRelayout(): the joins land, then one relayout.
+void BM_JoinStorm200_relayoutBatched(State& state)
+{
+    rtc::SessionRegistry<Session> registry;
+    media::TileLayout layout;
+    media::TileLayoutConfig config = pagedConfig();
+    uint64_t laidOutRevision = 0;
+    int changes = 0;
+    while (state.keepRunning()) {
+        registry.clear();
+        layout.reset();
+        for (int i = 0; i < kStormUsers; ++i)
+            registry.insert(stormUid(i), &registry);
+        if (registry.revision() != laidOutRevision) {
+            std::vector<agora::rtc::uid_t> uids = registeredUids(registry);
+            changes += layout.update(config, &uids[0], uids.size());
+            laidOutRevision = registry.revision();
+        }
+    }
+    doNotOptimize(changes);
+    state.setItemsProcessed(state.iterations() * kStormUsers);
+}
+TALKBOARD_BENCHMARK(BM_JoinStorm200_relayoutBatched);
+
+} // namespace
@@ -0,0 +1,257 @@
+//
+//  TalkBoard Benchmarks
+//
+//  StatsHistory after a full day of a 100-user room: recording, queries and
+//  lookups of uids it does not hold, with users coming and going. And
+//  LatencyHistogram percentiles.
+//
+
+#include "Benchmark.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "StatsHistory.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+const int kRoomUsers = 100;
+/** The SDK reports every 2 s. */
+const int kReportsPerDay = 24 * 60 * 60 / 2;
+/** One user leaves and another joins every minute. */
+const int kChurnReports = 30;
+/** record() calls per report: RtcStats, LocalVideoStats and three per remote uid. */
+const int kRecordsPerReport = 10 + 2 + 3 * kRoomUsers;
+
+/** The SDK side of the room: what it reports every two seconds. */
+class SimulatedDay
+{
+public:
+    SimulatedDay()
+        : m_nextUid(1000)
+        , m_reports(0)
+        , m_seed(0x9e3779b9u)
+    {
+        for (int i = 0; i < kRoomUsers; ++i) {
+            m_uids.push_back(m_nextUid++);
+            m_joined.push_back(0);
+        }
+    }
+
+    rtc::StatsHistory history;
+
+    /** Records one report and, every kChurnReports, replaces the longest-present user. */
+    void report()
+    {
+        agora::rtc::RtcStats rtc;
+        memset(&rtc, 0, sizeof(rtc));
+        rtc.txKBitRate = 600 + next() % 200;
+        rtc.rxKBitRate = 2400 + next() % 800;
+        rtc.lastmileDelay = 20 + next() % 60;
+        rtc.userCount = kRoomUsers + 1;
+        rtc.cpuAppUsage = (next() % 4000) / 100.0;
+        rtc.cpuTotalUsage = (next() % 8000) / 100.0;
+        history.recordRtcStats(rtc);
+
+        agora::rtc::LocalVideoStats local;
+        memset(&local, 0, sizeof(local));
+        local.sentBitrate = 500 + next() % 100;
+        local.sentFrameRate = 15;
+        history.recordLocalVideoStats(local);
+
+        for (int i = 0; i < kRoomUsers; ++i) {
+            agora::rtc::RemoteVideoStats remote;
+            memset(&remote, 0, sizeof(remote));
+            remote.uid = m_uids[i];
+            // A long tail, like real jitter-buffer delays.
+            uint32_t r = next();
+            remote.delay = 40 + r % 60 + (r % 97 == 0 ? 400 : 0);
+            remote.receivedBitrate = 200 + next() % 300;
+            remote.receivedFrameRate = 15;
+            history.recordRemoteVideoStats(remote);
+        }
+
+        if (++m_reports % kChurnReports == 0) {
+            int i = (int)(m_reports / kChurnReports % kRoomUsers);
+            history.removeUid(m_uids[i]);
+            m_departed.push_back(m_uids[i]);
+            m_uids[i] = m_nextUid++;
+            m_joined[i] = m_reports;
+        }
+    }
+
+    const std::vector<agora::rtc::uid_t>& uids() const { return m_uids; }
+    const std::vector<agora::rtc::uid_t>& departed() const { return m_departed; }
+    /** Reports recorded for the uid at `i` since it joined. */
+    uint64_t reportsOf(int i) const { return m_reports - m_joined[i]; }
+
+private:
+    uint32_t next()
+    {
+        m_seed ^= m_seed << 13;
+        m_seed ^= m_seed >> 17;
+        m_seed ^= m_seed << 5;
+        return m_seed;
+    }
+
+    std::vector<agora::rtc::uid_t> m_uids;
+    std::vector<agora::rtc::uid_t> m_departed;
+    std::vector<uint64_t> m_joined;
+    agora::rtc::uid_t m_nextUid;
+    uint64_t m_reports;
+    uint32_t m_seed;
+};
+
+// Every series of a present user must be there with all of its reports, and
+// nothing of a departed one; the footprint must be what the constructor
+// allocated. A user who joined on the last report has no series yet.
+void checkDay(SimulatedDay& day, size_t memoryUsage)
+{
+    rtc::StatsHistory& history = day.history;
+    rtc::StatsSummary summary;
+    int series = 10 + 2;
+    for (int i = 0; i < kRoomUsers; ++i) {
+        uint64_t reports = day.reportsOf(i);
+        bool found = history.session(day.uids()[i], rtc::STATS_VIDEO_DELAY, summary);
+        if (found != (reports > 0) || (found && summary.count != reports)) {
+            fprintf(stderr, "StatsHistory: uid %u has %llu reports, expected %llu\n", day.uids()[i],
+                    found ? (unsigned long long)summary.count : 0ULL, (unsigned long long)reports);
+            abort();
+        }
+        series += found ? 3 : 0;
+    }
+    if (history.seriesCount() != series || history.memoryUsage() != memoryUsage) {
+        fprintf(stderr, "StatsHistory: %d series and %zu bytes after a day, expected %d and %zu\n",
+                history.seriesCount(), history.memoryUsage(), series, memoryUsage);
+        abort();
+    }
+    for (size_t i = 0; i < day.departed().size(); ++i) {
+        if (history.session(day.departed()[i], rtc::STATS_VIDEO_DELAY, summary)) {
+            fprintf(stderr, "StatsHistory: uid %u left but still has a series\n", day.departed()[i]);
+            abort();
+        }
+    }
+}
+
+/** The history every benchmark starts from: a full day of the room, built and checked once. */
+SimulatedDay& fullDay()
+{
+    static SimulatedDay* day = NULL;
+    if (!day) {
+        day = new SimulatedDay();
+        size_t memoryUsage = day->history.memoryUsage();
+        for (int i = 0; i < kReportsPerDay; ++i)
+            day->report();
+        checkDay(*day, memoryUsage);
+    }
+    return *day;
+}
+
+// One report of the room, per record() call, at the end of a day.
+void BM_StatsHistory_recordFullDay100(State& state)
+{
+    SimulatedDay& day = fullDay();
+    while (state.keepRunning())
+        day.report();
+    state.setItemsProcessed(state.iterations() * kRecordsPerReport);
+}
+TALKBOARD_BENCHMARK(BM_StatsHistory_recordFullDay100);
+
+// The window summary of every present user's video delay.
+void BM_StatsHistory_windowFullDay100(State& state)
+{
+    SimulatedDay& day = fullDay();
+    rtc::StatsSummary summary;
+    uint64_t checksum = 0;
+    while (state.keepRunning()) {
+        for (int i = 0; i < kRoomUsers; ++i) {
+            day.history.window(day.uids()[i], rtc::STATS_VIDEO_DELAY, summary);
+            checksum += summary.p95;
+        }
+    }
+    doNotOptimize(checksum);
+    state.setItemsProcessed(state.iterations() * kRoomUsers);
+}
+TALKBOARD_BENCHMARK(BM_StatsHistory_windowFullDay100);
+
+// Lookups of users who left: what every newcomer's first record() pays, and
+// where tombstones left by removeUid() would show.
+void BM_StatsHistory_missFullDay100(State& state)
+{
+    SimulatedDay& day = fullDay();
+    const std::vector<agora::rtc::uid_t>& departed = day.departed();
+    uint64_t checksum = 0;
+    size_t i = 0;
+    while (state.keepRunning()) {
+        checksum += day.history.percentile(departed[i], rtc::STATS_VIDEO_DELAY, 0.95);
+        if (++i == departed.size())
+            i = 0;
+    }
+    doNotOptimize(checksum);
+}
+TALKBOARD_BENCHMARK(BM_StatsHistory_missFullDay100);
+
+// Below 128 every value has its own counter, so valueAtPercentile() must be
+// the exact nearest-rank percentile: the ceil(p * n / 100)-th smallest value.
+void checkLatencyPercentiles()
+{
+    const double percentiles[] = { 0, 0.1, 1, 7, 10, 25, 40, 50, 90, 95, 99, 99.9, 100 };
+    const int sizes[] = { 1, 2, 3, 7, 10, 100, 1000, 43200 };
+    uint32_t seed = 0x9e3779b9u;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        util::LatencyHistogram histogram;
+        std::vector<uint32_t> values;
+        for (int i = 0; i < sizes[s]; ++i) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            values.push_back(seed % 128);
+            histogram.record(values.back());
+        }
+        std::sort(values.begin(), values.end());
+        for (size_t p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); ++p) {
+            uint64_t rank = (uint64_t)ceil(percentiles[p] * values.size() / 100);
+            uint32_t expected = values[rank ? rank - 1 : 0];
+            uint32_t value = histogram.valueAtPercentile(percentiles[p]);
+            if (value != expected) {
+                fprintf(stderr, "LatencyHistogram: p%g of %d values is %u, expected %u\n", percentiles[p],
+                        sizes[s], value, expected);
+                abort();
+            }
+        }
+    }
+}
+
+// p99 of a day of 2 s delay reports.
+void BM_LatencyHistogram_p99(State& state)
+{
+    static bool checked = false;
+    if (!checked) {
+        checkLatencyPercentiles();
+        checked = true;
+    }
+
+    util::LatencyHistogram histogram;
+    uint32_t seed = 0x9e3779b9u;
+    for (int i = 0; i < kReportsPerDay; ++i) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        histogram.record(40 + seed % 60 + (seed % 97 == 0 ? 400 : 0));
+    }
+    uint64_t checksum = 0;
+    while (state.keepRunning())
+        checksum += histogram.valueAtPercentile(99);
+    doNotOptimize(checksum);
+}
+TALKBOARD_BENCHMARK(BM_LatencyHistogram_p99);
+
+} // namespace
@@ -0,0 +1,269 @@
+//
+//  TalkBoard Benchmarks
+//
+//  StreamTypeController in a simulated 30-user room: ten minutes of speaker
+//  changes and network phases, with and without hysteresis.
+//
+
+#include "Benchmark.h"
+#include "FakeEngine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "ParameterTransaction.h"
+#include "StreamTypeController.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+const int kRoomUsers = 30;
+const int kVisibleTiles = 9;
+/** Stats arrive every 2 s; the simulation lasts ten minutes. */
+const int kTickMs = 2000;
+const int kTicks = 10 * 60 * 1000 / kTickMs;
+/** The active speaker changes every 30 s. */
+const int kSpeakerTicks = 15;
+/** Mean bitrates the simulated senders use; measurements scatter around them. */
+const int kHighKbps = 900;
+const int kLowKbps = 150;
+
+/** Local downlink quality at `tick`: good, poor, bad, flaky, very bad, good. */
+int downlinkQuality(int tick)
+{
+    if (tick < 60)
+        return agora::rtc::QUALITY_EXCELLENT;
+    if (tick < 120)
+        return agora::rtc::QUALITY_POOR;
+    if (tick < 150)
+        return agora::rtc::QUALITY_BAD;
+    if (tick < 210)
+        return tick % 2 ? agora::rtc::QUALITY_GOOD : agora::rtc::QUALITY_POOR;
+    if (tick < 230)
+        return agora::rtc::QUALITY_VBAD;
+    return agora::rtc::QUALITY_GOOD;
+}
+
+/** What the room did to the subscriptions. */
+struct RoomOutcome
+{
+    /** Changes at ticks where the layout did not change: driven by stats. */
+    int measuredSwitches;
+    /** Most measurement-driven switches of one uid within one minute. */
+    int worstSwitchesPerMinute;
+    /** Time the current subscriptions cost more than the budget. */
+    int overBudgetSeconds;
+    uint64_t engineCalls;
+};
+
+/** The SDK and the screen: tiles, stats and quality reports for 30 users.
+ With `unmeasuredReports` every few reports are followed by QUALITY_UNKNOWN
+ or QUALITY_UNSUPPORTED ones, which must change nothing.
+ */
+class SimulatedRoom
+{
+public:
+    SimulatedRoom(const rtc::StreamTypeConfig& config, bool unmeasuredReports)
+        : m_controller(config)
+        , m_transaction(m_engine)
+        , m_unmeasuredReports(unmeasuredReports)
+        , m_tick(0)
+        , m_speaker(-1)
+        , m_seed(0x9e3779b9u)
+        , m_switches(kRoomUsers, 0)
+    {
+        m_outcome.measuredSwitches = 0;
+        m_outcome.worstSwitchesPerMinute = 0;
+        m_outcome.overBudgetSeconds = 0;
+        m_outcome.engineCalls = 0;
+    }
+
+    /** One stats interval: layout, reports, evaluate and commit. */
+    void tick()
+    {
+        const int phase = m_tick % kTicks;
+        const bool layoutChanged = layout(phase);
+        report(phase);
+
+        m_controller.evaluate((int64_t)m_tick * kTickMs);
+        const std::vector<rtc::StreamChange>& changes = m_controller.changes();
+        for (size_t i = 0; i < changes.size(); ++i) {
+            if (!layoutChanged && !changes[i].initial) {
+                ++m_outcome.measuredSwitches;
+                ++m_switches[changes[i].uid - 1000];
+            }
+        }
+        m_controller.apply(m_transaction);
+        m_transaction.commit();
+
+        int costKbps = 0;
+        for (int i = 0; i < kRoomUsers; ++i) {
+            rtc::STREAM_SUBSCRIPTION subscription = m_controller.subscription(1000 + i);
+            costKbps += subscription == rtc::SUBSCRIPTION_HIGH ? kHighKbps
+                : subscription == rtc::SUBSCRIPTION_LOW ? kLowKbps : 0;
+        }
+        if (costKbps > m_controller.budgetKbps())
+            m_outcome.overBudgetSeconds += kTickMs / 1000;
+
+        if (++m_tick % (60 * 1000 / kTickMs) == 0) {
+            for (int i = 0; i < kRoomUsers; ++i) {
+                m_outcome.worstSwitchesPerMinute = std::max(m_outcome.worstSwitchesPerMinute, m_switches[i]);
+                m_switches[i] = 0;
+            }
+        }
+        m_outcome.engineCalls = m_engine.parameter.calls;
+    }
+
+    const RoomOutcome& outcome() const { return m_outcome; }
+
+private:
+    // Nine tiles: the speaker and the two hosts big, six small; the next
+    // nine users one page away, the rest further.
+    bool layout(int phase)
+    {
+        int speaker = phase / kSpeakerTicks % kRoomUsers;
+        if (speaker == m_speaker)
+            return false;
+        m_speaker = speaker;
+        std::vector<int> visible;
+        visible.push_back(speaker);
+        for (int i = 0; (int)visible.size() < kVisibleTiles; ++i) {
+            if (i != speaker)
+                visible.push_back(i);
+        }
+        for (int i = 0; i < kRoomUsers; ++i) {
+            agora::rtc::uid_t uid = 1000 + i;
+            std::vector<int>::iterator tile = std::find(visible.begin(), visible.end(), i);
+            if (tile == visible.end()) {
+                m_controller.setTileSize(uid, 0, 0);
+                m_controller.setViewportDistance(uid, i < 2 * kVisibleTiles ? 1 : 2);
+            } else if (tile - visible.begin() < 3) {
+                m_controller.setTileSize(uid, 683, 512);
+                m_controller.setViewportDistance(uid, 0);
+            } else {
+                m_controller.setTileSize(uid, 340, 256);
+                m_controller.setViewportDistance(uid, 0);
+            }
+        }
+        return true;
+    }
+
+    void report(int phase)
+    {
+        agora::rtc::RtcStats rtc;
+        memset(&rtc, 0, sizeof(rtc));
+        rtc.cpuAppUsage = phase >= 260 && phase < 275 ? 90 : 40;
+        m_controller.updateRtcStats(rtc);
+
+        m_controller.updateNetworkQuality(0, agora::rtc::QUALITY_GOOD, downlinkQuality(phase));
+        if (m_unmeasuredReports && phase % 5 == 0)
+            m_controller.updateNetworkQuality(0, agora::rtc::QUALITY_UNSUPPORTED, agora::rtc::QUALITY_UNSUPPORTED);
+
+        for (int i = 0; i < kRoomUsers; ++i) {
+            agora::rtc::uid_t uid = 1000 + i;
+            // One host's uplink degrades for a while.
+            int uplink = i == 1 && phase >= 100 && phase < 180 ? agora::rtc::QUALITY_BAD : agora::rtc::QUALITY_GOOD;
+            m_controller.updateNetworkQuality(uid, uplink, agora::rtc::QUALITY_GOOD);
+            if (m_unmeasuredReports && (phase + i) % 3 == 0) {
+                int unmeasured = i % 2 ? agora::rtc::QUALITY_UNSUPPORTED : agora::rtc::QUALITY_UNKNOWN;
+                m_controller.updateNetworkQuality(uid, unmeasured, unmeasured);
+            }
+
+            rtc::STREAM_SUBSCRIPTION subscription = m_controller.subscription(uid);
+            if (subscription == rtc::SUBSCRIPTION_MUTED)
+                continue;
+            agora::rtc::RemoteVideoStats stats;
+            memset(&stats, 0, sizeof(stats));
+            stats.uid = uid;
+            bool high = subscription == rtc::SUBSCRIPTION_HIGH;
+            stats.rxStreamType = high ? agora::rtc::REMOTE_VIDEO_STREAM_HIGH : agora::rtc::REMOTE_VIDEO_STREAM_LOW;
+            int spread = high ? 400 : 80;
+            stats.receivedBitrate = (high ? kHighKbps : kLowKbps) - spread / 2 + (int)(next() % spread);
+            m_controller.updateRemoteVideoStats(stats);
+        }
+    }
+
+    uint32_t next()
+    {
+        m_seed ^= m_seed << 13;
+        m_seed ^= m_seed >> 17;
+        m_seed ^= m_seed << 5;
+        return m_seed;
+    }
+
+    FakeRtcEngine m_engine;
+    rtc::StreamTypeController m_controller;
+    rtc::ParameterTransaction m_transaction;
+    bool m_unmeasuredReports;
+    int m_tick;
+    int m_speaker;
+    uint32_t m_seed;
+    std::vector<int> m_switches;
+    RoomOutcome m_outcome;
+};
+
+RoomOutcome simulate(const rtc::StreamTypeConfig& config, bool unmeasuredReports)
+{
+    SimulatedRoom room(config, unmeasuredReports);
+    for (int i = 0; i < kTicks; ++i)
+        room.tick();
+    return room.outcome();
+}
+
+// Hysteresis must cut the switches driven by noisy stats without leaving
+// the room over budget for longer, and QUALITY_UNKNOWN or
+// QUALITY_UNSUPPORTED reports must not change a single decision.
+void checkRoom()
+{
+    rtc::StreamTypeConfig hysteresis;
+    rtc::StreamTypeConfig immediate;
+    immediate.upgradeDelayMs = 0;
+    immediate.downgradeDelayMs = 0;
+    immediate.muteDelayMs = 0;
+    immediate.upgradeMarginKbps = 0;
+
+    RoomOutcome with = simulate(hysteresis, false);
+    RoomOutcome without = simulate(immediate, false);
+    if (with.measuredSwitches >= without.measuredSwitches
+        || with.worstSwitchesPerMinute > without.worstSwitchesPerMinute
+        || with.overBudgetSeconds > without.overBudgetSeconds) {
+        fprintf(stderr, "StreamTypeController: with hysteresis %d switches, %d/min worst, %d s over budget; "
+                "without %d, %d/min, %d s\n", with.measuredSwitches, with.worstSwitchesPerMinute,
+                with.overBudgetSeconds, without.measuredSwitches, without.worstSwitchesPerMinute,
+                without.overBudgetSeconds);
+        abort();
+    }
+
+    RoomOutcome unmeasured = simulate(hysteresis, true);
+    if (unmeasured.measuredSwitches != with.measuredSwitches || unmeasured.overBudgetSeconds != with.overBudgetSeconds
+        || unmeasured.engineCalls != with.engineCalls) {
+        fprintf(stderr, "StreamTypeController: unknown or unsupported quality reports changed the outcome: "
+                "%d switches, %d s over budget, %llu calls instead of %d, %d s, %llu\n",
+                unmeasured.measuredSwitches, unmeasured.overBudgetSeconds,
+                (unsigned long long)unmeasured.engineCalls, with.measuredSwitches, with.overBudgetSeconds,
+                (unsigned long long)with.engineCalls);
+        abort();
+    }
+}
+
+// One stats interval of the room: reports, evaluate(), apply() and commit().
+void BM_StreamTypeController_room30(State& state)
+{
+    static bool checked = false;
+    if (!checked) {
+        checkRoom();
+        checked = true;
+    }
+
+    SimulatedRoom room(rtc::StreamTypeConfig(), true);
+    while (state.keepRunning())
+        room.tick();
+}
+TALKBOARD_BENCHMARK(BM_StreamTypeController_room30);
+
+} // namespace
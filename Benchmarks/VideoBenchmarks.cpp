@@ -0,0 +1,370 @@
+//
+//  TalkBoard Benchmarks
+//
+//  Frame production for pushExternalVideoFrame: packing board rasters,
+//  compositing transcoding layouts and detecting changed board tiles.
+//
+
+#include "Benchmark.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "BufferPool.h"
+#include "ThreadPool.h"
+#include "TileChangeDetector.h"
+#include "VideoCompositor.h"
+#include "VideoFramePacker.h"
+
+using namespace talkboard;
+using namespace talkboard::bench;
+
+namespace {
+
+/** An iPhone-sized board raster; 1334 * 4 bytes is not 32-byte aligned. */
+const int kBoardWidth = 1334;
+const int kBoardHeight = 750;
+
+/** The documented transcoding maximum, composited into 1080p. */
+const int kTranscodingUsers = 17;
+const int kCanvasWidth = 1920;
+const int kCanvasHeight = 1080;
+/** Remote streams as they are usually received. */
+const int kSourceWidth = 640;
+const int kSourceHeight = 360;
+/** A 4-core box: three workers and the composing thread. */
+const int kCompositorWorkers = 3;
+
+/** A shared board at 720p, as startScreenCapture sends it. */
+const int kShareWidth = 1280;
+const int kShareHeight = 720;
+/** Frames of the synthetic board session checked against a brute-force compare. */
+const int kCheckedFrames = 900;
+
+/** Stands in for the board rasterizer: writes every visible pixel of a BGRA image once. */
+void renderBoard(unsigned char* pixels, int rowBytes, int width, int height, int frame)
+{
+    for (int y = 0; y < height; ++y) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(pixels + (size_t)y * rowBytes);
+        uint32_t color = 0xff000000u | (uint32_t)((y + frame) & 0xff) * 0x010101u;
+        for (int x = 0; x < width; ++x)
+            row[x] = color;
+    }
+}
+
+// Baseline: render into a tight image, then copy it into a freshly allocated
+// packed buffer for the push, as with a CGContext and NSData.
+void BM_FramePush_copyToPacked(State& state)
+{
+    const int rowBytes = kBoardWidth * 4;
+    std::vector<unsigned char> canvas((size_t)rowBytes * kBoardHeight);
+    int frame = 0;
+    while (state.keepRunning()) {
+        renderBoard(&canvas[0], rowBytes, kBoardWidth, kBoardHeight, frame++);
+        unsigned char* packed = static_cast<unsigned char*>(malloc(canvas.size()));
+        memcpy(packed, &canvas[0], canvas.size());
+        doNotOptimize(packed[0]);
+        free(packed);
+    }
+    state.setItemsProcessed(state.iterations());
+    state.setBytesProcessed(state.iterations() * canvas.size());
+}
+TALKBOARD_BENCHMARK(BM_FramePush_copyToPacked);
+
+// The same copy into a pooled buffer, leaving only the repack itself.
+void BM_FramePush_copyToPooled(State& state)
+{
+    const int rowBytes = kBoardWidth * 4;
+    std::vector<unsigned char> canvas((size_t)rowBytes * kBoardHeight);
+    util::BufferPool pool(64, 4);
+    media::VideoFramePacker packer(pool);
+    int frame = 0;
+    while (state.keepRunning()) {
+        renderBoard(&canvas[0], rowBytes, kBoardWidth, kBoardHeight, frame++);
+        media::PackedVideoFrame packed;
+        packer.acquire(media::PACKED_FRAME_FORMAT_BGRA, kBoardWidth, kBoardHeight, packed);
+        for (int y = 0; y < kBoardHeight; ++y)
+            memcpy(packed.planes[0] + (size_t)y * packed.planeStrides[0], &canvas[(size_t)y * rowBytes], rowBytes);
+        doNotOptimize(packed.data[0]);
+        packer.release(packed);
+    }
+    state.setItemsProcessed(state.iterations());
+    state.setBytesProcessed(state.iterations() * canvas.size());
+}
+TALKBOARD_BENCHMARK(BM_FramePush_copyToPooled);
+
+// VideoFramePacker: render straight into a pooled, stride-aligned buffer.
+void BM_FramePush_packInPlace(State& state)
+{
+    util::BufferPool pool(64, 4);
+    media::VideoFramePacker packer(pool);
+    int frame = 0;
+    while (state.keepRunning()) {
+        media::PackedVideoFrame packed;
+        packer.acquire(media::PACKED_FRAME_FORMAT_BGRA, kBoardWidth, kBoardHeight, packed);
+        renderBoard(packed.planes[0], packed.planeStrides[0], kBoardWidth, kBoardHeight, frame++);
+        doNotOptimize(packed.data[0]);
+        packer.release(packed);
+    }
+    state.setItemsProcessed(state.iterations());
+    state.setBytesProcessed(state.iterations() * kBoardWidth * kBoardHeight * 4);
+}
+TALKBOARD_BENCHMARK(BM_FramePush_packInPlace);
+
+/** A speaker layout: one user full screen, the others in two rows of
+ semi-transparent thumbnails along the bottom. */
+void makeTranscoding(agora::rtc::LiveTranscoding& transcoding, std::vector<agora::rtc::TranscodingUser>& users)
+{
+    const int thumbWidth = kCanvasWidth / 8;
+    const int thumbHeight = thumbWidth * 9 / 16;
+    users.assign(kTranscodingUsers, agora::rtc::TranscodingUser());
+    for (int i = 0; i < kTranscodingUsers; ++i) {
+        agora::rtc::TranscodingUser& user = users[i];
+        user.uid = 1000 + i;
+        if (i == 0) {
+            user.width = kCanvasWidth;
+            user.height = kCanvasHeight;
+        } else {
+            user.x = (i - 1) % 8 * thumbWidth;
+            user.y = kCanvasHeight - (2 - (i - 1) / 8) * thumbHeight;
+            user.width = thumbWidth;
+            user.height = thumbHeight;
+            user.zOrder = 1;
+            user.alpha = 0.8;
+        }
+    }
+    transcoding.width = kCanvasWidth;
+    transcoding.height = kCanvasHeight;
+    transcoding.backgroundColor = 0x202020;
+    transcoding.userCount = kTranscodingUsers;
+    transcoding.transcodingUsers = &users[0];
+}
+
+/** 17 sources submitted as the render callbacks would, then one canvas composed per iteration. */
+void composeTranscoding(State& state, util::ThreadPool* threads)
+{
+    const int chromaWidth = kSourceWidth / 2;
+    const int chromaHeight = kSourceHeight / 2;
+    std::vector<unsigned char> y(kSourceWidth * kSourceHeight);
+    std::vector<unsigned char> u(chromaWidth * chromaHeight, 0x60);
+    std::vector<unsigned char> v(chromaWidth * chromaHeight, 0xa0);
+    for (size_t i = 0; i < y.size(); ++i)
+        y[i] = (unsigned char)(16 + (i * 7) % 220);
+
+    agora::media::IVideoFrameObserver::VideoFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = agora::media::IVideoFrameObserver::FRAME_TYPE_YUV420;
+    frame.width = kSourceWidth;
+    frame.height = kSourceHeight;
+    frame.yStride = kSourceWidth;
+    frame.uStride = chromaWidth;
+    frame.vStride = chromaWidth;
+    frame.yBuffer = &y[0];
+    frame.uBuffer = &u[0];
+    frame.vBuffer = &v[0];
+
+    agora::rtc::LiveTranscoding transcoding;
+    std::vector<agora::rtc::TranscodingUser> users;
+    makeTranscoding(transcoding, users);
+    media::VideoCompositor compositor(threads);
+    compositor.setLayout(transcoding);
+
+    util::BufferPool pool(64, 2);
+    media::VideoFramePacker packer(pool);
+    media::PackedVideoFrame canvas;
+    packer.acquire(media::PACKED_FRAME_FORMAT_I420, kCanvasWidth, kCanvasHeight, canvas);
+
+    while (state.keepRunning()) {
+        for (int i = 0; i < kTranscodingUsers; ++i)
+            compositor.submitFrame(1000 + i, frame);
+        compositor.compose(canvas);
+        doNotOptimize(canvas.planes[0][0]);
+    }
+    packer.release(canvas);
+    state.setItemsProcessed(state.iterations());
+}
+
+void BM_VideoCompositor_17x1080p_callingThread(State& state)
+{
+    composeTranscoding(state, NULL);
+}
+TALKBOARD_BENCHMARK(BM_VideoCompositor_17x1080p_callingThread);
+
+void BM_VideoCompositor_17x1080p_pool4(State& state)
+{
+    util::ThreadPool threads(kCompositorWorkers);
+    composeTranscoding(state, &threads);
+}
+TALKBOARD_BENCHMARK(BM_VideoCompositor_17x1080p_pool4);
+
+/** A synthetic board session standing in for a recording: a pen drawing a
+ stroke a few pixels per frame, every 10th frame idle, and the page
+ cleared every 300 frames. */
+class BoardSession
+{
+public:
+    BoardSession()
+        : pixels((size_t)kShareWidth * kShareHeight * 4)
+        , m_frame(0)
+    {
+        clear();
+    }
+
+    std::vector<unsigned char> pixels;
+
+    int stride() const { return kShareWidth * 4; }
+
+    void step()
+    {
+        ++m_frame;
+        if (m_frame % 300 == 0) {
+            clear();
+            return;
+        }
+        if (m_frame % 10 == 0)
+            return;
+        // Two dabs per frame keep the stroke continuous.
+        for (int i = 0; i < 2; ++i) {
+            double t = m_frame * 2 + i;
+            int x = 40 + (int)(t * 3) % (kShareWidth - 80);
+            int y = kShareHeight / 2 + (int)(250 * sin(t * 0.013)) + (int)(t * 3) / (kShareWidth - 80) * 20 % 100;
+            dab(x, y);
+        }
+    }
+
+private:
+    void clear() { memset(&pixels[0], 0xff, pixels.size()); }
+
+    void dab(int cx, int cy)
+    {
+        const int radius = 3;
+        for (int y = cy - radius; y <= cy + radius; ++y) {
+            for (int x = cx - radius; x <= cx + radius; ++x) {
+                if (x < 0 || y < 0 || x >= kShareWidth || y >= kShareHeight)
+                    continue;
+                uint32_t* p = reinterpret_cast<uint32_t*>(&pixels[(size_t)y * stride() + (size_t)x * 4]);
+                *p = 0xff202020u + (uint32_t)(m_frame & 0x1f);
+            }
+        }
+    }
+
+    int m_frame;
+};
+
+/** Changed tiles from a byte compare with the previous frame. */
+int changedTiles(const std::vector<unsigned char>& previous, const std::vector<unsigned char>& current, int tileSize,
+                 std::vector<uint8_t>& changed)
+{
+    int columns = (kShareWidth + tileSize - 1) / tileSize;
+    int rows = (kShareHeight + tileSize - 1) / tileSize;
+    changed.assign((size_t)columns * rows, 0);
+    int count = 0;
+    for (int ty = 0; ty < rows; ++ty) {
+        for (int tx = 0; tx < columns; ++tx) {
+            int width = std::min(tileSize, kShareWidth - tx * tileSize) * 4;
+            for (int y = ty * tileSize; y < std::min((ty + 1) * tileSize, kShareHeight); ++y) {
+                size_t offset = (size_t)y * kShareWidth * 4 + (size_t)tx * tileSize * 4;
+                if (memcmp(&previous[offset], &current[offset], width) != 0) {
+                    changed[(size_t)ty * columns + tx] = 1;
+                    ++count;
+                    break;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+/** Runs the session through the detector and checks that the dirty regions
+ cover exactly the tiles a byte compare finds changed. */
+void checkTileChangeDetector(int tileSize)
+{
+    BoardSession session;
+    media::TileChangeDetector detector(tileSize);
+    std::vector<agora::rtc::Rect> dirty;
+    std::vector<unsigned char> previous = session.pixels;
+    std::vector<uint8_t> expected;
+    int columns = (kShareWidth + tileSize - 1) / tileSize;
+    detector.detect(&session.pixels[0], session.stride(), kShareWidth, kShareHeight, 4, dirty);
+
+    for (int frame = 1; frame <= kCheckedFrames; ++frame) {
+        session.step();
+        int count = detector.detect(&session.pixels[0], session.stride(), kShareWidth, kShareHeight, 4, dirty);
+        int expectedCount = changedTiles(previous, session.pixels, tileSize, expected);
+
+        std::vector<uint8_t> covered(expected.size(), 0);
+        for (size_t i = 0; i < dirty.size(); ++i) {
+            const agora::rtc::Rect& r = dirty[i];
+            for (int y = r.top; y < r.bottom; y += tileSize)
+                for (int x = r.left; x < r.right; x += tileSize)
+                    ++covered[(size_t)(y / tileSize) * columns + x / tileSize];
+        }
+        bool match = count == expectedCount;
+        for (size_t i = 0; match && i < expected.size(); ++i)
+            match = covered[i] == expected[i];
+        if (!match) {
+            fprintf(stderr, "TileChangeDetector(%d): frame %d reports %d tiles, %d changed\n", tileSize, frame,
+                    count, expectedCount);
+            abort();
+        }
+        previous = session.pixels;
+    }
+}
+
+void detectBoardSession(State& state, int tileSize)
+{
+    static bool checked[2];
+    bool& done = checked[tileSize == 16 ? 0 : 1];
+    if (!done) {
+        checkTileChangeDetector(tileSize);
+        done = true;
+    }
+
+    BoardSession session;
+    media::TileChangeDetector detector(tileSize);
+    std::vector<agora::rtc::Rect> dirty;
+    int tiles = 0;
+    while (state.keepRunning()) {
+        session.step();
+        tiles += detector.detect(&session.pixels[0], session.stride(), kShareWidth, kShareHeight, 4, dirty);
+    }
+    doNotOptimize(tiles);
+    state.setItemsProcessed(state.iterations());
+    state.setBytesProcessed(state.iterations() * session.pixels.size());
+}
+
+// Baseline: keep a copy of the previous frame and compare bytes.
+void BM_TileChange_memcmp720p(State& state)
+{
+    BoardSession session;
+    std::vector<unsigned char> previous = session.pixels;
+    std::vector<uint8_t> changed;
+    int tiles = 0;
+    while (state.keepRunning()) {
+        session.step();
+        tiles += changedTiles(previous, session.pixels, 16, changed);
+        memcpy(&previous[0], &session.pixels[0], previous.size());
+    }
+    doNotOptimize(tiles);
+    state.setItemsProcessed(state.iterations());
+    state.setBytesProcessed(state.iterations() * session.pixels.size());
+}
+TALKBOARD_BENCHMARK(BM_TileChange_memcmp720p);
+
+void BM_TileChangeDetector_board720p_tile16(State& state)
+{
+    detectBoardSession(state, 16);
+}
+TALKBOARD_BENCHMARK(BM_TileChangeDetector_board720p_tile16);
+
+void BM_TileChangeDetector_board720p_tile64(State& state)
+{
+    detectBoardSession(state, 64);
+}
+TALKBOARD_BENCHMARK(BM_TileChangeDetector_board720p_tile64);
+
+} // namespace
@@ -0,0 +1,103 @@
+//
+//  TalkBoard Benchmarks
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Benchmark.h"
+
+using namespace talkboard::bench;
+
+namespace {
+
+void usage(const char* program)
+{
+    fprintf(stderr,
+            "usage: %s [--filter SUBSTRING] [--warmup-ms N] [--batch-ms N] [--repetitions N]\n"
+            "          [--outlier-threshold Z] [--cpu N] [--out FILE] [--list]\n",
+            program);
+}
+
+bool parseInt(const char* text, int& value)
+{
+    char* end = NULL;
+    long parsed = strtol(text, &end, 10);
+    if (!*text || *end || parsed < -1 || parsed > 1000000)
+        return false;
+    value = (int)parsed;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    RunOptions options;
+    const char* outPath = NULL;
+    bool list = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = true;
+        if (strcmp(arg, "--list") == 0) {
+            list = true;
+            continue;
+        } else if (!value) {
+            ok = false;
+        } else if (strcmp(arg, "--filter") == 0) {
+            options.filter = value;
+        } else if (strcmp(arg, "--warmup-ms") == 0) {
+            ok = parseInt(value, options.warmupMs) && options.warmupMs >= 0;
+        } else if (strcmp(arg, "--batch-ms") == 0) {
+            ok = parseInt(value, options.batchMs) && options.batchMs > 0;
+        } else if (strcmp(arg, "--repetitions") == 0) {
+            ok = parseInt(value, options.repetitions) && options.repetitions > 0;
+        } else if (strcmp(arg, "--outlier-threshold") == 0) {
+            options.outlierThreshold = atof(value);
+            ok = options.outlierThreshold > 0;
+        } else if (strcmp(arg, "--cpu") == 0) {
+            ok = parseInt(value, options.cpu);
+        } else if (strcmp(arg, "--out") == 0) {
+            outPath = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return 2;
+        }
+        ++i;
+    }
+
+    if (list) {
+        std::vector<std::string> names = benchmarkNames();
+        for (size_t i = 0; i < names.size(); ++i)
+            printf("%s\n", names[i].c_str());
+        return 0;
+    }
+
+    bool pinned = false;
+    if (options.cpu >= 0) {
+        pinned = pinToCpu(options.cpu) == 0;
+        if (!pinned)
+            fprintf(stderr, "warning: could not pin to CPU %d; running unpinned\n", options.cpu);
+    }
+
+    std::vector<Result> results = runBenchmarks(options, stderr);
+
+    FILE* out = stdout;
+    if (outPath) {
+        out = fopen(outPath, "w");
+        if (!out) {
+            fprintf(stderr, "cannot open %s\n", outPath);
+            return 1;
+        }
+    }
+    writeJson(results, options, pinned, out);
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
@@ -0,0 +1,32 @@
+//
+//  TalkBoard Engine
+//
+//  Objective-C++ glue between PackedVideoFrame and AgoraVideoFrame.
+//
+
+#ifndef TALKBOARD_AGORA_VIDEO_FRAME_ADAPTER_H
+#define TALKBOARD_AGORA_VIDEO_FRAME_ADAPTER_H
+
+#ifdef __OBJC__
+
+#import <AgoraRtcEngineKit/AgoraRtcEngineKit.h>
+
+#include "VideoFramePacker.h"
+
+namespace talkboard {
+namespace media {
+
+/** Wraps `frame` in an AgoraVideoFrame without copying the pixels.
+
+ The returned object owns the buffer: it goes back to `pool` when the SDK
+ releases dataBuf, so `pool` must outlive every frame pushed with it. `frame`
+ is cleared on success and left untouched on failure.
+ */
+AgoraVideoFrame* makeAgoraVideoFrame(PackedVideoFrame& frame, util::BufferPool& pool);
+
+} // namespace media
+} // namespace talkboard
+
+#endif
+
+#endif
@@ -0,0 +1,41 @@
+//
+//  TalkBoard Engine
+//
+
+#import "AgoraVideoFrameAdapter.h"
+
+namespace talkboard {
+namespace media {
+
+AgoraVideoFrame* makeAgoraVideoFrame(PackedVideoFrame& frame, util::BufferPool& pool)
+{
+    if (!frame.data)
+        return nil;
+
+    util::BufferPool* owner = &pool;
+    NSData* data = [[NSData alloc] initWithBytesNoCopy:frame.data
+                                                length:frame.size
+                                           deallocator:^(void* bytes, NSUInteger length) {
+                                               owner->release(static_cast<unsigned char*>(bytes));
+                                           }];
+    if (!data)
+        return nil;
+
+    AgoraVideoFrame* videoFrame = [[AgoraVideoFrame alloc] init];
+    videoFrame.format = frame.format;
+    videoFrame.time = CMTimeMake(frame.timestampMs, 1000);
+    videoFrame.strideInPixels = frame.strideInPixels;
+    videoFrame.height = frame.height;
+    videoFrame.dataBuf = data;
+    videoFrame.cropLeft = frame.cropLeft;
+    videoFrame.cropTop = frame.cropTop;
+    videoFrame.cropRight = frame.cropRight;
+    videoFrame.cropBottom = frame.cropBottom;
+    videoFrame.rotation = frame.rotation;
+
+    frame = PackedVideoFrame();
+    return videoFrame;
+}
+
+} // namespace media
+} // namespace talkboard
@@ -0,0 +1,275 @@
+//
+//  TalkBoard Engine
+//
+
+#include "AudioMixer.h"
+
+#include <string.h>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+// Define TALKBOARD_MIXER_SCALAR to build the reference scalar mixer.
+#if defined(TALKBOARD_MIXER_SCALAR)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TALKBOARD_MIXER_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TALKBOARD_MIXER_NEON 1
+#endif
+
+namespace talkboard {
+namespace media {
+
+namespace {
+
+const int kGainShift = 12;
+const int kUnityGain = 1 << kGainShift;
+const int kLimiterThreshold = 24576;
+const int kLimiterRange = 32767 - kLimiterThreshold;
+
+inline int32_t scaled(int16_t sample, int gain)
+{
+    return ((int32_t)sample * gain) >> kGainShift;
+}
+
+/** acc[i] += in[i] * gain for `count` samples of identical layout. */
+void accumulate(int32_t* acc, const int16_t* in, int count, int gain)
+{
+    int i = 0;
+#if defined(TALKBOARD_MIXER_SSE2)
+    const __m128i g = _mm_set1_epi16((short)gain);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i lo = _mm_mullo_epi16(v, g);
+        __m128i hi = _mm_mulhi_epi16(v, g);
+        __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), kGainShift);
+        __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), kGainShift);
+        __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), p0));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), p1));
+    }
+#elif defined(TALKBOARD_MIXER_NEON)
+    const int16x4_t g = vdup_n_s16((int16_t)gain);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        int32x4_t p0 = vshrq_n_s32(vmull_s16(vget_low_s16(v), g), kGainShift);
+        int32x4_t p1 = vshrq_n_s32(vmull_s16(vget_high_s16(v), g), kGainShift);
+        vst1q_s32(acc + i, vaddq_s32(vld1q_s32(acc + i), p0));
+        vst1q_s32(acc + i + 4, vaddq_s32(vld1q_s32(acc + i + 4), p1));
+    }
+#endif
+    for (; i < count; ++i)
+        acc[i] += scaled(in[i], gain);
+}
+
+/** Adds `frames` mono samples to both channels of a stereo accumulator. */
+void accumulateMonoToStereo(int32_t* acc, const int16_t* in, int frames, int gain)
+{
+    int i = 0;
+#if defined(TALKBOARD_MIXER_SSE2)
+    const __m128i g = _mm_set1_epi16((short)gain);
+    for (; i + 8 <= frames; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i lo = _mm_mullo_epi16(v, g);
+        __m128i hi = _mm_mulhi_epi16(v, g);
+        __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), kGainShift);
+        __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), kGainShift);
+        __m128i* a = reinterpret_cast<__m128i*>(acc + 2 * i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_unpacklo_epi32(p0, p0)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi32(p0, p0)));
+        _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_unpacklo_epi32(p1, p1)));
+        _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_unpackhi_epi32(p1, p1)));
+    }
+#elif defined(TALKBOARD_MIXER_NEON)
+    const int16x4_t g = vdup_n_s16((int16_t)gain);
+    for (; i + 4 <= frames; i += 4) {
+        int32x4_t p = vshrq_n_s32(vmull_s16(vld1_s16(in + i), g), kGainShift);
+        int32x4x2_t both = vzipq_s32(p, p);
+        int32_t* a = acc + 2 * i;
+        vst1q_s32(a, vaddq_s32(vld1q_s32(a), both.val[0]));
+        vst1q_s32(a + 4, vaddq_s32(vld1q_s32(a + 4), both.val[1]));
+    }
+#endif
+    for (; i < frames; ++i) {
+        int32_t p = scaled(in[i], gain);
+        acc[2 * i] += p;
+        acc[2 * i + 1] += p;
+    }
+}
+
+/** Adds the average of each stereo pair to a mono accumulator. */
+void accumulateStereoToMono(int32_t* acc, const int16_t* in, int frames, int gain)
+{
+    for (int i = 0; i < frames; ++i)
+        acc[i] += (scaled(in[2 * i], gain) + scaled(in[2 * i + 1], gain)) >> 1;
+}
+
+/** Passes samples below the threshold unchanged and bends the rest towards full scale. */
+inline int16_t limit(int32_t x)
+{
+    int32_t magnitude = x < 0 ? -x : x;
+    if (magnitude <= kLimiterThreshold)
+        return (int16_t)x;
+    int64_t over = magnitude - kLimiterThreshold;
+    int32_t bent = kLimiterThreshold + (int32_t)(over * kLimiterRange / (over + kLimiterRange));
+    return (int16_t)(x < 0 ? -bent : bent);
+}
+
+bool exceedsThreshold(const int32_t* acc, int count)
+{
+    int i = 0;
+#if defined(TALKBOARD_MIXER_SSE2)
+    const __m128i high = _mm_set1_epi32(kLimiterThreshold);
+    const __m128i low = _mm_set1_epi32(-kLimiterThreshold);
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i out = _mm_or_si128(_mm_cmpgt_epi32(v, high), _mm_cmplt_epi32(v, low));
+        if (_mm_movemask_epi8(out))
+            return true;
+    }
+#endif
+    for (; i < count; ++i) {
+        if (acc[i] > kLimiterThreshold || acc[i] < -kLimiterThreshold)
+            return true;
+    }
+    return false;
+}
+
+void finish(const int32_t* acc, int16_t* out, int count)
+{
+    // Quiet blocks, the common case, are a plain narrowing; the limiter only
+    // runs on blocks that contain a loud sample. Both give the same result.
+    const int kBlock = 64;
+    for (int begin = 0; begin < count; begin += kBlock) {
+        int n = count - begin < kBlock ? count - begin : kBlock;
+        if (exceedsThreshold(acc + begin, n)) {
+            for (int i = 0; i < n; ++i)
+                out[begin + i] = limit(acc[begin + i]);
+        } else {
+            for (int i = 0; i < n; ++i)
+                out[begin + i] = (int16_t)acc[begin + i];
+        }
+    }
+}
+
+} // namespace
+
+const float AudioMixer::MAX_GAIN = 32767.0f / kUnityGain;
+
+AudioMixer::AudioMixer(int channels)
+    : m_channels(channels > 1 ? 2 : 1)
+    , m_frames(0)
+    , m_streams(0)
+    , m_sampleRate(0)
+{
+    for (int i = 0; i < MAX_GAIN_ENTRIES; ++i) {
+        m_gains[i].key.store(0, std::memory_order_relaxed);
+        m_gains[i].q12.store(kUnityGain, std::memory_order_relaxed);
+    }
+}
+
+int AudioMixer::setGain(agora::rtc::uid_t uid, float gain)
+{
+    if (gain < 0)
+        gain = 0;
+    if (gain > MAX_GAIN)
+        gain = MAX_GAIN;
+    int q12 = (int)(gain * kUnityGain + 0.5f);
+    if (q12 > 32767)
+        q12 = 32767;
+
+    uint64_t key = (uint64_t)uid | (1ULL << 32);
+    uint32_t start = (uint32_t)uid * 2654435761u;
+    for (int probe = 0; probe < MAX_GAIN_ENTRIES; ++probe) {
+        Gain& entry = m_gains[(start + probe) % MAX_GAIN_ENTRIES];
+        uint64_t current = entry.key.load(std::memory_order_acquire);
+        if (current == 0) {
+            // Until the gain below is stored, readers see the unity gain the
+            // entry was initialized with.
+            uint64_t expected = 0;
+            if (entry.key.compare_exchange_strong(expected, key, std::memory_order_acq_rel))
+                current = key;
+            else
+                current = expected;
+        }
+        if (current == key) {
+            entry.q12.store(q12, std::memory_order_relaxed);
+            return 0;
+        }
+    }
+    return -agora::ERR_RESOURCE_LIMITED;
+}
+
+int AudioMixer::gainFor(agora::rtc::uid_t uid)
+{
+    uint64_t key = (uint64_t)uid | (1ULL << 32);
+    uint32_t start = (uint32_t)uid * 2654435761u;
+    for (int probe = 0; probe < MAX_GAIN_ENTRIES; ++probe) {
+        const Gain& entry = m_gains[(start + probe) % MAX_GAIN_ENTRIES];
+        uint64_t current = entry.key.load(std::memory_order_acquire);
+        if (current == key)
+            return entry.q12.load(std::memory_order_relaxed);
+        if (current == 0)
+            break;
+    }
+    return kUnityGain;
+}
+
+int AudioMixer::addFrame(agora::rtc::uid_t uid, const agora::media::IAudioFrameObserver::AudioFrame& frame)
+{
+    if (frame.type != agora::media::IAudioFrameObserver::FRAME_TYPE_PCM16 || frame.bytesPerSample != 2
+        || !frame.buffer || frame.samples <= 0 || frame.channels < 1 || frame.channels > 2)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    if (m_accumulator.size() < (size_t)frame.samples * m_channels)
+        m_accumulator.resize((size_t)frame.samples * m_channels, 0);
+    if (frame.samples > m_frames)
+        m_frames = frame.samples;
+    m_sampleRate = frame.samplesPerSec;
+
+    int gain = gainFor(uid);
+    if (gain == 0)
+        return 0;
+
+    const int16_t* in = static_cast<const int16_t*>(frame.buffer);
+    int32_t* acc = &m_accumulator[0];
+    if (frame.channels == m_channels)
+        accumulate(acc, in, frame.samples * m_channels, gain);
+    else if (frame.channels == 1)
+        accumulateMonoToStereo(acc, in, frame.samples, gain);
+    else
+        accumulateStereoToMono(acc, in, frame.samples, gain);
+    ++m_streams;
+    return 0;
+}
+
+int AudioMixer::mixTo(agora::media::IAudioFrameObserver::AudioFrame& frame)
+{
+    if (!frame.buffer || frame.samples <= 0)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    int16_t* out = static_cast<int16_t*>(frame.buffer);
+    int frames = m_frames ? (m_frames < frame.samples ? m_frames : frame.samples) : frame.samples;
+    if (m_frames)
+        finish(&m_accumulator[0], out, frames * m_channels);
+    else
+        memset(out, 0, (size_t)frames * m_channels * sizeof(int16_t));
+
+    frame.type = agora::media::IAudioFrameObserver::FRAME_TYPE_PCM16;
+    frame.samples = frames;
+    frame.bytesPerSample = 2;
+    frame.channels = m_channels;
+    if (m_sampleRate)
+        frame.samplesPerSec = m_sampleRate;
+
+    int streams = m_streams;
+    if (m_frames)
+        memset(&m_accumulator[0], 0, (size_t)m_frames * m_channels * sizeof(int32_t));
+    m_frames = 0;
+    m_streams = 0;
+    return streams;
+}
+
+} // namespace media
+} // namespace talkboard
@@ -0,0 +1,92 @@
+//
+//  TalkBoard Engine
+//
+//  PCM16 mixer for the per-uid frames of onPlaybackAudioFrameBeforeMixing.
+//
+
+#ifndef TALKBOARD_AUDIO_MIXER_H
+#define TALKBOARD_AUDIO_MIXER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraMediaEngine.h>
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+namespace talkboard {
+namespace media {
+
+/** Mixes remote speakers into one PCM16 stream with per-uid gain.
+
+ Frames are accumulated as they arrive: call addFrame() from
+ onPlaybackAudioFrameBeforeMixing for every uid, then mixTo() once per audio
+ tick (e.g. from onPlaybackAudioFrame) to get the mix and start the next one.
+ Mono inputs are duplicated into stereo output and stereo inputs are averaged
+ into mono output.
+
+ All arithmetic is integer: gains are Q12 fixed point, products are summed in
+ 32 bits and the soft limiter is scalar integer code. The SSE2/NEON and scalar
+ (TALKBOARD_MIXER_SCALAR) builds therefore produce bit-identical output.
+ */
+class AudioMixer
+{
+public:
+    /** Largest gain setGain() accepts. */
+    static const float MAX_GAIN;
+    /** Number of uids that can have a gain other than 1. */
+    enum { MAX_GAIN_ENTRIES = 128 };
+
+    /** @param channels Output channels, 1 or 2. */
+    explicit AudioMixer(int channels = 2);
+
+    /** Sets the gain of `uid`, clamped to [0, MAX_GAIN]. Safe to call from any thread.
+
+     @return
+
+     - 0: Success.
+     - < 0: -ERR_RESOURCE_LIMITED when MAX_GAIN_ENTRIES uids already have a gain.
+     */
+    int setGain(agora::rtc::uid_t uid, float gain);
+
+    /** Adds a PCM16 frame of `uid` to the current mix. Audio thread only.
+     */
+    int addFrame(agora::rtc::uid_t uid, const agora::media::IAudioFrameObserver::AudioFrame& frame);
+
+    /** Writes the current mix to `frame` and starts a new one. Audio thread only.
+
+     On input `frame.samples` is the capacity of `frame.buffer` in frames; on
+     return it is the number of frames written. Without any input since the
+     last call the mix is `frame.samples` frames of silence.
+
+     @return Number of streams in the mix.
+     */
+    int mixTo(agora::media::IAudioFrameObserver::AudioFrame& frame);
+
+    int channels() const { return m_channels; }
+
+private:
+    // Open-addressed table so the audio thread can read gains without a lock.
+    // A key is the uid with bit 32 set; 0 marks a free entry.
+    struct Gain {
+        std::atomic<uint64_t> key;
+        std::atomic<int> q12;
+    };
+
+    int gainFor(agora::rtc::uid_t uid);
+
+    int m_channels;
+    /** Sized for the largest frame seen; only the first m_frames are in use. */
+    std::vector<int32_t> m_accumulator;
+    /** Frames in the current mix: the longest frame added since mixTo(). */
+    int m_frames;
+    int m_streams;
+    int m_sampleRate;
+
+    Gain m_gains[MAX_GAIN_ENTRIES];
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,151 @@
+//
+//  TalkBoard Engine
+//
+
+#include "AudioRingBuffer.h"
+
+#include <string.h>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+namespace talkboard {
+namespace media {
+
+namespace {
+
+uint32_t nextPowerOfTwo(uint32_t value)
+{
+    uint32_t p = 1;
+    while (p < value)
+        p <<= 1;
+    return p;
+}
+
+} // namespace
+
+AudioRingBuffer::AudioRingBuffer(int sampleRate, int channels, int capacityMs)
+    : m_mask(nextPowerOfTwo((uint32_t)((int64_t)sampleRate * capacityMs / 1000)) - 1)
+    , m_sampleRate(sampleRate)
+    , m_channels(channels > 1 ? 2 : 1)
+{
+    m_write.position.store(0, std::memory_order_relaxed);
+    m_write.cachedOther = 0;
+    m_read.position.store(0, std::memory_order_relaxed);
+    m_read.cachedOther = 0;
+    m_underruns.store(0, std::memory_order_relaxed);
+    m_overruns.store(0, std::memory_order_relaxed);
+    m_droppedFrames.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < LATENCY_BUCKETS; ++i)
+        m_latency[i].store(0, std::memory_order_relaxed);
+    m_samples.resize((size_t)(m_mask + 1) * m_channels);
+}
+
+int AudioRingBuffer::write(const int16_t* samples, int frames)
+{
+    if (!samples || frames <= 0)
+        return 0;
+
+    uint32_t capacity = m_mask + 1;
+    uint32_t writePos = m_write.position.load(std::memory_order_relaxed);
+    uint32_t space = capacity - (writePos - m_write.cachedOther);
+    if (space < (uint32_t)frames) {
+        m_write.cachedOther = m_read.position.load(std::memory_order_acquire);
+        space = capacity - (writePos - m_write.cachedOther);
+    }
+
+    uint32_t count = (uint32_t)frames < space ? (uint32_t)frames : space;
+    if (count < (uint32_t)frames) {
+        m_overruns.store(m_overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_droppedFrames.store(m_droppedFrames.load(std::memory_order_relaxed) + (frames - count), std::memory_order_relaxed);
+    }
+
+    uint32_t start = writePos & m_mask;
+    uint32_t first = capacity - start < count ? capacity - start : count;
+    memcpy(&m_samples[(size_t)start * m_channels], samples, (size_t)first * m_channels * sizeof(int16_t));
+    if (count > first)
+        memcpy(&m_samples[0], samples + (size_t)first * m_channels, (size_t)(count - first) * m_channels * sizeof(int16_t));
+
+    m_write.position.store(writePos + count, std::memory_order_release);
+    return (int)count;
+}
+
+int AudioRingBuffer::read(int16_t* out, int frames)
+{
+    if (!out || frames <= 0)
+        return 0;
+
+    uint32_t capacity = m_mask + 1;
+    uint32_t readPos = m_read.position.load(std::memory_order_relaxed);
+    uint32_t buffered = m_read.cachedOther - readPos;
+    if (buffered < (uint32_t)frames) {
+        m_read.cachedOther = m_write.position.load(std::memory_order_acquire);
+        buffered = m_read.cachedOther - readPos;
+    }
+    recordLatency(buffered);
+
+    uint32_t count = (uint32_t)frames < buffered ? (uint32_t)frames : buffered;
+    uint32_t start = readPos & m_mask;
+    uint32_t first = capacity - start < count ? capacity - start : count;
+    memcpy(out, &m_samples[(size_t)start * m_channels], (size_t)first * m_channels * sizeof(int16_t));
+    if (count > first)
+        memcpy(out + (size_t)first * m_channels, &m_samples[0], (size_t)(count - first) * m_channels * sizeof(int16_t));
+
+    if (count < (uint32_t)frames) {
+        memset(out + (size_t)count * m_channels, 0, (size_t)(frames - count) * m_channels * sizeof(int16_t));
+        m_underruns.store(m_underruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    m_read.position.store(readPos + count, std::memory_order_release);
+    return (int)count;
+}
+
+int AudioRingBuffer::read(agora::media::IAudioFrameObserver::AudioFrame& frame, int samplesPerCall)
+{
+    if (!frame.buffer || samplesPerCall <= 0)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    frame.type = agora::media::IAudioFrameObserver::FRAME_TYPE_PCM16;
+    frame.samples = samplesPerCall;
+    frame.bytesPerSample = 2;
+    frame.channels = m_channels;
+    frame.samplesPerSec = m_sampleRate;
+    return read(static_cast<int16_t*>(frame.buffer), samplesPerCall);
+}
+
+int AudioRingBuffer::pushTo(agora::media::IMediaEngine& engine, int samplesPerCall, int64_t renderTimeMs)
+{
+    if (samplesPerCall <= 0)
+        return -agora::ERR_INVALID_ARGUMENT;
+    // Sized once for the steady-state call size; only a larger samplesPerCall allocates.
+    if (m_scratch.size() < (size_t)samplesPerCall * m_channels)
+        m_scratch.resize((size_t)samplesPerCall * m_channels);
+
+    agora::media::IAudioFrameObserver::AudioFrame frame;
+    frame.buffer = &m_scratch[0];
+    frame.renderTimeMs = renderTimeMs;
+    frame.avsync_type = 0;
+    read(frame, samplesPerCall);
+    return engine.pushAudioFrame(agora::media::AUDIO_RECORDING_SOURCE, &frame, false);
+}
+
+int AudioRingBuffer::available() const
+{
+    return (int)(m_write.position.load(std::memory_order_acquire) - m_read.position.load(std::memory_order_acquire));
+}
+
+void AudioRingBuffer::recordLatency(uint32_t buffered)
+{
+    uint32_t ms = (uint32_t)((uint64_t)buffered * 1000 / m_sampleRate);
+    int bucket = ms < LATENCY_BUCKETS ? (int)ms : LATENCY_BUCKETS - 1;
+    m_latency[bucket].store(m_latency[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+uint64_t AudioRingBuffer::latencyCount(int bucket) const
+{
+    if (bucket < 0 || bucket >= LATENCY_BUCKETS)
+        return 0;
+    return m_latency[bucket].load(std::memory_order_relaxed);
+}
+
+} // namespace media
+} // namespace talkboard
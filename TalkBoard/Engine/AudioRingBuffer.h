@@ -0,0 +1,117 @@
+//
+//  TalkBoard Engine
+//
+//  Single-producer/single-consumer PCM16 ring buffer feeding the external audio source.
+//
+
+#ifndef TALKBOARD_AUDIO_RING_BUFFER_H
+#define TALKBOARD_AUDIO_RING_BUFFER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraMediaEngine.h>
+
+#ifndef TALKBOARD_CACHE_LINE_SIZE
+#define TALKBOARD_CACHE_LINE_SIZE 64
+#endif
+
+namespace talkboard {
+namespace media {
+
+/** Interleaved PCM16 ring buffer between one producer thread and the audio thread.
+
+ Both sides are wait-free: write() and read() take no lock, never spin and do
+ a bounded amount of work. The producer may write any number of frames per
+ call; the consumer always reads exactly `samplesPerCall` frames, the size the
+ SDK expects from IMediaEngine::pushAudioFrame. Missing frames are replaced by
+ silence and counted as underruns, frames that do not fit are dropped and
+ counted as overruns.
+
+ A "frame" here is one sample per channel, as in AudioFrame::samples.
+ */
+class AudioRingBuffer
+{
+public:
+    /** Buckets of the buffered-audio histogram, 1 ms each; the last one collects the rest. */
+    enum { LATENCY_BUCKETS = 256 };
+
+    /**
+     @param sampleRate Rate passed to setExternalAudioSource.
+     @param channels 1 or 2, as passed to setExternalAudioSource.
+     @param capacityMs Capacity of the ring; rounded up to a power of two frames.
+     */
+    AudioRingBuffer(int sampleRate, int channels, int capacityMs = 200);
+
+    /** Producer side. Returns the number of frames stored. */
+    int write(const int16_t* samples, int frames);
+
+    /** Consumer side. Fills `frames` frames into `out`, padding with silence on underrun.
+
+     @return Number of frames that came from the producer.
+     */
+    int read(int16_t* out, int frames);
+
+    /** Consumer side. Fills `frame` with `samplesPerCall` frames of this ring's format.
+
+     `frame.buffer` must hold samplesPerCall * channels samples.
+     */
+    int read(agora::media::IAudioFrameObserver::AudioFrame& frame, int samplesPerCall);
+
+    /** Consumer side. Reads `samplesPerCall` frames and sends them with IMediaEngine::pushAudioFrame.
+
+     Uses a scratch buffer owned by the ring, so only the consumer thread may call it.
+     */
+    int pushTo(agora::media::IMediaEngine& engine, int samplesPerCall, int64_t renderTimeMs);
+
+    /** Frames currently stored. Exact on either side, approximate elsewhere. */
+    int available() const;
+
+    int sampleRate() const { return m_sampleRate; }
+    int channels() const { return m_channels; }
+    int capacity() const { return (int)m_mask + 1; }
+
+    /** Reads that could not be fully served. */
+    uint64_t underruns() const { return m_underruns.load(std::memory_order_relaxed); }
+    /** Writes that did not fit. */
+    uint64_t overruns() const { return m_overruns.load(std::memory_order_relaxed); }
+    /** Frames dropped by overruns. */
+    uint64_t droppedFrames() const { return m_droppedFrames.load(std::memory_order_relaxed); }
+
+    /** Reads whose buffered audio was in [bucket, bucket + 1) ms before the read. */
+    uint64_t latencyCount(int bucket) const;
+
+private:
+    AudioRingBuffer(const AudioRingBuffer&);
+    AudioRingBuffer& operator=(const AudioRingBuffer&);
+
+    void recordLatency(uint32_t buffered);
+
+    // Producer and consumer state live on separate cache lines so the two
+    // threads never write to the same line.
+    struct alignas(TALKBOARD_CACHE_LINE_SIZE) Cursor {
+        std::atomic<uint32_t> position;
+        /** Last value of the other side's position seen by this side. */
+        uint32_t cachedOther;
+    };
+
+    Cursor m_write;
+    Cursor m_read;
+    // Counters, grouped by the thread that updates them.
+    alignas(TALKBOARD_CACHE_LINE_SIZE) std::atomic<uint64_t> m_overruns;
+    std::atomic<uint64_t> m_droppedFrames;
+    alignas(TALKBOARD_CACHE_LINE_SIZE) std::atomic<uint64_t> m_underruns;
+    std::atomic<uint32_t> m_latency[LATENCY_BUCKETS];
+
+    std::vector<int16_t> m_samples;
+    std::vector<int16_t> m_scratch;
+    uint32_t m_mask;
+    int m_sampleRate;
+    int m_channels;
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,112 @@
+//
+//  TalkBoard Engine
+//
+
+#include "BufferPool.h"
+
+#include <stdlib.h>
+
+namespace talkboard {
+namespace util {
+
+namespace {
+
+size_t roundUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+BufferPool::BufferPool(size_t alignment, size_t maxPooled)
+    : m_alignment(alignment < sizeof(void*) ? sizeof(void*) : alignment)
+    , m_maxPooled(maxPooled)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+BufferPool::~BufferPool()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_idle.size(); ++i)
+        free(m_idle[i].data);
+    // Buffers still held by callers are leaked on purpose: freeing them here
+    // would leave dangling pointers in frames that are still in flight.
+    m_idle.clear();
+}
+
+unsigned char* BufferPool::acquire(size_t size, size_t* capacity)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Best fit: the smallest idle buffer that is large enough.
+    size_t best = m_idle.size();
+    for (size_t i = 0; i < m_idle.size(); ++i) {
+        if (m_idle[i].capacity >= size && (best == m_idle.size() || m_idle[i].capacity < m_idle[best].capacity))
+            best = i;
+    }
+
+    Block block;
+    if (best != m_idle.size()) {
+        block = m_idle[best];
+        m_idle[best] = m_idle.back();
+        m_idle.pop_back();
+        ++m_hits;
+    } else {
+        block.capacity = roundUp(size ? size : 1, m_alignment);
+        void* p = NULL;
+        if (posix_memalign(&p, m_alignment, block.capacity) != 0)
+            return NULL;
+        block.data = static_cast<unsigned char*>(p);
+        ++m_misses;
+    }
+
+    m_busy.push_back(block);
+    if (capacity)
+        *capacity = block.capacity;
+    return block.data;
+}
+
+void BufferPool::release(unsigned char* buffer)
+{
+    if (!buffer)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_busy.size(); ++i) {
+        if (m_busy[i].data != buffer)
+            continue;
+        Block block = m_busy[i];
+        m_busy[i] = m_busy.back();
+        m_busy.pop_back();
+        if (m_idle.size() < m_maxPooled)
+            m_idle.push_back(block);
+        else
+            free(block.data);
+        return;
+    }
+}
+
+void BufferPool::trim()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_idle.size(); ++i)
+        free(m_idle[i].data);
+    m_idle.clear();
+}
+
+size_t BufferPool::hits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+size_t BufferPool::misses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+} // namespace util
+} // namespace talkboard
@@ -0,0 +1,71 @@
+//
+//  TalkBoard Engine
+//
+//  Pool of aligned byte buffers shared by the frame and packet paths.
+//
+
+#ifndef TALKBOARD_BUFFER_POOL_H
+#define TALKBOARD_BUFFER_POOL_H
+
+#include <stddef.h>
+#include <mutex>
+#include <vector>
+
+namespace talkboard {
+namespace util {
+
+/** A pool of aligned heap buffers.
+
+ Buffers are handed out by capacity and returned with release(). The pool keeps
+ at most `maxPooled` idle buffers; anything beyond that is freed on release.
+ All methods are thread-safe.
+ */
+class BufferPool
+{
+public:
+    explicit BufferPool(size_t alignment = 64, size_t maxPooled = 8);
+    ~BufferPool();
+
+    /** Returns a buffer of at least `size` bytes, or NULL if allocation failed.
+
+     @param size Requested size in bytes.
+     @param capacity Receives the real capacity of the returned buffer. May be NULL.
+     */
+    unsigned char* acquire(size_t size, size_t* capacity = NULL);
+
+    /** Returns a buffer obtained from acquire() to the pool.
+     */
+    void release(unsigned char* buffer);
+
+    /** Frees every idle buffer.
+     */
+    void trim();
+
+    size_t alignment() const { return m_alignment; }
+    /** Number of acquire() calls served from the pool. */
+    size_t hits() const;
+    /** Number of acquire() calls that had to allocate. */
+    size_t misses() const;
+
+private:
+    BufferPool(const BufferPool&);
+    BufferPool& operator=(const BufferPool&);
+
+    struct Block {
+        unsigned char* data;
+        size_t capacity;
+    };
+
+    size_t m_alignment;
+    size_t m_maxPooled;
+    mutable std::mutex m_mutex;
+    std::vector<Block> m_idle;
+    std::vector<Block> m_busy;
+    size_t m_hits;
+    size_t m_misses;
+};
+
+} // namespace util
+} // namespace talkboard
+
+#endif
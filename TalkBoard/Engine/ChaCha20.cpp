@@ -0,0 +1,318 @@
+//
+//  TalkBoard Engine
+//
+
+#include "ChaCha20.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TALKBOARD_CHACHA_SIMD 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TALKBOARD_CHACHA_NEON 1
+#define TALKBOARD_CHACHA_SIMD 1
+#endif
+
+namespace talkboard {
+namespace util {
+
+namespace {
+
+// "expand 32-byte k"
+const uint32_t kSigma[4] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+const int kDoubleRounds = 10;
+const size_t kWideBytes = 4 * ChaCha20::BLOCK_SIZE;
+
+inline uint32_t load32(const unsigned char* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline void store32(unsigned char* p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+inline uint32_t rotl(uint32_t v, int n)
+{
+    return (v << n) | (v >> (32 - n));
+}
+
+/** The initial state of RFC 8439 section 2.3. */
+void initState(uint32_t state[16], const uint32_t key[8], const unsigned char* nonce, uint32_t counter)
+{
+    memcpy(state, kSigma, sizeof(kSigma));
+    memcpy(state + 4, key, 8 * sizeof(uint32_t));
+    state[12] = counter;
+    state[13] = load32(nonce);
+    state[14] = load32(nonce + 4);
+    state[15] = load32(nonce + 8);
+}
+
+#define TALKBOARD_QUARTER_ROUND(a, b, c, d) \
+    a += b; d = rotl(d ^ a, 16);            \
+    c += d; b = rotl(b ^ c, 12);            \
+    a += b; d = rotl(d ^ a, 8);             \
+    c += d; b = rotl(b ^ c, 7);
+
+/** One 64-byte key stream block. */
+void block(const uint32_t state[16], unsigned char out[ChaCha20::BLOCK_SIZE])
+{
+    uint32_t x[16];
+    memcpy(x, state, sizeof(x));
+    for (int i = 0; i < kDoubleRounds; ++i) {
+        TALKBOARD_QUARTER_ROUND(x[0], x[4], x[8], x[12])
+        TALKBOARD_QUARTER_ROUND(x[1], x[5], x[9], x[13])
+        TALKBOARD_QUARTER_ROUND(x[2], x[6], x[10], x[14])
+        TALKBOARD_QUARTER_ROUND(x[3], x[7], x[11], x[15])
+        TALKBOARD_QUARTER_ROUND(x[0], x[5], x[10], x[15])
+        TALKBOARD_QUARTER_ROUND(x[1], x[6], x[11], x[12])
+        TALKBOARD_QUARTER_ROUND(x[2], x[7], x[8], x[13])
+        TALKBOARD_QUARTER_ROUND(x[3], x[4], x[9], x[14])
+    }
+    for (int i = 0; i < 16; ++i)
+        store32(out + 4 * i, x[i] + state[i]);
+}
+
+/** XORs `size` bytes, at most one block, with a block of key stream. */
+void xorBlock(const uint32_t state[16], const unsigned char* in, unsigned char* out, size_t size)
+{
+    unsigned char stream[ChaCha20::BLOCK_SIZE];
+    block(state, stream);
+    for (size_t i = 0; i < size; ++i)
+        out[i] = in[i] ^ stream[i];
+}
+
+/** One block at a time, for builds without SIMD and to check the SIMD path. */
+void processScalar(uint32_t state[16], const unsigned char* in, unsigned char* out, size_t size)
+{
+    while (size) {
+        size_t n = size < (size_t)ChaCha20::BLOCK_SIZE ? size : (size_t)ChaCha20::BLOCK_SIZE;
+        xorBlock(state, in, out, n);
+        ++state[12];
+        in += n;
+        out += n;
+        size -= n;
+    }
+}
+
+#if defined(TALKBOARD_CHACHA_SIMD)
+
+// Four blocks side by side: lane i of x[j] is word j of block i.
+#if defined(TALKBOARD_CHACHA_NEON)
+typedef uint32x4_t Vec;
+inline Vec vdup(uint32_t v) { return vdupq_n_u32(v); }
+inline Vec vadd(Vec a, Vec b) { return vaddq_u32(a, b); }
+inline Vec vxor(Vec a, Vec b) { return veorq_u32(a, b); }
+template <int N> inline Vec vrotl(Vec v) { return vsriq_n_u32(vshlq_n_u32(v, N), v, 32 - N); }
+template <> inline Vec vrotl<16>(Vec v) { return vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(v))); }
+inline Vec vload(const unsigned char* p) { return vreinterpretq_u32_u8(vld1q_u8(p)); }
+inline void vstore(unsigned char* p, Vec v) { vst1q_u8(p, vreinterpretq_u8_u32(v)); }
+inline Vec vcounters(uint32_t counter)
+{
+    const uint32_t offsets[4] = { 0, 1, 2, 3 };
+    return vaddq_u32(vdupq_n_u32(counter), vld1q_u32(offsets));
+}
+
+/** Turns words j..j+3 of four blocks into 16 bytes of each block. */
+inline void transpose(Vec& a, Vec& b, Vec& c, Vec& d)
+{
+    uint32x4x2_t ab = vtrnq_u32(a, b);
+    uint32x4x2_t cd = vtrnq_u32(c, d);
+    a = vcombine_u32(vget_low_u32(ab.val[0]), vget_low_u32(cd.val[0]));
+    b = vcombine_u32(vget_low_u32(ab.val[1]), vget_low_u32(cd.val[1]));
+    c = vcombine_u32(vget_high_u32(ab.val[0]), vget_high_u32(cd.val[0]));
+    d = vcombine_u32(vget_high_u32(ab.val[1]), vget_high_u32(cd.val[1]));
+}
+#else
+typedef __m128i Vec;
+inline Vec vdup(uint32_t v) { return _mm_set1_epi32((int)v); }
+inline Vec vadd(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+inline Vec vxor(Vec a, Vec b) { return _mm_xor_si128(a, b); }
+template <int N> inline Vec vrotl(Vec v) { return _mm_or_si128(_mm_slli_epi32(v, N), _mm_srli_epi32(v, 32 - N)); }
+template <> inline Vec vrotl<16>(Vec v) { return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1); }
+inline Vec vload(const unsigned char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline void vstore(unsigned char* p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+inline Vec vcounters(uint32_t counter)
+{
+    return _mm_add_epi32(_mm_set1_epi32((int)counter), _mm_set_epi32(3, 2, 1, 0));
+}
+
+inline void transpose(Vec& a, Vec& b, Vec& c, Vec& d)
+{
+    __m128i ab0 = _mm_unpacklo_epi32(a, b);
+    __m128i cd0 = _mm_unpacklo_epi32(c, d);
+    __m128i ab1 = _mm_unpackhi_epi32(a, b);
+    __m128i cd1 = _mm_unpackhi_epi32(c, d);
+    a = _mm_unpacklo_epi64(ab0, cd0);
+    b = _mm_unpackhi_epi64(ab0, cd0);
+    c = _mm_unpacklo_epi64(ab1, cd1);
+    d = _mm_unpackhi_epi64(ab1, cd1);
+}
+#endif
+
+#define TALKBOARD_QUARTER_ROUND_4(a, b, c, d)         \
+    a = vadd(a, b); d = vrotl<16>(vxor(d, a));        \
+    c = vadd(c, d); b = vrotl<12>(vxor(b, c));        \
+    a = vadd(a, b); d = vrotl<8>(vxor(d, a));         \
+    c = vadd(c, d); b = vrotl<7>(vxor(b, c));
+
+/** XORs kWideBytes of `in` with four blocks of key stream, from block state[12]. */
+void xorBlocks4(const uint32_t state[16], const unsigned char* in, unsigned char* out)
+{
+    Vec s[16];
+    for (int i = 0; i < 16; ++i)
+        s[i] = vdup(state[i]);
+    s[12] = vcounters(state[12]);
+
+    Vec x[16];
+    for (int i = 0; i < 16; ++i)
+        x[i] = s[i];
+    for (int i = 0; i < kDoubleRounds; ++i) {
+        TALKBOARD_QUARTER_ROUND_4(x[0], x[4], x[8], x[12])
+        TALKBOARD_QUARTER_ROUND_4(x[1], x[5], x[9], x[13])
+        TALKBOARD_QUARTER_ROUND_4(x[2], x[6], x[10], x[14])
+        TALKBOARD_QUARTER_ROUND_4(x[3], x[7], x[11], x[15])
+        TALKBOARD_QUARTER_ROUND_4(x[0], x[5], x[10], x[15])
+        TALKBOARD_QUARTER_ROUND_4(x[1], x[6], x[11], x[12])
+        TALKBOARD_QUARTER_ROUND_4(x[2], x[7], x[8], x[13])
+        TALKBOARD_QUARTER_ROUND_4(x[3], x[4], x[9], x[14])
+    }
+    for (int i = 0; i < 16; ++i)
+        x[i] = vadd(x[i], s[i]);
+
+    for (int j = 0; j < 16; j += 4) {
+        transpose(x[j], x[j + 1], x[j + 2], x[j + 3]);
+        for (int b = 0; b < 4; ++b) {
+            size_t offset = (size_t)b * ChaCha20::BLOCK_SIZE + (size_t)j * 4;
+            vstore(out + offset, vxor(vload(in + offset), x[j + b]));
+        }
+    }
+}
+
+#endif
+
+} // namespace
+
+ChaCha20::ChaCha20()
+{
+    memset(m_key, 0, sizeof(m_key));
+}
+
+ChaCha20::ChaCha20(const unsigned char* key)
+{
+    setKey(key);
+}
+
+ChaCha20::~ChaCha20()
+{
+    // Not a guaranteed wipe (the store may be elided), but keeps the key out
+    // of freed heap blocks in the common case.
+    volatile uint32_t* key = m_key;
+    for (int i = 0; i < 8; ++i)
+        key[i] = 0;
+}
+
+void ChaCha20::setKey(const unsigned char* key)
+{
+    for (int i = 0; i < 8; ++i)
+        m_key[i] = load32(key + 4 * i);
+}
+
+void ChaCha20::process(const unsigned char* nonce, uint32_t counter,
+                       const unsigned char* in, unsigned char* out, size_t size) const
+{
+    uint32_t state[16];
+    initState(state, m_key, nonce, counter);
+#if defined(TALKBOARD_CHACHA_SIMD)
+    for (; size >= kWideBytes; size -= kWideBytes) {
+        xorBlocks4(state, in, out);
+        state[12] += 4;
+        in += kWideBytes;
+        out += kWideBytes;
+    }
+    // A tail of more than one block still costs less as four blocks at once.
+    if (size > (size_t)BLOCK_SIZE) {
+        unsigned char tail[kWideBytes];
+        memcpy(tail, in, size);
+        xorBlocks4(state, tail, tail);
+        memcpy(out, tail, size);
+        return;
+    }
+#endif
+    processScalar(state, in, out, size);
+}
+
+bool ChaCha20::selfTest()
+{
+    // RFC 8439 2.3.2: the block function.
+    static const unsigned char kBlockKey[KEY_SIZE] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+    };
+    static const unsigned char kBlockNonce[NONCE_SIZE] = {
+        0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x4a, 0x00, 0x00, 0x00, 0x00,
+    };
+    static const unsigned char kBlockOut[BLOCK_SIZE] = {
+        0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+        0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+        0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09, 0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+        0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e,
+    };
+    // RFC 8439 2.4.2: encryption from block 1.
+    static const unsigned char kNonce[NONCE_SIZE] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4a, 0x00, 0x00, 0x00, 0x00,
+    };
+    static const char kPlaintext[] =
+        "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, "
+        "sunscreen would be it.";
+    static const unsigned char kCiphertext[] = {
+        0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80, 0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81,
+        0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2, 0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b,
+        0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab, 0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57,
+        0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab, 0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8,
+        0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61, 0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e,
+        0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06, 0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36,
+        0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6, 0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42,
+        0x87, 0x4d,
+    };
+    const size_t length = sizeof(kPlaintext) - 1;
+    if (length != sizeof(kCiphertext))
+        return false;
+
+    ChaCha20 cipher(kBlockKey);
+    uint32_t state[16];
+    initState(state, cipher.m_key, kBlockNonce, 1);
+    unsigned char stream[BLOCK_SIZE];
+    block(state, stream);
+    if (memcmp(stream, kBlockOut, BLOCK_SIZE) != 0)
+        return false;
+
+    unsigned char text[sizeof(kCiphertext)];
+    cipher.process(kNonce, 1, reinterpret_cast<const unsigned char*>(kPlaintext), text, length);
+    if (memcmp(text, kCiphertext, length) != 0)
+        return false;
+    cipher.process(kNonce, 1, text, text, length);
+    if (memcmp(text, kPlaintext, length) != 0)
+        return false;
+
+    // A packet-sized run, through the four-block path where there is one,
+    // must match the block function byte for byte.
+    const size_t kRun = 1200;
+    unsigned char wide[kRun];
+    unsigned char single[kRun];
+    for (size_t i = 0; i < kRun; ++i)
+        wide[i] = single[i] = (unsigned char)(i * 31 + 7);
+    cipher.process(kNonce, 0xfffffffe, wide, wide, kRun);
+    initState(state, cipher.m_key, kNonce, 0xfffffffe);
+    processScalar(state, single, single, kRun);
+    return memcmp(wide, single, kRun) == 0;
+}
+
+} // namespace util
+} // namespace talkboard
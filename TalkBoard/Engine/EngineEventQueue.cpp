@@ -0,0 +1,515 @@
+//
+//  TalkBoard Engine
+//
+
+#include "EngineEventQueue.h"
+
+#include <string.h>
+
+namespace talkboard {
+namespace rtc {
+
+using agora::rtc::AudioVolumeInfo;
+using agora::rtc::CLIENT_ROLE_TYPE;
+using agora::rtc::IRtcEngineEventHandler;
+using agora::rtc::LocalVideoStats;
+using agora::rtc::MEDIA_DEVICE_TYPE;
+using agora::rtc::REMOTE_VIDEO_STATE;
+using agora::rtc::RemoteVideoStats;
+using agora::rtc::RtcStats;
+using agora::rtc::USER_OFFLINE_REASON_TYPE;
+using agora::rtc::uid_t;
+
+namespace {
+
+/** Copies `text` into the data area of `event`; returns false if it had to be cut. */
+bool appendText(EngineEvent& event, int index, const char* text)
+{
+    if (!text) {
+        event.text[index] = -1;
+        return true;
+    }
+    size_t room = EngineEvent::MAX_DATA - event.size;
+    if (room == 0) {
+        event.text[index] = -1;
+        return false;
+    }
+    size_t length = strlen(text);
+    bool fits = length < room;
+    if (!fits)
+        length = room - 1;
+    memcpy(event.data + event.size, text, length);
+    event.data[event.size + length] = 0;
+    event.text[index] = (int16_t)event.size;
+    event.size = (uint16_t)(event.size + length + 1);
+    return fits;
+}
+
+/** Copies raw bytes to the start of the data area; returns false if they had to be cut. */
+bool setData(EngineEvent& event, const void* data, size_t length)
+{
+    bool fits = length <= EngineEvent::MAX_DATA;
+    if (!fits)
+        length = EngineEvent::MAX_DATA;
+    if (data && length)
+        memcpy(event.data, data, length);
+    event.size = (uint16_t)length;
+    return fits;
+}
+
+const char* textOf(const EngineEvent& event, int index)
+{
+    return event.text[index] < 0 ? NULL : event.data + event.text[index];
+}
+
+} // namespace
+
+EngineEventQueue::EngineEventQueue(size_t capacity)
+    : m_queue(capacity)
+    , m_dropped(0)
+    , m_truncated(0)
+{
+}
+
+EngineEvent* EngineEventQueue::begin(ENGINE_EVENT_TYPE type, size_t& ticket, uid_t uid, int a0, int a1, int a2, int a3)
+{
+    EngineEvent* event = m_queue.claim(ticket);
+    if (!event) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    // Only the header is reset; data past `size` is never read.
+    event->type = type;
+    event->uid = uid;
+    event->args[0] = a0;
+    event->args[1] = a1;
+    event->args[2] = a2;
+    event->args[3] = a3;
+    event->text[0] = -1;
+    event->text[1] = -1;
+    event->size = 0;
+    event->truncated = false;
+    return event;
+}
+
+void EngineEventQueue::end(EngineEvent* event, size_t ticket)
+{
+    if (event->truncated)
+        m_truncated.fetch_add(1, std::memory_order_relaxed);
+    m_queue.publish(ticket);
+}
+
+void EngineEventQueue::post(ENGINE_EVENT_TYPE type, uid_t uid, int a0, int a1, int a2, int a3)
+{
+    size_t ticket;
+    if (EngineEvent* event = begin(type, ticket, uid, a0, a1, a2, a3))
+        end(event, ticket);
+}
+
+void EngineEventQueue::postText(ENGINE_EVENT_TYPE type, const char* first, const char* second, uid_t uid, int a0, int a1, int a2)
+{
+    size_t ticket;
+    EngineEvent* event = begin(type, ticket, uid, a0, a1, a2);
+    if (!event)
+        return;
+    bool fits = appendText(*event, 0, first);
+    fits = appendText(*event, 1, second) && fits;
+    event->truncated = !fits;
+    end(event, ticket);
+}
+
+size_t EngineEventQueue::drain(IRtcEngineEventHandler& handler, size_t maxEvents)
+{
+    size_t delivered = 0;
+    while (delivered < maxEvents) {
+        EngineEvent* event = m_queue.front();
+        if (!event)
+            break;
+        dispatch(*event, handler);
+        m_queue.pop();
+        ++delivered;
+    }
+    return delivered;
+}
+
+void EngineEventQueue::dispatch(const EngineEvent& event, IRtcEngineEventHandler& handler)
+{
+    const int* a = event.args;
+    switch (event.type) {
+    case ENGINE_EVENT_WARNING: handler.onWarning(a[0], textOf(event, 0)); break;
+    case ENGINE_EVENT_ERROR: handler.onError(a[0], textOf(event, 0)); break;
+    case ENGINE_EVENT_JOIN_CHANNEL_SUCCESS: handler.onJoinChannelSuccess(textOf(event, 0), event.uid, a[0]); break;
+    case ENGINE_EVENT_REJOIN_CHANNEL_SUCCESS: handler.onRejoinChannelSuccess(textOf(event, 0), event.uid, a[0]); break;
+    case ENGINE_EVENT_LEAVE_CHANNEL: handler.onLeaveChannel(event.stats.rtc); break;
+    case ENGINE_EVENT_CLIENT_ROLE_CHANGED: handler.onClientRoleChanged((CLIENT_ROLE_TYPE)a[0], (CLIENT_ROLE_TYPE)a[1]); break;
+    case ENGINE_EVENT_USER_JOINED: handler.onUserJoined(event.uid, a[0]); break;
+    case ENGINE_EVENT_USER_OFFLINE: handler.onUserOffline(event.uid, (USER_OFFLINE_REASON_TYPE)a[0]); break;
+    case ENGINE_EVENT_LASTMILE_QUALITY: handler.onLastmileQuality(a[0]); break;
+    case ENGINE_EVENT_CONNECTION_INTERRUPTED: handler.onConnectionInterrupted(); break;
+    case ENGINE_EVENT_CONNECTION_LOST: handler.onConnectionLost(); break;
+    case ENGINE_EVENT_CONNECTION_BANNED: handler.onConnectionBanned(); break;
+    case ENGINE_EVENT_API_CALL_EXECUTED: handler.onApiCallExecuted(a[0], textOf(event, 0), textOf(event, 1)); break;
+    case ENGINE_EVENT_REQUEST_TOKEN: handler.onRequestToken(); break;
+    case ENGINE_EVENT_TOKEN_PRIVILEGE_WILL_EXPIRE: handler.onTokenPrivilegeWillExpire(textOf(event, 0)); break;
+    case ENGINE_EVENT_AUDIO_QUALITY: handler.onAudioQuality(event.uid, a[0], (unsigned short)a[1], (unsigned short)a[2]); break;
+    case ENGINE_EVENT_RTC_STATS: handler.onRtcStats(event.stats.rtc); break;
+    case ENGINE_EVENT_NETWORK_QUALITY: handler.onNetworkQuality(event.uid, a[0], a[1]); break;
+    case ENGINE_EVENT_LOCAL_VIDEO_STATS: handler.onLocalVideoStats(event.stats.localVideo); break;
+    case ENGINE_EVENT_REMOTE_VIDEO_STATS: handler.onRemoteVideoStats(event.stats.remoteVideo); break;
+    case ENGINE_EVENT_AUDIO_VOLUME_INDICATION:
+        handler.onAudioVolumeIndication(reinterpret_cast<const AudioVolumeInfo*>(event.data),
+                                        event.size / sizeof(AudioVolumeInfo), a[0]);
+        break;
+    case ENGINE_EVENT_ACTIVE_SPEAKER: handler.onActiveSpeaker(event.uid); break;
+    case ENGINE_EVENT_VIDEO_STOPPED: handler.onVideoStopped(); break;
+    case ENGINE_EVENT_FIRST_LOCAL_VIDEO_FRAME: handler.onFirstLocalVideoFrame(a[0], a[1], a[2]); break;
+    case ENGINE_EVENT_FIRST_REMOTE_VIDEO_DECODED: handler.onFirstRemoteVideoDecoded(event.uid, a[0], a[1], a[2]); break;
+    case ENGINE_EVENT_FIRST_REMOTE_VIDEO_FRAME: handler.onFirstRemoteVideoFrame(event.uid, a[0], a[1], a[2]); break;
+    case ENGINE_EVENT_USER_MUTE_AUDIO: handler.onUserMuteAudio(event.uid, a[0] != 0); break;
+    case ENGINE_EVENT_USER_MUTE_VIDEO: handler.onUserMuteVideo(event.uid, a[0] != 0); break;
+    case ENGINE_EVENT_USER_ENABLE_VIDEO: handler.onUserEnableVideo(event.uid, a[0] != 0); break;
+    case ENGINE_EVENT_AUDIO_DEVICE_STATE_CHANGED: handler.onAudioDeviceStateChanged(textOf(event, 0), a[0], a[1]); break;
+    case ENGINE_EVENT_AUDIO_DEVICE_VOLUME_CHANGED: handler.onAudioDeviceVolumeChanged((MEDIA_DEVICE_TYPE)a[0], a[1], a[2] != 0); break;
+    case ENGINE_EVENT_CAMERA_READY: handler.onCameraReady(); break;
+    case ENGINE_EVENT_CAMERA_FOCUS_AREA_CHANGED: handler.onCameraFocusAreaChanged(a[0], a[1], a[2], a[3]); break;
+    case ENGINE_EVENT_AUDIO_MIXING_FINISHED: handler.onAudioMixingFinished(); break;
+    case ENGINE_EVENT_REMOTE_AUDIO_MIXING_BEGIN: handler.onRemoteAudioMixingBegin(); break;
+    case ENGINE_EVENT_REMOTE_AUDIO_MIXING_END: handler.onRemoteAudioMixingEnd(); break;
+    case ENGINE_EVENT_AUDIO_EFFECT_FINISHED: handler.onAudioEffectFinished(a[0]); break;
+    case ENGINE_EVENT_VIDEO_DEVICE_STATE_CHANGED: handler.onVideoDeviceStateChanged(textOf(event, 0), a[0], a[1]); break;
+    case ENGINE_EVENT_VIDEO_SIZE_CHANGED: handler.onVideoSizeChanged(event.uid, a[0], a[1], a[2]); break;
+    case ENGINE_EVENT_REMOTE_VIDEO_STATE_CHANGED: handler.onRemoteVideoStateChanged(event.uid, (REMOTE_VIDEO_STATE)a[0]); break;
+    case ENGINE_EVENT_USER_ENABLE_LOCAL_VIDEO: handler.onUserEnableLocalVideo(event.uid, a[0] != 0); break;
+    case ENGINE_EVENT_STREAM_MESSAGE: handler.onStreamMessage(event.uid, a[0], event.data, event.size); break;
+    case ENGINE_EVENT_STREAM_MESSAGE_ERROR: handler.onStreamMessageError(event.uid, a[0], a[1], a[2], a[3]); break;
+    case ENGINE_EVENT_MEDIA_ENGINE_LOAD_SUCCESS: handler.onMediaEngineLoadSuccess(); break;
+    case ENGINE_EVENT_MEDIA_ENGINE_START_CALL_SUCCESS: handler.onMediaEngineStartCallSuccess(); break;
+    case ENGINE_EVENT_FIRST_LOCAL_AUDIO_FRAME: handler.onFirstLocalAudioFrame(a[0]); break;
+    case ENGINE_EVENT_FIRST_REMOTE_AUDIO_FRAME: handler.onFirstRemoteAudioFrame(event.uid, a[0]); break;
+    case ENGINE_EVENT_STREAM_PUBLISHED: handler.onStreamPublished(textOf(event, 0), a[0]); break;
+    case ENGINE_EVENT_STREAM_UNPUBLISHED: handler.onStreamUnpublished(textOf(event, 0)); break;
+    case ENGINE_EVENT_TRANSCODING_UPDATED: handler.onTranscodingUpdated(); break;
+    case ENGINE_EVENT_STREAM_INJECTED_STATUS: handler.onStreamInjectedStatus(textOf(event, 0), event.uid, a[0]); break;
+    case ENGINE_EVENT_LOCAL_PUBLISH_FALLBACK_TO_AUDIO_ONLY: handler.onLocalPublishFallbackToAudioOnly(a[0] != 0); break;
+    case ENGINE_EVENT_REMOTE_SUBSCRIBE_FALLBACK_TO_AUDIO_ONLY: handler.onRemoteSubscribeFallbackToAudioOnly(event.uid, a[0] != 0); break;
+    case ENGINE_EVENT_REMOTE_AUDIO_TRANSPORT_STATS:
+        handler.onRemoteAudioTransportStats(event.uid, (unsigned short)a[0], (unsigned short)a[1], (unsigned short)a[2]);
+        break;
+    case ENGINE_EVENT_REMOTE_VIDEO_TRANSPORT_STATS:
+        handler.onRemoteVideoTransportStats(event.uid, (unsigned short)a[0], (unsigned short)a[1], (unsigned short)a[2]);
+        break;
+    case ENGINE_EVENT_MICROPHONE_ENABLED: handler.onMicrophoneEnabled(a[0] != 0); break;
+    case ENGINE_EVENT_TYPE_COUNT: break;
+    }
+}
+
+void EngineEventQueue::onWarning(int warn, const char* msg)
+{
+    postText(ENGINE_EVENT_WARNING, msg, NULL, 0, warn);
+}
+
+void EngineEventQueue::onError(int err, const char* msg)
+{
+    postText(ENGINE_EVENT_ERROR, msg, NULL, 0, err);
+}
+
+void EngineEventQueue::onJoinChannelSuccess(const char* channel, uid_t uid, int elapsed)
+{
+    postText(ENGINE_EVENT_JOIN_CHANNEL_SUCCESS, channel, NULL, uid, elapsed);
+}
+
+void EngineEventQueue::onRejoinChannelSuccess(const char* channel, uid_t uid, int elapsed)
+{
+    postText(ENGINE_EVENT_REJOIN_CHANNEL_SUCCESS, channel, NULL, uid, elapsed);
+}
+
+void EngineEventQueue::onLeaveChannel(const RtcStats& stats)
+{
+    size_t ticket;
+    if (EngineEvent* event = begin(ENGINE_EVENT_LEAVE_CHANNEL, ticket)) {
+        event->stats.rtc = stats;
+        end(event, ticket);
+    }
+}
+
+void EngineEventQueue::onClientRoleChanged(CLIENT_ROLE_TYPE oldRole, CLIENT_ROLE_TYPE newRole)
+{
+    post(ENGINE_EVENT_CLIENT_ROLE_CHANGED, 0, oldRole, newRole);
+}
+
+void EngineEventQueue::onUserJoined(uid_t uid, int elapsed)
+{
+    post(ENGINE_EVENT_USER_JOINED, uid, elapsed);
+}
+
+void EngineEventQueue::onUserOffline(uid_t uid, USER_OFFLINE_REASON_TYPE reason)
+{
+    post(ENGINE_EVENT_USER_OFFLINE, uid, reason);
+}
+
+void EngineEventQueue::onLastmileQuality(int quality)
+{
+    post(ENGINE_EVENT_LASTMILE_QUALITY, 0, quality);
+}
+
+void EngineEventQueue::onConnectionInterrupted()
+{
+    post(ENGINE_EVENT_CONNECTION_INTERRUPTED);
+}
+
+void EngineEventQueue::onConnectionLost()
+{
+    post(ENGINE_EVENT_CONNECTION_LOST);
+}
+
+void EngineEventQueue::onConnectionBanned()
+{
+    post(ENGINE_EVENT_CONNECTION_BANNED);
+}
+
+void EngineEventQueue::onApiCallExecuted(int err, const char* api, const char* result)
+{
+    postText(ENGINE_EVENT_API_CALL_EXECUTED, api, result, 0, err);
+}
+
+void EngineEventQueue::onRequestToken()
+{
+    post(ENGINE_EVENT_REQUEST_TOKEN);
+}
+
+void EngineEventQueue::onTokenPrivilegeWillExpire(const char* token)
+{
+    postText(ENGINE_EVENT_TOKEN_PRIVILEGE_WILL_EXPIRE, token);
+}
+
+void EngineEventQueue::onAudioQuality(uid_t uid, int quality, unsigned short delay, unsigned short lost)
+{
+    post(ENGINE_EVENT_AUDIO_QUALITY, uid, quality, delay, lost);
+}
+
+void EngineEventQueue::onRtcStats(const RtcStats& stats)
+{
+    size_t ticket;
+    if (EngineEvent* event = begin(ENGINE_EVENT_RTC_STATS, ticket)) {
+        event->stats.rtc = stats;
+        end(event, ticket);
+    }
+}
+
+void EngineEventQueue::onNetworkQuality(uid_t uid, int txQuality, int rxQuality)
+{
+    post(ENGINE_EVENT_NETWORK_QUALITY, uid, txQuality, rxQuality);
+}
+
+void EngineEventQueue::onLocalVideoStats(const LocalVideoStats& stats)
+{
+    size_t ticket;
+    if (EngineEvent* event = begin(ENGINE_EVENT_LOCAL_VIDEO_STATS, ticket)) {
+        event->stats.localVideo = stats;
+        end(event, ticket);
+    }
+}
+
+void EngineEventQueue::onRemoteVideoStats(const RemoteVideoStats& stats)
+{
+    size_t ticket;
+    if (EngineEvent* event = begin(ENGINE_EVENT_REMOTE_VIDEO_STATS, ticket, stats.uid)) {
+        event->stats.remoteVideo = stats;
+        end(event, ticket);
+    }
+}
+
+void EngineEventQueue::onAudioVolumeIndication(const AudioVolumeInfo* speakers, unsigned int speakerNumber, int totalVolume)
+{
+    size_t ticket;
+    if (EngineEvent* event = begin(ENGINE_EVENT_AUDIO_VOLUME_INDICATION, ticket, 0, totalVolume)) {
+        size_t bytes = speakers ? (size_t)speakerNumber * sizeof(AudioVolumeInfo) : 0;
+        // Keep whole entries only.
+        size_t whole = EngineEvent::MAX_DATA / sizeof(AudioVolumeInfo) * sizeof(AudioVolumeInfo);
+        event->truncated = bytes > whole;
+        setData(*event, speakers, bytes > whole ? whole : bytes);
+        end(event, ticket);
+    }
+}
+
+void EngineEventQueue::onActiveSpeaker(uid_t uid)
+{
+    post(ENGINE_EVENT_ACTIVE_SPEAKER, uid);
+}
+
+void EngineEventQueue::onVideoStopped()
+{
+    post(ENGINE_EVENT_VIDEO_STOPPED);
+}
+
+void EngineEventQueue::onFirstLocalVideoFrame(int width, int height, int elapsed)
+{
+    post(ENGINE_EVENT_FIRST_LOCAL_VIDEO_FRAME, 0, width, height, elapsed);
+}
+
+void EngineEventQueue::onFirstRemoteVideoDecoded(uid_t uid, int width, int height, int elapsed)
+{
+    post(ENGINE_EVENT_FIRST_REMOTE_VIDEO_DECODED, uid, width, height, elapsed);
+}
+
+void EngineEventQueue::onFirstRemoteVideoFrame(uid_t uid, int width, int height, int elapsed)
+{
+    post(ENGINE_EVENT_FIRST_REMOTE_VIDEO_FRAME, uid, width, height, elapsed);
+}
+
+void EngineEventQueue::onUserMuteAudio(uid_t uid, bool muted)
+{
+    post(ENGINE_EVENT_USER_MUTE_AUDIO, uid, muted);
+}
+
+void EngineEventQueue::onUserMuteVideo(uid_t uid, bool muted)
+{
+    post(ENGINE_EVENT_USER_MUTE_VIDEO, uid, muted);
+}
+
+void EngineEventQueue::onUserEnableVideo(uid_t uid, bool enabled)
+{
+    post(ENGINE_EVENT_USER_ENABLE_VIDEO, uid, enabled);
+}
+
+void EngineEventQueue::onAudioDeviceStateChanged(const char* deviceId, int deviceType, int deviceState)
+{
+    postText(ENGINE_EVENT_AUDIO_DEVICE_STATE_CHANGED, deviceId, NULL, 0, deviceType, deviceState);
+}
+
+void EngineEventQueue::onAudioDeviceVolumeChanged(MEDIA_DEVICE_TYPE deviceType, int volume, bool muted)
+{
+    post(ENGINE_EVENT_AUDIO_DEVICE_VOLUME_CHANGED, 0, deviceType, volume, muted);
+}
+
+void EngineEventQueue::onCameraReady()
+{
+    post(ENGINE_EVENT_CAMERA_READY);
+}
+
+void EngineEventQueue::onCameraFocusAreaChanged(int x, int y, int width, int height)
+{
+    post(ENGINE_EVENT_CAMERA_FOCUS_AREA_CHANGED, 0, x, y, width, height);
+}
+
+void EngineEventQueue::onAudioMixingFinished()
+{
+    post(ENGINE_EVENT_AUDIO_MIXING_FINISHED);
+}
+
+void EngineEventQueue::onRemoteAudioMixingBegin()
+{
+    post(ENGINE_EVENT_REMOTE_AUDIO_MIXING_BEGIN);
+}
+
+void EngineEventQueue::onRemoteAudioMixingEnd()
+{
+    post(ENGINE_EVENT_REMOTE_AUDIO_MIXING_END);
+}
+
+void EngineEventQueue::onAudioEffectFinished(int soundId)
+{
+    post(ENGINE_EVENT_AUDIO_EFFECT_FINISHED, 0, soundId);
+}
+
+void EngineEventQueue::onVideoDeviceStateChanged(const char* deviceId, int deviceType, int deviceState)
+{
+    postText(ENGINE_EVENT_VIDEO_DEVICE_STATE_CHANGED, deviceId, NULL, 0, deviceType, deviceState);
+}
+
+void EngineEventQueue::onVideoSizeChanged(uid_t uid, int width, int height, int rotation)
+{
+    post(ENGINE_EVENT_VIDEO_SIZE_CHANGED, uid, width, height, rotation);
+}
+
+void EngineEventQueue::onRemoteVideoStateChanged(uid_t uid, REMOTE_VIDEO_STATE state)
+{
+    post(ENGINE_EVENT_REMOTE_VIDEO_STATE_CHANGED, uid, state);
+}
+
+void EngineEventQueue::onUserEnableLocalVideo(uid_t uid, bool enabled)
+{
+    post(ENGINE_EVENT_USER_ENABLE_LOCAL_VIDEO, uid, enabled);
+}
+
+void EngineEventQueue::onStreamMessage(uid_t uid, int streamId, const char* data, size_t length)
+{
+    size_t ticket;
+    if (EngineEvent* event = begin(ENGINE_EVENT_STREAM_MESSAGE, ticket, uid, streamId)) {
+        event->truncated = !setData(*event, data, data ? length : 0);
+        end(event, ticket);
+    }
+}
+
+void EngineEventQueue::onStreamMessageError(uid_t uid, int streamId, int code, int missed, int cached)
+{
+    post(ENGINE_EVENT_STREAM_MESSAGE_ERROR, uid, streamId, code, missed, cached);
+}
+
+void EngineEventQueue::onMediaEngineLoadSuccess()
+{
+    post(ENGINE_EVENT_MEDIA_ENGINE_LOAD_SUCCESS);
+}
+
+void EngineEventQueue::onMediaEngineStartCallSuccess()
+{
+    post(ENGINE_EVENT_MEDIA_ENGINE_START_CALL_SUCCESS);
+}
+
+void EngineEventQueue::onFirstLocalAudioFrame(int elapsed)
+{
+    post(ENGINE_EVENT_FIRST_LOCAL_AUDIO_FRAME, 0, elapsed);
+}
+
+void EngineEventQueue::onFirstRemoteAudioFrame(uid_t uid, int elapsed)
+{
+    post(ENGINE_EVENT_FIRST_REMOTE_AUDIO_FRAME, uid, elapsed);
+}
+
+void EngineEventQueue::onStreamPublished(const char* url, int error)
+{
+    postText(ENGINE_EVENT_STREAM_PUBLISHED, url, NULL, 0, error);
+}
+
+void EngineEventQueue::onStreamUnpublished(const char* url)
+{
+    postText(ENGINE_EVENT_STREAM_UNPUBLISHED, url);
+}
+
+void EngineEventQueue::onTranscodingUpdated()
+{
+    post(ENGINE_EVENT_TRANSCODING_UPDATED);
+}
+
+void EngineEventQueue::onStreamInjectedStatus(const char* url, uid_t uid, int status)
+{
+    postText(ENGINE_EVENT_STREAM_INJECTED_STATUS, url, NULL, uid, status);
+}
+
+void EngineEventQueue::onLocalPublishFallbackToAudioOnly(bool isFallbackOrRecover)
+{
+    post(ENGINE_EVENT_LOCAL_PUBLISH_FALLBACK_TO_AUDIO_ONLY, 0, isFallbackOrRecover);
+}
+
+void EngineEventQueue::onRemoteSubscribeFallbackToAudioOnly(uid_t uid, bool isFallbackOrRecover)
+{
+    post(ENGINE_EVENT_REMOTE_SUBSCRIBE_FALLBACK_TO_AUDIO_ONLY, uid, isFallbackOrRecover);
+}
+
+void EngineEventQueue::onRemoteAudioTransportStats(uid_t uid, unsigned short delay, unsigned short lost, unsigned short rxKBitRate)
+{
+    post(ENGINE_EVENT_REMOTE_AUDIO_TRANSPORT_STATS, uid, delay, lost, rxKBitRate);
+}
+
+void EngineEventQueue::onRemoteVideoTransportStats(uid_t uid, unsigned short delay, unsigned short lost, unsigned short rxKBitRate)
+{
+    post(ENGINE_EVENT_REMOTE_VIDEO_TRANSPORT_STATS, uid, delay, lost, rxKBitRate);
+}
+
+void EngineEventQueue::onMicrophoneEnabled(bool enabled)
+{
+    post(ENGINE_EVENT_MICROPHONE_ENABLED, 0, enabled);
+}
+
+} // namespace rtc
+} // namespace talkboard
@@ -0,0 +1,234 @@
+//
+//  TalkBoard Engine
+//
+//  IRtcEngineEventHandler that queues callbacks for another thread.
+//
+
+#ifndef TALKBOARD_ENGINE_EVENT_QUEUE_H
+#define TALKBOARD_ENGINE_EVENT_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+#include "MpscQueue.h"
+
+namespace talkboard {
+namespace rtc {
+
+/** One value per IRtcEngineEventHandler callback.
+ */
+enum ENGINE_EVENT_TYPE
+{
+    ENGINE_EVENT_WARNING = 0,
+    ENGINE_EVENT_ERROR,
+    ENGINE_EVENT_JOIN_CHANNEL_SUCCESS,
+    ENGINE_EVENT_REJOIN_CHANNEL_SUCCESS,
+    ENGINE_EVENT_LEAVE_CHANNEL,
+    ENGINE_EVENT_CLIENT_ROLE_CHANGED,
+    ENGINE_EVENT_USER_JOINED,
+    ENGINE_EVENT_USER_OFFLINE,
+    ENGINE_EVENT_LASTMILE_QUALITY,
+    ENGINE_EVENT_CONNECTION_INTERRUPTED,
+    ENGINE_EVENT_CONNECTION_LOST,
+    ENGINE_EVENT_CONNECTION_BANNED,
+    ENGINE_EVENT_API_CALL_EXECUTED,
+    ENGINE_EVENT_REQUEST_TOKEN,
+    ENGINE_EVENT_TOKEN_PRIVILEGE_WILL_EXPIRE,
+    ENGINE_EVENT_AUDIO_QUALITY,
+    ENGINE_EVENT_RTC_STATS,
+    ENGINE_EVENT_NETWORK_QUALITY,
+    ENGINE_EVENT_LOCAL_VIDEO_STATS,
+    ENGINE_EVENT_REMOTE_VIDEO_STATS,
+    ENGINE_EVENT_AUDIO_VOLUME_INDICATION,
+    ENGINE_EVENT_ACTIVE_SPEAKER,
+    ENGINE_EVENT_VIDEO_STOPPED,
+    ENGINE_EVENT_FIRST_LOCAL_VIDEO_FRAME,
+    ENGINE_EVENT_FIRST_REMOTE_VIDEO_DECODED,
+    ENGINE_EVENT_FIRST_REMOTE_VIDEO_FRAME,
+    ENGINE_EVENT_USER_MUTE_AUDIO,
+    ENGINE_EVENT_USER_MUTE_VIDEO,
+    ENGINE_EVENT_USER_ENABLE_VIDEO,
+    ENGINE_EVENT_AUDIO_DEVICE_STATE_CHANGED,
+    ENGINE_EVENT_AUDIO_DEVICE_VOLUME_CHANGED,
+    ENGINE_EVENT_CAMERA_READY,
+    ENGINE_EVENT_CAMERA_FOCUS_AREA_CHANGED,
+    ENGINE_EVENT_AUDIO_MIXING_FINISHED,
+    ENGINE_EVENT_REMOTE_AUDIO_MIXING_BEGIN,
+    ENGINE_EVENT_REMOTE_AUDIO_MIXING_END,
+    ENGINE_EVENT_AUDIO_EFFECT_FINISHED,
+    ENGINE_EVENT_VIDEO_DEVICE_STATE_CHANGED,
+    ENGINE_EVENT_VIDEO_SIZE_CHANGED,
+    ENGINE_EVENT_REMOTE_VIDEO_STATE_CHANGED,
+    ENGINE_EVENT_USER_ENABLE_LOCAL_VIDEO,
+    ENGINE_EVENT_STREAM_MESSAGE,
+    ENGINE_EVENT_STREAM_MESSAGE_ERROR,
+    ENGINE_EVENT_MEDIA_ENGINE_LOAD_SUCCESS,
+    ENGINE_EVENT_MEDIA_ENGINE_START_CALL_SUCCESS,
+    ENGINE_EVENT_FIRST_LOCAL_AUDIO_FRAME,
+    ENGINE_EVENT_FIRST_REMOTE_AUDIO_FRAME,
+    ENGINE_EVENT_STREAM_PUBLISHED,
+    ENGINE_EVENT_STREAM_UNPUBLISHED,
+    ENGINE_EVENT_TRANSCODING_UPDATED,
+    ENGINE_EVENT_STREAM_INJECTED_STATUS,
+    ENGINE_EVENT_LOCAL_PUBLISH_FALLBACK_TO_AUDIO_ONLY,
+    ENGINE_EVENT_REMOTE_SUBSCRIBE_FALLBACK_TO_AUDIO_ONLY,
+    ENGINE_EVENT_REMOTE_AUDIO_TRANSPORT_STATS,
+    ENGINE_EVENT_REMOTE_VIDEO_TRANSPORT_STATS,
+    ENGINE_EVENT_MICROPHONE_ENABLED,
+    ENGINE_EVENT_TYPE_COUNT,
+};
+
+/** A callback and a copy of its arguments.
+
+ `uid` and `args` hold the scalar arguments in declaration order (the uid,
+ where there is one, goes to `uid` and is not repeated in `args`); the stats
+ callbacks fill the matching member of `stats`. Strings are copied into
+ `data` and located by `text`; the stream message and the speaker array of
+ onAudioVolumeIndication are copied to the start of `data`, `size` bytes.
+ EngineEventQueue::dispatch() turns an event back into the call.
+ */
+struct EngineEvent
+{
+    /** Room for strings, a stream message (at most 1 KB) or 128 speakers. */
+    enum { MAX_DATA = 1024 };
+
+    ENGINE_EVENT_TYPE type;
+    agora::rtc::uid_t uid;
+    int args[4];
+    union
+    {
+        agora::rtc::RtcStats rtc;
+        agora::rtc::LocalVideoStats localVideo;
+        agora::rtc::RemoteVideoStats remoteVideo;
+    } stats;
+    /** Offsets into `data` of the string arguments; -1 for NULL. */
+    int16_t text[2];
+    /** Bytes of `data` in use. */
+    uint16_t size;
+    /** Something did not fit in `data` and was cut. */
+    bool truncated;
+    /** Aligned for the AudioVolumeInfo array dispatch() reads in place. */
+    alignas(alignof(max_align_t)) char data[MAX_DATA];
+};
+
+static_assert(offsetof(EngineEvent, data) % alignof(agora::rtc::AudioVolumeInfo) == 0,
+              "EngineEvent::data cannot hold an AudioVolumeInfo array");
+
+/** Implements every IRtcEngineEventHandler callback by queueing it.
+
+ Register it with the engine in place of the application's handler. Each
+ callback copies its arguments into a preallocated EngineEvent slot of a
+ bounded lock-free queue and returns: no lock, no allocation, no call into
+ application code on the SDK's threads. The application then calls drain()
+ from a thread of its choosing (the main thread, a UI timer) to replay the
+ events, in order, on its own handler.
+
+ Any number of SDK threads may produce; only one thread may drain. When the
+ queue is full the event is dropped and counted, rather than stalling the
+ SDK, so size the queue for the longest expected gap between drains.
+ */
+class EngineEventQueue : public agora::rtc::IRtcEngineEventHandler
+{
+public:
+    /** @param capacity Events buffered between drains; rounded up to a power of two. */
+    explicit EngineEventQueue(size_t capacity = 1024);
+
+    /** Replays up to `maxEvents` queued events on `handler`, oldest first.
+
+     @return Number of events delivered.
+     */
+    size_t drain(agora::rtc::IRtcEngineEventHandler& handler, size_t maxEvents = (size_t)-1);
+
+    /** Calls the `handler` method `event` was recorded from. */
+    static void dispatch(const EngineEvent& event, agora::rtc::IRtcEngineEventHandler& handler);
+
+    /** Events waiting for drain(); approximate while callbacks arrive. */
+    size_t pending() const { return m_queue.size(); }
+    /** Events lost because the queue was full. */
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    /** Events that lost part of their strings or data. */
+    uint64_t truncated() const { return m_truncated.load(std::memory_order_relaxed); }
+
+    virtual void onWarning(int warn, const char* msg);
+    virtual void onError(int err, const char* msg);
+    virtual void onJoinChannelSuccess(const char* channel, agora::rtc::uid_t uid, int elapsed);
+    virtual void onRejoinChannelSuccess(const char* channel, agora::rtc::uid_t uid, int elapsed);
+    virtual void onLeaveChannel(const agora::rtc::RtcStats& stats);
+    virtual void onClientRoleChanged(agora::rtc::CLIENT_ROLE_TYPE oldRole, agora::rtc::CLIENT_ROLE_TYPE newRole);
+    virtual void onUserJoined(agora::rtc::uid_t uid, int elapsed);
+    virtual void onUserOffline(agora::rtc::uid_t uid, agora::rtc::USER_OFFLINE_REASON_TYPE reason);
+    virtual void onLastmileQuality(int quality);
+    virtual void onConnectionInterrupted();
+    virtual void onConnectionLost();
+    virtual void onConnectionBanned();
+    virtual void onApiCallExecuted(int err, const char* api, const char* result);
+    virtual void onRequestToken();
+    virtual void onTokenPrivilegeWillExpire(const char* token);
+    virtual void onAudioQuality(agora::rtc::uid_t uid, int quality, unsigned short delay, unsigned short lost);
+    virtual void onRtcStats(const agora::rtc::RtcStats& stats);
+    virtual void onNetworkQuality(agora::rtc::uid_t uid, int txQuality, int rxQuality);
+    virtual void onLocalVideoStats(const agora::rtc::LocalVideoStats& stats);
+    virtual void onRemoteVideoStats(const agora::rtc::RemoteVideoStats& stats);
+    virtual void onAudioVolumeIndication(const agora::rtc::AudioVolumeInfo* speakers, unsigned int speakerNumber, int totalVolume);
+    virtual void onActiveSpeaker(agora::rtc::uid_t uid);
+    virtual void onVideoStopped();
+    virtual void onFirstLocalVideoFrame(int width, int height, int elapsed);
+    virtual void onFirstRemoteVideoDecoded(agora::rtc::uid_t uid, int width, int height, int elapsed);
+    virtual void onFirstRemoteVideoFrame(agora::rtc::uid_t uid, int width, int height, int elapsed);
+    virtual void onUserMuteAudio(agora::rtc::uid_t uid, bool muted);
+    virtual void onUserMuteVideo(agora::rtc::uid_t uid, bool muted);
+    virtual void onUserEnableVideo(agora::rtc::uid_t uid, bool enabled);
+    virtual void onAudioDeviceStateChanged(const char* deviceId, int deviceType, int deviceState);
+    virtual void onAudioDeviceVolumeChanged(agora::rtc::MEDIA_DEVICE_TYPE deviceType, int volume, bool muted);
+    virtual void onCameraReady();
+    virtual void onCameraFocusAreaChanged(int x, int y, int width, int height);
+    virtual void onAudioMixingFinished();
+    virtual void onRemoteAudioMixingBegin();
+    virtual void onRemoteAudioMixingEnd();
+    virtual void onAudioEffectFinished(int soundId);
+    virtual void onVideoDeviceStateChanged(const char* deviceId, int deviceType, int deviceState);
+    virtual void onVideoSizeChanged(agora::rtc::uid_t uid, int width, int height, int rotation);
+    virtual void onRemoteVideoStateChanged(agora::rtc::uid_t uid, agora::rtc::REMOTE_VIDEO_STATE state);
+    virtual void onUserEnableLocalVideo(agora::rtc::uid_t uid, bool enabled);
+    virtual void onStreamMessage(agora::rtc::uid_t uid, int streamId, const char* data, size_t length);
+    virtual void onStreamMessageError(agora::rtc::uid_t uid, int streamId, int code, int missed, int cached);
+    virtual void onMediaEngineLoadSuccess();
+    virtual void onMediaEngineStartCallSuccess();
+    virtual void onFirstLocalAudioFrame(int elapsed);
+    virtual void onFirstRemoteAudioFrame(agora::rtc::uid_t uid, int elapsed);
+    virtual void onStreamPublished(const char* url, int error);
+    virtual void onStreamUnpublished(const char* url);
+    virtual void onTranscodingUpdated();
+    virtual void onStreamInjectedStatus(const char* url, agora::rtc::uid_t uid, int status);
+    virtual void onLocalPublishFallbackToAudioOnly(bool isFallbackOrRecover);
+    virtual void onRemoteSubscribeFallbackToAudioOnly(agora::rtc::uid_t uid, bool isFallbackOrRecover);
+    virtual void onRemoteAudioTransportStats(agora::rtc::uid_t uid, unsigned short delay, unsigned short lost, unsigned short rxKBitRate);
+    virtual void onRemoteVideoTransportStats(agora::rtc::uid_t uid, unsigned short delay, unsigned short lost, unsigned short rxKBitRate);
+    virtual void onMicrophoneEnabled(bool enabled);
+
+private:
+    EngineEventQueue(const EngineEventQueue&);
+    EngineEventQueue& operator=(const EngineEventQueue&);
+
+    /** Claims a slot and fills in the common fields; NULL if the queue is full. */
+    EngineEvent* begin(ENGINE_EVENT_TYPE type, size_t& ticket, agora::rtc::uid_t uid = 0,
+                       int a0 = 0, int a1 = 0, int a2 = 0, int a3 = 0);
+    void end(EngineEvent* event, size_t ticket);
+    /** Queues an event without strings or data. */
+    void post(ENGINE_EVENT_TYPE type, agora::rtc::uid_t uid = 0, int a0 = 0, int a1 = 0, int a2 = 0, int a3 = 0);
+    /** Queues an event with up to two string arguments. */
+    void postText(ENGINE_EVENT_TYPE type, const char* first, const char* second = NULL,
+                  agora::rtc::uid_t uid = 0, int a0 = 0, int a1 = 0, int a2 = 0);
+
+    util::MpscQueue<EngineEvent> m_queue;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_truncated;
+};
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,155 @@
+//
+//  TalkBoard Engine
+//
+//  Movable owner of SDK objects that are freed with release().
+//
+
+#ifndef TALKBOARD_ENGINE_HANDLE_H
+#define TALKBOARD_ENGINE_HANDLE_H
+
+#include <stddef.h>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+namespace talkboard {
+namespace util {
+
+/** Owns an object of the SDK's release() protocol, like agora::util::AutoPtr,
+ but can be moved.
+
+ AutoPtr (and AString, AParameter, AAudioDeviceManager, ...) can neither be
+ copied nor moved, so it cannot go in a std::vector or be returned from a
+ function. A Handle can: moving hands the object over, and release() is
+ called once, by the last owner. Moves are noexcept, so a std::vector of
+ handles moves them when it grows. Handles are not copyable; the SDK
+ objects have no reference count to share.
+
+ An AutoPtr gives up its object with the adopting constructor, so the
+ SDK's out-parameters can be used as is:
+
+ @code
+ agora::util::AString value;
+ if (parameter->getString("rtc.call_id", value) == 0)
+     strings.push_back(util::Handle<agora::util::IString>(value));
+ @endcode
+ */
+template <class T>
+class Handle
+{
+public:
+    Handle()
+        : m_object(NULL) {}
+    /** Takes ownership of `object`. */
+    explicit Handle(T* object)
+        : m_object(object) {}
+    /** Takes the object of `owner`, which is left empty. */
+    explicit Handle(agora::util::AutoPtr<T>& owner)
+        : m_object(owner.release()) {}
+    Handle(Handle&& other) noexcept
+        : m_object(other.m_object)
+    {
+        other.m_object = NULL;
+    }
+
+    ~Handle()
+    {
+        if (m_object)
+            m_object->release();
+    }
+
+    Handle& operator=(Handle&& other) noexcept
+    {
+        if (this != &other)
+            reset(other.release());
+        return *this;
+    }
+
+    T* get() const { return m_object; }
+    T* operator->() const { return m_object; }
+    T& operator*() const { return *m_object; }
+    explicit operator bool() const { return m_object != NULL; }
+
+    /** Gives up ownership without calling release() on the object. */
+    T* release()
+    {
+        T* object = m_object;
+        m_object = NULL;
+        return object;
+    }
+
+    /** Releases the current object, if any, and takes `object`. */
+    void reset(T* object = NULL)
+    {
+        if (object == m_object)
+            return;
+        if (m_object)
+            m_object->release();
+        m_object = object;
+    }
+
+    void swap(Handle& other)
+    {
+        T* object = m_object;
+        m_object = other.m_object;
+        other.m_object = object;
+    }
+
+    /** Replaces the object with the interface `iid` of `source`, as
+     AutoPtr::queryInterface does.
+
+     @return Whether `source` provided the interface; the handle is left
+     unchanged if it did not.
+     */
+    template <class Source>
+    bool queryInterface(Source* source, agora::INTERFACE_ID_TYPE iid)
+    {
+        T* object = NULL;
+        if (!source || source->queryInterface(iid, reinterpret_cast<void**>(&object)) != 0 || !object)
+            return false;
+        reset(object);
+        return true;
+    }
+
+private:
+    Handle(const Handle&);
+    Handle& operator=(const Handle&);
+
+    T* m_object;
+};
+
+} // namespace util
+
+namespace rtc {
+
+typedef util::Handle<agora::rtc::IRtcEngineParameter> ParameterHandle;
+typedef util::Handle<agora::rtc::IAudioDeviceManager> AudioDeviceManagerHandle;
+typedef util::Handle<agora::rtc::IVideoDeviceManager> VideoDeviceManagerHandle;
+
+/** The interfaces AParameter, AAudioDeviceManager and AVideoDeviceManager
+ query, as handles; empty if `engine` is NULL or does not provide them.
+ */
+inline ParameterHandle queryParameter(agora::rtc::IRtcEngine* engine)
+{
+    ParameterHandle handle;
+    handle.queryInterface(engine, agora::AGORA_IID_RTC_ENGINE_PARAMETER);
+    return handle;
+}
+
+inline AudioDeviceManagerHandle queryAudioDeviceManager(agora::rtc::IRtcEngine* engine)
+{
+    AudioDeviceManagerHandle handle;
+    handle.queryInterface(engine, agora::AGORA_IID_AUDIO_DEVICE_MANAGER);
+    return handle;
+}
+
+inline VideoDeviceManagerHandle queryVideoDeviceManager(agora::rtc::IRtcEngine* engine)
+{
+    VideoDeviceManagerHandle handle;
+    handle.queryInterface(engine, agora::AGORA_IID_VIDEO_DEVICE_MANAGER);
+    return handle;
+}
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
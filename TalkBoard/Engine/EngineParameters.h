@@ -0,0 +1,280 @@
+//
+//  TalkBoard Engine
+//
+//  RtcEngineParameters setters built with JsonWriter instead of vsnprintf.
+//
+
+#ifndef TALKBOARD_ENGINE_PARAMETERS_H
+#define TALKBOARD_ENGINE_PARAMETERS_H
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+#include "JsonWriter.h"
+
+namespace talkboard {
+namespace rtc {
+
+/** The JSON-building setters of agora::rtc::RtcEngineParameters.
+
+ RtcEngineParameters formats every JSON parameter with vsnprintf into a
+ 512-byte buffer, which silently truncates long file paths and does not
+ escape them. These setters send the same keys and values, built with
+ JsonWriter: a stack buffer, heap fallback, no format-string parsing.
+
+ Setters that pass a single scalar straight to IRtcEngineParameter (setBool,
+ setInt, ...) involve no JSON and are not repeated here; keep using
+ RtcEngineParameters for those.
+ */
+class EngineParameters
+{
+public:
+    typedef util::JsonWriter<> Json;
+
+    EngineParameters(agora::rtc::IRtcEngine& engine)
+        : m_parameter(engine) {}
+    EngineParameters(agora::rtc::IRtcEngine* engine)
+        : m_parameter(engine) {}
+
+    int enableLocalVideo(bool enabled) {
+        Json json;
+        json.beginObject()
+            .member("rtc.video.capture", enabled)
+            .member("che.video.local.capture", enabled)
+            .member("che.video.local.render", enabled)
+            .member("che.video.local.send", enabled)
+            .endObject();
+        return setParameters(json);
+    }
+
+    int muteLocalVideoStream(bool mute) {
+        Json json;
+        json.beginObject().member("rtc.video.mute_me", mute).member("che.video.local.send", !mute).endObject();
+        return setParameters(json);
+    }
+
+    int muteRemoteVideoStream(agora::rtc::uid_t uid, bool mute) {
+        Json json;
+        json.beginObject().member("uid", uid).member("mute", mute).endObject();
+        return setObject("rtc.video.mute_peer", json);
+    }
+
+    int startAudioRecording(const char* filePath, agora::rtc::AUDIO_RECORDING_QUALITY_TYPE quality) {
+        Json json;
+        json.beginObject().member("filePath", filePath).member("quality", quality).endObject();
+        return setObject("che.audio.start_recording", json);
+    }
+
+    int startAudioMixing(const char* filePath, bool loopback, bool replace, int cycle) {
+        Json json;
+        json.beginObject()
+            .member("filePath", filePath)
+            .member("loopback", loopback)
+            .member("replace", replace)
+            .member("cycle", cycle)
+            .endObject();
+        return setObject("che.audio.start_file_as_playout", json);
+    }
+
+    int setVolumeOfEffect(int soundId, int volume) {
+        Json json;
+        json.beginObject().member("soundId", soundId).member("gain", volume).endObject();
+        return setObject("che.audio.game_adjust_effect_volume", json);
+    }
+
+    int playEffect(int soundId, const char* filePath, int loopCount, double pitch, double pan, int gain, bool publish = false) {
+        Json json;
+        json.beginObject()
+            .member("soundId", soundId)
+            .member("filePath", filePath ? filePath : "")
+            .member("loopCount", loopCount)
+            .member("pitch", pitch)
+            .member("pan", pan)
+            .member("gain", gain)
+            .member("send2far", publish ? 1 : 0)
+            .endObject();
+        return setObject("che.audio.game_play_effect", json);
+    }
+
+    int preloadEffect(int soundId, const char* filePath) {
+        Json json;
+        json.beginObject().member("soundId", soundId).member("filePath", filePath).endObject();
+        return setObject("che.audio.game_preload_effect", json);
+    }
+
+    int setLocalVoiceEqualization(agora::rtc::AUDIO_EQUALIZATION_BAND_FREQUENCY bandFrequency, int bandGain) {
+        Json json;
+        json.beginObject().member("index", static_cast<int>(bandFrequency)).member("gain", bandGain).endObject();
+        return setObject("che.audio.morph.equalization", json);
+    }
+
+    int setLocalVoiceReverb(agora::rtc::AUDIO_REVERB_TYPE reverbKey, int value) {
+        Json json;
+        json.beginObject().member("key", static_cast<int>(reverbKey)).member("value", value).endObject();
+        return setObject("che.audio.morph.reverb", json);
+    }
+
+    int setHighQualityAudioParameters(bool fullband, bool stereo, bool fullBitrate) {
+        Json json;
+        json.beginObject()
+            .member("fullband", fullband)
+            .member("stereo", stereo)
+            .member("fullBitrate", fullBitrate)
+            .endObject();
+        return setObject("che.audio.codec.hq", json);
+    }
+
+    int muteRecordingSignal(bool enabled) {
+        Json json;
+        json.beginObject().member("che.audio.record.signal.mute", enabled).endObject();
+        return setParameters(json);
+    }
+
+    int enableAudioVolumeIndication(int interval, int smooth) {
+        if (interval < 0)
+            interval = 0;
+        Json json;
+        json.beginObject().member("interval", interval).member("smooth", smooth).endObject();
+        return setObject("che.audio.volume_indication", json);
+    }
+
+    int muteLocalAudioStream(bool mute) {
+        Json json;
+        json.beginObject().member("rtc.audio.mute_me", mute).member("che.audio.mute_me", mute).endObject();
+        return setParameters(json);
+    }
+
+    int muteRemoteAudioStream(agora::rtc::uid_t uid, bool mute) {
+        Json json;
+        json.beginObject().member("uid", uid).member("mute", mute).endObject();
+        return setObject("rtc.audio.mute_peer", json);
+    }
+
+    int setExternalAudioSource(bool enabled, int sampleRate, int channels) {
+        Json json;
+        json.beginObject()
+            .member("che.audio.external_capture", enabled)
+            .member("che.audio.external_capture.push", enabled);
+        if (enabled) {
+            json.beginObject("che.audio.set_capture_raw_audio_format")
+                .member("sampleRate", sampleRate)
+                .member("channelCnt", channels)
+                .member("mode", static_cast<int>(agora::rtc::RAW_AUDIO_FRAME_OP_MODE_READ_WRITE))
+                .endObject();
+        }
+        json.endObject();
+        return setParameters(json);
+    }
+
+    int setLocalRenderMode(agora::rtc::RENDER_MODE_TYPE renderMode) {
+        return setRemoteRenderMode(0, renderMode);
+    }
+
+    int setRemoteRenderMode(agora::rtc::uid_t uid, agora::rtc::RENDER_MODE_TYPE renderMode) {
+        Json json;
+        json.beginObject().member("uid", uid).member("mode", static_cast<int>(renderMode)).endObject();
+        return setObject("che.video.render_mode", json);
+    }
+
+    int enableDualStreamMode(bool enabled) {
+        Json json;
+        json.beginObject()
+            .member("rtc.dual_stream_mode", enabled)
+            .member("che.video.enableLowBitRateStream", enabled ? 1 : 0)
+            .endObject();
+        return setParameters(json);
+    }
+
+    int setRemoteVideoStreamType(agora::rtc::uid_t uid, agora::rtc::REMOTE_VIDEO_STREAM_TYPE streamType) {
+        Json json;
+        json.beginObject();
+        json.beginObject("rtc.video.set_remote_video_stream")
+            .member("uid", uid).member("stream", static_cast<int>(streamType)).endObject();
+        json.beginObject("che.video.setstream")
+            .member("uid", uid).member("stream", static_cast<int>(streamType)).endObject();
+        json.endObject();
+        return setParameters(json);
+    }
+
+    int setRecordingAudioFrameParameters(int sampleRate, int channel, agora::rtc::RAW_AUDIO_FRAME_OP_MODE_TYPE mode, int samplesPerCall) {
+        Json json;
+        rawAudioFormat(json, sampleRate, channel, mode, samplesPerCall);
+        return setObject("che.audio.set_capture_raw_audio_format", json);
+    }
+
+    int setPlaybackAudioFrameParameters(int sampleRate, int channel, agora::rtc::RAW_AUDIO_FRAME_OP_MODE_TYPE mode, int samplesPerCall) {
+        Json json;
+        rawAudioFormat(json, sampleRate, channel, mode, samplesPerCall);
+        return setObject("che.audio.set_render_raw_audio_format", json);
+    }
+
+    int setMixedAudioFrameParameters(int sampleRate, int samplesPerCall) {
+        Json json;
+        json.beginObject().member("sampleRate", sampleRate).member("samplesPerCall", samplesPerCall).endObject();
+        return setObject("che.audio.set_mixed_raw_audio_format", json);
+    }
+
+    int enableWebSdkInteroperability(bool enabled) {
+        Json json;
+        json.beginObject()
+            .member("rtc.video.web_h264_interop_enable", enabled)
+            .member("che.video.web_h264_interop_enable", enabled)
+            .endObject();
+        return setParameters(json);
+    }
+
+    int setVideoQualityParameters(bool preferFrameRateOverImageQuality) {
+        Json json;
+        json.beginObject()
+            .member("rtc.video.prefer_frame_rate", preferFrameRateOverImageQuality)
+            .member("che.video.prefer_frame_rate", preferFrameRateOverImageQuality)
+            .endObject();
+        return setParameters(json);
+    }
+
+    int enableLoopbackRecording(bool enabled, const char* deviceName = NULL) {
+        Json json;
+        json.beginObject();
+        if (deviceName)
+            json.member("che.audio.loopback.deviceName", deviceName);
+        json.member("che.audio.loopback.recording", enabled).endObject();
+        return setParameters(json);
+    }
+
+protected:
+    agora::rtc::AParameter& parameter() {
+        return m_parameter;
+    }
+
+    int setParameters(const Json& json) {
+        if (!m_parameter)
+            return -agora::ERR_NOT_INITIALIZED;
+        if (json.failed())
+            return -agora::ERR_RESOURCE_LIMITED;
+        return m_parameter->setParameters(json.c_str());
+    }
+
+    int setObject(const char* key, const Json& json) {
+        if (!m_parameter)
+            return -agora::ERR_NOT_INITIALIZED;
+        if (json.failed())
+            return -agora::ERR_RESOURCE_LIMITED;
+        return m_parameter->setObject(key, json.c_str());
+    }
+
+private:
+    static void rawAudioFormat(Json& json, int sampleRate, int channel, agora::rtc::RAW_AUDIO_FRAME_OP_MODE_TYPE mode, int samplesPerCall) {
+        json.beginObject()
+            .member("sampleRate", sampleRate)
+            .member("channelCnt", channel)
+            .member("mode", static_cast<int>(mode))
+            .member("samplesPerCall", samplesPerCall)
+            .endObject();
+    }
+
+    agora::rtc::AParameter m_parameter;
+};
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
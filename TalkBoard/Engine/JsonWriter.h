@@ -0,0 +1,328 @@
+//
+//  TalkBoard Engine
+//
+//  Allocation-free JSON writer for engine parameter strings.
+//
+
+#ifndef TALKBOARD_JSON_WRITER_H
+#define TALKBOARD_JSON_WRITER_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace talkboard {
+namespace util {
+
+/** Builds a JSON document in a stack buffer, moving to the heap only when it outgrows it.
+
+ Keys are string literals: their length is a template parameter, so a key
+ and its punctuation are copied with a fixed-size memcpy and nothing about
+ the layout is parsed or formatted at runtime. Only values are formatted, by
+ hand-written integer and fixed-point routines instead of vsnprintf, and
+ strings are escaped. Output is never truncated; if the heap fallback cannot
+ allocate, failed() is set and the document must not be used.
+
+ @code
+ JsonWriter<> json;
+ json.beginObject().member("uid", uid).member("mute", true).endObject();
+ parameter->setObject("rtc.video.mute_peer", json.c_str());
+ @endcode
+ */
+template <size_t StackSize = 256>
+class JsonWriter
+{
+public:
+    /** Nesting depth beginObject() and beginArray() support. */
+    enum { MAX_DEPTH = 31 };
+
+    JsonWriter()
+        : m_data(m_stack)
+        , m_size(0)
+        , m_capacity(StackSize)
+        , m_depth(0)
+        , m_first(1)
+        , m_failed(false)
+    {
+        m_stack[0] = 0;
+    }
+
+    ~JsonWriter()
+    {
+        if (m_data != m_stack)
+            free(m_data);
+    }
+
+    /** Starts an anonymous object: the document itself or an array element. */
+    JsonWriter& beginObject()
+    {
+        separate();
+        put('{');
+        push();
+        return *this;
+    }
+
+    /** Starts an object member `key` whose value is an object. */
+    template <size_t N>
+    JsonWriter& beginObject(const char (&key)[N])
+    {
+        writeKey(key);
+        put('{');
+        push();
+        return *this;
+    }
+
+    JsonWriter& endObject()
+    {
+        put('}');
+        if (m_depth > 0)
+            --m_depth;
+        return *this;
+    }
+
+    /** Starts an anonymous array: the document itself or an array element. */
+    JsonWriter& beginArray()
+    {
+        separate();
+        put('[');
+        push();
+        return *this;
+    }
+
+    /** Starts an object member `key` whose value is an array; add elements with value() or beginObject(). */
+    template <size_t N>
+    JsonWriter& beginArray(const char (&key)[N])
+    {
+        writeKey(key);
+        put('[');
+        push();
+        return *this;
+    }
+
+    JsonWriter& endArray()
+    {
+        put(']');
+        if (m_depth > 0)
+            --m_depth;
+        return *this;
+    }
+
+    /** Writes `"key":value`. Keys must be literals that need no escaping. */
+    template <size_t N, typename T>
+    JsonWriter& member(const char (&key)[N], T value)
+    {
+        writeKey(key);
+        writeValue(value);
+        return *this;
+    }
+
+    /** Writes `"key":json` for a key known only at runtime and an already
+     serialized value; neither is escaped or checked.
+     */
+    JsonWriter& rawMember(const char* key, size_t keyLength, const char* json, size_t jsonLength)
+    {
+        separate();
+        put('"');
+        append(key, keyLength);
+        append("\":", 2);
+        append(json, jsonLength);
+        return *this;
+    }
+
+    /** Writes a bare value, e.g. to serialize a scalar on its own. */
+    template <typename T>
+    JsonWriter& value(T v)
+    {
+        separate();
+        writeValue(v);
+        return *this;
+    }
+
+    /** Empties the document; a heap buffer is kept for reuse. */
+    void clear()
+    {
+        m_size = 0;
+        m_data[0] = 0;
+        m_depth = 0;
+        m_first = 1;
+        m_failed = false;
+    }
+
+    const char* c_str() const { return m_data; }
+    size_t size() const { return m_size; }
+    /** True once the document outgrew the stack buffer. */
+    bool onHeap() const { return m_data != m_stack; }
+    /** True if the heap fallback failed; the document is incomplete. */
+    bool failed() const { return m_failed; }
+
+private:
+    JsonWriter(const JsonWriter&);
+    JsonWriter& operator=(const JsonWriter&);
+
+    template <size_t N>
+    void writeKey(const char (&key)[N])
+    {
+        separate();
+        if (!reserve(N + 2))
+            return;
+        m_data[m_size] = '"';
+        memcpy(m_data + m_size + 1, key, N - 1);
+        m_data[m_size + N] = '"';
+        m_data[m_size + N + 1] = ':';
+        m_size += N + 2;
+        m_data[m_size] = 0;
+    }
+
+    void writeValue(bool value)
+    {
+        if (value)
+            append("true", 4);
+        else
+            append("false", 5);
+    }
+
+    void writeValue(int value) { writeSigned(value); }
+    void writeValue(long value) { writeSigned(value); }
+    void writeValue(long long value) { writeSigned(value); }
+    void writeValue(unsigned int value) { writeUnsigned(value); }
+    void writeValue(unsigned long value) { writeUnsigned(value); }
+    void writeValue(unsigned long long value) { writeUnsigned(value); }
+
+    /** Six decimals, like the "%lf" the SDK uses. JSON has no NaN or infinity; they become 0. */
+    void writeValue(double value)
+    {
+        if (!isfinite(value))
+            value = 0;
+        if (fabs(value) >= 9.2e12) {
+            // Beyond the range of the micro-unit conversion; whole numbers only.
+            writeSigned((long long)(value < 0 ? fmax(value, -9.2e18) : fmin(value, 9.2e18)));
+            return;
+        }
+        long long micros = llround(value * 1e6);
+        unsigned long long magnitude = micros < 0 ? 0ULL - (unsigned long long)micros : (unsigned long long)micros;
+        if (micros < 0)
+            put('-');
+        writeUnsigned(magnitude / 1000000);
+        char fraction[7];
+        unsigned long long rest = magnitude % 1000000;
+        fraction[0] = '.';
+        for (int i = 6; i >= 1; --i, rest /= 10)
+            fraction[i] = (char)('0' + rest % 10);
+        append(fraction, 7);
+    }
+
+    void writeValue(const char* value)
+    {
+        put('"');
+        if (value) {
+            static const char kHex[] = "0123456789abcdef";
+            const char* run = value;
+            for (const char* p = value; *p; ++p) {
+                unsigned char c = (unsigned char)*p;
+                if (c >= 0x20 && c != '"' && c != '\\')
+                    continue;
+                append(run, p - run);
+                if (c == '"' || c == '\\') {
+                    char escaped[2] = { '\\', (char)c };
+                    append(escaped, 2);
+                } else {
+                    char escaped[6] = { '\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 15] };
+                    append(escaped, 6);
+                }
+                run = p + 1;
+            }
+            append(run, strlen(run));
+        }
+        put('"');
+    }
+
+    template <typename T>
+    void writeSigned(T value)
+    {
+        unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+        if (value < 0)
+            put('-');
+        writeUnsigned(magnitude);
+    }
+
+    void writeUnsigned(unsigned long long value)
+    {
+        char digits[20];
+        int n = 0;
+        do {
+            digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value);
+        append(digits + sizeof(digits) - n, n);
+    }
+
+    void separate()
+    {
+        if (m_first & (1u << m_depth))
+            m_first &= ~(1u << m_depth);
+        else
+            put(',');
+    }
+
+    void push()
+    {
+        if (m_depth < MAX_DEPTH)
+            ++m_depth;
+        m_first |= 1u << m_depth;
+    }
+
+    void put(char c)
+    {
+        if (!reserve(1))
+            return;
+        m_data[m_size++] = c;
+        m_data[m_size] = 0;
+    }
+
+    void append(const char* text, size_t length)
+    {
+        if (!length || !reserve(length))
+            return;
+        memcpy(m_data + m_size, text, length);
+        m_size += length;
+        m_data[m_size] = 0;
+    }
+
+    /** Makes room for `length` more characters plus the terminator. */
+    bool reserve(size_t length)
+    {
+        if (m_failed)
+            return false;
+        if (m_size + length + 1 <= m_capacity)
+            return true;
+        size_t capacity = m_capacity * 2;
+        while (capacity < m_size + length + 1)
+            capacity *= 2;
+        char* data = static_cast<char*>(m_data == m_stack ? malloc(capacity) : realloc(m_data, capacity));
+        if (!data) {
+            m_failed = true;
+            return false;
+        }
+        if (m_data == m_stack)
+            memcpy(data, m_stack, m_size + 1);
+        m_data = data;
+        m_capacity = capacity;
+        return true;
+    }
+
+    char m_stack[StackSize];
+    char* m_data;
+    size_t m_size;
+    size_t m_capacity;
+    int m_depth;
+    /** Bit d is set while the object or array at depth d is still empty. */
+    uint32_t m_first;
+    bool m_failed;
+};
+
+} // namespace util
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,255 @@
+//
+//  TalkBoard Engine
+//
+
+#include "LatencyHistogram.h"
+
+#include <math.h>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+namespace talkboard {
+namespace util {
+
+namespace {
+
+const int kSubBuckets = 1 << LatencyHistogram::SUB_BUCKET_BITS;
+const int kHalfSubBuckets = kSubBuckets / 2;
+/** First byte of an encoding: format and bucket layout. */
+const uint8_t kEncodingVersion = 0x10 | LatencyHistogram::SUB_BUCKET_BITS;
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+bool getVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && data < end; shift += 7) {
+        uint8_t byte = *data++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline uint64_t zigZag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+inline int64_t unZigZag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+    : m_count(0)
+    , m_sum(0)
+    , m_max(0)
+{
+    static_assert(COUNTS == (16 - SUB_BUCKET_BITS + 2) * (1 << (SUB_BUCKET_BITS - 1)), "COUNTS does not cover MAX_VALUE");
+    for (int i = 0; i < COUNTS; ++i)
+        m_counts[i].store(0, std::memory_order_relaxed);
+}
+
+// Bucket b covers [2^(b+6), 2^(b+7)) with counters 64 apart from b = 1 on;
+// bucket 0 covers [0, 128) one value per counter. The counter is the bucket's
+// half-range offset plus the value shifted down to its top seven bits.
+int LatencyHistogram::indexOf(uint32_t value)
+{
+    if (value > MAX_VALUE)
+        value = MAX_VALUE;
+    int bucket = (31 - __builtin_clz(value | (kSubBuckets - 1))) - (SUB_BUCKET_BITS - 1);
+    return bucket * kHalfSubBuckets + (int)(value >> bucket);
+}
+
+uint32_t LatencyHistogram::lowestValueAt(int index)
+{
+    int bucket = index / kHalfSubBuckets - 1;
+    int sub = index % kHalfSubBuckets + kHalfSubBuckets;
+    if (bucket < 0) {
+        bucket = 0;
+        sub -= kHalfSubBuckets;
+    }
+    return (uint32_t)sub << bucket;
+}
+
+uint32_t LatencyHistogram::highestValueAt(int index)
+{
+    int bucket = index / kHalfSubBuckets - 1;
+    return lowestValueAt(index) + (bucket > 0 ? (1u << bucket) - 1 : 0);
+}
+
+void LatencyHistogram::record(uint32_t value)
+{
+    if (value > MAX_VALUE)
+        value = MAX_VALUE;
+    m_counts[indexOf(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    raiseMax(value);
+}
+
+void LatencyHistogram::raiseMax(uint32_t value)
+{
+    uint32_t current = m_max.load(std::memory_order_relaxed);
+    while (value > current && !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::add(int index, uint64_t count)
+{
+    // Counters saturate rather than wrap; four billion samples of one value
+    // is more than a session produces.
+    uint32_t current = m_counts[index].load(std::memory_order_relaxed);
+    uint64_t sum = current + count;
+    if (sum > 0xffffffffu)
+        count = 0xffffffffu - current;
+    m_counts[index].fetch_add((uint32_t)count, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const
+{
+    uint64_t count = m_count.load(std::memory_order_relaxed);
+    return count ? (double)m_sum.load(std::memory_order_relaxed) / count : 0;
+}
+
+uint32_t LatencyHistogram::valueAtPercentile(double percentile) const
+{
+    uint64_t total = 0;
+    uint32_t counts[COUNTS];
+    for (int i = 0; i < COUNTS; ++i) {
+        counts[i] = m_counts[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (!total)
+        return 0;
+    if (percentile < 0)
+        percentile = 0;
+    if (percentile > 100)
+        percentile = 100;
+    // Nearest rank: the smallest value with at least `percentile` percent of
+    // the values at or below it. Multiplying first keeps whole percentages exact.
+    uint64_t rank = (uint64_t)ceil(percentile * total / 100);
+    if (rank < 1)
+        rank = 1;
+    if (rank > total)
+        rank = total;
+    uint64_t seen = 0;
+    for (int i = 0; i < COUNTS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint32_t value = highestValueAt(i);
+            uint32_t max = m_max.load(std::memory_order_relaxed);
+            return value < max ? value : max;
+        }
+    }
+    return m_max.load(std::memory_order_relaxed);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (int i = 0; i < COUNTS; ++i) {
+        uint32_t count = other.m_counts[i].load(std::memory_order_relaxed);
+        if (count)
+            add(i, count);
+    }
+    m_count.fetch_add(other.m_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_sum.fetch_add(other.m_sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    raiseMax(other.m_max.load(std::memory_order_relaxed));
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < COUNTS; ++i)
+        m_counts[i].store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+// Layout: version byte, varint sum, varint max, varint number of counter
+// varints, then per counter zigZag(count), or zigZag(-n) for n empty
+// counters in a row. Trailing empty counters are left out; the total count
+// is the sum of the counters.
+void LatencyHistogram::serialize(std::vector<uint8_t>& out) const
+{
+    std::vector<uint8_t> counters;
+    uint64_t fields = 0;
+    int64_t zeros = 0;
+    for (int i = 0; i < COUNTS; ++i) {
+        uint32_t count = m_counts[i].load(std::memory_order_relaxed);
+        if (!count) {
+            ++zeros;
+            continue;
+        }
+        if (zeros) {
+            putVarint(counters, zigZag(-zeros));
+            ++fields;
+            zeros = 0;
+        }
+        putVarint(counters, zigZag(count));
+        ++fields;
+    }
+
+    out.push_back(kEncodingVersion);
+    putVarint(out, m_sum.load(std::memory_order_relaxed));
+    putVarint(out, m_max.load(std::memory_order_relaxed));
+    putVarint(out, fields);
+    out.insert(out.end(), counters.begin(), counters.end());
+}
+
+int LatencyHistogram::mergeSerialized(const uint8_t* data, size_t size)
+{
+    if (!data || !size || data[0] != kEncodingVersion)
+        return -agora::ERR_INVALID_ARGUMENT;
+    const uint8_t* p = data + 1;
+    const uint8_t* end = data + size;
+    uint64_t sum, max, fields;
+    if (!getVarint(p, end, sum) || !getVarint(p, end, max) || !getVarint(p, end, fields) || max > MAX_VALUE)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    // Check the whole encoding before adding anything.
+    const uint8_t* counters = p;
+    int64_t index = 0;
+    for (uint64_t f = 0; f < fields; ++f) {
+        uint64_t raw;
+        if (!getVarint(p, end, raw))
+            return -agora::ERR_INVALID_ARGUMENT;
+        int64_t value = unZigZag(raw);
+        index += value < 0 ? -value : 1;
+        if (value == 0 || value > 0xffffffffLL || index > COUNTS)
+            return -agora::ERR_INVALID_ARGUMENT;
+    }
+
+    const uint8_t* q = counters;
+    uint64_t count = 0;
+    index = 0;
+    for (uint64_t f = 0; f < fields; ++f) {
+        uint64_t raw;
+        getVarint(q, end, raw);
+        int64_t value = unZigZag(raw);
+        if (value < 0) {
+            index -= value;
+        } else {
+            add((int)index++, (uint64_t)value);
+            count += (uint64_t)value;
+        }
+    }
+    m_count.fetch_add(count, std::memory_order_relaxed);
+    m_sum.fetch_add(sum, std::memory_order_relaxed);
+    raiseMax((uint32_t)max);
+    return (int)(p - data);
+}
+
+} // namespace util
+} // namespace talkboard
@@ -0,0 +1,93 @@
+//
+//  TalkBoard Engine
+//
+//  Lock-free log-bucketed histogram for delays and loss rates.
+//
+
+#ifndef TALKBOARD_LATENCY_HISTOGRAM_H
+#define TALKBOARD_LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+namespace talkboard {
+namespace util {
+
+/** Counts of values from 0 to MAX_VALUE in HdrHistogram-style buckets.
+
+ Values below 128 are counted exactly. Above that each power of two is split
+ into 64 sub-buckets, so every value shares its counter only with values
+ within 1/64 (1.6%) of it, and percentiles are reported as the highest value
+ of their counter: a p99 is never below the true one. 704 counters cover the
+ 16-bit delays and rates the SDK reports.
+
+ record() is a relaxed atomic increment and may be called from any number of
+ threads. Readers see a consistent histogram once recording has stopped and
+ an approximate one while it runs.
+
+ serialize() appends a compact encoding (zig-zag varints of the non-zero
+ counters, with runs of empty counters collapsed into one number), and
+ mergeSerialized() adds such an encoding back into a histogram, so data from
+ several calls or devices can be combined.
+ */
+class LatencyHistogram
+{
+public:
+    enum
+    {
+        SUB_BUCKET_BITS = 7,
+        MAX_VALUE = 65535,
+        COUNTS = 704,
+    };
+
+    LatencyHistogram();
+
+    /** Counts `value`; larger values are counted as MAX_VALUE. */
+    void record(uint32_t value);
+
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    uint32_t max() const { return m_max.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    /** Value at or below which `percentile` percent (0 to 100) of the values
+     lie, rounded up to the top of its counter; 0 when empty. */
+    uint32_t valueAtPercentile(double percentile) const;
+
+    /** Adds the counts of `other`. */
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    /** Appends the encoding of this histogram to `out`. */
+    void serialize(std::vector<uint8_t>& out) const;
+
+    /** Adds the histogram encoded at `data` by serialize().
+
+     @return Bytes consumed, or -ERR_INVALID_ARGUMENT if `data` is not a
+     complete encoding; nothing is added then.
+     */
+    int mergeSerialized(const uint8_t* data, size_t size);
+
+    /** Counter of `value`, and the range of values that share it. */
+    static int indexOf(uint32_t value);
+    static uint32_t lowestValueAt(int index);
+    static uint32_t highestValueAt(int index);
+
+private:
+    LatencyHistogram(const LatencyHistogram&);
+    LatencyHistogram& operator=(const LatencyHistogram&);
+
+    void add(int index, uint64_t count);
+    void raiseMax(uint32_t value);
+
+    std::atomic<uint32_t> m_counts[COUNTS];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint32_t> m_max;
+};
+
+} // namespace util
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,244 @@
+//
+//  TalkBoard Engine
+//
+
+#include "LatencyRecorder.h"
+
+#include <string.h>
+
+namespace talkboard {
+namespace rtc {
+
+namespace {
+
+const uint64_t kFreeKey = 0;
+/** Start of a serialize() blob: "TBLR" and the format version. */
+const uint8_t kMagic[5] = { 'T', 'B', 'L', 'R', 1 };
+
+inline uint64_t keyOf(agora::rtc::uid_t uid)
+{
+    return (uint64_t)uid | (1ULL << 32);
+}
+
+inline uint32_t hashOf(agora::rtc::uid_t uid)
+{
+    return (uint32_t)uid * 2654435761u;
+}
+
+void putUInt32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+uint32_t getUInt32(const uint8_t* data)
+{
+    return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+} // namespace
+
+LatencyRecorder::LatencyRecorder(int maxUids)
+    : m_slots(maxUids > 0 ? maxUids : 1)
+    , m_dropped(0)
+{
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        m_slots[i] = new Slot();
+        m_slots[i]->key.store(kFreeKey, std::memory_order_relaxed);
+    }
+}
+
+LatencyRecorder::~LatencyRecorder()
+{
+    for (size_t i = 0; i < m_slots.size(); ++i)
+        delete m_slots[i];
+}
+
+LatencyRecorder::Slot* LatencyRecorder::slotFor(agora::rtc::uid_t uid)
+{
+    const size_t size = m_slots.size();
+    uint64_t key = keyOf(uid);
+    uint32_t start = hashOf(uid);
+    for (size_t probe = 0; probe < size; ++probe) {
+        Slot* slot = m_slots[(start + probe) % size];
+        uint64_t current = slot->key.load(std::memory_order_acquire);
+        if (current == key)
+            return slot;
+        if (current == kFreeKey) {
+            // Another callback thread may claim the same slot first; it may even
+            // be for this uid.
+            if (slot->key.compare_exchange_strong(current, key, std::memory_order_acq_rel) || current == key)
+                return slot;
+        }
+    }
+    return NULL;
+}
+
+const LatencyRecorder::Slot* LatencyRecorder::find(agora::rtc::uid_t uid) const
+{
+    const size_t size = m_slots.size();
+    uint64_t key = keyOf(uid);
+    uint32_t start = hashOf(uid);
+    for (size_t probe = 0; probe < size; ++probe) {
+        const Slot* slot = m_slots[(start + probe) % size];
+        uint64_t current = slot->key.load(std::memory_order_acquire);
+        if (current == key)
+            return slot;
+        if (current == kFreeKey)
+            break;
+    }
+    return NULL;
+}
+
+int LatencyRecorder::record(agora::rtc::uid_t uid, LATENCY_METRIC metric, uint32_t value)
+{
+    if (metric < 0 || metric >= LATENCY_METRIC_COUNT)
+        return -agora::ERR_INVALID_ARGUMENT;
+    Slot* slot = slotFor(uid);
+    if (!slot) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return -agora::ERR_RESOURCE_LIMITED;
+    }
+    slot->histograms[metric].record(value);
+    return 0;
+}
+
+void LatencyRecorder::recordRtcStats(const agora::rtc::RtcStats& stats)
+{
+    record(0, LATENCY_LASTMILE_DELAY, stats.lastmileDelay);
+}
+
+void LatencyRecorder::recordAudioQuality(agora::rtc::uid_t uid, int quality, unsigned short delay, unsigned short lost)
+{
+    (void)quality;
+    if (Slot* slot = slotFor(uid)) {
+        slot->histograms[LATENCY_AUDIO_DELAY].record(delay);
+        slot->histograms[LATENCY_AUDIO_LOSS].record(lost);
+    } else {
+        m_dropped.fetch_add(2, std::memory_order_relaxed);
+    }
+}
+
+void LatencyRecorder::recordRemoteAudioTransportStats(agora::rtc::uid_t uid, unsigned short delay, unsigned short lost, unsigned short rxKBitRate)
+{
+    (void)rxKBitRate;
+    if (Slot* slot = slotFor(uid)) {
+        slot->histograms[LATENCY_AUDIO_TRANSPORT_DELAY].record(delay);
+        slot->histograms[LATENCY_AUDIO_TRANSPORT_LOSS].record(lost);
+    } else {
+        m_dropped.fetch_add(2, std::memory_order_relaxed);
+    }
+}
+
+void LatencyRecorder::recordRemoteVideoTransportStats(agora::rtc::uid_t uid, unsigned short delay, unsigned short lost, unsigned short rxKBitRate)
+{
+    (void)rxKBitRate;
+    if (Slot* slot = slotFor(uid)) {
+        slot->histograms[LATENCY_VIDEO_TRANSPORT_DELAY].record(delay);
+        slot->histograms[LATENCY_VIDEO_TRANSPORT_LOSS].record(lost);
+    } else {
+        m_dropped.fetch_add(2, std::memory_order_relaxed);
+    }
+}
+
+const util::LatencyHistogram* LatencyRecorder::histogram(agora::rtc::uid_t uid, LATENCY_METRIC metric) const
+{
+    if (metric < 0 || metric >= LATENCY_METRIC_COUNT)
+        return NULL;
+    const Slot* slot = find(uid);
+    return slot ? &slot->histograms[metric] : NULL;
+}
+
+void LatencyRecorder::total(LATENCY_METRIC metric, util::LatencyHistogram& out) const
+{
+    if (metric < 0 || metric >= LATENCY_METRIC_COUNT)
+        return;
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        if (m_slots[i]->key.load(std::memory_order_acquire) != kFreeKey)
+            out.merge(m_slots[i]->histograms[metric]);
+    }
+}
+
+int LatencyRecorder::merge(const LatencyRecorder& other)
+{
+    int result = 0;
+    for (size_t i = 0; i < other.m_slots.size(); ++i) {
+        const Slot* from = other.m_slots[i];
+        uint64_t key = from->key.load(std::memory_order_acquire);
+        if (key == kFreeKey)
+            continue;
+        Slot* to = slotFor((agora::rtc::uid_t)key);
+        if (!to) {
+            result = -agora::ERR_RESOURCE_LIMITED;
+            continue;
+        }
+        for (int m = 0; m < LATENCY_METRIC_COUNT; ++m)
+            to->histograms[m].merge(from->histograms[m]);
+    }
+    return result;
+}
+
+// Layout: kMagic, then per non-empty histogram the uid (4 bytes, little
+// endian), the metric (1 byte) and LatencyHistogram::serialize().
+void LatencyRecorder::serialize(std::vector<uint8_t>& out) const
+{
+    out.insert(out.end(), kMagic, kMagic + sizeof(kMagic));
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        const Slot* slot = m_slots[i];
+        uint64_t key = slot->key.load(std::memory_order_acquire);
+        if (key == kFreeKey)
+            continue;
+        for (int m = 0; m < LATENCY_METRIC_COUNT; ++m) {
+            if (!slot->histograms[m].count())
+                continue;
+            putUInt32(out, (uint32_t)key);
+            out.push_back((uint8_t)m);
+            slot->histograms[m].serialize(out);
+        }
+    }
+}
+
+int LatencyRecorder::mergeSerialized(const uint8_t* data, size_t size)
+{
+    if (!data || size < sizeof(kMagic) || memcmp(data, kMagic, sizeof(kMagic)) != 0)
+        return -agora::ERR_INVALID_ARGUMENT;
+    size_t offset = sizeof(kMagic);
+    int result = 0;
+    while (offset < size) {
+        if (size - offset < 5 || data[offset + 4] >= LATENCY_METRIC_COUNT)
+            return -agora::ERR_INVALID_ARGUMENT;
+        agora::rtc::uid_t uid = getUInt32(data + offset);
+        int metric = data[offset + 4];
+        offset += 5;
+
+        Slot* slot = slotFor(uid);
+        if (slot) {
+            int used = slot->histograms[metric].mergeSerialized(data + offset, size - offset);
+            if (used < 0)
+                return used;
+            offset += used;
+        } else {
+            // Parse into a scratch histogram to find where the next one starts.
+            util::LatencyHistogram skipped;
+            int used = skipped.mergeSerialized(data + offset, size - offset);
+            if (used < 0)
+                return used;
+            offset += used;
+            result = -agora::ERR_RESOURCE_LIMITED;
+        }
+    }
+    return result;
+}
+
+void LatencyRecorder::reset()
+{
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        for (int m = 0; m < LATENCY_METRIC_COUNT; ++m)
+            m_slots[i]->histograms[m].reset();
+        m_slots[i]->key.store(kFreeKey, std::memory_order_release);
+    }
+    m_dropped.store(0, std::memory_order_relaxed);
+}
+
+} // namespace rtc
+} // namespace talkboard
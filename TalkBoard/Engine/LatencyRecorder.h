@@ -0,0 +1,118 @@
+//
+//  TalkBoard Engine
+//
+//  Per-uid delay and loss histograms of a call.
+//
+
+#ifndef TALKBOARD_LATENCY_RECORDER_H
+#define TALKBOARD_LATENCY_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+#include "LatencyHistogram.h"
+
+namespace talkboard {
+namespace rtc {
+
+/** What a histogram measures: delays in ms, losses in percent.
+ */
+enum LATENCY_METRIC
+{
+    /** RtcStats::lastmileDelay, under uid 0. */
+    LATENCY_LASTMILE_DELAY = 0,
+    /** onAudioQuality delay and lost. */
+    LATENCY_AUDIO_DELAY,
+    LATENCY_AUDIO_LOSS,
+    /** onRemoteAudioTransportStats delay and lost. */
+    LATENCY_AUDIO_TRANSPORT_DELAY,
+    LATENCY_AUDIO_TRANSPORT_LOSS,
+    /** onRemoteVideoTransportStats delay and lost. */
+    LATENCY_VIDEO_TRANSPORT_DELAY,
+    LATENCY_VIDEO_TRANSPORT_LOSS,
+    LATENCY_METRIC_COUNT,
+};
+
+/** Histograms of every delay and loss the SDK reports, per uid and metric.
+
+ Call the record methods from the matching IRtcEngineEventHandler callbacks;
+ they are lock-free and may run on any SDK thread. A uid's histograms are
+ claimed on its first report and kept until reset(), so the tail of a whole
+ call survives users leaving.
+
+ serialize() writes every non-empty histogram in a compact binary form for
+ upload; mergeSerialized() adds such a blob into another recorder, which is
+ how reports of several calls are combined. total() merges all uids of one
+ metric into a single histogram.
+ */
+class LatencyRecorder
+{
+public:
+    /** @param maxUids Uids with histograms at the same time, uid 0 included. */
+    explicit LatencyRecorder(int maxUids = 64);
+    ~LatencyRecorder();
+
+    void recordRtcStats(const agora::rtc::RtcStats& stats);
+    void recordAudioQuality(agora::rtc::uid_t uid, int quality, unsigned short delay, unsigned short lost);
+    void recordRemoteAudioTransportStats(agora::rtc::uid_t uid, unsigned short delay, unsigned short lost, unsigned short rxKBitRate);
+    void recordRemoteVideoTransportStats(agora::rtc::uid_t uid, unsigned short delay, unsigned short lost, unsigned short rxKBitRate);
+
+    /** Records one value.
+
+     @return 0, -ERR_INVALID_ARGUMENT for an unknown metric, or
+     -ERR_RESOURCE_LIMITED when maxUids uids are already tracked.
+     */
+    int record(agora::rtc::uid_t uid, LATENCY_METRIC metric, uint32_t value);
+
+    /** The histogram of `uid` and `metric`, or NULL if `uid` never reported. */
+    const util::LatencyHistogram* histogram(agora::rtc::uid_t uid, LATENCY_METRIC metric) const;
+
+    /** Adds the `metric` histograms of every uid into `out`. */
+    void total(LATENCY_METRIC metric, util::LatencyHistogram& out) const;
+
+    /** Adds every histogram of `other`, uid by uid. */
+    int merge(const LatencyRecorder& other);
+
+    /** Appends every non-empty histogram to `out`. */
+    void serialize(std::vector<uint8_t>& out) const;
+
+    /** Adds the histograms written by serialize(), uid by uid.
+
+     @return 0, -ERR_INVALID_ARGUMENT if `data` is malformed (histograms
+     before the fault have been added), or -ERR_RESOURCE_LIMITED if it
+     holds more uids than fit.
+     */
+    int mergeSerialized(const uint8_t* data, size_t size);
+
+    /** Forgets every uid. Only while no record method can run. */
+    void reset();
+
+    /** Values lost because maxUids uids were already tracked. */
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    LatencyRecorder(const LatencyRecorder&);
+    LatencyRecorder& operator=(const LatencyRecorder&);
+
+    struct Slot
+    {
+        /** uid with bit 32 set; 0 marks a free slot. */
+        std::atomic<uint64_t> key;
+        util::LatencyHistogram histograms[LATENCY_METRIC_COUNT];
+    };
+
+    Slot* slotFor(agora::rtc::uid_t uid);
+    const Slot* find(agora::rtc::uid_t uid) const;
+
+    std::vector<Slot*> m_slots;
+    std::atomic<uint64_t> m_dropped;
+};
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
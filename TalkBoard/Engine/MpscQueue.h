@@ -0,0 +1,147 @@
+//
+//  TalkBoard Engine
+//
+//  Bounded lock-free queue for many producers and one consumer.
+//
+
+#ifndef TALKBOARD_MPSC_QUEUE_H
+#define TALKBOARD_MPSC_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#ifndef TALKBOARD_CACHE_LINE_SIZE
+#define TALKBOARD_CACHE_LINE_SIZE 64
+#endif
+
+namespace talkboard {
+namespace util {
+
+/** Fixed-capacity queue: any number of producer threads, one consumer thread.
+
+ Every cell carries a sequence number (D. Vyukov's bounded queue). A producer
+ reserves a cell with one compare-and-swap on the tail, fills it in place and
+ publishes it by bumping the cell's sequence; the consumer reads cells in
+ order and hands them back the same way. Nothing blocks or allocates after
+ construction, and a full queue fails the claim instead of waiting, so it is
+ safe to feed from threads that must not stall.
+
+ Elements are filled and read in place, which avoids copying large T:
+
+ @code
+ size_t ticket;
+ if (T* slot = queue.claim(ticket)) {
+     fill(*slot);
+     queue.publish(ticket);
+ }
+ ...
+ while (T* slot = queue.front()) {
+     use(*slot);
+     queue.pop();
+ }
+ @endcode
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+    /** @param capacity Rounded up to a power of two, at least 2. */
+    explicit MpscQueue(size_t capacity)
+        : m_cells(roundUp(capacity))
+        , m_mask(m_cells.size() - 1)
+        , m_head(0)
+        , m_tail(0)
+    {
+        for (size_t i = 0; i < m_cells.size(); ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /** Producer side. Reserves the next cell, or returns NULL if the queue is full.
+
+     The cell must be handed to publish() with `ticket`; until then the
+     consumer stops at it.
+     */
+    T* claim(size_t& ticket)
+    {
+        size_t position = m_tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[position & m_mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return NULL;
+            } else {
+                position = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+        ticket = position;
+        return &m_cells[position & m_mask].value;
+    }
+
+    /** Producer side. Makes the cell reserved by claim() visible to the consumer. */
+    void publish(size_t ticket)
+    {
+        m_cells[ticket & m_mask].sequence.store(ticket + 1, std::memory_order_release);
+    }
+
+    /** Consumer side. The oldest published element, or NULL. */
+    T* front()
+    {
+        size_t position = m_head.load(std::memory_order_relaxed);
+        Cell& cell = m_cells[position & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != position + 1)
+            return NULL;
+        return &cell.value;
+    }
+
+    /** Consumer side. Releases the element returned by front() to the producers. */
+    void pop()
+    {
+        size_t position = m_head.load(std::memory_order_relaxed);
+        m_cells[position & m_mask].sequence.store(position + m_mask + 1, std::memory_order_release);
+        m_head.store(position + 1, std::memory_order_relaxed);
+    }
+
+    /** Elements claimed and not yet popped; approximate while producers run. */
+    size_t size() const
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return m_cells.size(); }
+
+private:
+    MpscQueue(const MpscQueue&);
+    MpscQueue& operator=(const MpscQueue&);
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static size_t roundUp(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    std::vector<Cell> m_cells;
+    size_t m_mask;
+    alignas(TALKBOARD_CACHE_LINE_SIZE) std::atomic<size_t> m_head;
+    alignas(TALKBOARD_CACHE_LINE_SIZE) std::atomic<size_t> m_tail;
+};
+
+} // namespace util
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,397 @@
+//
+//  TalkBoard Engine
+//
+
+#include "PacketCapture.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+namespace talkboard {
+namespace rtc {
+
+namespace {
+
+const char kMagic[8] = { 'T', 'B', 'P', 'C', 'A', 'P', '0', '1' };
+const unsigned char kTruncatedFlag = 0x80;
+/** Records queued between wakeups of the writer; at most a quarter of the queue. */
+const size_t kWakeRecords = 64;
+/** Upper bound on how late the writer notices records it was not woken for. */
+const int kWriterPollMs = 50;
+const size_t kFileBufferSize = 256 * 1024;
+
+int64_t monotonicNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool isMessage(int type)
+{
+    return type == CAPTURE_STREAM_MESSAGE_RECEIVED || type == CAPTURE_STREAM_MESSAGE_SENT;
+}
+
+size_t putVarint(unsigned char* p, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (unsigned char)v;
+    return n;
+}
+
+bool getVarint(FILE* file, uint64_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(file);
+        if (c == EOF)
+            return false;
+        v |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+} // namespace
+
+PacketCapture::PacketCapture(size_t capacity)
+    : m_queue(capacity)
+    , m_wakeMask(std::max<size_t>(std::min(kWakeRecords, m_queue.capacity() / 4), 1) - 1)
+    , m_observer(NULL)
+    , m_file(NULL)
+    , m_startNanos(0)
+    , m_lastTimeUs(0)
+{
+    m_capturing.store(false);
+    m_running.store(false);
+    m_ioError.store(false);
+    m_captured.store(0);
+    m_dropped.store(0);
+    m_truncated.store(0);
+    m_bytesWritten.store(0);
+}
+
+PacketCapture::~PacketCapture()
+{
+    stop();
+}
+
+int PacketCapture::start(const char* path)
+{
+    if (m_file)
+        return -agora::ERR_ALREADY_IN_USE;
+    if (!path)
+        return -agora::ERR_INVALID_ARGUMENT;
+    m_file = fopen(path, "wb");
+    if (!m_file)
+        return -agora::ERR_FAILED;
+    setvbuf(m_file, NULL, _IOFBF, kFileBufferSize);
+
+    // Records of callbacks that raced the previous stop().
+    while (m_queue.front())
+        m_queue.pop();
+
+    unsigned char header[sizeof(kMagic) + 8];
+    memcpy(header, kMagic, sizeof(kMagic));
+    int64_t wallUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    for (int i = 0; i < 8; ++i)
+        header[sizeof(kMagic) + i] = (unsigned char)((uint64_t)wallUs >> (8 * i));
+    bool ok = fwrite(header, 1, sizeof(header), m_file) == sizeof(header);
+
+    m_ioError.store(!ok);
+    m_captured.store(0);
+    m_dropped.store(0);
+    m_truncated.store(0);
+    m_bytesWritten.store(ok ? sizeof(header) : 0);
+    m_lastTimeUs = 0;
+    m_startNanos = monotonicNanos();
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&PacketCapture::run, this);
+    m_capturing.store(true, std::memory_order_release);
+    return 0;
+}
+
+int PacketCapture::stop()
+{
+    if (!m_file)
+        return 0;
+    m_capturing.store(false, std::memory_order_release);
+    m_running.store(false, std::memory_order_release);
+    notifyWriter();
+    m_thread.join();
+    if (fclose(m_file) != 0)
+        m_ioError.store(true);
+    m_file = NULL;
+    return m_ioError.load() ? -agora::ERR_FAILED : 0;
+}
+
+void PacketCapture::capture(CAPTURE_RECORD_TYPE type, agora::rtc::uid_t uid, int streamId,
+                            const unsigned char* data, size_t length)
+{
+    if (!m_capturing.load(std::memory_order_acquire))
+        return;
+    size_t ticket;
+    CaptureRecord* record = m_queue.claim(ticket);
+    if (!record) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    size_t size = length < (size_t)CaptureRecord::MAX_DATA ? length : (size_t)CaptureRecord::MAX_DATA;
+    record->type = type;
+    record->timeUs = (monotonicNanos() - m_startNanos) / 1000;
+    record->uid = uid;
+    record->streamId = streamId;
+    record->length = (uint32_t)length;
+    record->size = (uint16_t)size;
+    if (size)
+        memcpy(record->data, data, size);
+    m_queue.publish(ticket);
+    m_captured.fetch_add(1, std::memory_order_relaxed);
+    if (size < length)
+        m_truncated.fetch_add(1, std::memory_order_relaxed);
+    // Waking the writer for every packet would cost the SDK thread a system
+    // call each time, and on one core a switch to the writer and back.
+    if ((ticket & m_wakeMask) == m_wakeMask)
+        notifyWriter();
+}
+
+void PacketCapture::notifyWriter()
+{
+    // Called without the mutex so the SDK thread never waits for the writer;
+    // a wakeup lost to that race is covered by the writer's poll interval.
+    m_wake.notify_one();
+}
+
+void PacketCapture::captureStreamMessage(agora::rtc::uid_t uid, int streamId, const char* data, size_t length)
+{
+    capture(CAPTURE_STREAM_MESSAGE_RECEIVED, uid, streamId, reinterpret_cast<const unsigned char*>(data), length);
+}
+
+void PacketCapture::captureSentStreamMessage(int streamId, const char* data, size_t length)
+{
+    capture(CAPTURE_STREAM_MESSAGE_SENT, 0, streamId, reinterpret_cast<const unsigned char*>(data), length);
+}
+
+bool PacketCapture::onSendAudioPacket(Packet& packet)
+{
+    if (m_observer && !m_observer->onSendAudioPacket(packet))
+        return false;
+    capture(CAPTURE_SEND_AUDIO, 0, 0, packet.buffer, packet.size);
+    return true;
+}
+
+bool PacketCapture::onSendVideoPacket(Packet& packet)
+{
+    if (m_observer && !m_observer->onSendVideoPacket(packet))
+        return false;
+    capture(CAPTURE_SEND_VIDEO, 0, 0, packet.buffer, packet.size);
+    return true;
+}
+
+bool PacketCapture::onReceiveAudioPacket(Packet& packet)
+{
+    capture(CAPTURE_RECEIVE_AUDIO, 0, 0, packet.buffer, packet.size);
+    return !m_observer || m_observer->onReceiveAudioPacket(packet);
+}
+
+bool PacketCapture::onReceiveVideoPacket(Packet& packet)
+{
+    capture(CAPTURE_RECEIVE_VIDEO, 0, 0, packet.buffer, packet.size);
+    return !m_observer || m_observer->onReceiveVideoPacket(packet);
+}
+
+void PacketCapture::run()
+{
+    for (;;) {
+        // Read the flag before draining so everything queued before stop()
+        // is written before the thread exits.
+        bool stopping = !m_running.load(std::memory_order_acquire);
+        if (drain())
+            continue;
+        if (stopping)
+            break;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait_for(lock, std::chrono::milliseconds(kWriterPollMs));
+    }
+}
+
+bool PacketCapture::drain()
+{
+    bool wrote = false;
+    while (const CaptureRecord* record = m_queue.front()) {
+        unsigned char head[48];
+        size_t n = 0;
+        bool cut = record->size < record->length;
+        head[n++] = (unsigned char)(record->type | (cut ? kTruncatedFlag : 0));
+        // Records from different threads can reach the queue slightly out of
+        // time order, hence a signed delta.
+        n += putVarint(head + n, zigzag(record->timeUs - m_lastTimeUs));
+        m_lastTimeUs = record->timeUs;
+        if (isMessage(record->type)) {
+            n += putVarint(head + n, record->uid);
+            n += putVarint(head + n, (uint32_t)record->streamId);
+        }
+        n += putVarint(head + n, record->size);
+        if (cut)
+            n += putVarint(head + n, record->length);
+
+        if (!m_ioError.load(std::memory_order_relaxed)) {
+            if (fwrite(head, 1, n, m_file) != n || fwrite(record->data, 1, record->size, m_file) != record->size)
+                m_ioError.store(true);
+            else
+                m_bytesWritten.fetch_add(n + record->size, std::memory_order_relaxed);
+        }
+        m_queue.pop();
+        wrote = true;
+    }
+    return wrote;
+}
+
+PacketReplay::PacketReplay()
+    : m_file(NULL)
+    , m_startTimeUs(0)
+    , m_timeUs(0)
+{
+    m_cancelled.store(false);
+}
+
+PacketReplay::~PacketReplay()
+{
+    close();
+}
+
+int PacketReplay::open(const char* path)
+{
+    close();
+    if (!path)
+        return -agora::ERR_INVALID_ARGUMENT;
+    m_file = fopen(path, "rb");
+    if (!m_file)
+        return -agora::ERR_FAILED;
+    unsigned char header[sizeof(kMagic) + 8];
+    if (fread(header, 1, sizeof(header), m_file) != sizeof(header) || memcmp(header, kMagic, sizeof(kMagic)) != 0) {
+        close();
+        return -agora::ERR_INVALID_ARGUMENT;
+    }
+    uint64_t start = 0;
+    for (int i = 0; i < 8; ++i)
+        start |= (uint64_t)header[sizeof(kMagic) + i] << (8 * i);
+    m_startTimeUs = (int64_t)start;
+    m_timeUs = 0;
+    return 0;
+}
+
+void PacketReplay::close()
+{
+    if (m_file)
+        fclose(m_file);
+    m_file = NULL;
+}
+
+int PacketReplay::next(CaptureRecord& record)
+{
+    if (!m_file)
+        return -agora::ERR_FAILED;
+    int type = fgetc(m_file);
+    if (type == EOF)
+        return 0;
+    bool cut = (type & kTruncatedFlag) != 0;
+    type &= ~kTruncatedFlag;
+    if (type >= CAPTURE_RECORD_TYPE_COUNT)
+        return -agora::ERR_FAILED;
+
+    uint64_t delta, uid = 0, streamId = 0, size, length;
+    if (!getVarint(m_file, delta))
+        return -agora::ERR_FAILED;
+    if (isMessage(type) && (!getVarint(m_file, uid) || !getVarint(m_file, streamId)))
+        return -agora::ERR_FAILED;
+    if (!getVarint(m_file, size) || size > CaptureRecord::MAX_DATA)
+        return -agora::ERR_FAILED;
+    length = size;
+    if (cut && (!getVarint(m_file, length) || length <= size || length > 0xffffffffu))
+        return -agora::ERR_FAILED;
+    if (fread(record.data, 1, (size_t)size, m_file) != size)
+        return -agora::ERR_FAILED;
+
+    m_timeUs += unzigzag(delta);
+    record.type = (CAPTURE_RECORD_TYPE)type;
+    record.timeUs = m_timeUs;
+    record.uid = (agora::rtc::uid_t)uid;
+    record.streamId = (int)streamId;
+    record.length = (uint32_t)length;
+    record.size = (uint16_t)size;
+    return 1;
+}
+
+int PacketReplay::run(agora::rtc::IPacketObserver* observer, agora::rtc::IRtcEngineEventHandler* handler,
+                      double speed)
+{
+    m_cancelled.store(false, std::memory_order_relaxed);
+    const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    bool first = true;
+    int64_t firstUs = 0;
+    int delivered = 0;
+    CaptureRecord record;
+    while (!m_cancelled.load(std::memory_order_relaxed)) {
+        int ret = next(record);
+        if (ret <= 0)
+            return ret < 0 ? ret : delivered;
+        if (first) {
+            firstUs = record.timeUs;
+            first = false;
+        }
+        if (speed > 0) {
+            int64_t dueUs = (int64_t)((record.timeUs - firstUs) / speed);
+            std::this_thread::sleep_until(begin + std::chrono::microseconds(dueUs));
+        }
+
+        agora::rtc::IPacketObserver::Packet packet = { record.data, record.size };
+        switch (record.type) {
+        case CAPTURE_SEND_AUDIO:
+            if (observer)
+                observer->onSendAudioPacket(packet);
+            break;
+        case CAPTURE_SEND_VIDEO:
+            if (observer)
+                observer->onSendVideoPacket(packet);
+            break;
+        case CAPTURE_RECEIVE_AUDIO:
+            if (observer)
+                observer->onReceiveAudioPacket(packet);
+            break;
+        case CAPTURE_RECEIVE_VIDEO:
+            if (observer)
+                observer->onReceiveVideoPacket(packet);
+            break;
+        case CAPTURE_STREAM_MESSAGE_RECEIVED:
+            if (handler)
+                handler->onStreamMessage(record.uid, record.streamId, reinterpret_cast<const char*>(record.data), record.size);
+            break;
+        default:
+            continue;
+        }
+        ++delivered;
+    }
+    return delivered;
+}
+
+} // namespace rtc
+} // namespace talkboard
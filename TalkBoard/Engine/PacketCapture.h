@@ -0,0 +1,212 @@
+//
+//  TalkBoard Engine
+//
+//  Capture of media packets and data-stream messages to a file, and replay.
+//
+
+#ifndef TALKBOARD_PACKET_CAPTURE_H
+#define TALKBOARD_PACKET_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+#include "MpscQueue.h"
+
+namespace talkboard {
+namespace rtc {
+
+enum CAPTURE_RECORD_TYPE
+{
+    CAPTURE_SEND_AUDIO = 0,
+    CAPTURE_SEND_VIDEO = 1,
+    CAPTURE_RECEIVE_AUDIO = 2,
+    CAPTURE_RECEIVE_VIDEO = 3,
+    /** A data-stream message from onStreamMessage. */
+    CAPTURE_STREAM_MESSAGE_RECEIVED = 4,
+    /** A data-stream message given to sendStreamMessage. */
+    CAPTURE_STREAM_MESSAGE_SENT = 5,
+    CAPTURE_RECORD_TYPE_COUNT,
+};
+
+/** One captured packet or message. */
+struct CaptureRecord
+{
+    /** Room for an Ethernet-MTU packet; larger ones are cut, see PacketCapture. */
+    enum { MAX_DATA = 1500 };
+
+    CAPTURE_RECORD_TYPE type;
+    /** Microseconds since PacketCapture::start(). */
+    int64_t timeUs;
+    /** Sender of a received message, 0 otherwise. */
+    agora::rtc::uid_t uid;
+    /** Data stream of a message, 0 for packets. */
+    int streamId;
+    /** Size of the packet or message; more than `size` if it was cut. */
+    uint32_t length;
+    /** Bytes of `data` in use. */
+    uint16_t size;
+    unsigned char data[MAX_DATA];
+};
+
+/** Records every audio and video packet and every board data-stream
+ message to a compact file, to reproduce field issues with PacketReplay.
+
+ Register it with registerPacketObserver(), and feed it data-stream
+ messages from onStreamMessage and next to sendStreamMessage. Packets are
+ passed on to the observer set with setObserver() (e.g. PacketCrypto), so
+ the file holds what is on the wire: sent packets after that observer,
+ received ones before it.
+
+ The callbacks only copy the packet into a preallocated slot of a bounded
+ lock-free queue; a writer thread, woken once a batch has queued, encodes
+ and writes the slots. When the queue is full the record is dropped and counted rather
+ than stalling the SDK thread. Any number of threads may call the callbacks.
+
+ A slot holds CaptureRecord::MAX_DATA bytes. SDK packets stay below the
+ MTU, but a larger packet or data-stream message is cut to that prefix:
+ the record keeps its full length, is flagged in the file and counted by
+ truncated(), so a replay can tell it is incomplete.
+
+ File layout, all integers little-endian or LEB128 varints:
+ "TBPCAP01", the int64 wall-clock start in microseconds, then per record a
+ type byte (bit 7 set if the record was cut), the zigzag varint time since
+ the previous record, for messages the uid and stream id, the size, for cut
+ records the original length, and the bytes.
+ */
+class PacketCapture : public agora::rtc::IPacketObserver
+{
+public:
+    /** @param capacity Records buffered for the writer; rounded up to a power of two. */
+    explicit PacketCapture(size_t capacity = 2048);
+    ~PacketCapture();
+
+    /** Observer the packets are passed on to; may be NULL. Set it before
+     registering the capture with the engine. */
+    void setObserver(agora::rtc::IPacketObserver* observer) { m_observer = observer; }
+
+    /** Creates `path` and starts recording.
+
+     @return 0, -ERR_ALREADY_IN_USE if already recording, or -ERR_FAILED if
+     the file cannot be created.
+     */
+    int start(const char* path);
+
+    /** Writes what is queued and closes the file. Packets keep flowing to
+     the chained observer.
+
+     @return 0, or -ERR_FAILED if a write failed during the capture.
+     */
+    int stop();
+
+    bool isCapturing() const { return m_capturing.load(std::memory_order_acquire); }
+
+    void captureStreamMessage(agora::rtc::uid_t uid, int streamId, const char* data, size_t length);
+    void captureSentStreamMessage(int streamId, const char* data, size_t length);
+
+    virtual bool onSendAudioPacket(Packet& packet);
+    virtual bool onSendVideoPacket(Packet& packet);
+    virtual bool onReceiveAudioPacket(Packet& packet);
+    virtual bool onReceiveVideoPacket(Packet& packet);
+
+    /** Records queued since start(), the ones lost to a full queue, and
+     the queued ones cut to MAX_DATA bytes. */
+    uint64_t captured() const { return m_captured.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    uint64_t truncated() const { return m_truncated.load(std::memory_order_relaxed); }
+    /** Bytes written to the file so far. */
+    uint64_t bytesWritten() const { return m_bytesWritten.load(std::memory_order_relaxed); }
+
+private:
+    PacketCapture(const PacketCapture&);
+    PacketCapture& operator=(const PacketCapture&);
+
+    void capture(CAPTURE_RECORD_TYPE type, agora::rtc::uid_t uid, int streamId,
+                 const unsigned char* data, size_t length);
+    void run();
+    void notifyWriter();
+    /** Writes the queued records; false once nothing was queued. */
+    bool drain();
+
+    util::MpscQueue<CaptureRecord> m_queue;
+    /** The writer is woken when a ticket ends with these bits set. */
+    size_t m_wakeMask;
+    agora::rtc::IPacketObserver* m_observer;
+    FILE* m_file;
+    int64_t m_startNanos;
+    int64_t m_lastTimeUs;
+    std::thread m_thread;
+    std::atomic<bool> m_capturing;
+    std::atomic<bool> m_running;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_ioError;
+    std::atomic<uint64_t> m_captured;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_truncated;
+    std::atomic<uint64_t> m_bytesWritten;
+};
+
+/** Reads a file written by PacketCapture and delivers it again, in order.
+
+ Sent and received packets go to the matching IPacketObserver callback and
+ received messages to IRtcEngineEventHandler::onStreamMessage, so a capture
+ can be fed through the same observers (PacketCrypto, a loopback engine)
+ it was recorded from. Messages the app sent are in the file for reference
+ and are not replayed.
+ */
+class PacketReplay
+{
+public:
+    PacketReplay();
+    ~PacketReplay();
+
+    /** @return 0, -ERR_FAILED if the file cannot be opened, or
+     -ERR_INVALID_ARGUMENT if it is not a capture. */
+    int open(const char* path);
+    void close();
+
+    /** Reads the next record.
+
+     @return 1 for a record, 0 at the end of the file, or -ERR_FAILED if the
+     file is cut short or corrupt.
+     */
+    int next(CaptureRecord& record);
+
+    /** Delivers every remaining record.
+
+     @param observer Receives the packets; may be NULL.
+     @param handler Receives the messages; may be NULL.
+     @param speed 1 replays with the captured timing, 2 twice as fast, and
+     so on; 0 delivers as fast as possible.
+     @return Number of records delivered, or -ERR_FAILED as next().
+     */
+    int run(agora::rtc::IPacketObserver* observer, agora::rtc::IRtcEngineEventHandler* handler,
+            double speed = 1);
+
+    /** Makes run() return after its current record; from any thread. */
+    void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+
+    /** Wall-clock time the capture started, in microseconds since 1970. */
+    int64_t startTimeUs() const { return m_startTimeUs; }
+
+private:
+    PacketReplay(const PacketReplay&);
+    PacketReplay& operator=(const PacketReplay&);
+
+    FILE* m_file;
+    int64_t m_startTimeUs;
+    int64_t m_timeUs;
+    std::atomic<bool> m_cancelled;
+};
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
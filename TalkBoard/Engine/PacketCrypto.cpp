@@ -0,0 +1,212 @@
+//
+//  TalkBoard Engine
+//
+
+#include "PacketCrypto.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+namespace talkboard {
+namespace rtc {
+
+namespace {
+
+// Block 0 is left for a Poly1305 key, as in the RFC 8439 AEAD construction,
+// so authentication can be added without changing the key stream.
+const uint32_t kFirstBlock = 1;
+
+bool fillRandom(void* data, size_t size)
+{
+#if defined(__APPLE__)
+    arc4random_buf(data, size);
+    return true;
+#else
+    FILE* file = fopen("/dev/urandom", "rb");
+    if (!file)
+        return false;
+    bool ok = fread(data, 1, size, file) == size;
+    fclose(file);
+    return ok;
+#endif
+}
+
+inline void store32(unsigned char* p, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+inline void store64(unsigned char* p, uint64_t v)
+{
+    for (int i = 0; i < 8; ++i)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+} // namespace
+
+PacketCrypto::PacketCrypto(util::BufferPool& pool)
+    : m_pool(pool)
+    , m_hasKey(false)
+    , m_salt(0)
+    , m_keyVersion(0)
+    , m_sequence(0)
+    , m_dropped(0)
+{
+    for (int i = 0; i < KEY_WORDS; ++i)
+        m_key[i].store(0, std::memory_order_relaxed);
+    memset(m_buffers, 0, sizeof(m_buffers));
+}
+
+PacketCrypto::~PacketCrypto()
+{
+    for (int i = 0; i < KEY_WORDS; ++i)
+        m_key[i].store(0, std::memory_order_relaxed);
+    for (int i = 0; i < DIRECTION_COUNT; ++i)
+        m_pool.release(m_buffers[i].data);
+}
+
+int PacketCrypto::setKey(const unsigned char* key, size_t length)
+{
+    if (!key || length != KEY_SIZE)
+        return -agora::ERR_INVALID_ARGUMENT;
+    static const bool kCipherOk = util::ChaCha20::selfTest();
+    if (!kCipherOk)
+        return -agora::ERR_FAILED;
+
+    uint32_t salt;
+    uint64_t sequence;
+    if (!fillRandom(&salt, sizeof(salt)) || !fillRandom(&sequence, sizeof(sequence)))
+        return -agora::ERR_FAILED;
+
+    // Sequence lock with a single writer: readers retry while the version is
+    // odd or has moved, so none uses half of each key.
+    uint32_t version = m_keyVersion.load(std::memory_order_relaxed);
+    m_keyVersion.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < KEY_WORDS; ++i) {
+        uint32_t word;
+        memcpy(&word, key + 4 * i, 4);
+        m_key[i].store(word, std::memory_order_relaxed);
+    }
+    m_salt.store(salt, std::memory_order_relaxed);
+    m_keyVersion.store(version + 2, std::memory_order_release);
+
+    m_sequence.store(sequence, std::memory_order_relaxed);
+    m_hasKey.store(true, std::memory_order_release);
+    return 0;
+}
+
+void PacketCrypto::loadKey(unsigned char* key, uint32_t& salt) const
+{
+    for (;;) {
+        uint32_t version = m_keyVersion.load(std::memory_order_acquire);
+        if (version & 1)
+            continue;
+        for (int i = 0; i < KEY_WORDS; ++i) {
+            uint32_t word = m_key[i].load(std::memory_order_relaxed);
+            memcpy(key + 4 * i, &word, 4);
+        }
+        salt = m_salt.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_keyVersion.load(std::memory_order_relaxed) == version)
+            return;
+    }
+}
+
+void PacketCrypto::clearKey()
+{
+    m_hasKey.store(false, std::memory_order_release);
+}
+
+int PacketCrypto::encrypt(const unsigned char* in, size_t size, unsigned char* out)
+{
+    if (!m_hasKey.load(std::memory_order_acquire))
+        return -agora::ERR_FAILED;
+    unsigned char key[KEY_SIZE];
+    uint32_t salt;
+    loadKey(key, salt);
+    util::ChaCha20 cipher(key);
+    store32(out, salt);
+    store64(out + 4, m_sequence.fetch_add(1, std::memory_order_relaxed));
+    cipher.process(out, kFirstBlock, in, out + OVERHEAD, size);
+    return (int)(size + OVERHEAD);
+}
+
+int PacketCrypto::decrypt(const unsigned char* in, size_t size, unsigned char* out) const
+{
+    if (!m_hasKey.load(std::memory_order_acquire))
+        return -agora::ERR_FAILED;
+    if (size < OVERHEAD)
+        return -agora::ERR_INVALID_ARGUMENT;
+    unsigned char key[KEY_SIZE];
+    uint32_t salt;
+    loadKey(key, salt);
+    util::ChaCha20 cipher(key);
+    cipher.process(in, kFirstBlock, in + OVERHEAD, out, size - OVERHEAD);
+    return (int)(size - OVERHEAD);
+}
+
+unsigned char* PacketCrypto::buffer(Direction direction, size_t size)
+{
+    Buffer& b = m_buffers[direction];
+    if (b.capacity < size) {
+        m_pool.release(b.data);
+        b.data = m_pool.acquire(size, &b.capacity);
+        if (!b.data)
+            b.capacity = 0;
+    }
+    return b.data;
+}
+
+bool PacketCrypto::send(Direction direction, Packet& packet)
+{
+    unsigned char* out = buffer(direction, (size_t)packet.size + OVERHEAD);
+    int size = out ? encrypt(packet.buffer, packet.size, out) : -agora::ERR_FAILED;
+    if (size < 0) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    packet.buffer = out;
+    packet.size = (unsigned int)size;
+    return true;
+}
+
+bool PacketCrypto::receive(Direction direction, Packet& packet)
+{
+    unsigned char* out = buffer(direction, packet.size);
+    int size = out ? decrypt(packet.buffer, packet.size, out) : -agora::ERR_FAILED;
+    if (size < 0) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    packet.buffer = out;
+    packet.size = (unsigned int)size;
+    return true;
+}
+
+bool PacketCrypto::onSendAudioPacket(Packet& packet)
+{
+    return send(SEND_AUDIO, packet);
+}
+
+bool PacketCrypto::onSendVideoPacket(Packet& packet)
+{
+    return send(SEND_VIDEO, packet);
+}
+
+bool PacketCrypto::onReceiveAudioPacket(Packet& packet)
+{
+    return receive(RECEIVE_AUDIO, packet);
+}
+
+bool PacketCrypto::onReceiveVideoPacket(Packet& packet)
+{
+    return receive(RECEIVE_VIDEO, packet);
+}
+
+} // namespace rtc
+} // namespace talkboard
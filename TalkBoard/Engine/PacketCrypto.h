@@ -0,0 +1,124 @@
+//
+//  TalkBoard Engine
+//
+//  End-to-end packet encryption through IPacketObserver.
+//
+
+#ifndef TALKBOARD_PACKET_CRYPTO_H
+#define TALKBOARD_PACKET_CRYPTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+#include "BufferPool.h"
+#include "ChaCha20.h"
+
+namespace talkboard {
+namespace rtc {
+
+/** Encrypts every audio and video packet with ChaCha20 under a key shared
+ by the channel, in place of the SDK's built-in setEncryptionMode modes.
+
+ A sent packet becomes a 12-byte nonce followed by the ciphertext of the
+ original packet. The nonce is a random 32-bit sender salt and a 64-bit
+ packet sequence that starts at a random value, so senders sharing the key
+ do not repeat a nonce. Received packets are decrypted with the nonce they
+ carry; ones too short to hold it are dropped.
+
+ Packet::buffer is const, so the result goes into a buffer of this object
+ taken from the pool, and Packet::buffer and size are pointed at it. Each
+ of the four callbacks has its own buffer, which is reused by its next
+ call: the SDK is done with a packet once it moves on to the next one.
+
+ Packets are not authenticated; a flipped ciphertext bit flips the same
+ bit of the decrypted packet. Without a key every packet is dropped rather
+ than sent in the clear.
+
+ The callbacks may run on any SDK thread, one call per callback at a
+ time. setKey() and clearKey() may be called while they run, e.g. to rotate
+ the key of a registered observer or one a PacketCapture forwards to: the
+ key and salt are published under a sequence lock, so each packet is
+ processed with the whole old key or the whole new one. Call setKey() and
+ clearKey() from one thread.
+ */
+class PacketCrypto : public agora::rtc::IPacketObserver
+{
+public:
+    enum { KEY_SIZE = util::ChaCha20::KEY_SIZE, OVERHEAD = util::ChaCha20::NONCE_SIZE };
+
+    /** `pool` must outlive this object. */
+    explicit PacketCrypto(util::BufferPool& pool);
+    ~PacketCrypto();
+
+    /** Sets the channel key, KEY_SIZE bytes, and draws a new nonce salt.
+
+     @return
+
+     - 0: Success.
+     - < 0: -ERR_INVALID_ARGUMENT for a key of the wrong length;
+       -ERR_FAILED if the cipher fails its known-answer test or no random
+       numbers are available.
+     */
+    int setKey(const unsigned char* key, size_t length);
+    /** Packets are dropped from now until the next setKey(). */
+    void clearKey();
+
+    /** Encrypts `size` bytes of `in` to `out`, which has room for size + OVERHEAD.
+
+     @return Size of the encrypted packet, or -ERR_FAILED without a key.
+     */
+    int encrypt(const unsigned char* in, size_t size, unsigned char* out);
+    /** Decrypts a packet from encrypt() to `out`, which has room for size - OVERHEAD.
+
+     @return Size of the decrypted packet; -ERR_FAILED without a key,
+     -ERR_INVALID_ARGUMENT if `size` is too small to hold the nonce.
+     */
+    int decrypt(const unsigned char* in, size_t size, unsigned char* out) const;
+
+    virtual bool onSendAudioPacket(Packet& packet);
+    virtual bool onSendVideoPacket(Packet& packet);
+    virtual bool onReceiveAudioPacket(Packet& packet);
+    virtual bool onReceiveVideoPacket(Packet& packet);
+
+    /** Packets dropped because there was no key, no buffer or no nonce. */
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    PacketCrypto(const PacketCrypto&);
+    PacketCrypto& operator=(const PacketCrypto&);
+
+    enum Direction { SEND_AUDIO, SEND_VIDEO, RECEIVE_AUDIO, RECEIVE_VIDEO, DIRECTION_COUNT };
+
+    struct Buffer
+    {
+        unsigned char* data;
+        size_t capacity;
+    };
+
+    bool send(Direction direction, Packet& packet);
+    bool receive(Direction direction, Packet& packet);
+    /** The buffer of `direction`, grown to `size` bytes; NULL if that failed. */
+    unsigned char* buffer(Direction direction, size_t size);
+    /** Copies the key and salt setKey() published last. */
+    void loadKey(unsigned char* key, uint32_t& salt) const;
+
+    enum { KEY_WORDS = KEY_SIZE / 4 };
+
+    util::BufferPool& m_pool;
+    std::atomic<bool> m_hasKey;
+    /** The key bytes and the salt, written by setKey() while m_keyVersion is odd. */
+    std::atomic<uint32_t> m_key[KEY_WORDS];
+    std::atomic<uint32_t> m_salt;
+    std::atomic<uint32_t> m_keyVersion;
+    std::atomic<uint64_t> m_sequence;
+    Buffer m_buffers[DIRECTION_COUNT];
+    std::atomic<uint64_t> m_dropped;
+};
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,73 @@
+//
+//  TalkBoard Engine
+//
+
+#include "ParameterCache.h"
+
+namespace talkboard {
+namespace rtc {
+
+namespace {
+
+const uint64_t kNoSlot = ~0ULL;
+
+} // namespace
+
+ParameterCache::ParameterCache()
+    : m_hits(0)
+    , m_misses(0)
+{
+}
+
+uint64_t ParameterCache::slot(const std::string& key, agora::rtc::uid_t scope, bool insert)
+{
+    // A handful of distinct keys: a scan beats hashing the string.
+    size_t index = 0;
+    while (index < m_keys.size() && m_keys[index] != key)
+        ++index;
+    if (index == m_keys.size()) {
+        if (!insert)
+            return kNoSlot;
+        m_keys.push_back(key);
+    }
+    return (uint64_t)index << 32 | scope;
+}
+
+bool ParameterCache::contains(const std::string& key, agora::rtc::uid_t scope, PARAMETER_VALUE_TYPE type, const std::string& value)
+{
+    uint64_t s = slot(key, scope, false);
+    if (s != kNoSlot) {
+        std::unordered_map<uint64_t, Value>::const_iterator it = m_values.find(s);
+        if (it != m_values.end() && it->second.type == type && it->second.text == value) {
+            ++m_hits;
+            return true;
+        }
+    }
+    ++m_misses;
+    return false;
+}
+
+void ParameterCache::store(const std::string& key, agora::rtc::uid_t scope, PARAMETER_VALUE_TYPE type, const std::string& value)
+{
+    Value& cached = m_values[slot(key, scope, true)];
+    cached.type = type;
+    cached.text = value;
+}
+
+void ParameterCache::invalidate()
+{
+    m_values.clear();
+}
+
+void ParameterCache::invalidateScope(agora::rtc::uid_t scope)
+{
+    for (std::unordered_map<uint64_t, Value>::iterator it = m_values.begin(); it != m_values.end();) {
+        if ((agora::rtc::uid_t)(it->first & 0xffffffffu) == scope)
+            it = m_values.erase(it);
+        else
+            ++it;
+    }
+}
+
+} // namespace rtc
+} // namespace talkboard
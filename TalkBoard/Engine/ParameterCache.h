@@ -0,0 +1,88 @@
+//
+//  TalkBoard Engine
+//
+//  Shadow copy of the engine parameters last applied, to skip identical writes.
+//
+
+#ifndef TALKBOARD_PARAMETER_CACHE_H
+#define TALKBOARD_PARAMETER_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+namespace talkboard {
+namespace rtc {
+
+/** Type a cached value was written as; equal text of another type is a different value.
+ */
+enum PARAMETER_VALUE_TYPE
+{
+    PARAMETER_VALUE_BOOL = 0,
+    PARAMETER_VALUE_INT = 1,
+    PARAMETER_VALUE_UINT = 2,
+    PARAMETER_VALUE_NUMBER = 3,
+    PARAMETER_VALUE_STRING = 4,
+    PARAMETER_VALUE_OBJECT = 5,
+};
+
+/** Last value applied for each parameter key and uid.
+
+ ParameterTransaction consults it before sending: a write equal to the
+ cached one is dropped, and a write the engine accepted replaces it. The
+ cache only mirrors what went through it, so it has to be invalidated
+ whenever the engine may have forgotten its state: after the engine is
+ created again, after onRejoinChannelSuccess and on leaving the channel
+ (invalidate()), and when a remote user joins or goes offline
+ (invalidateScope(uid)).
+
+ Not thread-safe.
+ */
+class ParameterCache
+{
+public:
+    ParameterCache();
+
+    /** True if `key` for `scope` was last applied as this value. Counts a hit or a miss.
+     */
+    bool contains(const std::string& key, agora::rtc::uid_t scope, PARAMETER_VALUE_TYPE type, const std::string& value);
+
+    /** Records that `key` for `scope` was applied as this value. */
+    void store(const std::string& key, agora::rtc::uid_t scope, PARAMETER_VALUE_TYPE type, const std::string& value);
+
+    /** Forgets every value. */
+    void invalidate();
+    /** Forgets the values stored for `scope`, e.g. when that uid goes offline. */
+    void invalidateScope(agora::rtc::uid_t scope);
+
+    size_t size() const { return m_values.size(); }
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+
+private:
+    ParameterCache(const ParameterCache&);
+    ParameterCache& operator=(const ParameterCache&);
+
+    struct Value
+    {
+        PARAMETER_VALUE_TYPE type;
+        std::string text;
+    };
+
+    /** Slot of `key` and `scope`; `insert` adds the key if it is new, else ~0 is returned for it. */
+    uint64_t slot(const std::string& key, agora::rtc::uid_t scope, bool insert);
+
+    std::vector<std::string> m_keys;
+    std::unordered_map<uint64_t, Value> m_values;
+    uint64_t m_hits;
+    uint64_t m_misses;
+};
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,47 @@
+//
+//  TalkBoard Engine
+//
+
+#include "ParameterStrings.h"
+
+namespace talkboard {
+namespace rtc {
+
+namespace {
+
+typedef int (agora::rtc::IRtcEngineParameter::*StringGetter)(const char*, agora::util::AString&);
+
+int get(agora::rtc::IRtcEngineParameter* parameter, StringGetter getter, const char* key, std::string& value)
+{
+    if (!parameter)
+        return -agora::ERR_NOT_INITIALIZED;
+    agora::util::AString string;
+    int result = (parameter->*getter)(key, string);
+    if (result != 0)
+        return result;
+    if (string)
+        value.assign(string->data(), string->length());
+    else
+        value.clear();
+    return 0;
+}
+
+} // namespace
+
+int getString(agora::rtc::IRtcEngineParameter* parameter, const char* key, std::string& value)
+{
+    return get(parameter, &agora::rtc::IRtcEngineParameter::getString, key, value);
+}
+
+int getObject(agora::rtc::IRtcEngineParameter* parameter, const char* key, std::string& value)
+{
+    return get(parameter, &agora::rtc::IRtcEngineParameter::getObject, key, value);
+}
+
+int getArray(agora::rtc::IRtcEngineParameter* parameter, const char* key, std::string& value)
+{
+    return get(parameter, &agora::rtc::IRtcEngineParameter::getArray, key, value);
+}
+
+} // namespace rtc
+} // namespace talkboard
@@ -0,0 +1,35 @@
+//
+//  TalkBoard Engine
+//
+//  IRtcEngineParameter string getters that copy into a std::string.
+//
+
+#ifndef TALKBOARD_PARAMETER_STRINGS_H
+#define TALKBOARD_PARAMETER_STRINGS_H
+
+#include <string>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+namespace talkboard {
+namespace rtc {
+
+/** IRtcEngineParameter::getString, getObject and getArray into `value`.
+
+ The SDK allocates an IString for every result, and an AString keeps it
+ until it goes out of scope. These copy the text into `value` and release
+ the IString before they return, so nothing of the SDK's is held between
+ polls. Reusing one std::string for a key polled repeatedly allocates only
+ when the value outgrows it.
+
+ @return What the getter returned, or -ERR_NOT_INITIALIZED if `parameter` is
+ NULL. `value` is left unchanged if the getter fails.
+ */
+int getString(agora::rtc::IRtcEngineParameter* parameter, const char* key, std::string& value);
+int getObject(agora::rtc::IRtcEngineParameter* parameter, const char* key, std::string& value);
+int getArray(agora::rtc::IRtcEngineParameter* parameter, const char* key, std::string& value);
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,260 @@
+//
+//  TalkBoard Engine
+//
+
+#include "ParameterTransaction.h"
+
+#include <string.h>
+#include <algorithm>
+
+namespace talkboard {
+namespace rtc {
+
+namespace {
+
+/** Slots the table starts with: a layout pass of a 16-user room, two keys each. */
+const size_t kInitialSlots = 64;
+
+uint32_t hashSlot(size_t key, agora::rtc::uid_t scope)
+{
+    return (uint32_t)scope * 2654435761u ^ (uint32_t)key * 0x85ebca6bu;
+}
+
+} // namespace
+
+ParameterTransaction::ParameterTransaction(agora::rtc::IRtcEngine& engine)
+    : m_parameter(engine)
+    , m_cache(NULL)
+    , m_count(0)
+    , m_slots(kInitialSlots, 0)
+{
+}
+
+ParameterTransaction::ParameterTransaction(agora::rtc::IRtcEngine* engine)
+    : m_parameter(engine)
+    , m_cache(NULL)
+    , m_count(0)
+    , m_slots(kInitialSlots, 0)
+{
+}
+
+ParameterTransaction::ParameterTransaction(agora::rtc::IRtcEngineParameter* parameter)
+    : m_parameter(parameter)
+    , m_cache(NULL)
+    , m_count(0)
+    , m_slots(kInitialSlots, 0)
+{
+}
+
+template <typename T>
+int ParameterTransaction::stage(const char* key, PARAMETER_VALUE_TYPE type, T value)
+{
+    util::JsonWriter<64> json;
+    json.value(value);
+    if (json.failed())
+        return -agora::ERR_RESOURCE_LIMITED;
+    return stageRaw(key, 0, type, json.c_str(), json.size());
+}
+
+size_t ParameterTransaction::internKey(const char* key)
+{
+    for (size_t i = 0; i < m_keys.size(); ++i) {
+        if (m_keys[i] == key)
+            return i;
+    }
+    m_keys.push_back(key);
+    return m_keys.size() - 1;
+}
+
+size_t ParameterTransaction::findSlot(size_t key, agora::rtc::uid_t scope) const
+{
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = hashSlot(key, scope) & mask;; i = (i + 1) & mask) {
+        uint32_t index = m_slots[i];
+        if (!index)
+            return i;
+        const Entry& entry = m_entries[index - 1];
+        if (entry.key == key && entry.scope == scope)
+            return i;
+    }
+}
+
+int ParameterTransaction::stageRaw(const char* key, agora::rtc::uid_t scope, PARAMETER_VALUE_TYPE type, const char* json, size_t length)
+{
+    if (!key || !*key || !json)
+        return -agora::ERR_INVALID_ARGUMENT;
+    size_t keyIndex = internKey(key);
+    size_t slot = findSlot(keyIndex, scope);
+    if (m_slots[slot]) {
+        Entry& entry = m_entries[m_slots[slot] - 1];
+        entry.type = type;
+        entry.value.assign(json, length);
+        return 0;
+    }
+    if (m_count == m_entries.size())
+        m_entries.push_back(Entry());
+    Entry& entry = m_entries[m_count];
+    entry.key = keyIndex;
+    entry.scope = scope;
+    entry.type = type;
+    entry.value.assign(json, length);
+    ++m_count;
+    if (m_count * 2 > m_slots.size()) {
+        m_slots.assign(m_slots.size() * 2, 0);
+        for (size_t i = 0; i < m_count; ++i)
+            m_slots[findSlot(m_entries[i].key, m_entries[i].scope)] = (uint32_t)(i + 1);
+    } else {
+        m_slots[slot] = (uint32_t)m_count;
+    }
+    return 0;
+}
+
+int ParameterTransaction::setBool(const char* key, bool value)
+{
+    return stage(key, PARAMETER_VALUE_BOOL, value);
+}
+
+int ParameterTransaction::setInt(const char* key, int value)
+{
+    return stage(key, PARAMETER_VALUE_INT, value);
+}
+
+int ParameterTransaction::setUInt(const char* key, unsigned int value)
+{
+    return stage(key, PARAMETER_VALUE_UINT, value);
+}
+
+int ParameterTransaction::setNumber(const char* key, double value)
+{
+    return stage(key, PARAMETER_VALUE_NUMBER, value);
+}
+
+int ParameterTransaction::setString(const char* key, const char* value)
+{
+    return stage(key, PARAMETER_VALUE_STRING, value);
+}
+
+int ParameterTransaction::setObject(const char* key, const char* json, agora::rtc::uid_t scope)
+{
+    return stageRaw(key, scope, PARAMETER_VALUE_OBJECT, json, json ? strlen(json) : 0);
+}
+
+int ParameterTransaction::setRemoteVideoStreamType(agora::rtc::uid_t uid, agora::rtc::REMOTE_VIDEO_STREAM_TYPE streamType)
+{
+    util::JsonWriter<64> json;
+    json.beginObject().member("uid", uid).member("stream", static_cast<int>(streamType)).endObject();
+    int r = stageRaw("rtc.video.set_remote_video_stream", uid, PARAMETER_VALUE_OBJECT, json.c_str(), json.size());
+    if (r == 0)
+        r = stageRaw("che.video.setstream", uid, PARAMETER_VALUE_OBJECT, json.c_str(), json.size());
+    return r;
+}
+
+int ParameterTransaction::muteLocalAudioStream(bool mute)
+{
+    int r = setBool("rtc.audio.mute_me", mute);
+    if (r == 0)
+        r = setBool("che.audio.mute_me", mute);
+    return r;
+}
+
+int ParameterTransaction::muteRemoteAudioStream(agora::rtc::uid_t uid, bool mute)
+{
+    util::JsonWriter<64> json;
+    json.beginObject().member("uid", uid).member("mute", mute).endObject();
+    return stageRaw("rtc.audio.mute_peer", uid, PARAMETER_VALUE_OBJECT, json.c_str(), json.size());
+}
+
+int ParameterTransaction::muteRemoteVideoStream(agora::rtc::uid_t uid, bool mute)
+{
+    util::JsonWriter<64> json;
+    json.beginObject().member("uid", uid).member("mute", mute).endObject();
+    return stageRaw("rtc.video.mute_peer", uid, PARAMETER_VALUE_OBJECT, json.c_str(), json.size());
+}
+
+int ParameterTransaction::setRemoteSubscribeFallbackOption(agora::rtc::STREAM_FALLBACK_OPTIONS option)
+{
+    return setInt("rtc.remote_subscribe_fallback_option", option);
+}
+
+int ParameterTransaction::commit()
+{
+    if (!m_count)
+        return 0;
+    if (!m_parameter) {
+        rollback();
+        return -agora::ERR_NOT_INITIALIZED;
+    }
+
+    // Drop what the engine already has, then number the scopes of each key:
+    // the n-th scope of a key goes into the n-th object.
+    m_keyScopes.assign(m_keys.size(), 0);
+    int batches = 0;
+    for (size_t i = 0; i < m_count; ++i) {
+        Entry& entry = m_entries[i];
+        if (m_cache && m_cache->contains(m_keys[entry.key], entry.scope, entry.type, entry.value)) {
+            entry.batch = -1;
+            continue;
+        }
+        entry.batch = m_keyScopes[entry.key]++;
+        if (entry.batch >= batches)
+            batches = entry.batch + 1;
+    }
+    if (!batches) {
+        rollback();
+        return 0;
+    }
+
+    // Counting sort by batch; entries keep their staging order within one.
+    m_starts.assign(batches + 1, 0);
+    for (size_t i = 0; i < m_count; ++i) {
+        if (m_entries[i].batch >= 0)
+            ++m_starts[m_entries[i].batch + 1];
+    }
+    for (int b = 0; b < batches; ++b)
+        m_starts[b + 1] += m_starts[b];
+    m_order.resize(m_starts[batches]);
+    for (size_t i = 0; i < m_count; ++i) {
+        if (m_entries[i].batch >= 0)
+            m_order[m_starts[m_entries[i].batch]++] = i;
+    }
+    // Each start has moved to the end of its batch, i.e. the next one's start.
+
+    int result = 0;
+    int calls = 0;
+    size_t begin = 0;
+    for (int b = 0; b < batches; ++b) {
+        m_document.clear();
+        m_document.beginObject();
+        for (size_t k = begin; k < m_starts[b]; ++k) {
+            const Entry& entry = m_entries[m_order[k]];
+            const std::string& key = m_keys[entry.key];
+            m_document.rawMember(key.data(), key.size(), entry.value.data(), entry.value.size());
+        }
+        m_document.endObject();
+        int r = -agora::ERR_RESOURCE_LIMITED;
+        if (!m_document.failed()) {
+            r = m_parameter->setParameters(m_document.c_str());
+            ++calls;
+        }
+        if (r < 0 && result == 0)
+            result = r;
+        if (r == 0 && m_cache) {
+            for (size_t k = begin; k < m_starts[b]; ++k) {
+                const Entry& entry = m_entries[m_order[k]];
+                m_cache->store(m_keys[entry.key], entry.scope, entry.type, entry.value);
+            }
+        }
+        begin = m_starts[b];
+    }
+    rollback();
+    return result < 0 ? result : calls;
+}
+
+void ParameterTransaction::rollback()
+{
+    m_count = 0;
+    std::fill(m_slots.begin(), m_slots.end(), 0);
+}
+
+} // namespace rtc
+} // namespace talkboard
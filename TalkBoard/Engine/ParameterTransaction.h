@@ -0,0 +1,147 @@
+//
+//  TalkBoard Engine
+//
+//  Collects engine parameter updates and applies only the last value of each.
+//
+
+#ifndef TALKBOARD_PARAMETER_TRANSACTION_H
+#define TALKBOARD_PARAMETER_TRANSACTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+#include "JsonWriter.h"
+#include "ParameterCache.h"
+
+namespace talkboard {
+namespace rtc {
+
+/** Stages IRtcEngineParameter updates and commits them together.
+
+ Every update is kept under its key and scope; a later update of the same key
+ and scope replaces the earlier one in place, so only the last value of each
+ is sent. That deduplication, and the cache below, are what save engine calls.
+
+ commit() passes the updates to IRtcEngineParameter::setParameters as JSON
+ objects. The SDK parses one flat object per call and an object cannot hold a
+ key twice, so per-uid updates that share a key (rtc.video.set_remote_video_stream,
+ rtc.audio.mute_peer, ...) cannot be merged: commit() makes as many calls as
+ the most-repeated key has scopes, e.g. one per uid for a layout pass, and
+ puts unscoped updates in the first. Updates keep their staging order within
+ each object.
+
+ With a ParameterCache attached, commit() drops updates equal to the value
+ last applied and records the ones the engine accepts.
+
+ Not thread-safe; stage and commit on one thread.
+ */
+class ParameterTransaction
+{
+public:
+    ParameterTransaction(agora::rtc::IRtcEngine& engine);
+    ParameterTransaction(agora::rtc::IRtcEngine* engine);
+    /** Takes ownership of `parameter`, like AParameter. */
+    explicit ParameterTransaction(agora::rtc::IRtcEngineParameter* parameter);
+
+    /** The setters stage a value for `key`; `scope` tells apart updates of
+     the same key for different uids and is not sent.
+
+     @return
+
+     - 0: Success.
+     - < 0: -ERR_INVALID_ARGUMENT if `key` is NULL or empty.
+     */
+    int setBool(const char* key, bool value);
+    int setInt(const char* key, int value);
+    int setUInt(const char* key, unsigned int value);
+    int setNumber(const char* key, double value);
+    int setString(const char* key, const char* value);
+    /** @param json A serialized JSON object or other value, sent as is. */
+    int setObject(const char* key, const char* json, agora::rtc::uid_t scope = 0);
+
+    /** Stages the same update as RtcEngineParameters::setRemoteVideoStreamType. */
+    int setRemoteVideoStreamType(agora::rtc::uid_t uid, agora::rtc::REMOTE_VIDEO_STREAM_TYPE streamType);
+    /** Stages the same update as RtcEngineParameters::muteRemoteAudioStream. */
+    int muteRemoteAudioStream(agora::rtc::uid_t uid, bool mute);
+    /** Stages the same update as RtcEngineParameters::muteRemoteVideoStream. */
+    int muteRemoteVideoStream(agora::rtc::uid_t uid, bool mute);
+
+    /** Stages the same update as RtcEngineParameters::setRemoteSubscribeFallbackOption. */
+    int setRemoteSubscribeFallbackOption(agora::rtc::STREAM_FALLBACK_OPTIONS option);
+
+    /** Uses `cache` (may be NULL) to skip updates that would not change anything.
+     The cache must outlive the transaction or be detached first.
+     */
+    void setCache(ParameterCache* cache) { m_cache = cache; }
+    ParameterCache* cache() const { return m_cache; }
+
+    /** Stages the same update as RtcEngineParameters::muteLocalAudioStream. */
+    int muteLocalAudioStream(bool mute);
+
+    /** Number of staged updates. */
+    size_t pending() const { return m_count; }
+
+    /** Sends the staged updates and empties the transaction.
+
+     Every object is sent even if an earlier one fails. With nothing left to
+     send after the cache is consulted, no call is made and 0 is returned.
+
+     @return
+
+     - >= 0: Number of setParameters calls made.
+     - < 0: The first error: -ERR_NOT_INITIALIZED without a parameter
+     interface, -ERR_RESOURCE_LIMITED if an object could not be built, or
+     what setParameters returned.
+     */
+    int commit();
+
+    /** Drops the staged updates without sending them. */
+    void rollback();
+
+private:
+    ParameterTransaction(const ParameterTransaction&);
+    ParameterTransaction& operator=(const ParameterTransaction&);
+
+    struct Entry
+    {
+        /** Index into m_keys. */
+        size_t key;
+        agora::rtc::uid_t scope;
+        PARAMETER_VALUE_TYPE type;
+        std::string value;
+        /** Index of the setParameters call the entry goes into. */
+        int batch;
+    };
+
+    template <typename T>
+    int stage(const char* key, PARAMETER_VALUE_TYPE type, T value);
+    int stageRaw(const char* key, agora::rtc::uid_t scope, PARAMETER_VALUE_TYPE type, const char* json, size_t length);
+    size_t internKey(const char* key);
+    /** Index into m_slots of `key` and `scope`, or of the free slot where they go. */
+    size_t findSlot(size_t key, agora::rtc::uid_t scope) const;
+
+    agora::rtc::AParameter m_parameter;
+    ParameterCache* m_cache;
+    /** Keys seen so far; a transaction is reused for the same few keys. */
+    std::vector<std::string> m_keys;
+    /** Number of scopes staged for each of m_keys. */
+    std::vector<int> m_keyScopes;
+    /** Staged entries are [0, m_count); the rest keep their buffers for reuse. */
+    std::vector<Entry> m_entries;
+    size_t m_count;
+    /** Open-addressed entry index + 1 by key index and scope, 0 if free.
+     A power of two, at least twice m_count; rollback() zeroes it. */
+    std::vector<uint32_t> m_slots;
+    std::vector<size_t> m_starts;
+    std::vector<size_t> m_order;
+    util::JsonWriter<1024> m_document;
+};
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
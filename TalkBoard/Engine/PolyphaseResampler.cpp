@@ -0,0 +1,287 @@
+//
+//  TalkBoard Engine
+//
+
+#include "PolyphaseResampler.h"
+
+#include <math.h>
+#include <string.h>
+#include <map>
+#include <mutex>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TALKBOARD_RESAMPLER_NEON 1
+#endif
+
+namespace talkboard {
+namespace media {
+
+struct PolyphaseResampler::FilterBank
+{
+    /** Upsampling factor, i.e. number of phases. */
+    int L;
+    /** Decimation factor. */
+    int M;
+    /** Taps per phase, a multiple of 8. */
+    int taps;
+    /** Phase-major coefficients; each phase is stored oldest sample first. */
+    std::vector<float> coefs;
+};
+
+namespace {
+
+const int kRates[] = { 8000, 16000, 32000, 44100, 48000 };
+const double kPi = 3.14159265358979323846;
+// Kaiser window for about 80 dB of stopband attenuation.
+const double kStopbandDb = 80.0;
+const double kKaiserBeta = 0.1102 * (kStopbandDb - 8.7);
+
+int gcd(int a, int b)
+{
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/** Zeroth-order modified Bessel function of the first kind. */
+double besselI0(double x)
+{
+    double sum = 1, term = 1, q = x * x / 4;
+    for (int k = 1; k < 64 && term > sum * 1e-12; ++k) {
+        term *= q / ((double)k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+PolyphaseResampler::FilterBank* designBank(int inputRate, int outputRate)
+{
+    int g = gcd(inputRate, outputRate);
+    PolyphaseResampler::FilterBank* bank = new PolyphaseResampler::FilterBank;
+    bank->L = outputRate / g;
+    bank->M = inputRate / g;
+
+    // Downsampling needs a longer filter in input samples for the same
+    // transition band relative to the output rate.
+    double ratio = outputRate < inputRate ? (double)outputRate / inputRate : 1.0;
+    int taps = (int)ceil(PolyphaseResampler::MIN_TAPS / ratio);
+    bank->taps = (taps + 7) & ~7;
+
+    // Cutoff in cycles per input sample, placed so the stopband starts at the
+    // lower Nyquist frequency.
+    double transition = (kStopbandDb - 8) / (2.285 * 2 * kPi * bank->taps);
+    double cutoff = 0.5 * ratio - transition / 2;
+
+    const int L = bank->L, T = bank->taps;
+    const int length = L * T;
+    const double center = (length - 1) / 2.0;
+    const double fc = cutoff / L;
+    const double i0Beta = besselI0(kKaiserBeta);
+    std::vector<double> h(length);
+    double sum = 0;
+    for (int k = 0; k < length; ++k) {
+        double x = k - center;
+        double sinc = x == 0 ? 2 * fc : sin(2 * kPi * fc * x) / (kPi * x);
+        double r = x / (length / 2.0);
+        double window = besselI0(kKaiserBeta * sqrt(1 - r * r > 0 ? 1 - r * r : 0)) / i0Beta;
+        h[k] = sinc * window;
+        sum += h[k];
+    }
+
+    // Unity DC gain per output sample: the L phases together sum to L.
+    bank->coefs.resize(length);
+    for (int p = 0; p < L; ++p) {
+        for (int j = 0; j < T; ++j)
+            bank->coefs[(size_t)p * T + (T - 1 - j)] = (float)(h[p + (size_t)j * L] * L / sum);
+    }
+    return bank;
+}
+
+std::shared_ptr<const PolyphaseResampler::FilterBank> bankFor(int inputRate, int outputRate)
+{
+    static std::mutex mutex;
+    static std::map<int64_t, std::shared_ptr<const PolyphaseResampler::FilterBank> > banks;
+
+    int64_t key = (int64_t)inputRate << 32 | outputRate;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const PolyphaseResampler::FilterBank>& bank = banks[key];
+    if (!bank)
+        bank.reset(designBank(inputRate, outputRate));
+    return bank;
+}
+
+float dot(const float* x, const float* c, int taps)
+{
+#if defined(__SSE__)
+    __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+    for (int i = 0; i < taps; i += 8) {
+        a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(c + i)));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(c + i + 4)));
+    }
+    a0 = _mm_add_ps(a0, a1);
+    a0 = _mm_add_ps(a0, _mm_movehl_ps(a0, a0));
+    a0 = _mm_add_ss(a0, _mm_shuffle_ps(a0, a0, 1));
+    return _mm_cvtss_f32(a0);
+#elif defined(TALKBOARD_RESAMPLER_NEON)
+    float32x4_t a0 = vdupq_n_f32(0), a1 = vdupq_n_f32(0);
+    for (int i = 0; i < taps; i += 8) {
+        a0 = vmlaq_f32(a0, vld1q_f32(x + i), vld1q_f32(c + i));
+        a1 = vmlaq_f32(a1, vld1q_f32(x + i + 4), vld1q_f32(c + i + 4));
+    }
+    a0 = vaddq_f32(a0, a1);
+    float32x2_t s = vadd_f32(vget_low_f32(a0), vget_high_f32(a0));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+#else
+    float a[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    for (int i = 0; i < taps; i += 8) {
+        for (int k = 0; k < 8; ++k)
+            a[k] += x[i + k] * c[i + k];
+    }
+    return ((a[0] + a[4]) + (a[1] + a[5])) + ((a[2] + a[6]) + (a[3] + a[7]));
+#endif
+}
+
+inline int16_t toPcm16(float v)
+{
+    if (v >= 32767.0f)
+        return 32767;
+    if (v <= -32768.0f)
+        return -32768;
+    return (int16_t)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+} // namespace
+
+PolyphaseResampler::PolyphaseResampler()
+    : m_inputRate(0)
+    , m_outputRate(0)
+    , m_channels(0)
+    , m_position(0)
+{
+}
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+}
+
+bool PolyphaseResampler::isSupportedRate(int rate)
+{
+    for (size_t i = 0; i < sizeof(kRates) / sizeof(kRates[0]); ++i) {
+        if (kRates[i] == rate)
+            return true;
+    }
+    return false;
+}
+
+int PolyphaseResampler::configure(int inputRate, int outputRate, int channels)
+{
+    if (!isSupportedRate(inputRate) || !isSupportedRate(outputRate) || channels < 1 || channels > 2)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    m_inputRate = inputRate;
+    m_outputRate = outputRate;
+    m_channels = channels;
+    if (inputRate == outputRate)
+        m_bank.reset();
+    else
+        m_bank = bankFor(inputRate, outputRate);
+    reset();
+    return 0;
+}
+
+void PolyphaseResampler::reset()
+{
+    for (int c = 0; c < 2; ++c)
+        m_buffer[c].clear();
+    if (!m_bank)
+        return;
+    for (int c = 0; c < m_channels; ++c)
+        m_buffer[c].assign((size_t)m_bank->taps - 1, 0.0f);
+    m_position = (int64_t)(m_bank->taps - 1) * m_bank->L;
+}
+
+int PolyphaseResampler::maxOutputFrames(int frames) const
+{
+    if (frames <= 0)
+        return 0;
+    if (!m_bank)
+        return frames;
+    return (int)(((int64_t)frames * m_bank->L + m_bank->M - 1) / m_bank->M) + 1;
+}
+
+int PolyphaseResampler::process(const int16_t* in, int frames, int16_t* out, int capacity)
+{
+    if (!m_channels || !in || !out || frames < 0)
+        return -agora::ERR_INVALID_ARGUMENT;
+    if (capacity < maxOutputFrames(frames))
+        return -agora::ERR_BUFFER_TOO_SMALL;
+    if (!m_bank) {
+        memcpy(out, in, (size_t)frames * m_channels * sizeof(int16_t));
+        return frames;
+    }
+
+    const int L = m_bank->L, M = m_bank->M, T = m_bank->taps;
+    const size_t history = (size_t)T - 1;
+    const size_t total = history + frames;
+    const int64_t end = (int64_t)total * L;
+
+    int produced = 0;
+    for (int c = 0; c < m_channels; ++c) {
+        std::vector<float>& buffer = m_buffer[c];
+        // Only grows when a larger frame than before arrives.
+        if (buffer.size() < total)
+            buffer.resize(total);
+        float* x = &buffer[0];
+        for (int i = 0; i < frames; ++i)
+            x[history + i] = in[(size_t)i * m_channels + c];
+
+        const float* coefs = &m_bank->coefs[0];
+        int n = 0;
+        for (int64_t pos = m_position; pos < end; pos += M, ++n) {
+            int64_t current = pos / L;
+            int phase = (int)(pos - current * L);
+            float y = dot(x + (current - (int64_t)history), coefs + (size_t)phase * T, T);
+            out[(size_t)n * m_channels + c] = toPcm16(y);
+        }
+        produced = n;
+        memmove(x, x + frames, history * sizeof(float));
+    }
+
+    // Every channel visited the same positions; advance the shared phase once.
+    m_position += (int64_t)produced * M - (int64_t)frames * L;
+    return produced;
+}
+
+int PolyphaseResampler::process(const agora::media::IAudioFrameObserver::AudioFrame& in,
+                                agora::media::IAudioFrameObserver::AudioFrame& out)
+{
+    if (in.type != agora::media::IAudioFrameObserver::FRAME_TYPE_PCM16 || in.bytesPerSample != 2
+        || in.channels != m_channels || in.samplesPerSec != m_inputRate || !in.buffer || !out.buffer)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    int frames = process(static_cast<const int16_t*>(in.buffer), in.samples,
+                         static_cast<int16_t*>(out.buffer), out.samples);
+    if (frames < 0)
+        return frames;
+
+    out.type = agora::media::IAudioFrameObserver::FRAME_TYPE_PCM16;
+    out.samples = frames;
+    out.bytesPerSample = 2;
+    out.channels = m_channels;
+    out.samplesPerSec = m_outputRate;
+    // Output timestamps lag by the filter's group delay of (taps - 1) / 2 input samples.
+    out.renderTimeMs = in.renderTimeMs;
+    out.avsync_type = in.avsync_type;
+    return frames;
+}
+
+} // namespace media
+} // namespace talkboard
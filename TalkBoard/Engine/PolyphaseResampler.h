@@ -0,0 +1,96 @@
+//
+//  TalkBoard Engine
+//
+//  Streaming sample-rate conversion between the raw audio frame parameter rates.
+//
+
+#ifndef TALKBOARD_POLYPHASE_RESAMPLER_H
+#define TALKBOARD_POLYPHASE_RESAMPLER_H
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraMediaEngine.h>
+
+namespace talkboard {
+namespace media {
+
+/** Polyphase windowed-sinc resampler for PCM16.
+
+ Converts between any two of the rates accepted by
+ setRecordingAudioFrameParameters and friends: 8000, 16000, 32000, 44100 and
+ 48000 Hz. The ratio is reduced to L/M and a Kaiser-windowed sinc prototype
+ is split into L phases; every output sample is one dot product over the
+ input history (SSE or NEON when available). Phases have MIN_TAPS taps when
+ upsampling and proportionally more when downsampling, so the anti-aliasing
+ transition band stays the same fraction of the output band.
+
+ Filter banks are computed once per rate pair and shared, read-only, by every
+ resampler with that pair. History and phase survive across process() calls,
+ so AudioFrame boundaries are seamless.
+ */
+class PolyphaseResampler
+{
+public:
+    /** Taps per phase of an upsampling filter. */
+    enum { MIN_TAPS = 48 };
+
+    PolyphaseResampler();
+    ~PolyphaseResampler();
+
+    /** Prepares a conversion; builds the filter bank on first use of the rate pair.
+
+     @return
+
+     - 0: Success.
+     - < 0: -ERR_INVALID_ARGUMENT for an unsupported rate or channel count.
+     */
+    int configure(int inputRate, int outputRate, int channels);
+
+    /** Converts `frames` interleaved input frames.
+
+     @param out Receives up to `capacity` interleaved frames.
+     @return Number of frames written to `out`, or -ERR_BUFFER_TOO_SMALL if
+     `capacity` is less than maxOutputFrames(frames).
+     */
+    int process(const int16_t* in, int frames, int16_t* out, int capacity);
+
+    /** Converts an AudioFrame. `out.buffer` and `out.samples` give the output
+     capacity; the other fields of `out` are filled in.
+     */
+    int process(const agora::media::IAudioFrameObserver::AudioFrame& in,
+                agora::media::IAudioFrameObserver::AudioFrame& out);
+
+    /** Upper bound of the frames process() produces for `frames` input frames. */
+    int maxOutputFrames(int frames) const;
+
+    /** Clears history and phase, e.g. after a discontinuity in the input. */
+    void reset();
+
+    int inputRate() const { return m_inputRate; }
+    int outputRate() const { return m_outputRate; }
+    int channels() const { return m_channels; }
+
+    static bool isSupportedRate(int rate);
+
+    struct FilterBank;
+
+private:
+    PolyphaseResampler(const PolyphaseResampler&);
+    PolyphaseResampler& operator=(const PolyphaseResampler&);
+
+    std::shared_ptr<const FilterBank> m_bank;
+    int m_inputRate;
+    int m_outputRate;
+    int m_channels;
+    /** Position of the next output in 1/L input samples, relative to the start of m_buffer. */
+    int64_t m_position;
+    /** Per channel: taps - 1 samples of history followed by the current input. */
+    std::vector<float> m_buffer[2];
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
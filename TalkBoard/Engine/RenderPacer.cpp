@@ -0,0 +1,166 @@
+//
+//  TalkBoard Engine
+//
+
+#include "RenderPacer.h"
+
+#include <math.h>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+namespace talkboard {
+namespace media {
+
+namespace {
+
+/** Weight of a slower frame in the transit offset; the offset follows a
+ slowdown with a time constant of about 256 frames. */
+const double kOffsetDriftWeight = 1.0 / 256;
+
+} // namespace
+
+RenderPacer::RenderPacer(VideoFramePacker& packer, const RenderPacerConfig& config)
+    : m_packer(packer)
+    , m_config(config)
+{
+}
+
+RenderPacer::~RenderPacer()
+{
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        Stream* s = m_streams[i];
+        for (size_t j = 0; j < s->queue.size(); ++j)
+            m_packer.release(s->queue[j].frame);
+        delete s;
+    }
+}
+
+void RenderPacer::setConfig(const RenderPacerConfig& config)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = config;
+}
+
+RenderPacer::Stream* RenderPacer::stream(agora::rtc::uid_t uid)
+{
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        if (m_streams[i]->stats.uid == uid)
+            return m_streams[i];
+    }
+    Stream* s = new Stream();
+    s->stats.uid = uid;
+    s->stats.presented = 0;
+    s->stats.dropped = 0;
+    s->stats.late = 0;
+    s->clockOffset = 0;
+    s->hasOffset = false;
+    m_streams.push_back(s);
+    return s;
+}
+
+int RenderPacer::enqueue(agora::rtc::uid_t uid, const agora::media::IVideoFrameObserver::VideoFrame& frame, int64_t nowMs)
+{
+    QueuedFrame queued;
+    int ret = m_packer.copyFrom(frame, queued.frame);
+    if (ret != 0)
+        return ret;
+
+    PackedVideoFrame evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stream* s = stream(uid);
+
+        // Follow the fastest transit immediately and drift upwards slowly, so
+        // one delayed burst does not push every later frame back.
+        double offset = (double)(nowMs - frame.renderTimeMs);
+        if (!s->hasOffset || offset < s->clockOffset) {
+            s->clockOffset = offset;
+            s->hasOffset = true;
+        } else {
+            s->clockOffset += (offset - s->clockOffset) * kOffsetDriftWeight;
+        }
+        queued.dueMs = frame.renderTimeMs + (int64_t)floor(s->clockOffset + 0.5) + m_config.latencyTargetMs;
+
+        if ((int)s->queue.size() >= m_config.maxQueuedFrames) {
+            evicted = s->queue.front().frame;
+            s->queue.pop_front();
+            ++s->stats.dropped;
+        }
+        s->queue.push_back(queued);
+    }
+    if (evicted.data)
+        m_packer.release(evicted);
+    return 0;
+}
+
+int RenderPacer::tick(int64_t vsyncMs, Renderer& renderer)
+{
+    m_presenting.clear();
+    m_presentingUids.clear();
+    std::vector<PackedVideoFrame> superseded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        double halfRefresh = m_config.refreshIntervalMs / 2;
+        for (size_t i = 0; i < m_streams.size(); ++i) {
+            Stream* s = m_streams[i];
+            size_t due = 0;
+            while (due < s->queue.size() && s->queue[due].dueMs <= vsyncMs + halfRefresh)
+                ++due;
+            if (due == 0)
+                continue;
+
+            for (size_t j = 0; j + 1 < due; ++j)
+                superseded.push_back(s->queue[j].frame);
+            s->stats.dropped += due - 1;
+
+            const QueuedFrame& shown = s->queue[due - 1];
+            if (vsyncMs - shown.dueMs > m_config.refreshIntervalMs)
+                ++s->stats.late;
+            ++s->stats.presented;
+            m_presenting.push_back(shown.frame);
+            m_presentingUids.push_back(s->stats.uid);
+            s->queue.erase(s->queue.begin(), s->queue.begin() + due);
+        }
+    }
+
+    for (size_t i = 0; i < superseded.size(); ++i)
+        m_packer.release(superseded[i]);
+    for (size_t i = 0; i < m_presenting.size(); ++i) {
+        renderer.onPresentFrame(m_presentingUids[i], m_presenting[i]);
+        m_packer.release(m_presenting[i]);
+    }
+    return (int)m_presenting.size();
+}
+
+void RenderPacer::removeUid(agora::rtc::uid_t uid)
+{
+    Stream* removed = NULL;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_streams.size(); ++i) {
+            if (m_streams[i]->stats.uid == uid) {
+                removed = m_streams[i];
+                m_streams[i] = m_streams.back();
+                m_streams.pop_back();
+                break;
+            }
+        }
+    }
+    if (!removed)
+        return;
+    for (size_t j = 0; j < removed->queue.size(); ++j)
+        m_packer.release(removed->queue[j].frame);
+    delete removed;
+}
+
+std::vector<RenderPacerStats> RenderPacer::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<RenderPacerStats> result;
+    for (size_t i = 0; i < m_streams.size(); ++i)
+        result.push_back(m_streams[i]->stats);
+    return result;
+}
+
+} // namespace media
+} // namespace talkboard
@@ -0,0 +1,126 @@
+//
+//  TalkBoard Engine
+//
+//  Presentation pacing for frames delivered by IVideoFrameObserver::onRenderVideoFrame.
+//
+
+#ifndef TALKBOARD_RENDER_PACER_H
+#define TALKBOARD_RENDER_PACER_H
+
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraMediaEngine.h>
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+#include "VideoFramePacker.h"
+
+namespace talkboard {
+namespace media {
+
+/** Pacing parameters.
+ */
+struct RenderPacerConfig
+{
+    /** Delay between a frame's renderTimeMs and its presentation, on the local clock. */
+    int latencyTargetMs;
+    /** Display refresh interval, e.g. 16.67 for 60 Hz. */
+    double refreshIntervalMs;
+    /** Frames kept per uid; older frames are dropped when the queue is full. */
+    int maxQueuedFrames;
+
+    RenderPacerConfig()
+        : latencyTargetMs(60)
+        , refreshIntervalMs(1000.0 / 60)
+        , maxQueuedFrames(6)
+    {}
+};
+
+/** Per-uid presentation counters.
+ */
+struct RenderPacerStats
+{
+    agora::rtc::uid_t uid;
+    /** Frames handed to the renderer. */
+    uint64_t presented;
+    /** Frames never presented: superseded by a newer due frame or evicted from a full queue. */
+    uint64_t dropped;
+    /** Presented frames that were more than one refresh interval past their due time. */
+    uint64_t late;
+};
+
+/** Queues render frames per uid and releases them on display refresh ticks.
+
+ The SDK delivers frames in bursts; presenting them as they arrive causes
+ judder. enqueue() copies each frame from the render callback into a pooled
+ buffer and stamps it with a due time: renderTimeMs mapped onto the local
+ clock, plus the latency target. tick() runs once per display refresh and,
+ for every uid, presents the newest frame that is due and drops the older
+ due ones.
+ */
+class RenderPacer
+{
+public:
+    class Renderer
+    {
+    public:
+        virtual ~Renderer() {}
+        /** Called from tick(). `frame` is only valid for the duration of the call. */
+        virtual void onPresentFrame(agora::rtc::uid_t uid, const PackedVideoFrame& frame) = 0;
+    };
+
+    RenderPacer(VideoFramePacker& packer, const RenderPacerConfig& config = RenderPacerConfig());
+    ~RenderPacer();
+
+    /** Copies a frame from onRenderVideoFrame. `nowMs` is the local monotonic clock.
+     */
+    int enqueue(agora::rtc::uid_t uid, const agora::media::IVideoFrameObserver::VideoFrame& frame, int64_t nowMs);
+
+    /** Presents due frames for a display refresh at `vsyncMs`.
+
+     @return Number of frames presented.
+     */
+    int tick(int64_t vsyncMs, Renderer& renderer);
+
+    /** Drops the queue and counters of `uid`, e.g. after onUserOffline.
+     */
+    void removeUid(agora::rtc::uid_t uid);
+
+    void setConfig(const RenderPacerConfig& config);
+    /** Counters of every uid seen so far. */
+    std::vector<RenderPacerStats> stats() const;
+
+private:
+    RenderPacer(const RenderPacer&);
+    RenderPacer& operator=(const RenderPacer&);
+
+    struct QueuedFrame {
+        PackedVideoFrame frame;
+        int64_t dueMs;
+    };
+    struct Stream {
+        RenderPacerStats stats;
+        std::deque<QueuedFrame> queue;
+        /** Transit offset, arrival - renderTimeMs, in ms: follows the fastest
+         frame at once and slower frames as a slow moving average. A double so
+         that a drift of a few ms is not rounded away. */
+        double clockOffset;
+        bool hasOffset;
+    };
+
+    Stream* stream(agora::rtc::uid_t uid);
+
+    VideoFramePacker& m_packer;
+    RenderPacerConfig m_config;
+    mutable std::mutex m_mutex;
+    std::vector<Stream*> m_streams;
+    std::vector<PackedVideoFrame> m_presenting;
+    std::vector<agora::rtc::uid_t> m_presentingUids;
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,133 @@
+//
+//  TalkBoard Engine
+//
+
+#include "SessionClock.h"
+
+namespace talkboard {
+namespace media {
+
+namespace {
+
+const int64_t kTicksPerMs = 90;
+
+int64_t floorDiv(int64_t a, int64_t b)
+{
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+} // namespace
+
+TimestampUnwrapper::TimestampUnwrapper()
+    : m_last(0)
+    , m_started(false)
+{
+}
+
+int64_t TimestampUnwrapper::unwrap(uint32_t timestamp)
+{
+    if (!m_started) {
+        m_started = true;
+        m_last = timestamp;
+        return m_last;
+    }
+    m_last += (int32_t)(timestamp - (uint32_t)m_last);
+    return m_last;
+}
+
+void TimestampUnwrapper::reset()
+{
+    m_last = 0;
+    m_started = false;
+}
+
+ClockDriftEstimator::ClockDriftEstimator(int windowSeconds)
+    : m_window(windowSeconds > 2 ? (size_t)windowSeconds : 2)
+{
+    reset();
+}
+
+void ClockDriftEstimator::reset()
+{
+    m_buckets.clear();
+    m_hasCurrent = false;
+    m_anchorMs = 0;
+    m_intercept = 0;
+    m_slope = 0;
+}
+
+void ClockDriftEstimator::addSample(int64_t remoteMs, int64_t localMs)
+{
+    int64_t second = floorDiv(remoteMs, 1000);
+    int64_t offset = localMs - remoteMs;
+    if (m_hasCurrent && second <= m_current.second) {
+        // Late samples from an earlier second still tighten the current minimum.
+        if (offset < m_current.offsetMs) {
+            m_current.offsetMs = offset;
+            m_current.remoteMs = remoteMs;
+        }
+        return;
+    }
+
+    if (m_hasCurrent) {
+        if (m_buckets.empty())
+            m_anchorMs = m_current.remoteMs;
+        m_buckets.push_back(m_current);
+        if (m_buckets.size() > m_window)
+            m_buckets.erase(m_buckets.begin());
+        fit();
+    }
+    m_current.second = second;
+    m_current.remoteMs = remoteMs;
+    m_current.offsetMs = offset;
+    m_hasCurrent = true;
+}
+
+void ClockDriftEstimator::fit()
+{
+    size_t n = m_buckets.size();
+    if (n < 2) {
+        m_intercept = (double)m_buckets[0].offsetMs;
+        m_slope = 0;
+        return;
+    }
+
+    // Least squares on values relative to the first bucket to keep the
+    // products small enough for doubles.
+    const double x0 = (double)(m_buckets[0].remoteMs - m_anchorMs);
+    const double y0 = (double)m_buckets[0].offsetMs;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double x = (double)(m_buckets[i].remoteMs - m_anchorMs) - x0;
+        double y = (double)m_buckets[i].offsetMs - y0;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double denominator = n * sxx - sx * sx;
+    m_slope = denominator > 0 ? (n * sxy - sx * sy) / denominator : 0;
+    m_intercept = y0 + (sy - m_slope * sx) / n - m_slope * x0;
+}
+
+int64_t ClockDriftEstimator::toLocalMs(int64_t remoteMs) const
+{
+    if (m_buckets.empty())
+        return m_hasCurrent ? remoteMs + m_current.offsetMs : remoteMs;
+    double offset = m_intercept + m_slope * (double)(remoteMs - m_anchorMs);
+    return remoteMs + (int64_t)(offset < 0 ? offset - 0.5 : offset + 0.5);
+}
+
+int64_t SessionClock::ticks90kToMs(int64_t ticks)
+{
+    return floorDiv(ticks, kTicksPerMs);
+}
+
+int64_t SessionClock::msToTicks90k(int64_t ms)
+{
+    return ms * kTicksPerMs;
+}
+
+} // namespace media
+} // namespace talkboard
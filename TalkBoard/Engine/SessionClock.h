@@ -0,0 +1,116 @@
+//
+//  TalkBoard Engine
+//
+//  Common time base for audio, video and board events of a session.
+//
+
+#ifndef TALKBOARD_SESSION_CLOCK_H
+#define TALKBOARD_SESSION_CLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace talkboard {
+namespace media {
+
+/** Extends the 32-bit 90 kHz timestamps of IVideoFrame::timestamp() to 64 bits.
+ */
+class TimestampUnwrapper
+{
+public:
+    TimestampUnwrapper();
+
+    /** Returns `timestamp` unwrapped relative to the previous one; steps of
+     more than half the range are taken as going backwards.
+     */
+    int64_t unwrap(uint32_t timestamp);
+
+    void reset();
+
+private:
+    int64_t m_last;
+    bool m_started;
+};
+
+/** Estimates how a remote device's clock maps onto the local clock.
+
+ Feed it pairs of (remote timestamp, local arrival time), e.g. the "t" of a
+ board point against the time it arrived, or a remote frame's renderTimeMs
+ against onRenderVideoFrame. Network delay only ever adds to the observed
+ offset, so the estimator keeps the smallest offset seen in each second of
+ remote time and fits a line through those minima: the intercept is the clock
+ offset plus the minimum delay, the slope the drift between the two clocks.
+ */
+class ClockDriftEstimator
+{
+public:
+    /** @param windowSeconds Seconds of remote time the fit looks back over. */
+    explicit ClockDriftEstimator(int windowSeconds = 120);
+
+    void addSample(int64_t remoteMs, int64_t localMs);
+
+    /** True once two seconds of remote time have been seen and the drift estimate means something. */
+    bool ready() const { return m_buckets.size() >= 2; }
+
+    /** Maps a remote timestamp onto the local clock; before ready() only the offset is applied. */
+    int64_t toLocalMs(int64_t remoteMs) const;
+
+    /** Local clock rate relative to the remote one, in parts per million. */
+    double driftPpm() const { return m_slope * 1e6; }
+
+    void reset();
+
+private:
+    struct Bucket {
+        int64_t second;
+        int64_t remoteMs;
+        int64_t offsetMs;
+    };
+
+    void fit();
+
+    size_t m_window;
+    std::vector<Bucket> m_buckets;
+    Bucket m_current;
+    bool m_hasCurrent;
+    int64_t m_anchorMs;
+    double m_intercept;
+    double m_slope;
+};
+
+/** The session time base: milliseconds since the session started, on the local monotonic clock.
+
+ Audio and video renderTimeMs, 90 kHz video timestamps and board touch times
+ are all converted to session time so one timeline can order them. Remote
+ timestamps go through a ClockDriftEstimator for their device first.
+ */
+class SessionClock
+{
+public:
+    /** @param originMs Start of the session on the local monotonic clock. */
+    explicit SessionClock(int64_t originMs = 0) : m_originMs(originMs) {}
+
+    void setOrigin(int64_t originMs) { m_originMs = originMs; }
+    int64_t origin() const { return m_originMs; }
+
+    /** Local monotonic milliseconds, e.g. a local renderTimeMs. */
+    int64_t fromLocalMs(int64_t localMs) const { return localMs - m_originMs; }
+    int64_t toLocalMs(int64_t sessionMs) const { return sessionMs + m_originMs; }
+
+    /** Board time as stored in SNSPoint.t: UITouch.timestamp in milliseconds.
+     It runs on the same uptime clock as the local monotonic milliseconds.
+     */
+    int64_t fromBoardMs(int64_t boardMs) const { return boardMs - m_originMs; }
+
+    static int64_t ticks90kToMs(int64_t ticks);
+    static int64_t msToTicks90k(int64_t ms);
+
+private:
+    int64_t m_originMs;
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
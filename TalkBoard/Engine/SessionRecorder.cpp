@@ -0,0 +1,641 @@
+//
+//  TalkBoard Engine
+//
+
+#include "SessionRecorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+namespace talkboard {
+namespace media {
+
+namespace {
+
+/** Alignment of block buffers, file offsets and write sizes for uncached I/O. */
+const size_t kDirectAlignment = 4096;
+/** Disk space reserved ahead of the write offset. */
+const uint64_t kPreallocateBytes = 64ULL << 20;
+/** Upper bound on how late the I/O thread notices a block it was not woken for. */
+const int kWriterPollMs = 20;
+const size_t kWavHeaderSize = 44;
+/** Timeline events per stream waiting for the I/O thread, which drains them
+ at least every kWriterPollMs. */
+const int kTimelineQueueEvents = 1024;
+
+int64_t monotonicNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** Single-producer/single-consumer queue. */
+template <typename T>
+class RingQueue
+{
+public:
+    RingQueue() : m_mask(0) { m_head.store(0); m_tail.store(0); }
+
+    void init(int capacity)
+    {
+        uint32_t size = 1;
+        while (size < (uint32_t)capacity)
+            size <<= 1;
+        m_items.assign(size, T());
+        m_mask = size - 1;
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+    }
+
+    bool push(const T& item)
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask)
+            return false;
+        m_items[tail & m_mask] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item)
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        item = m_items[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    int size() const
+    {
+        return (int)(m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire));
+    }
+
+private:
+    std::vector<T> m_items;
+    uint32_t m_mask;
+    std::atomic<uint32_t> m_head;
+    std::atomic<uint32_t> m_tail;
+};
+
+/** Indices of blocks. */
+typedef RingQueue<int> BlockQueue;
+
+void putLE16(unsigned char* p, uint16_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+void putLE32(unsigned char* p, uint32_t v)
+{
+    putLE16(p, (uint16_t)v);
+    putLE16(p + 2, (uint16_t)(v >> 16));
+}
+
+void wavHeader(unsigned char* h, int sampleRate, int channels, uint32_t dataBytes)
+{
+    memcpy(h, "RIFF", 4);
+    putLE32(h + 4, 36 + dataBytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    putLE32(h + 16, 16);
+    putLE16(h + 20, 1);
+    putLE16(h + 22, (uint16_t)channels);
+    putLE32(h + 24, (uint32_t)sampleRate);
+    putLE32(h + 28, (uint32_t)(sampleRate * channels * 2));
+    putLE16(h + 32, (uint16_t)(channels * 2));
+    putLE16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    putLE32(h + 40, dataBytes);
+}
+
+int openOutput(const char* path, bool& direct)
+{
+    int fd = -1;
+    direct = false;
+#if defined(__linux__) && defined(O_DIRECT)
+    // Not every file system supports O_DIRECT; fall back to buffered I/O.
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+    direct = fd >= 0;
+#endif
+    if (fd < 0)
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#if defined(__APPLE__)
+    if (fd >= 0)
+        fcntl(fd, F_NOCACHE, 1);
+#endif
+    return fd;
+}
+
+void preallocate(int fd, uint64_t offset, uint64_t length)
+{
+#if defined(__APPLE__)
+    (void)offset;
+    fstore_t store = { F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, (off_t)length, 0 };
+    if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        fcntl(fd, F_PREALLOCATE, &store);
+    }
+#elif defined(__linux__)
+    fallocate(fd, FALLOC_FL_KEEP_SIZE, (off_t)offset, (off_t)length);
+#else
+    (void)fd;
+    (void)offset;
+    (void)length;
+#endif
+}
+
+} // namespace
+
+class SessionRecorder::EventQueue : public RingQueue<TimelineEvent>
+{
+};
+
+struct SessionRecorder::Stream
+{
+    struct Block {
+        unsigned char* data;
+        size_t used;
+    };
+
+    int fd;
+    bool direct;
+    size_t blockSize;
+    std::vector<Block> blocks;
+    /** Filled blocks, producer to I/O thread. */
+    BlockQueue full;
+    /** Written blocks, I/O thread to producer. */
+    BlockQueue empty;
+
+    /** Timeline entries of accepted frames, producer to I/O thread. */
+    EventQueue events;
+
+    // Producer side.
+    int current;
+    size_t used;
+    /** File offset of the next byte appended. */
+    uint64_t position;
+    std::atomic<uint64_t> accepted;
+    std::atomic<uint64_t> dropped;
+
+    // I/O thread.
+    uint64_t offset;
+    uint64_t allocated;
+    std::atomic<uint64_t> written;
+
+    Stream() : fd(-1), direct(false), blockSize(0), current(-1), used(0), position(0), offset(0), allocated(0)
+    {
+        accepted.store(0);
+        dropped.store(0);
+        written.store(0);
+    }
+
+    /** Bytes that can be appended without waiting for the I/O thread. */
+    size_t room() const
+    {
+        size_t free = (size_t)empty.size() * blockSize;
+        return current < 0 ? free : free + blockSize - used;
+    }
+
+    /** Appends `length` bytes; the caller checked room(). Returns true if a block was queued. */
+    bool append(const void* data, size_t length)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        bool queued = false;
+        position += length;
+        while (length) {
+            if (current < 0) {
+                empty.pop(current);
+                used = 0;
+            }
+            size_t n = blockSize - used < length ? blockSize - used : length;
+            memcpy(blocks[current].data + used, p, n);
+            used += n;
+            p += n;
+            length -= n;
+            if (used == blockSize)
+                queued |= flush();
+        }
+        return queued;
+    }
+
+    /** Queues the current block, even if partly filled. */
+    bool flush()
+    {
+        if (current < 0 || !used)
+            return false;
+        blocks[current].used = used;
+        full.push(current);
+        current = -1;
+        used = 0;
+        return true;
+    }
+};
+
+SessionRecorder::SessionRecorder()
+    : m_pool(kDirectAlignment, 16)
+    , m_audio(NULL)
+    , m_video(NULL)
+    , m_startNanos(0)
+    , m_stopNanos(0)
+    , m_timeline(NULL)
+    , m_boardEvents(new EventQueue)
+{
+    m_recording.store(false);
+    m_running.store(false);
+    m_writeNanos.store(0);
+    m_callbackNanos.store(0);
+    m_maxCallbackNanos.store(0);
+    m_ioError.store(0);
+    m_droppedEvents.store(0);
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    stop();
+    delete m_audio;
+    delete m_video;
+    delete m_boardEvents;
+}
+
+void SessionRecorder::setTimeline(SessionTimeline* timeline, const SessionClock& clock)
+{
+    if (m_recording.load(std::memory_order_acquire))
+        return;
+    m_timeline = timeline;
+    m_clock = clock;
+}
+
+int SessionRecorder::start(const char* audioPath, const char* videoPath, const SessionRecorderConfig& config)
+{
+    if (m_recording.load(std::memory_order_acquire))
+        return -agora::ERR_ALREADY_IN_USE;
+    if ((!audioPath && !videoPath) || config.blockSize <= 0 || config.blockSize % kDirectAlignment
+        || config.blocksPerStream < 2)
+        return -agora::ERR_INVALID_ARGUMENT;
+    if (audioPath && (config.sampleRate <= 0 || config.channels < 1 || config.channels > 2))
+        return -agora::ERR_INVALID_ARGUMENT;
+    if (videoPath && (config.width <= 0 || config.height <= 0 || config.frameRate <= 0))
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    delete m_audio;
+    delete m_video;
+    m_audio = m_video = NULL;
+    m_startNanos = m_stopNanos = 0;
+    // Cleared before anything can fail, so neither a failed start nor the
+    // next recording reports an error left over from the previous one.
+    m_writeNanos.store(0);
+    m_callbackNanos.store(0);
+    m_maxCallbackNanos.store(0);
+    m_ioError.store(0);
+    m_droppedEvents.store(0);
+    m_boardEvents->init(kTimelineQueueEvents);
+
+    m_config = config;
+    const char* paths[2] = { audioPath, videoPath };
+    Stream* streams[2] = { NULL, NULL };
+    for (int i = 0; i < 2; ++i) {
+        if (!paths[i])
+            continue;
+        Stream* stream = new Stream;
+        streams[i] = stream;
+        stream->fd = openOutput(paths[i], stream->direct);
+        if (stream->fd < 0) {
+            m_ioError.store(errno ? errno : EIO);
+            break;
+        }
+        stream->blockSize = config.blockSize;
+        stream->full.init(config.blocksPerStream);
+        stream->empty.init(config.blocksPerStream);
+        stream->events.init(kTimelineQueueEvents);
+        for (int b = 0; b < config.blocksPerStream; ++b) {
+            Stream::Block block = { m_pool.acquire(config.blockSize), 0 };
+            if (!block.data)
+                break;
+            // Fault the pages in now rather than on the first callback that fills them.
+            memset(block.data, 0, config.blockSize);
+            stream->blocks.push_back(block);
+            stream->empty.push(b);
+        }
+        if ((int)stream->blocks.size() < config.blocksPerStream) {
+            m_ioError.store(ENOMEM);
+            close(stream->fd);
+            stream->fd = -1;
+            break;
+        }
+    }
+    m_audio = streams[0];
+    m_video = streams[1];
+    if ((m_audio && m_audio->fd < 0) || (m_video && m_video->fd < 0)) {
+        // stop() releases the blocks and closes whatever was opened.
+        m_recording.store(true);
+        stop();
+        return -agora::ERR_FAILED;
+    }
+
+    // Container headers go through the same blocks as the media. The WAV
+    // sizes are patched in stop().
+    if (m_audio) {
+        unsigned char header[kWavHeaderSize];
+        wavHeader(header, config.sampleRate, config.channels, 0);
+        m_audio->append(header, sizeof(header));
+    }
+    if (m_video) {
+        char header[128];
+        int n = snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+                         config.width, config.height, config.frameRate);
+        m_video->append(header, (size_t)n);
+    }
+
+    m_startNanos = monotonicNanos();
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&SessionRecorder::run, this);
+    m_recording.store(true, std::memory_order_release);
+    return 0;
+}
+
+int SessionRecorder::stop()
+{
+    if (!m_recording.exchange(false, std::memory_order_acq_rel))
+        return 0;
+
+    if (m_thread.joinable()) {
+        if (m_audio)
+            m_audio->flush();
+        if (m_video)
+            m_video->flush();
+        m_running.store(false, std::memory_order_release);
+        notifyWriter();
+        m_thread.join();
+    }
+
+    Stream* streams[2] = { m_audio, m_video };
+    for (int i = 0; i < 2; ++i) {
+        Stream* stream = streams[i];
+        if (!stream)
+            continue;
+        if (stream->fd >= 0) {
+            if (stream == m_audio) {
+                uint64_t data = stream->offset > kWavHeaderSize ? stream->offset - kWavHeaderSize : 0;
+                unsigned char header[kWavHeaderSize];
+                wavHeader(header, m_config.sampleRate, m_config.channels,
+                          data > 0xffffffffULL - 36 ? 0xffffffffU - 36 : (uint32_t)data);
+#if defined(O_DIRECT)
+                if (stream->direct)
+                    fcntl(stream->fd, F_SETFL, fcntl(stream->fd, F_GETFL) & ~O_DIRECT);
+#endif
+                if (pwrite(stream->fd, header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+                    int expected = 0;
+                    m_ioError.compare_exchange_strong(expected, errno ? errno : EIO);
+                }
+            }
+            close(stream->fd);
+        }
+        stream->fd = -1;
+        for (size_t b = 0; b < stream->blocks.size(); ++b)
+            m_pool.release(stream->blocks[b].data);
+        stream->blocks.clear();
+    }
+
+    // The streams stay allocated so stats() still reports the finished
+    // recording; start() and the destructor free them.
+    m_stopNanos = monotonicNanos();
+    return m_ioError.load() ? -agora::ERR_FAILED : 0;
+}
+
+void SessionRecorder::notifyWriter()
+{
+    // Called without the mutex so producers never wait for the I/O thread;
+    // a wakeup lost to that race is covered by the writer's poll interval.
+    m_wake.notify_one();
+}
+
+void SessionRecorder::addCallbackTime(int64_t nanos)
+{
+    m_callbackNanos.fetch_add((uint64_t)nanos, std::memory_order_relaxed);
+    uint64_t worst = m_maxCallbackNanos.load(std::memory_order_relaxed);
+    while ((uint64_t)nanos > worst
+           && !m_maxCallbackNanos.compare_exchange_weak(worst, (uint64_t)nanos, std::memory_order_relaxed)) {
+    }
+}
+
+int SessionRecorder::writeAudio(const agora::media::IAudioFrameObserver::AudioFrame& frame)
+{
+    if (!m_recording.load(std::memory_order_acquire) || !m_audio)
+        return -agora::ERR_NOT_READY;
+    if (frame.type != agora::media::IAudioFrameObserver::FRAME_TYPE_PCM16 || frame.bytesPerSample != 2
+        || frame.channels != m_config.channels || frame.samplesPerSec != m_config.sampleRate
+        || !frame.buffer || frame.samples <= 0)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    int64_t begin = monotonicNanos();
+    size_t bytes = (size_t)frame.samples * frame.channels * 2;
+    int ret = 0;
+    if (m_audio->room() < bytes) {
+        m_audio->dropped.fetch_add(1, std::memory_order_relaxed);
+        ret = -agora::ERR_RESOURCE_LIMITED;
+    } else {
+        uint64_t offset = m_audio->position;
+        if (m_audio->append(frame.buffer, bytes))
+            notifyWriter();
+        m_audio->accepted.fetch_add(bytes, std::memory_order_relaxed);
+        indexFrame(m_audio, TIMELINE_TRACK_AUDIO, m_clock.fromLocalMs(frame.renderTimeMs), offset, bytes);
+    }
+    addCallbackTime(monotonicNanos() - begin);
+    return ret;
+}
+
+int SessionRecorder::writeVideo(const agora::media::IVideoFrameObserver::VideoFrame& frame)
+{
+    if (frame.type != agora::media::IVideoFrameObserver::FRAME_TYPE_YUV420)
+        return -agora::ERR_INVALID_ARGUMENT;
+    const uint8_t* planes[3] = {
+        static_cast<const uint8_t*>(frame.yBuffer),
+        static_cast<const uint8_t*>(frame.uBuffer),
+        static_cast<const uint8_t*>(frame.vBuffer),
+    };
+    const int strides[3] = { frame.yStride, frame.uStride, frame.vStride };
+    return writePlanes(planes, strides, frame.width, frame.height, frame.renderTimeMs);
+}
+
+int SessionRecorder::writeVideo(const PackedVideoFrame& frame)
+{
+    if (frame.format != PACKED_FRAME_FORMAT_I420 || frame.planeCount != 3)
+        return -agora::ERR_INVALID_ARGUMENT;
+    const uint8_t* planes[3] = {
+        frame.planes[0] + (size_t)frame.cropTop * frame.planeStrides[0] + frame.cropLeft,
+        frame.planes[1] + (size_t)(frame.cropTop / 2) * frame.planeStrides[1] + frame.cropLeft / 2,
+        frame.planes[2] + (size_t)(frame.cropTop / 2) * frame.planeStrides[2] + frame.cropLeft / 2,
+    };
+    return writePlanes(planes, frame.planeStrides, frame.width(), frame.visibleHeight(), frame.timestampMs);
+}
+
+int SessionRecorder::writePlanes(const uint8_t* const planes[3], const int strides[3], int width, int height,
+                                 int64_t timestampMs)
+{
+    if (!m_recording.load(std::memory_order_acquire) || !m_video)
+        return -agora::ERR_NOT_READY;
+    if (width != m_config.width || height != m_config.height || !planes[0] || !planes[1] || !planes[2])
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    int64_t begin = monotonicNanos();
+    static const char kFrameHeader[] = "FRAME\n";
+    const int chromaWidth = (width + 1) / 2;
+    const int chromaHeight = (height + 1) / 2;
+    size_t bytes = sizeof(kFrameHeader) - 1 + (size_t)width * height + 2 * (size_t)chromaWidth * chromaHeight;
+
+    int ret = 0;
+    if (m_video->room() < bytes) {
+        m_video->dropped.fetch_add(1, std::memory_order_relaxed);
+        ret = -agora::ERR_RESOURCE_LIMITED;
+    } else {
+        uint64_t offset = m_video->position;
+        bool queued = m_video->append(kFrameHeader, sizeof(kFrameHeader) - 1);
+        for (int p = 0; p < 3; ++p) {
+            int w = p ? chromaWidth : width;
+            int h = p ? chromaHeight : height;
+            for (int y = 0; y < h; ++y)
+                queued |= m_video->append(planes[p] + (size_t)y * strides[p], (size_t)w);
+        }
+        if (queued)
+            notifyWriter();
+        m_video->accepted.fetch_add(bytes, std::memory_order_relaxed);
+        indexFrame(m_video, TIMELINE_TRACK_VIDEO, m_clock.fromLocalMs(timestampMs), offset, bytes);
+    }
+    addCallbackTime(monotonicNanos() - begin);
+    return ret;
+}
+
+int SessionRecorder::writeBoardEvent(int64_t boardMs, uint64_t id, uint32_t size)
+{
+    if (!m_recording.load(std::memory_order_acquire) || !m_timeline)
+        return -agora::ERR_NOT_READY;
+    TimelineEvent event = { m_clock.fromBoardMs(boardMs), TIMELINE_TRACK_BOARD, id, size };
+    if (!m_boardEvents->push(event)) {
+        m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+        return -agora::ERR_RESOURCE_LIMITED;
+    }
+    return 0;
+}
+
+void SessionRecorder::indexFrame(Stream* stream, int track, int64_t sessionMs, uint64_t offset, uint64_t size)
+{
+    if (!m_timeline)
+        return;
+    TimelineEvent event = { sessionMs, track, offset, (uint32_t)size };
+    if (!stream->events.push(event))
+        m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SessionRecorder::drainTimeline()
+{
+    if (!m_timeline)
+        return;
+    EventQueue* queues[3] = { m_audio ? &m_audio->events : NULL, m_video ? &m_video->events : NULL, m_boardEvents };
+    for (int i = 0; i < 3; ++i) {
+        TimelineEvent event;
+        while (queues[i] && queues[i]->pop(event)) {
+            // A frame stamped earlier than its predecessor (a clock step or a
+            // source without timestamps) keeps its place in the file order.
+            size_t count = m_timeline->count(event.track);
+            if (count && event.timeMs < m_timeline->at(event.track, count - 1).timeMs)
+                event.timeMs = m_timeline->at(event.track, count - 1).timeMs;
+            m_timeline->append(event);
+        }
+    }
+}
+
+void SessionRecorder::run()
+{
+    Stream* streams[2] = { m_audio, m_video };
+    for (;;) {
+        // Read the flag before draining so everything queued before stop()
+        // is written before the thread exits.
+        bool stopping = !m_running.load(std::memory_order_acquire);
+        bool wrote = false;
+        for (int i = 0; i < 2; ++i) {
+            Stream* stream = streams[i];
+            int index;
+            while (stream && stream->full.pop(index)) {
+                Stream::Block& block = stream->blocks[index];
+                if (!m_ioError.load(std::memory_order_relaxed)) {
+                    if (stream->offset + block.used > stream->allocated) {
+                        preallocate(stream->fd, stream->offset, kPreallocateBytes);
+                        stream->allocated = stream->offset + kPreallocateBytes;
+                    }
+#if defined(O_DIRECT)
+                    // Only the final block of a recording can be unaligned.
+                    if (stream->direct && block.used % kDirectAlignment) {
+                        fcntl(stream->fd, F_SETFL, fcntl(stream->fd, F_GETFL) & ~O_DIRECT);
+                        stream->direct = false;
+                    }
+#endif
+                    int64_t begin = monotonicNanos();
+                    size_t done = 0;
+                    while (done < block.used) {
+                        ssize_t n = pwrite(stream->fd, block.data + done, block.used - done,
+                                           (off_t)(stream->offset + done));
+                        if (n < 0 && errno == EINTR)
+                            continue;
+                        if (n <= 0) {
+                            int expected = 0;
+                            m_ioError.compare_exchange_strong(expected, n < 0 ? errno : EIO);
+                            break;
+                        }
+                        done += (size_t)n;
+                    }
+                    m_writeNanos.fetch_add((uint64_t)(monotonicNanos() - begin), std::memory_order_relaxed);
+                    stream->offset += done;
+                    stream->written.fetch_add(done, std::memory_order_relaxed);
+                }
+                stream->empty.push(index);
+                wrote = true;
+            }
+        }
+        drainTimeline();
+        if (wrote)
+            continue;
+        if (stopping)
+            break;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait_for(lock, std::chrono::milliseconds(kWriterPollMs));
+    }
+}
+
+SessionRecorderStats SessionRecorder::stats() const
+{
+    SessionRecorderStats stats;
+    memset(&stats, 0, sizeof(stats));
+    uint64_t written = 0;
+    if (m_audio) {
+        stats.audioBytes = m_audio->accepted.load(std::memory_order_relaxed);
+        stats.droppedAudioFrames = m_audio->dropped.load(std::memory_order_relaxed);
+        written += m_audio->written.load(std::memory_order_relaxed);
+    }
+    if (m_video) {
+        stats.videoBytes = m_video->accepted.load(std::memory_order_relaxed);
+        stats.droppedVideoFrames = m_video->dropped.load(std::memory_order_relaxed);
+        written += m_video->written.load(std::memory_order_relaxed);
+    }
+    int64_t end = m_stopNanos ? m_stopNanos : monotonicNanos();
+    double elapsed = m_startNanos ? (end - m_startNanos) / 1e9 : 0;
+    double writing = m_writeNanos.load(std::memory_order_relaxed) / 1e9;
+    stats.sustainedMBps = elapsed > 0 ? written / elapsed / 1e6 : 0;
+    stats.diskMBps = writing > 0 ? written / writing / 1e6 : 0;
+    stats.callbackNanos = m_callbackNanos.load(std::memory_order_relaxed);
+    stats.maxCallbackNanos = m_maxCallbackNanos.load(std::memory_order_relaxed);
+    stats.ioError = m_ioError.load(std::memory_order_relaxed);
+    stats.droppedTimelineEvents = m_droppedEvents.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace media
+} // namespace talkboard
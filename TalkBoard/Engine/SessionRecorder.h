@@ -0,0 +1,189 @@
+//
+//  TalkBoard Engine
+//
+//  Application-side recorder for the mixed audio and composited video of a session.
+//
+
+#ifndef TALKBOARD_SESSION_RECORDER_H
+#define TALKBOARD_SESSION_RECORDER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <AgoraRtcEngineKit/IAgoraMediaEngine.h>
+
+#include "BufferPool.h"
+#include "SessionClock.h"
+#include "SessionTimeline.h"
+#include "VideoFramePacker.h"
+
+namespace talkboard {
+namespace media {
+
+/** Output format and buffering of a recording.
+ */
+struct SessionRecorderConfig
+{
+    /** Format of the frames passed to writeAudio(). */
+    int sampleRate;
+    int channels;
+    /** Format of the I420 frames passed to writeVideo(). */
+    int width;
+    int height;
+    int frameRate;
+    /** Size of one disk write; a multiple of 4096. */
+    int blockSize;
+    /** Blocks per stream. One is being filled, the others are queued for or being written to disk. */
+    int blocksPerStream;
+
+    SessionRecorderConfig()
+        : sampleRate(48000)
+        , channels(2)
+        , width(0)
+        , height(0)
+        , frameRate(15)
+        , blockSize(1 << 20)
+        , blocksPerStream(8)
+    {}
+};
+
+/** Counters of a recording. Bytes include container headers.
+ */
+struct SessionRecorderStats
+{
+    uint64_t audioBytes;
+    uint64_t videoBytes;
+    uint64_t droppedAudioFrames;
+    uint64_t droppedVideoFrames;
+    /** Bytes written to disk divided by the time from start() to now or stop(). */
+    double sustainedMBps;
+    /** Bytes written to disk divided by the time spent in write calls. */
+    double diskMBps;
+    /** Time spent inside writeAudio() and writeVideo(), summed and worst case. */
+    uint64_t callbackNanos;
+    uint64_t maxCallbackNanos;
+    /** errno of the first failed disk operation, or 0. */
+    int ioError;
+    /** Events the timeline lost because the I/O thread fell behind. */
+    uint64_t droppedTimelineEvents;
+};
+
+/** Records mixed audio to WAV and video to Y4M without blocking the callbacks.
+
+ writeAudio() (from onMixedAudioFrame) and writeVideo() (from
+ onCaptureVideoFrame or the compositor) only copy into the current block of
+ their stream. Full blocks go to a dedicated I/O thread through lock-free
+ queues and come back empty once written, so disk stalls never reach the
+ callbacks: when every block of a stream is in flight, frames are dropped and
+ counted instead.
+
+ Writes are block sized. Files are preallocated ahead of the write offset and
+ bypass the page cache where the platform allows (F_NOCACHE on Apple,
+ O_DIRECT on Linux).
+
+ With a timeline set, every accepted frame is also indexed in it by session
+ time, with its byte offset and size in the file, and writeBoardEvent()
+ adds the board points drawn meanwhile. The callbacks hand the entries to
+ the I/O thread, which appends them, so the timeline may only be read after
+ stop().
+
+ Each stream, and the board events, must be fed by one thread at a time.
+ Call stop() after the callbacks have stopped delivering frames.
+ */
+class SessionRecorder
+{
+public:
+    SessionRecorder();
+    ~SessionRecorder();
+
+    /** Opens the output files and starts the I/O thread.
+
+     @param audioPath WAV file, or NULL to record no audio.
+     @param videoPath Y4M file, or NULL to record no video.
+     @return
+
+     - 0: Success.
+     - < 0: -ERR_INVALID_ARGUMENT, -ERR_ALREADY_IN_USE if already recording,
+     or -ERR_FAILED if a file cannot be created; stats().ioError then has
+     the errno.
+     */
+    int start(const char* audioPath, const char* videoPath, const SessionRecorderConfig& config);
+
+    /** Indexes the next recordings in `timeline`, timed by `clock`; NULL to
+     stop indexing. Call while not recording. The timeline is not cleared.
+     */
+    void setTimeline(SessionTimeline* timeline, const SessionClock& clock);
+
+    /** Writes the remaining data, finalizes the headers and closes the files.
+
+     @return 0, or -ERR_FAILED if any disk operation failed during the recording.
+     */
+    int stop();
+
+    /** Appends a PCM16 frame in the configured format.
+
+     @return 0, or -ERR_RESOURCE_LIMITED if the frame was dropped.
+     */
+    int writeAudio(const agora::media::IAudioFrameObserver::AudioFrame& frame);
+
+    /** Appends an I420 frame in the configured size. */
+    int writeVideo(const agora::media::IVideoFrameObserver::VideoFrame& frame);
+    int writeVideo(const PackedVideoFrame& frame);
+
+    /** Adds a board point to the timeline: `boardMs` is its SNSPoint.t and
+     `id` is passed on as the event's payload.
+
+     @return 0, -ERR_NOT_READY without a recording or a timeline, or
+     -ERR_RESOURCE_LIMITED if the event was dropped.
+     */
+    int writeBoardEvent(int64_t boardMs, uint64_t id, uint32_t size = 0);
+
+    bool isRecording() const { return m_recording.load(std::memory_order_acquire); }
+
+    SessionRecorderStats stats() const;
+
+private:
+    SessionRecorder(const SessionRecorder&);
+    SessionRecorder& operator=(const SessionRecorder&);
+
+    struct Stream;
+    class EventQueue;
+
+    int writePlanes(const uint8_t* const planes[3], const int strides[3], int width, int height,
+                    int64_t timestampMs);
+    void indexFrame(Stream* stream, int track, int64_t sessionMs, uint64_t offset, uint64_t size);
+    void drainTimeline();
+    void run();
+    void notifyWriter();
+    void addCallbackTime(int64_t nanos);
+
+    SessionRecorderConfig m_config;
+    util::BufferPool m_pool;
+    Stream* m_audio;
+    Stream* m_video;
+    /** Read by the callbacks; set once the streams are ready, cleared first in stop(). */
+    std::atomic<bool> m_recording;
+    int64_t m_startNanos;
+    int64_t m_stopNanos;
+    SessionTimeline* m_timeline;
+    SessionClock m_clock;
+    EventQueue* m_boardEvents;
+    std::atomic<uint64_t> m_droppedEvents;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<uint64_t> m_writeNanos;
+    std::atomic<uint64_t> m_callbackNanos;
+    std::atomic<uint64_t> m_maxCallbackNanos;
+    std::atomic<int> m_ioError;
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
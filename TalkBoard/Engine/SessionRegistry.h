@@ -0,0 +1,220 @@
+//
+//  TalkBoard Engine
+//
+//  Per-uid sessions with constant-time lookup, join order and stable handles.
+//
+
+#ifndef TALKBOARD_SESSION_REGISTRY_H
+#define TALKBOARD_SESSION_REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+namespace talkboard {
+namespace rtc {
+
+/** Names one registration: the slot and the generation it was made in.
+ 0 names nothing. */
+typedef uint64_t SessionHandle;
+
+/** The sessions of a channel, one per uid, in the order they joined.
+
+ Sessions live in a slot map: a vector of slots, a free list of slots to
+ reuse, and a hash index from uid to slot, so finding, adding and removing
+ a uid take constant time instead of a scan over every participant. Slots
+ are linked in join order, so iteration follows the order the layout shows
+ them in without any moves on removal.
+
+ A handle stays valid while its uid is registered. Each slot has a
+ generation that is bumped when its session is removed, so the handle of a
+ user who left finds nothing even after the slot is reused by someone else.
+
+ revision() changes with every add and remove; comparing it with the
+ revision last laid out lets a burst of joins and leaves be laid out once.
+
+ Not thread-safe; use from one thread, e.g. the main thread.
+ */
+template <typename T>
+class SessionRegistry
+{
+public:
+    SessionRegistry()
+        : m_head(kNone)
+        , m_tail(kNone)
+        , m_free(kNone)
+        , m_revision(0)
+    {}
+
+    size_t size() const { return m_index.size(); }
+    bool empty() const { return m_index.empty(); }
+    uint64_t revision() const { return m_revision; }
+
+    /** Makes room for `count` sessions without rehashing or reallocating. */
+    void reserve(size_t count)
+    {
+        m_slots.reserve(count);
+        m_index.reserve(count);
+    }
+
+    /** Adds `uid` after the others.
+
+     @return Its handle, or 0 if `uid` is already registered.
+     */
+    SessionHandle insert(agora::rtc::uid_t uid, const T& value)
+    {
+        std::pair<typename Index::iterator, bool> entry = m_index.insert(std::make_pair(uid, 0u));
+        if (!entry.second)
+            return 0;
+        uint32_t index = m_free;
+        if (index != kNone) {
+            m_free = m_slots[index].next;
+        } else {
+            index = (uint32_t)m_slots.size();
+            m_slots.push_back(Slot());
+        }
+        entry.first->second = index;
+
+        Slot& slot = m_slots[index];
+        slot.uid = uid;
+        slot.value = value;
+        slot.used = true;
+        slot.prev = m_tail;
+        slot.next = kNone;
+        if (m_tail != kNone)
+            m_slots[m_tail].next = index;
+        else
+            m_head = index;
+        m_tail = index;
+        ++m_revision;
+        return handleOf(index);
+    }
+
+    /** The session of `uid`; NULL if it is not registered. */
+    T* find(agora::rtc::uid_t uid)
+    {
+        typename Index::const_iterator it = m_index.find(uid);
+        return it != m_index.end() ? &m_slots[it->second].value : NULL;
+    }
+    const T* find(agora::rtc::uid_t uid) const
+    {
+        return const_cast<SessionRegistry*>(this)->find(uid);
+    }
+
+    /** Handle of `uid`; 0 if it is not registered. */
+    SessionHandle handle(agora::rtc::uid_t uid) const
+    {
+        typename Index::const_iterator it = m_index.find(uid);
+        return it != m_index.end() ? handleOf(it->second) : 0;
+    }
+
+    /** The session `handle` names; NULL once it was removed. */
+    T* get(SessionHandle handle)
+    {
+        uint32_t index = (uint32_t)handle - 1;
+        if (index >= m_slots.size())
+            return NULL;
+        Slot& slot = m_slots[index];
+        return slot.used && slot.generation == (uint32_t)(handle >> 32) ? &slot.value : NULL;
+    }
+
+    /** Removes `uid`, handing its session to `removed` if given.
+
+     @return false if `uid` was not registered.
+     */
+    bool remove(agora::rtc::uid_t uid, T* removed = NULL)
+    {
+        typename Index::iterator it = m_index.find(uid);
+        if (it == m_index.end())
+            return false;
+        uint32_t index = it->second;
+        m_index.erase(it);
+
+        Slot& slot = m_slots[index];
+        if (slot.prev != kNone)
+            m_slots[slot.prev].next = slot.next;
+        else
+            m_head = slot.next;
+        if (slot.next != kNone)
+            m_slots[slot.next].prev = slot.prev;
+        else
+            m_tail = slot.prev;
+
+        if (removed)
+            *removed = slot.value;
+        // Drop the value now rather than when the slot is reused: it may
+        // hold the last reference to a view.
+        slot.value = T();
+        slot.used = false;
+        ++slot.generation;
+        slot.next = m_free;
+        m_free = index;
+        ++m_revision;
+        return true;
+    }
+
+    /** Removes every session; handles given out so far find nothing. */
+    void clear()
+    {
+        while (m_head != kNone)
+            remove(m_slots[m_head].uid);
+    }
+
+    /** Calls `visit(uid, value)` for every session, in join order. */
+    template <typename F>
+    void forEach(F visit) const
+    {
+        for (uint32_t index = m_head; index != kNone; index = m_slots[index].next)
+            visit(m_slots[index].uid, m_slots[index].value);
+    }
+
+private:
+    static const uint32_t kNone = 0xffffffffu;
+
+    struct Slot
+    {
+        Slot()
+            : uid(0)
+            , value()
+            , generation(1)
+            , prev(kNone)
+            , next(kNone)
+            , used(false)
+        {}
+
+        agora::rtc::uid_t uid;
+        T value;
+        uint32_t generation;
+        /** Neighbours in join order; `next` links the free list once the slot is free. */
+        uint32_t prev;
+        uint32_t next;
+        bool used;
+    };
+
+    typedef std::unordered_map<agora::rtc::uid_t, uint32_t> Index;
+
+    SessionHandle handleOf(uint32_t index) const
+    {
+        return ((SessionHandle)m_slots[index].generation << 32) | (index + 1);
+    }
+
+    SessionRegistry(const SessionRegistry&);
+    SessionRegistry& operator=(const SessionRegistry&);
+
+    std::vector<Slot> m_slots;
+    Index m_index;
+    /** First and last session in join order. */
+    uint32_t m_head;
+    uint32_t m_tail;
+    /** First free slot. */
+    uint32_t m_free;
+    uint64_t m_revision;
+};
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
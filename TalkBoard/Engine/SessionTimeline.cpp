@@ -0,0 +1,117 @@
+//
+//  TalkBoard Engine
+//
+
+#include "SessionTimeline.h"
+
+#include <algorithm>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+namespace talkboard {
+namespace media {
+
+namespace {
+
+bool earlier(const TimelineEvent& event, int64_t timeMs)
+{
+    return event.timeMs < timeMs;
+}
+
+} // namespace
+
+int SessionTimeline::append(const TimelineEvent& event)
+{
+    if (event.track < 0 || event.track >= TIMELINE_TRACK_COUNT)
+        return -agora::ERR_INVALID_ARGUMENT;
+    std::vector<TimelineEvent>& track = m_tracks[event.track];
+    if (!track.empty() && event.timeMs < track.back().timeMs)
+        return -agora::ERR_INVALID_ARGUMENT;
+    track.push_back(event);
+    return 0;
+}
+
+size_t SessionTimeline::count(int track) const
+{
+    if (track < 0 || track >= TIMELINE_TRACK_COUNT)
+        return 0;
+    return m_tracks[track].size();
+}
+
+size_t SessionTimeline::lowerBound(int track, int64_t timeMs) const
+{
+    if (track < 0 || track >= TIMELINE_TRACK_COUNT)
+        return 0;
+    const std::vector<TimelineEvent>& events = m_tracks[track];
+    return std::lower_bound(events.begin(), events.end(), timeMs, earlier) - events.begin();
+}
+
+int64_t SessionTimeline::endMs() const
+{
+    int64_t end = 0;
+    for (int t = 0; t < TIMELINE_TRACK_COUNT; ++t) {
+        if (!m_tracks[t].empty() && m_tracks[t].back().timeMs > end)
+            end = m_tracks[t].back().timeMs;
+    }
+    return end;
+}
+
+void SessionTimeline::clear()
+{
+    for (int t = 0; t < TIMELINE_TRACK_COUNT; ++t)
+        m_tracks[t].clear();
+}
+
+TimelinePlayer::TimelinePlayer(const SessionTimeline& timeline)
+    : m_timeline(timeline)
+    , m_positionMs(0)
+{
+    for (int t = 0; t < TIMELINE_TRACK_COUNT; ++t)
+        m_cursor[t] = 0;
+}
+
+void TimelinePlayer::seek(int64_t timeMs)
+{
+    for (int t = 0; t < TIMELINE_TRACK_COUNT; ++t)
+        m_cursor[t] = m_timeline.lowerBound(t, timeMs);
+    m_positionMs = timeMs;
+}
+
+bool TimelinePlayer::next(int64_t untilMs, TimelineEvent& event)
+{
+    // Three tracks: a linear scan is the cheapest k-way merge. Ties go to the
+    // lower track number, so the order is stable across seeks.
+    int best = -1;
+    int64_t bestTime = untilMs;
+    for (int t = 0; t < TIMELINE_TRACK_COUNT; ++t) {
+        if (m_cursor[t] >= m_timeline.count(t))
+            continue;
+        int64_t time = m_timeline.at(t, m_cursor[t]).timeMs;
+        if (time < bestTime) {
+            best = t;
+            bestTime = time;
+        }
+    }
+    if (best < 0)
+        return false;
+    event = m_timeline.at(best, m_cursor[best]++);
+    if (event.timeMs > m_positionMs)
+        m_positionMs = event.timeMs;
+    return true;
+}
+
+int TimelinePlayer::advance(int64_t untilMs, Sink& sink)
+{
+    int delivered = 0;
+    TimelineEvent event;
+    while (next(untilMs, event)) {
+        sink.onTimelineEvent(event);
+        ++delivered;
+    }
+    if (untilMs > m_positionMs)
+        m_positionMs = untilMs;
+    return delivered;
+}
+
+} // namespace media
+} // namespace talkboard
@@ -0,0 +1,113 @@
+//
+//  TalkBoard Engine
+//
+//  Time-ordered index of a recorded session and a seekable player over it.
+//
+
+#ifndef TALKBOARD_SESSION_TIMELINE_H
+#define TALKBOARD_SESSION_TIMELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace talkboard {
+namespace media {
+
+/** Tracks of a session, in the order events with equal times are played.
+ */
+enum TIMELINE_TRACK
+{
+    TIMELINE_TRACK_AUDIO = 0,
+    TIMELINE_TRACK_VIDEO = 1,
+    TIMELINE_TRACK_BOARD = 2,
+    TIMELINE_TRACK_COUNT = 3,
+};
+
+/** One entry of the timeline.
+ */
+struct TimelineEvent
+{
+    /** Session time, see SessionClock. */
+    int64_t timeMs;
+    int track;
+    /** Byte offset of the frame in the track's recording for audio and video
+     (see SessionRecorder), an application-defined id for board points. */
+    uint64_t payload;
+    uint32_t size;
+};
+
+/** Per-track, time-sorted event index of a session.
+ */
+class SessionTimeline
+{
+public:
+    /** Adds an event. Events of one track must be appended in time order.
+
+     @return
+
+     - 0: Success.
+     - < 0: -ERR_INVALID_ARGUMENT for an unknown track or an event earlier
+     than the last one of its track.
+     */
+    int append(const TimelineEvent& event);
+
+    size_t count(int track) const;
+    const TimelineEvent& at(int track, size_t index) const { return m_tracks[track][index]; }
+
+    /** Index of the first event of `track` at or after `timeMs`, or count(track). */
+    size_t lowerBound(int track, int64_t timeMs) const;
+
+    /** Time of the last event of any track. */
+    int64_t endMs() const;
+
+    void clear();
+
+private:
+    std::vector<TimelineEvent> m_tracks[TIMELINE_TRACK_COUNT];
+};
+
+/** Plays a SessionTimeline: merges its tracks by time and seeks.
+
+ Seeking is a binary search per track, so it costs the same anywhere in a
+ long recording. Board strokes accumulate, so after a seek the canvas has to
+ be rebuilt from the board events before the new position, i.e. indices
+ [0, lowerBound(TIMELINE_TRACK_BOARD, timeMs)).
+ */
+class TimelinePlayer
+{
+public:
+    class Sink
+    {
+    public:
+        virtual ~Sink() {}
+        virtual void onTimelineEvent(const TimelineEvent& event) = 0;
+    };
+
+    explicit TimelinePlayer(const SessionTimeline& timeline);
+
+    /** Moves to `timeMs`; the next event is the earliest one at or after it. */
+    void seek(int64_t timeMs);
+
+    /** Returns the next event before `untilMs` in time order, if there is one. */
+    bool next(int64_t untilMs, TimelineEvent& event);
+
+    /** Delivers every event before `untilMs` to `sink` and moves to `untilMs`.
+
+     @return Number of events delivered.
+     */
+    int advance(int64_t untilMs, Sink& sink);
+
+    /** Current position in session time. */
+    int64_t position() const { return m_positionMs; }
+
+private:
+    const SessionTimeline& m_timeline;
+    size_t m_cursor[TIMELINE_TRACK_COUNT];
+    int64_t m_positionMs;
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,416 @@
+//
+//  TalkBoard Engine
+//
+
+#include "StatsHistory.h"
+
+#include <algorithm>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+namespace talkboard {
+namespace rtc {
+
+namespace {
+
+const uint64_t kFreeKey = 0;
+const uint64_t kRemovedKey = 1;
+/** Values below this have a bucket each. */
+const uint32_t kExactBuckets = 16;
+/** Buckets per power of two above kExactBuckets. */
+const int kSubBucketBits = 3;
+
+inline uint64_t keyOf(agora::rtc::uid_t uid, STATS_METRIC metric)
+{
+    return (uint64_t)uid | (uint64_t)(metric + 1) << 32;
+}
+
+inline uint32_t hashOf(agora::rtc::uid_t uid, STATS_METRIC metric)
+{
+    return (uint32_t)uid * 2654435761u ^ (uint32_t)metric * 0x85ebca6bu;
+}
+
+// Bucket b < 16 holds the value b. Above that, each power of two [2^e, 2^e+1)
+// is split into 8 equal buckets, 16 + (e - 4) * 8 + the next three bits.
+inline int bucketOf(uint32_t value)
+{
+    if (value < kExactBuckets)
+        return (int)value;
+    int exponent = 31 - __builtin_clz(value);
+    int sub = (int)(value >> (exponent - kSubBucketBits)) & ((1 << kSubBucketBits) - 1);
+    return (int)kExactBuckets + ((exponent - 4) << kSubBucketBits) + sub;
+}
+
+/** Middle of bucket `bucket`, the value reported for its samples. */
+inline uint32_t valueOf(int bucket)
+{
+    if (bucket < (int)kExactBuckets)
+        return (uint32_t)bucket;
+    int exponent = ((bucket - (int)kExactBuckets) >> kSubBucketBits) + 4;
+    uint32_t sub = (uint32_t)(bucket - (int)kExactBuckets) & ((1 << kSubBucketBits) - 1);
+    uint64_t width = 1ULL << (exponent - kSubBucketBits);
+    uint64_t low = (((1ULL << kSubBucketBits) + sub) << (exponent - kSubBucketBits));
+    return (uint32_t)(low + width / 2);
+}
+
+/** Nearest-rank position of `fraction`, 1-based. */
+inline uint64_t rankOf(double fraction, uint64_t count)
+{
+    if (fraction <= 0)
+        return 1;
+    if (fraction >= 1)
+        return count;
+    uint64_t rank = (uint64_t)(fraction * count + 0.999999);
+    return rank ? rank : 1;
+}
+
+template <typename Count>
+uint32_t percentileOf(const Count* counts, int buckets, uint64_t count, double fraction)
+{
+    uint64_t rank = rankOf(fraction, count);
+    uint64_t seen = 0;
+    for (int b = 0; b < buckets; ++b) {
+        seen += counts[b];
+        if (seen >= rank)
+            return valueOf(b);
+    }
+    return 0;
+}
+
+/** p50, p95, p99 and the top bucket in one pass. */
+template <typename Count>
+void distributionOf(const Count* counts, int buckets, uint64_t count, StatsSummary& summary)
+{
+    const uint64_t ranks[3] = { rankOf(0.50, count), rankOf(0.95, count), rankOf(0.99, count) };
+    uint32_t* const out[3] = { &summary.p50, &summary.p95, &summary.p99 };
+    int next = 0;
+    uint64_t seen = 0;
+    for (int b = 0; b < buckets; ++b) {
+        if (!counts[b])
+            continue;
+        seen += counts[b];
+        while (next < 3 && seen >= ranks[next])
+            *out[next++] = valueOf(b);
+        summary.max = valueOf(b);
+    }
+}
+
+} // namespace
+
+StatsHistory::StatsHistory(const StatsHistoryConfig& config)
+    : m_config(config)
+    , m_mask(0)
+    , m_removed(0)
+    , m_seriesCount(0)
+{
+    m_config.maxSeries = std::max(m_config.maxSeries, 1);
+    m_config.windowSamples = std::min(std::max(m_config.windowSamples, 1), 65535);
+    m_config.rollupSamples = std::min(std::max(m_config.rollupSamples, 1), m_config.windowSamples);
+    m_config.rollups = std::max(m_config.rollups, 1);
+
+    // At most half full, so probes stay short.
+    uint32_t tableSize = 2;
+    while (tableSize < (uint32_t)m_config.maxSeries * 2)
+        tableSize <<= 1;
+    m_keys.assign(tableSize, kFreeKey);
+    m_indexes.assign(tableSize, -1);
+    m_mask = tableSize - 1;
+
+    const size_t series = (size_t)m_config.maxSeries;
+    m_series.resize(series);
+    m_free.reserve(series);
+    m_samples.resize(series * m_config.windowSamples);
+    m_windowCounts.resize(series * BUCKETS);
+    m_sessionCounts.resize(series * BUCKETS);
+    m_rollups.resize(series * m_config.rollups);
+    m_scratch.resize(m_config.rollupSamples);
+    reset();
+}
+
+int StatsHistory::find(agora::rtc::uid_t uid, STATS_METRIC metric) const
+{
+    uint64_t key = keyOf(uid, metric);
+    uint32_t slot = hashOf(uid, metric) & m_mask;
+    for (uint32_t probe = 0; probe <= m_mask; ++probe, slot = (slot + 1) & m_mask) {
+        if (m_keys[slot] == key)
+            return (int)slot;
+        if (m_keys[slot] == kFreeKey)
+            break;
+    }
+    return -1;
+}
+
+int StatsHistory::insert(agora::rtc::uid_t uid, STATS_METRIC metric)
+{
+    if (m_free.empty())
+        return -1;
+    uint64_t key = keyOf(uid, metric);
+    uint32_t slot = hashOf(uid, metric) & m_mask;
+    while (m_keys[slot] != kFreeKey && m_keys[slot] != kRemovedKey)
+        slot = (slot + 1) & m_mask;
+    if (m_keys[slot] == kRemovedKey)
+        --m_removed;
+
+    int index = m_free.back();
+    m_free.pop_back();
+    ++m_seriesCount;
+    Series& series = m_series[index];
+    series.key = key;
+    series.count = 0;
+    series.windowSum = 0;
+    series.sessionSum = 0;
+    series.sessionMax = 0;
+    series.rollupCount = 0;
+    std::fill_n(&m_windowCounts[(size_t)index * BUCKETS], (size_t)BUCKETS, (uint16_t)0);
+    std::fill_n(&m_sessionCounts[(size_t)index * BUCKETS], (size_t)BUCKETS, 0u);
+    m_keys[slot] = key;
+    m_indexes[slot] = index;
+    return index;
+}
+
+void StatsHistory::release(int slot)
+{
+    m_series[m_indexes[slot]].key = kFreeKey;
+    m_free.push_back(m_indexes[slot]);
+    --m_seriesCount;
+    m_keys[slot] = kRemovedKey;
+    m_indexes[slot] = -1;
+    ++m_removed;
+}
+
+void StatsHistory::rehash()
+{
+    // Every live series knows its key, so the table can be rebuilt from
+    // m_series without a second one.
+    std::fill(m_keys.begin(), m_keys.end(), kFreeKey);
+    std::fill(m_indexes.begin(), m_indexes.end(), -1);
+    for (int index = 0; index < m_config.maxSeries; ++index) {
+        uint64_t key = m_series[index].key;
+        if (key == kFreeKey)
+            continue;
+        uint32_t slot = hashOf((agora::rtc::uid_t)key, (STATS_METRIC)((key >> 32) - 1)) & m_mask;
+        while (m_keys[slot] != kFreeKey)
+            slot = (slot + 1) & m_mask;
+        m_keys[slot] = key;
+        m_indexes[slot] = index;
+    }
+    m_removed = 0;
+}
+
+int StatsHistory::record(agora::rtc::uid_t uid, STATS_METRIC metric, int64_t value)
+{
+    if (metric < 0 || metric >= STATS_METRIC_COUNT)
+        return -agora::ERR_INVALID_ARGUMENT;
+    int slot = find(uid, metric);
+    int index = slot >= 0 ? m_indexes[slot] : insert(uid, metric);
+    if (index < 0)
+        return -agora::ERR_RESOURCE_LIMITED;
+
+    uint32_t sample = value < 0 ? 0 : value > 0xffffffffLL ? 0xffffffffu : (uint32_t)value;
+    int bucket = bucketOf(sample);
+    Series& series = m_series[index];
+    const size_t window = (size_t)m_config.windowSamples;
+    uint32_t* samples = &m_samples[index * window];
+    uint16_t* windowCounts = &m_windowCounts[(size_t)index * BUCKETS];
+    size_t position = (size_t)(series.count % window);
+    if (series.count >= window) {
+        uint32_t evicted = samples[position];
+        --windowCounts[bucketOf(evicted)];
+        series.windowSum -= evicted;
+    }
+    samples[position] = sample;
+    ++windowCounts[bucket];
+    series.windowSum += sample;
+    ++m_sessionCounts[(size_t)index * BUCKETS + bucket];
+    series.sessionSum += sample;
+    series.sessionMax = std::max(series.sessionMax, sample);
+    if (++series.count % m_config.rollupSamples == 0)
+        closeRollup(index);
+    return 0;
+}
+
+void StatsHistory::closeRollup(int index)
+{
+    Series& series = m_series[index];
+    const size_t window = (size_t)m_config.windowSamples;
+    const size_t count = (size_t)m_config.rollupSamples;
+    const uint32_t* samples = &m_samples[index * window];
+    uint64_t sum = 0;
+    uint32_t max = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t sample = samples[(size_t)((series.count - count + i) % window)];
+        m_scratch[i] = sample;
+        sum += sample;
+        max = std::max(max, sample);
+    }
+
+    // Select the ranks from the lowest up; each pass only looks above the last.
+    StatsRollup& rollup = m_rollups[(size_t)index * m_config.rollups + series.rollupCount % m_config.rollups];
+    rollup.mean = (uint32_t)(sum / count);
+    rollup.max = max;
+    const double fractions[3] = { 0.50, 0.95, 0.99 };
+    uint32_t* const out[3] = { &rollup.p50, &rollup.p95, &rollup.p99 };
+    std::vector<uint32_t>::iterator begin = m_scratch.begin();
+    for (int i = 0; i < 3; ++i) {
+        std::vector<uint32_t>::iterator nth = m_scratch.begin() + (rankOf(fractions[i], count) - 1);
+        std::nth_element(begin, nth, m_scratch.begin() + count);
+        *out[i] = *nth;
+        begin = nth;
+    }
+    ++series.rollupCount;
+}
+
+int StatsHistory::recordRtcStats(const agora::rtc::RtcStats& stats)
+{
+    int result = 0;
+    result |= record(0, STATS_TX_KBITRATE, stats.txKBitRate);
+    result |= record(0, STATS_RX_KBITRATE, stats.rxKBitRate);
+    result |= record(0, STATS_TX_AUDIO_KBITRATE, stats.txAudioKBitRate);
+    result |= record(0, STATS_RX_AUDIO_KBITRATE, stats.rxAudioKBitRate);
+    result |= record(0, STATS_TX_VIDEO_KBITRATE, stats.txVideoKBitRate);
+    result |= record(0, STATS_RX_VIDEO_KBITRATE, stats.rxVideoKBitRate);
+    result |= record(0, STATS_LASTMILE_DELAY, stats.lastmileDelay);
+    result |= record(0, STATS_USER_COUNT, stats.userCount);
+    result |= record(0, STATS_CPU_APP_USAGE, (int64_t)(stats.cpuAppUsage * 100 + 0.5));
+    result |= record(0, STATS_CPU_TOTAL_USAGE, (int64_t)(stats.cpuTotalUsage * 100 + 0.5));
+    return result ? -agora::ERR_RESOURCE_LIMITED : 0;
+}
+
+int StatsHistory::recordLocalVideoStats(const agora::rtc::LocalVideoStats& stats)
+{
+    int result = 0;
+    result |= record(0, STATS_SENT_BITRATE, stats.sentBitrate);
+    result |= record(0, STATS_SENT_FRAME_RATE, stats.sentFrameRate);
+    return result ? -agora::ERR_RESOURCE_LIMITED : 0;
+}
+
+int StatsHistory::recordRemoteVideoStats(const agora::rtc::RemoteVideoStats& stats)
+{
+    int result = 0;
+    result |= record(stats.uid, STATS_VIDEO_DELAY, stats.delay);
+    result |= record(stats.uid, STATS_RECEIVED_BITRATE, stats.receivedBitrate);
+    result |= record(stats.uid, STATS_RECEIVED_FRAME_RATE, stats.receivedFrameRate);
+    return result ? -agora::ERR_RESOURCE_LIMITED : 0;
+}
+
+bool StatsHistory::window(agora::rtc::uid_t uid, STATS_METRIC metric, StatsSummary& summary) const
+{
+    int slot = find(uid, metric);
+    if (slot < 0)
+        return false;
+    int index = m_indexes[slot];
+    const Series& series = m_series[index];
+    const uint64_t window = (uint64_t)m_config.windowSamples;
+    summary = StatsSummary();
+    summary.count = std::min(series.count, window);
+    if (!summary.count)
+        return true;
+    summary.latest = m_samples[(size_t)index * window + (series.count - 1) % window];
+    summary.mean = (uint32_t)(series.windowSum / summary.count);
+    distributionOf(&m_windowCounts[(size_t)index * BUCKETS], BUCKETS, summary.count, summary);
+    return true;
+}
+
+bool StatsHistory::session(agora::rtc::uid_t uid, STATS_METRIC metric, StatsSummary& summary) const
+{
+    int slot = find(uid, metric);
+    if (slot < 0)
+        return false;
+    int index = m_indexes[slot];
+    const Series& series = m_series[index];
+    const uint64_t window = (uint64_t)m_config.windowSamples;
+    summary = StatsSummary();
+    summary.count = series.count;
+    if (!summary.count)
+        return true;
+    summary.latest = m_samples[(size_t)index * window + (series.count - 1) % window];
+    summary.mean = (uint32_t)(series.sessionSum / series.count);
+    distributionOf(&m_sessionCounts[(size_t)index * BUCKETS], BUCKETS, series.count, summary);
+    summary.max = series.sessionMax;
+    return true;
+}
+
+uint32_t StatsHistory::percentile(agora::rtc::uid_t uid, STATS_METRIC metric, double fraction) const
+{
+    int slot = find(uid, metric);
+    if (slot < 0)
+        return 0;
+    int index = m_indexes[slot];
+    uint64_t count = std::min(m_series[index].count, (uint64_t)m_config.windowSamples);
+    if (!count)
+        return 0;
+    return percentileOf(&m_windowCounts[(size_t)index * BUCKETS], BUCKETS, count, fraction);
+}
+
+int StatsHistory::rollups(agora::rtc::uid_t uid, STATS_METRIC metric, StatsRollup* rollups, int capacity) const
+{
+    int slot = find(uid, metric);
+    if (slot < 0 || !rollups || capacity <= 0)
+        return 0;
+    int index = m_indexes[slot];
+    const uint32_t total = m_series[index].rollupCount;
+    const uint32_t kept = (uint32_t)m_config.rollups;
+    uint32_t count = std::min(std::min(total, kept), (uint32_t)capacity);
+    const StatsRollup* ring = &m_rollups[(size_t)index * kept];
+    for (uint32_t i = 0; i < count; ++i)
+        rollups[i] = ring[(total - count + i) % kept];
+    return (int)count;
+}
+
+int StatsHistory::samples(agora::rtc::uid_t uid, STATS_METRIC metric, uint32_t* samples, int capacity) const
+{
+    int slot = find(uid, metric);
+    if (slot < 0 || !samples || capacity <= 0)
+        return 0;
+    int index = m_indexes[slot];
+    const uint64_t total = m_series[index].count;
+    const uint64_t window = (uint64_t)m_config.windowSamples;
+    uint64_t count = std::min(std::min(total, window), (uint64_t)capacity);
+    const uint32_t* ring = &m_samples[(size_t)index * window];
+    for (uint64_t i = 0; i < count; ++i)
+        samples[i] = ring[(total - count + i) % window];
+    return (int)count;
+}
+
+void StatsHistory::removeUid(agora::rtc::uid_t uid)
+{
+    for (int metric = 0; metric < STATS_METRIC_COUNT; ++metric) {
+        int slot = find(uid, (STATS_METRIC)metric);
+        if (slot >= 0)
+            release(slot);
+    }
+    // The table is at most half full of live keys; past a quarter of
+    // tombstones, misses would start walking long runs of them.
+    if (m_removed > (m_mask + 1) / 4)
+        rehash();
+}
+
+void StatsHistory::reset()
+{
+    std::fill(m_keys.begin(), m_keys.end(), kFreeKey);
+    std::fill(m_indexes.begin(), m_indexes.end(), -1);
+    m_removed = 0;
+    m_free.clear();
+    for (int i = m_config.maxSeries - 1; i >= 0; --i) {
+        m_series[i].key = kFreeKey;
+        m_free.push_back(i);
+    }
+    m_seriesCount = 0;
+}
+
+size_t StatsHistory::memoryUsage() const
+{
+    return sizeof(*this)
+        + m_keys.capacity() * sizeof(uint64_t)
+        + m_indexes.capacity() * sizeof(int)
+        + m_series.capacity() * sizeof(Series)
+        + m_free.capacity() * sizeof(int)
+        + m_samples.capacity() * sizeof(uint32_t)
+        + m_windowCounts.capacity() * sizeof(uint16_t)
+        + m_sessionCounts.capacity() * sizeof(uint32_t)
+        + m_rollups.capacity() * sizeof(StatsRollup)
+        + m_scratch.capacity() * sizeof(uint32_t);
+}
+
+} // namespace rtc
+} // namespace talkboard
@@ -0,0 +1,204 @@
+//
+//  TalkBoard Engine
+//
+//  Fixed-memory history of the statistics callbacks, with percentiles.
+//
+
+#ifndef TALKBOARD_STATS_HISTORY_H
+#define TALKBOARD_STATS_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+namespace talkboard {
+namespace rtc {
+
+/** What a series measures. RtcStats and LocalVideoStats values are recorded
+ under uid 0, RemoteVideoStats values under the sender's uid.
+ */
+enum STATS_METRIC
+{
+    // RtcStats
+    STATS_TX_KBITRATE = 0,
+    STATS_RX_KBITRATE,
+    STATS_TX_AUDIO_KBITRATE,
+    STATS_RX_AUDIO_KBITRATE,
+    STATS_TX_VIDEO_KBITRATE,
+    STATS_RX_VIDEO_KBITRATE,
+    STATS_LASTMILE_DELAY,
+    STATS_USER_COUNT,
+    /** cpuAppUsage in hundredths of a percent. */
+    STATS_CPU_APP_USAGE,
+    /** cpuTotalUsage in hundredths of a percent. */
+    STATS_CPU_TOTAL_USAGE,
+    // LocalVideoStats
+    STATS_SENT_BITRATE,
+    STATS_SENT_FRAME_RATE,
+    // RemoteVideoStats
+    STATS_VIDEO_DELAY,
+    STATS_RECEIVED_BITRATE,
+    STATS_RECEIVED_FRAME_RATE,
+    STATS_METRIC_COUNT,
+};
+
+/** Sizes of the store; every buffer is allocated by the constructor.
+ */
+struct StatsHistoryConfig
+{
+    /** Series tracked at the same time: one per uid and metric. */
+    int maxSeries;
+    /** Raw samples kept per series: 10 minutes of the SDK's 2 s reports. */
+    int windowSamples;
+    /** Samples folded into one rollup: 5 minutes. At most windowSamples, which
+     is at most 65535. */
+    int rollupSamples;
+    /** Rollups kept per series: 24 hours. */
+    int rollups;
+
+    StatsHistoryConfig()
+        : maxSeries(400)
+        , windowSamples(300)
+        , rollupSamples(150)
+        , rollups(288)
+    {}
+};
+
+/** Distribution of the samples of a window or a session. Percentiles are
+ bucket values; `max` is exact for a session and a bucket value for a window.
+ */
+struct StatsSummary
+{
+    uint64_t count;
+    uint32_t latest;
+    uint32_t mean;
+    uint32_t max;
+    uint32_t p50;
+    uint32_t p95;
+    uint32_t p99;
+};
+
+/** rollupSamples consecutive samples reduced to a few numbers.
+ */
+struct StatsRollup
+{
+    uint32_t mean;
+    uint32_t max;
+    uint32_t p50;
+    uint32_t p95;
+    uint32_t p99;
+};
+
+/** Keeps the statistics the SDK reports every two seconds and forgets nothing
+ it cannot afford.
+
+ Each (uid, metric) series has three levels: a ring of the last windowSamples
+ raw values, a ring of rollups of rollupSamples values each, and a histogram
+ of the whole session. The window and session histograms are kept up to
+ date as samples arrive and leave, so percentile queries walk a fixed number
+ of buckets whatever the window or session length. Buckets are log-linear
+ (exact below 16, then 8 per octave), so a window or session percentile is
+ within 6.25% of the true sample; rollup percentiles are exact.
+
+ A sample is one report: the store does not know about time, so a uid whose
+ reports stop simply stops advancing. Memory is fixed by the config; when
+ maxSeries series are in use new ones are refused until removeUid(). Slots
+ freed by removeUid() are tombstones in the lookup table until they are
+ reused; once they fill a quarter of it the table is rebuilt in place, so
+ lookups stay short however many uids come and go.
+
+ Not thread-safe: record and query from one thread, e.g. the one that
+ collects a StatsSnapshot.
+ */
+class StatsHistory
+{
+public:
+    explicit StatsHistory(const StatsHistoryConfig& config = StatsHistoryConfig());
+
+    /** Appends `value` (clamped at 0) to the (uid, metric) series.
+
+     @return 0, or -ERR_RESOURCE_LIMITED if maxSeries series are in use.
+     */
+    int record(agora::rtc::uid_t uid, STATS_METRIC metric, int64_t value);
+
+    /** Records every STATS_METRIC of RtcStats under uid 0. */
+    int recordRtcStats(const agora::rtc::RtcStats& stats);
+    int recordLocalVideoStats(const agora::rtc::LocalVideoStats& stats);
+    int recordRemoteVideoStats(const agora::rtc::RemoteVideoStats& stats);
+
+    /** The last windowSamples samples. @return false if the series does not exist. */
+    bool window(agora::rtc::uid_t uid, STATS_METRIC metric, StatsSummary& summary) const;
+    /** Every sample since the series was created. */
+    bool session(agora::rtc::uid_t uid, STATS_METRIC metric, StatsSummary& summary) const;
+
+    /** Any percentile of the window, `fraction` in [0, 1]; 0 for an unknown series. */
+    uint32_t percentile(agora::rtc::uid_t uid, STATS_METRIC metric, double fraction) const;
+
+    /** Copies the newest `capacity` rollups, oldest first. @return Number written. */
+    int rollups(agora::rtc::uid_t uid, STATS_METRIC metric, StatsRollup* rollups, int capacity) const;
+    /** Copies the newest `capacity` raw samples, oldest first. @return Number written. */
+    int samples(agora::rtc::uid_t uid, STATS_METRIC metric, uint32_t* samples, int capacity) const;
+
+    /** Drops every series of `uid`, e.g. from onUserOffline. */
+    void removeUid(agora::rtc::uid_t uid);
+    /** Drops everything, e.g. when leaving the channel. */
+    void reset();
+
+    int seriesCount() const { return m_seriesCount; }
+    /** Bytes allocated, all of it by the constructor. */
+    size_t memoryUsage() const;
+
+private:
+    StatsHistory(const StatsHistory&);
+    StatsHistory& operator=(const StatsHistory&);
+
+    /** Log-linear buckets covering uint32_t; see the .cpp. */
+    enum { BUCKETS = 240 };
+
+    struct Series
+    {
+        /** The table key of the series, 0 while it is on the free list. */
+        uint64_t key;
+        /** Samples ever recorded; the newest is at (count - 1) % windowSamples. */
+        uint64_t count;
+        uint64_t windowSum;
+        uint64_t sessionSum;
+        uint32_t sessionMax;
+        /** Rollups ever closed. */
+        uint32_t rollupCount;
+    };
+
+    int find(agora::rtc::uid_t uid, STATS_METRIC metric) const;
+    int insert(agora::rtc::uid_t uid, STATS_METRIC metric);
+    void release(int slot);
+    void rehash();
+    void closeRollup(int series);
+
+    StatsHistoryConfig m_config;
+    /** Open-addressed (uid, metric) -> series index. */
+    std::vector<uint64_t> m_keys;
+    std::vector<int> m_indexes;
+    uint32_t m_mask;
+    /** Tombstones in m_keys. */
+    uint32_t m_removed;
+    std::vector<Series> m_series;
+    std::vector<int> m_free;
+    int m_seriesCount;
+    /** maxSeries x windowSamples raw values. */
+    std::vector<uint32_t> m_samples;
+    /** maxSeries x BUCKETS counts of the window. */
+    std::vector<uint16_t> m_windowCounts;
+    /** maxSeries x BUCKETS counts of the session. */
+    std::vector<uint32_t> m_sessionCounts;
+    /** maxSeries x rollups. */
+    std::vector<StatsRollup> m_rollups;
+    /** rollupSamples values being reduced to a rollup. */
+    std::vector<uint32_t> m_scratch;
+};
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,350 @@
+//
+//  TalkBoard Engine
+//
+
+#include "StreamTypeController.h"
+
+#include <limits.h>
+#include <algorithm>
+
+namespace talkboard {
+namespace rtc {
+
+namespace {
+
+/** Weight of the newest receivedBitrate in the smoothed stream cost. */
+const double kBitrateSmoothing = 0.3;
+
+/** QUALITY_UNKNOWN (not measured yet) and QUALITY_UNSUPPORTED say nothing
+ about the network; reports of them are ignored. */
+inline bool isMeasured(int quality)
+{
+    return quality >= agora::rtc::QUALITY_EXCELLENT && quality <= agora::rtc::QUALITY_DOWN;
+}
+
+/** Share of the budget usable at a downlink quality. */
+double budgetFactor(int quality)
+{
+    switch (quality) {
+    case agora::rtc::QUALITY_POOR:
+        return 0.6;
+    case agora::rtc::QUALITY_BAD:
+        return 0.35;
+    case agora::rtc::QUALITY_VBAD:
+        return 0.15;
+    case agora::rtc::QUALITY_DOWN:
+        return 0;
+    default:
+        return 1;
+    }
+}
+
+} // namespace
+
+StreamTypeController::StreamTypeController(const StreamTypeConfig& config)
+    : m_config(config)
+{
+    reset();
+}
+
+void StreamTypeController::reset()
+{
+    m_streams.clear();
+    m_changes.clear();
+    m_downlinkQuality = agora::rtc::QUALITY_UNKNOWN;
+    m_cpuAppUsage = 0;
+    m_budgetKbps = m_config.downlinkBudgetKbps;
+    m_plannedKbps = 0;
+    m_fallback = agora::rtc::STREAM_FALLBACK_OPTION_VIDEO_STREAM_LOW;
+    m_fallbackTarget = m_fallback;
+    m_fallbackPending = m_fallback;
+    m_fallbackSinceMs = 0;
+    m_fallbackApplied = false;
+    m_fallbackChanged = false;
+}
+
+StreamTypeController::Stream* StreamTypeController::find(agora::rtc::uid_t uid)
+{
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        if (m_streams[i].uid == uid)
+            return &m_streams[i];
+    }
+    return NULL;
+}
+
+const StreamTypeController::Stream* StreamTypeController::find(agora::rtc::uid_t uid) const
+{
+    return const_cast<StreamTypeController*>(this)->find(uid);
+}
+
+StreamTypeController::Stream& StreamTypeController::stream(agora::rtc::uid_t uid)
+{
+    if (Stream* s = find(uid))
+        return *s;
+    Stream s;
+    s.uid = uid;
+    s.tileArea = 0;
+    s.viewportDistance = INT_MAX;
+    s.resized = false;
+    s.highKbps = 0;
+    s.lowKbps = 0;
+    s.uplinkQuality = agora::rtc::QUALITY_UNKNOWN;
+    s.current = SUBSCRIPTION_MUTED;
+    s.applied = false;
+    s.target = SUBSCRIPTION_MUTED;
+    s.pending = SUBSCRIPTION_MUTED;
+    s.pendingSinceMs = 0;
+    m_streams.push_back(s);
+    return m_streams.back();
+}
+
+void StreamTypeController::setTileSize(agora::rtc::uid_t uid, int width, int height)
+{
+    if (uid == 0)
+        return;
+    Stream& s = stream(uid);
+    int area = width > 0 && height > 0 ? width * height : 0;
+    if (area != s.tileArea) {
+        s.tileArea = area;
+        s.resized = true;
+    }
+}
+
+void StreamTypeController::setViewportDistance(agora::rtc::uid_t uid, int distance)
+{
+    if (uid == 0)
+        return;
+    stream(uid).viewportDistance = std::max(0, distance);
+}
+
+void StreamTypeController::removeUid(agora::rtc::uid_t uid)
+{
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        if (m_streams[i].uid == uid) {
+            m_streams[i] = m_streams.back();
+            m_streams.pop_back();
+            return;
+        }
+    }
+}
+
+void StreamTypeController::updateRemoteVideoStats(const agora::rtc::RemoteVideoStats& stats)
+{
+    Stream* s = find(stats.uid);
+    if (!s || stats.receivedBitrate <= 0)
+        return;
+    double& kbps = stats.rxStreamType == agora::rtc::REMOTE_VIDEO_STREAM_HIGH ? s->highKbps : s->lowKbps;
+    kbps = kbps > 0 ? kbps + (stats.receivedBitrate - kbps) * kBitrateSmoothing : stats.receivedBitrate;
+}
+
+void StreamTypeController::updateNetworkQuality(agora::rtc::uid_t uid, int txQuality, int rxQuality)
+{
+    if (uid == 0) {
+        if (isMeasured(rxQuality))
+            m_downlinkQuality = rxQuality;
+    } else if (Stream* s = find(uid)) {
+        if (isMeasured(txQuality))
+            s->uplinkQuality = txQuality;
+    }
+}
+
+void StreamTypeController::updateRtcStats(const agora::rtc::RtcStats& stats)
+{
+    m_cpuAppUsage = stats.cpuAppUsage;
+}
+
+int StreamTypeController::lowCost(const Stream& s) const
+{
+    return s.lowKbps > 0 ? (int)(s.lowKbps + 0.5) : m_config.lowStreamKbps;
+}
+
+int StreamTypeController::highCost(const Stream& s) const
+{
+    return s.highKbps > 0 ? (int)(s.highKbps + 0.5) : m_config.highStreamKbps;
+}
+
+// Visible streams get the low stream, biggest tile first, as long as there
+// are decoder slots; what is left of the budget goes to high streams in the
+// same order and, between equal tiles, to those already high; after that,
+// streams next to the viewport are prefetched on the low stream.
+void StreamTypeController::plan()
+{
+    m_budgetKbps = (int)(m_config.downlinkBudgetKbps * budgetFactor(m_downlinkQuality));
+    m_plannedKbps = 0;
+    m_order.clear();
+    m_prefetch.clear();
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        Stream& s = m_streams[i];
+        s.target = SUBSCRIPTION_MUTED;
+        if (s.tileArea)
+            m_order.push_back(i);
+        else if (s.viewportDistance <= m_config.prefetchDistance)
+            m_prefetch.push_back(i);
+    }
+
+    const std::vector<Stream>& streams = m_streams;
+    std::sort(m_order.begin(), m_order.end(), [&streams](size_t a, size_t b) {
+        const Stream& x = streams[a];
+        const Stream& y = streams[b];
+        if (x.tileArea != y.tileArea)
+            return x.tileArea > y.tileArea;
+        if ((x.current == SUBSCRIPTION_HIGH) != (y.current == SUBSCRIPTION_HIGH))
+            return x.current == SUBSCRIPTION_HIGH;
+        return x.uid < y.uid;
+    });
+
+    size_t slots = (size_t)std::max(0, m_config.maxDecodedStreams);
+    size_t decoded = std::min(m_order.size(), slots);
+    for (size_t i = 0; i < decoded; ++i) {
+        Stream& s = m_streams[m_order[i]];
+        s.target = SUBSCRIPTION_LOW;
+        m_plannedKbps += lowCost(s);
+    }
+
+    const bool unusable = m_downlinkQuality >= agora::rtc::QUALITY_VBAD
+        && m_downlinkQuality <= agora::rtc::QUALITY_DOWN;
+    m_fallbackTarget = m_plannedKbps > m_budgetKbps || unusable
+        ? agora::rtc::STREAM_FALLBACK_OPTION_AUDIO_ONLY
+        : agora::rtc::STREAM_FALLBACK_OPTION_VIDEO_STREAM_LOW;
+
+    size_t maxHigh = m_cpuAppUsage > m_config.cpuLimitPercent ? 1 : decoded;
+    size_t high = 0;
+    for (size_t i = 0; i < decoded && high < maxHigh; ++i) {
+        Stream& s = m_streams[m_order[i]];
+        if (s.tileArea < m_config.minHighTileArea)
+            continue;
+        if (s.uplinkQuality >= agora::rtc::QUALITY_BAD && s.uplinkQuality <= agora::rtc::QUALITY_DOWN)
+            continue;
+        int extra = highCost(s) - lowCost(s);
+        int limit = s.current == SUBSCRIPTION_HIGH ? m_budgetKbps : m_budgetKbps - m_config.upgradeMarginKbps;
+        if (m_plannedKbps + extra <= limit) {
+            s.target = SUBSCRIPTION_HIGH;
+            m_plannedKbps += extra;
+            ++high;
+        }
+    }
+
+    // Nearest first; streams already prefetched keep their place so a
+    // scroll does not swap one neighbour for another.
+    std::sort(m_prefetch.begin(), m_prefetch.end(), [&streams](size_t a, size_t b) {
+        const Stream& x = streams[a];
+        const Stream& y = streams[b];
+        if (x.viewportDistance != y.viewportDistance)
+            return x.viewportDistance < y.viewportDistance;
+        if ((x.current != SUBSCRIPTION_MUTED) != (y.current != SUBSCRIPTION_MUTED))
+            return x.current != SUBSCRIPTION_MUTED;
+        return x.uid < y.uid;
+    });
+    for (size_t i = 0; i < m_prefetch.size() && decoded < slots; ++i) {
+        Stream& s = m_streams[m_prefetch[i]];
+        int limit = s.current == SUBSCRIPTION_MUTED ? m_budgetKbps - m_config.upgradeMarginKbps : m_budgetKbps;
+        if (m_plannedKbps + lowCost(s) > limit)
+            break;
+        s.target = SUBSCRIPTION_LOW;
+        m_plannedKbps += lowCost(s);
+        ++decoded;
+    }
+}
+
+int StreamTypeController::delayOf(const Stream& s, bool overBudget) const
+{
+    if (!s.applied || s.resized || s.current == SUBSCRIPTION_MUTED)
+        return 0;
+    if (s.target == SUBSCRIPTION_MUTED)
+        return m_config.muteDelayMs;
+    if (s.target > s.current)
+        return m_config.upgradeDelayMs;
+    return overBudget ? 0 : m_config.downgradeDelayMs;
+}
+
+int StreamTypeController::evaluate(int64_t nowMs)
+{
+    plan();
+    int currentKbps = 0;
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        const Stream& s = m_streams[i];
+        if (s.current == SUBSCRIPTION_HIGH)
+            currentKbps += highCost(s);
+        else if (s.current == SUBSCRIPTION_LOW)
+            currentKbps += lowCost(s);
+    }
+    const bool overBudget = currentKbps > m_budgetKbps;
+
+    m_changes.clear();
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        Stream& s = m_streams[i];
+        if (s.applied && s.target == s.current) {
+            s.pending = s.current;
+            s.resized = false;
+            continue;
+        }
+        if (s.target != s.pending) {
+            s.pending = s.target;
+            s.pendingSinceMs = nowMs;
+        }
+        if (nowMs - s.pendingSinceMs < delayOf(s, overBudget))
+            continue;
+
+        StreamChange change;
+        change.uid = s.uid;
+        change.from = s.current;
+        change.to = s.target;
+        change.initial = !s.applied;
+        m_changes.push_back(change);
+        s.current = s.target;
+        s.pending = s.target;
+        s.applied = true;
+        s.resized = false;
+    }
+
+    m_fallbackChanged = false;
+    if (!m_fallbackApplied || m_fallbackTarget == m_fallback) {
+        m_fallbackPending = m_fallbackTarget;
+        m_fallbackSinceMs = nowMs;
+        m_fallbackChanged = !m_fallbackApplied;
+    } else {
+        if (m_fallbackTarget != m_fallbackPending) {
+            m_fallbackPending = m_fallbackTarget;
+            m_fallbackSinceMs = nowMs;
+        }
+        int delay = m_fallbackTarget == agora::rtc::STREAM_FALLBACK_OPTION_AUDIO_ONLY
+            ? m_config.downgradeDelayMs : m_config.upgradeDelayMs;
+        m_fallbackChanged = nowMs - m_fallbackSinceMs >= delay;
+    }
+    if (m_fallbackChanged) {
+        m_fallback = m_fallbackTarget;
+        m_fallbackApplied = true;
+    }
+    return (int)m_changes.size() + (m_fallbackChanged ? 1 : 0);
+}
+
+int StreamTypeController::apply(ParameterTransaction& transaction) const
+{
+    int result = 0;
+    for (size_t i = 0; i < m_changes.size() && result == 0; ++i) {
+        const StreamChange& change = m_changes[i];
+        if (change.to == SUBSCRIPTION_MUTED) {
+            result = transaction.muteRemoteVideoStream(change.uid, true);
+            continue;
+        }
+        if (change.initial || change.from == SUBSCRIPTION_MUTED)
+            result = transaction.muteRemoteVideoStream(change.uid, false);
+        if (result == 0) {
+            agora::rtc::REMOTE_VIDEO_STREAM_TYPE type = change.to == SUBSCRIPTION_HIGH
+                ? agora::rtc::REMOTE_VIDEO_STREAM_HIGH : agora::rtc::REMOTE_VIDEO_STREAM_LOW;
+            result = transaction.setRemoteVideoStreamType(change.uid, type);
+        }
+    }
+    if (result == 0 && m_fallbackChanged)
+        result = transaction.setRemoteSubscribeFallbackOption(m_fallback);
+    return result;
+}
+
+STREAM_SUBSCRIPTION StreamTypeController::subscription(agora::rtc::uid_t uid) const
+{
+    const Stream* s = find(uid);
+    return s ? s->current : SUBSCRIPTION_MUTED;
+}
+
+} // namespace rtc
+} // namespace talkboard
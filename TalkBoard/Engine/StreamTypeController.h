@@ -0,0 +1,208 @@
+//
+//  TalkBoard Engine
+//
+//  Picks the high stream, low stream or no video for every remote uid.
+//
+
+#ifndef TALKBOARD_STREAM_TYPE_CONTROLLER_H
+#define TALKBOARD_STREAM_TYPE_CONTROLLER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+#include "ParameterTransaction.h"
+
+namespace talkboard {
+namespace rtc {
+
+/** What is subscribed for a uid; ordered from cheapest to most expensive.
+ */
+enum STREAM_SUBSCRIPTION
+{
+    SUBSCRIPTION_MUTED = 0,
+    SUBSCRIPTION_LOW = 1,
+    SUBSCRIPTION_HIGH = 2,
+};
+
+/** Budget and hysteresis of a StreamTypeController.
+ */
+struct StreamTypeConfig
+{
+    /** Video downlink to spend when the network is good. */
+    int downlinkBudgetKbps;
+    /** Assumed bitrates of a stream until one has been measured. */
+    int highStreamKbps;
+    int lowStreamKbps;
+    /** Tiles smaller than this (pixels, not points) never get the high stream:
+     the low stream already fills them. */
+    int minHighTileArea;
+    /** cpuAppUsage (%) above which at most one high stream is decoded. */
+    int cpuLimitPercent;
+    /** How long a decision must hold before it is applied. Upgrades wait
+     longest so a stream that barely fits does not flap; showing a tile that
+     has no video applies at once. */
+    int upgradeDelayMs;
+    int downgradeDelayMs;
+    int muteDelayMs;
+    /** Budget an upgrade must leave free; streams already high keep their
+     place up to the full budget. About one low stream plus measurement noise. */
+    int upgradeMarginKbps;
+    /** Most remote videos subscribed at once, visible and prefetched
+     together; every subscribed stream is decoded. Biggest tiles win. */
+    int maxDecodedStreams;
+    /** Off-screen uids at most this viewport distance away keep the low
+     stream while budget and decoder slots are left, so paging or scrolling
+     to them shows video at once. 0 disables prefetch. */
+    int prefetchDistance;
+
+    StreamTypeConfig()
+        : downlinkBudgetKbps(2500)
+        , highStreamKbps(900)
+        , lowStreamKbps(150)
+        , minHighTileArea(400 * 400)
+        , cpuLimitPercent(80)
+        , upgradeDelayMs(6000)
+        , downgradeDelayMs(2000)
+        , muteDelayMs(1000)
+        , upgradeMarginKbps(200)
+        , maxDecodedStreams(20)
+        , prefetchDistance(1)
+    {}
+};
+
+/** A subscription change decided by StreamTypeController::evaluate(). */
+struct StreamChange
+{
+    agora::rtc::uid_t uid;
+    /** SUBSCRIPTION_MUTED for a uid that had no decision yet. */
+    STREAM_SUBSCRIPTION from;
+    STREAM_SUBSCRIPTION to;
+    /** The first decision for the uid: everything is sent, not just the difference. */
+    bool initial;
+};
+
+/** Chooses setRemoteVideoStreamType and muteRemoteVideoStream for each
+ remote uid, and the remote subscribe fallback option, from what is on
+ screen and what the network and CPU can take.
+
+ Every uid starts on the low stream, which is cheap, once its tile is
+ visible, up to maxDecodedStreams with the biggest tiles first; off-screen
+ uids are muted. The remaining downlink budget goes to high streams,
+ biggest tile first, and what is left after that to low streams for
+ off-screen uids next to the viewport (prefetchDistance), so a swipe to
+ the next page shows video at once. The budget shrinks with the local
+ downlink rxQuality of onNetworkQuality, stream costs are the bitrates
+ measured by onRemoteVideoStats, senders whose uplink is bad stay low, and
+ above cpuLimitPercent only one high stream is kept. The fallback option is
+ global in the SDK: video-low normally, audio-only when even the low
+ streams do not fit.
+
+ Decisions go through hysteresis before they are applied: a change must
+ hold for its delay, and an upgrade must leave upgradeMarginKbps of the
+ budget free while a stream already high keeps it up to the full budget.
+ Changes caused by the layout (a tile grew or shrank) and downgrades while
+ the current subscriptions exceed the budget are applied at once; only the
+ ones driven by measurements wait.
+
+ Call evaluate() on stats updates (every two seconds) and after layout
+ changes, then apply() the changes.
+
+ Not thread-safe; use from one thread, e.g. the main thread.
+ */
+class StreamTypeController
+{
+public:
+    explicit StreamTypeController(const StreamTypeConfig& config = StreamTypeConfig());
+
+    /** Size in pixels of the tile showing `uid`; 0 when it is not on screen. */
+    void setTileSize(agora::rtc::uid_t uid, int width, int height);
+    /** How many pages or screens away from the viewport the tile of `uid`
+     is (see media::Tile::viewportDistance); INT_MAX when it has none. */
+    void setViewportDistance(agora::rtc::uid_t uid, int distance);
+    /** Forgets `uid`, e.g. from onUserOffline. */
+    void removeUid(agora::rtc::uid_t uid);
+    void reset();
+
+    void updateRemoteVideoStats(const agora::rtc::RemoteVideoStats& stats);
+    /** uid 0 is the local downlink; other uids report their uplink in
+     `txQuality`. QUALITY_UNKNOWN and QUALITY_UNSUPPORTED keep the last
+     measured quality. */
+    void updateNetworkQuality(agora::rtc::uid_t uid, int txQuality, int rxQuality);
+    void updateRtcStats(const agora::rtc::RtcStats& stats);
+
+    /** Decides every subscription for the time `nowMs` (any monotonic clock).
+
+     @return Number of changes, available from changes() until the next call.
+     */
+    int evaluate(int64_t nowMs);
+
+    const std::vector<StreamChange>& changes() const { return m_changes; }
+    /** Set by evaluate() when the fallback option has to be sent. */
+    bool fallbackChanged() const { return m_fallbackChanged; }
+    agora::rtc::STREAM_FALLBACK_OPTIONS fallbackOption() const { return m_fallback; }
+
+    /** Stages the last evaluate()'s decisions in `transaction`.
+
+     @return 0, or the first error of the transaction.
+     */
+    int apply(ParameterTransaction& transaction) const;
+
+    /** Current subscription of `uid`; SUBSCRIPTION_MUTED if unknown. */
+    STREAM_SUBSCRIPTION subscription(agora::rtc::uid_t uid) const;
+    /** Budget after the network adjustment, and the expected use of the plan. */
+    int budgetKbps() const { return m_budgetKbps; }
+    int plannedKbps() const { return m_plannedKbps; }
+
+private:
+    struct Stream
+    {
+        agora::rtc::uid_t uid;
+        int tileArea;
+        int viewportDistance;
+        /** The tile changed size since the last decision was applied. */
+        bool resized;
+        /** Measured bitrates, smoothed; 0 until measured. */
+        double highKbps;
+        double lowKbps;
+        int uplinkQuality;
+        STREAM_SUBSCRIPTION current;
+        bool applied;
+        STREAM_SUBSCRIPTION target;
+        STREAM_SUBSCRIPTION pending;
+        int64_t pendingSinceMs;
+    };
+
+    Stream* find(agora::rtc::uid_t uid);
+    const Stream* find(agora::rtc::uid_t uid) const;
+    Stream& stream(agora::rtc::uid_t uid);
+    int lowCost(const Stream& stream) const;
+    int highCost(const Stream& stream) const;
+    int delayOf(const Stream& stream, bool overBudget) const;
+    void plan();
+
+    StreamTypeConfig m_config;
+    std::vector<Stream> m_streams;
+    /** Indexes of visible streams, ordered for the decoder slots and the
+     high-stream allocation. */
+    std::vector<size_t> m_order;
+    /** Indexes of streams close enough to prefetch. */
+    std::vector<size_t> m_prefetch;
+    std::vector<StreamChange> m_changes;
+    int m_downlinkQuality;
+    double m_cpuAppUsage;
+    int m_budgetKbps;
+    int m_plannedKbps;
+    agora::rtc::STREAM_FALLBACK_OPTIONS m_fallback;
+    agora::rtc::STREAM_FALLBACK_OPTIONS m_fallbackTarget;
+    agora::rtc::STREAM_FALLBACK_OPTIONS m_fallbackPending;
+    int64_t m_fallbackSinceMs;
+    bool m_fallbackApplied;
+    bool m_fallbackChanged;
+};
+
+} // namespace rtc
+} // namespace talkboard
+
+#endif
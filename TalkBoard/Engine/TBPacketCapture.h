@@ -0,0 +1,55 @@
+//
+//  TalkBoard Engine
+//
+//  Objective-C face of talkboard::rtc::PacketCapture for Swift.
+//
+
+#import <Foundation/Foundation.h>
+#import <AgoraRtcEngineKit/AgoraRtcEngineKit.h>
+
+@class TBPacketCrypto;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Records the channel's audio and video packets and the board's
+ data-stream messages to a file, for reproducing field issues.
+
+ The engine takes a single packet observer, so while recording the capture
+ is registered and passes packets on to `crypto`; enable the crypto before
+ starting and stop the capture before disabling it. Use it from one thread.
+ */
+@interface TBPacketCapture : NSObject
+
+- (instancetype)initWithEngine:(AgoraRtcEngineKit *)engine NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Creates the file at `path` and registers the capture with the engine.
+
+ @param crypto An enabled TBPacketCrypto to record the encrypted packets
+ through, or nil.
+ @return 0, or < 0: already recording, the file cannot be created, or the
+ engine refused the observer.
+ */
+- (int)startWithPath:(NSString *)path crypto:(nullable TBPacketCrypto *)crypto NS_SWIFT_NAME(start(path:crypto:));
+
+/** Finishes the file and gives the packet observer back to the crypto, if any.
+
+ @return 0, or < 0 if a write failed and the file is incomplete.
+ */
+- (int)stop;
+
+/** Records a message from rtcEngine(_:receiveStreamMessageFromUid:streamId:data:). */
+- (void)captureStreamMessage:(NSData *)data fromUid:(NSUInteger)uid streamId:(NSInteger)streamId
+    NS_SWIFT_NAME(captureStreamMessage(_:fromUid:streamId:));
+/** Records a message given to sendStreamMessage. */
+- (void)captureSentStreamMessage:(NSData *)data streamId:(NSInteger)streamId
+    NS_SWIFT_NAME(captureSentStreamMessage(_:streamId:));
+
+@property (nonatomic, readonly, getter=isCapturing) BOOL capturing;
+/** Records taken since start, and the ones lost because the writer fell behind. */
+@property (nonatomic, readonly) uint64_t capturedRecords;
+@property (nonatomic, readonly) uint64_t droppedRecords;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,83 @@
+//
+//  TalkBoard Engine
+//
+
+#import "TBPacketCapture.h"
+#import "TBPacketCrypto.h"
+
+#include "PacketCapture.h"
+
+@implementation TBPacketCapture
+{
+    agora::rtc::IRtcEngine* _engine;
+    talkboard::rtc::PacketCapture* _capture;
+    TBPacketCrypto* _crypto;
+}
+
+- (instancetype)initWithEngine:(AgoraRtcEngineKit *)engine
+{
+    if ((self = [super init])) {
+        _engine = static_cast<agora::rtc::IRtcEngine*>([engine getNativeHandle]);
+        _capture = new talkboard::rtc::PacketCapture();
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self stop];
+    delete _capture;
+}
+
+- (int)startWithPath:(NSString *)path crypto:(TBPacketCrypto *)crypto
+{
+    if (_capture->isCapturing())
+        return -agora::ERR_ALREADY_IN_USE;
+    _capture->setObserver(crypto.enabled ? crypto.nativeCrypto : NULL);
+    int result = _capture->start(path.fileSystemRepresentation);
+    if (result != 0)
+        return result;
+    result = _engine->registerPacketObserver(_capture);
+    if (result != 0) {
+        _capture->stop();
+        return result;
+    }
+    _crypto = crypto.enabled ? crypto : nil;
+    return 0;
+}
+
+- (int)stop
+{
+    if (!_capture->isCapturing())
+        return 0;
+    _engine->registerPacketObserver(_crypto ? _crypto.nativeCrypto : NULL);
+    _crypto = nil;
+    return _capture->stop();
+}
+
+- (void)captureStreamMessage:(NSData *)data fromUid:(NSUInteger)uid streamId:(NSInteger)streamId
+{
+    _capture->captureStreamMessage((agora::rtc::uid_t)uid, (int)streamId, static_cast<const char*>(data.bytes), data.length);
+}
+
+- (void)captureSentStreamMessage:(NSData *)data streamId:(NSInteger)streamId
+{
+    _capture->captureSentStreamMessage((int)streamId, static_cast<const char*>(data.bytes), data.length);
+}
+
+- (BOOL)isCapturing
+{
+    return _capture->isCapturing();
+}
+
+- (uint64_t)capturedRecords
+{
+    return _capture->captured();
+}
+
+- (uint64_t)droppedRecords
+{
+    return _capture->dropped();
+}
+
+@end
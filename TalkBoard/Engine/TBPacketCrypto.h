@@ -0,0 +1,55 @@
+//
+//  TalkBoard Engine
+//
+//  Objective-C face of talkboard::rtc::PacketCrypto for Swift.
+//
+
+#import <Foundation/Foundation.h>
+#import <AgoraRtcEngineKit/AgoraRtcEngineKit.h>
+
+#ifdef __cplusplus
+namespace talkboard {
+namespace rtc {
+class PacketCrypto;
+}
+}
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Encrypts the channel's audio and video packets with ChaCha20 under a
+ 32-byte key every participant shares, instead of the SDK's built-in
+ encryption modes. Packets are not authenticated. Enable it before joining
+ the channel and use it from one thread.
+ */
+@interface TBPacketCrypto : NSObject
+
+- (instancetype)initWithEngine:(AgoraRtcEngineKit *)engine NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Sets `key` and registers the packet observer with the engine.
+
+ While enabled, replaces the key without unregistering: each packet in
+ flight is processed with the whole old key or the whole new one, and none
+ goes out in the clear. If the new key is refused the old one stays.
+
+ @return 0, or < 0: the key is not 32 bytes, the cipher failed its
+ known-answer test, or the engine refused the observer.
+ */
+- (int)enableWithKey:(NSData *)key NS_SWIFT_NAME(enable(key:));
+
+/** Unregisters the packet observer; packets go out as the SDK sends them. */
+- (void)disable;
+
+@property (nonatomic, readonly, getter=isEnabled) BOOL enabled;
+/** Packets dropped because they could not be encrypted or decrypted. */
+@property (nonatomic, readonly) uint64_t droppedPackets;
+
+#ifdef __cplusplus
+/** The wrapped observer, for other Objective-C++ wrappers that chain packet observers. */
+@property (nonatomic, readonly) talkboard::rtc::PacketCrypto *nativeCrypto;
+#endif
+
+@end
+
+NS_ASSUME_NONNULL_END
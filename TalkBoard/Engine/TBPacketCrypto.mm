@@ -0,0 +1,69 @@
+//
+//  TalkBoard Engine
+//
+
+#import "TBPacketCrypto.h"
+
+#include "PacketCrypto.h"
+
+@implementation TBPacketCrypto
+{
+    agora::rtc::IRtcEngine* _engine;
+    talkboard::util::BufferPool* _pool;
+    talkboard::rtc::PacketCrypto* _crypto;
+}
+
+- (instancetype)initWithEngine:(AgoraRtcEngineKit *)engine
+{
+    if ((self = [super init])) {
+        _engine = static_cast<agora::rtc::IRtcEngine*>([engine getNativeHandle]);
+        // One buffer per packet direction.
+        _pool = new talkboard::util::BufferPool(64, 4);
+        _crypto = new talkboard::rtc::PacketCrypto(*_pool);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self disable];
+    delete _crypto;
+    delete _pool;
+}
+
+- (int)enableWithKey:(NSData *)key
+{
+    // Unregistering to rekey would let packets through in the clear.
+    if (_enabled)
+        return _crypto->setKey(static_cast<const unsigned char*>(key.bytes), key.length);
+    int result = _crypto->setKey(static_cast<const unsigned char*>(key.bytes), key.length);
+    if (result == 0)
+        result = _engine->registerPacketObserver(_crypto);
+    if (result != 0) {
+        _crypto->clearKey();
+        return result;
+    }
+    _enabled = YES;
+    return 0;
+}
+
+- (void)disable
+{
+    if (!_enabled)
+        return;
+    _engine->registerPacketObserver(NULL);
+    _crypto->clearKey();
+    _enabled = NO;
+}
+
+- (uint64_t)droppedPackets
+{
+    return _crypto->dropped();
+}
+
+- (talkboard::rtc::PacketCrypto *)nativeCrypto
+{
+    return _crypto;
+}
+
+@end
@@ -0,0 +1,64 @@
+//
+//  TalkBoard Engine
+//
+//  Objective-C face of talkboard::rtc::ParameterTransaction for Swift.
+//
+
+#import <Foundation/Foundation.h>
+#import <AgoraRtcEngineKit/AgoraRtcEngineKit.h>
+
+#ifdef __cplusplus
+namespace talkboard {
+namespace rtc {
+class ParameterTransaction;
+}
+}
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Stages engine parameter updates and sends them in merged setParameters calls.
+
+ Staging the same uid twice keeps only the last value, and a write-through
+ cache drops updates equal to what was last applied. Use from one thread.
+ */
+@interface TBParameterTransaction : NSObject
+
+- (instancetype)initWithEngine:(AgoraRtcEngineKit *)engine NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Stages the same update as -[AgoraRtcEngineKit setRemoteVideoStream:type:]. */
+- (void)setRemoteVideoStream:(NSUInteger)uid type:(AgoraVideoStreamType)streamType;
+
+/** Stages the same update as -[AgoraRtcEngineKit muteLocalAudioStream:]. */
+- (void)muteLocalAudioStream:(BOOL)mute;
+
+/** Number of staged updates. */
+@property (nonatomic, readonly) NSUInteger pendingCount;
+
+/** Sends the staged updates.
+
+ @return >= 0: number of setParameters calls made; < 0: the first error.
+ */
+- (int)commit;
+
+/** Drops the staged updates. */
+- (void)rollback;
+
+/** Forgets every cached value; call after rejoining or leaving the channel. */
+- (void)invalidateCache;
+/** Forgets the cached values of `uid`; call when it joins or goes offline. */
+- (void)invalidateCacheForUid:(NSUInteger)uid;
+
+/** Updates the cache dropped, and updates it let through. */
+@property (nonatomic, readonly) uint64_t cacheHits;
+@property (nonatomic, readonly) uint64_t cacheMisses;
+
+#ifdef __cplusplus
+/** The wrapped transaction, for other Objective-C++ wrappers that stage updates. */
+@property (nonatomic, readonly) talkboard::rtc::ParameterTransaction *nativeTransaction;
+#endif
+
+@end
+
+NS_ASSUME_NONNULL_END
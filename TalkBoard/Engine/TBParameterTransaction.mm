@@ -0,0 +1,81 @@
+//
+//  TalkBoard Engine
+//
+
+#import "TBParameterTransaction.h"
+
+#include "ParameterTransaction.h"
+
+@implementation TBParameterTransaction
+{
+    talkboard::rtc::ParameterTransaction* _transaction;
+    talkboard::rtc::ParameterCache* _cache;
+}
+
+- (instancetype)initWithEngine:(AgoraRtcEngineKit *)engine
+{
+    if ((self = [super init])) {
+        _transaction = new talkboard::rtc::ParameterTransaction(static_cast<agora::rtc::IRtcEngine*>([engine getNativeHandle]));
+        _cache = new talkboard::rtc::ParameterCache();
+        _transaction->setCache(_cache);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    delete _transaction;
+    delete _cache;
+}
+
+- (void)setRemoteVideoStream:(NSUInteger)uid type:(AgoraVideoStreamType)streamType
+{
+    _transaction->setRemoteVideoStreamType(static_cast<agora::rtc::uid_t>(uid), static_cast<agora::rtc::REMOTE_VIDEO_STREAM_TYPE>(streamType));
+}
+
+- (void)muteLocalAudioStream:(BOOL)mute
+{
+    _transaction->muteLocalAudioStream(mute);
+}
+
+- (NSUInteger)pendingCount
+{
+    return _transaction->pending();
+}
+
+- (int)commit
+{
+    return _transaction->commit();
+}
+
+- (void)rollback
+{
+    _transaction->rollback();
+}
+
+- (void)invalidateCache
+{
+    _cache->invalidate();
+}
+
+- (void)invalidateCacheForUid:(NSUInteger)uid
+{
+    _cache->invalidateScope(static_cast<agora::rtc::uid_t>(uid));
+}
+
+- (uint64_t)cacheHits
+{
+    return _cache->hits();
+}
+
+- (uint64_t)cacheMisses
+{
+    return _cache->misses();
+}
+
+- (talkboard::rtc::ParameterTransaction *)nativeTransaction
+{
+    return _transaction;
+}
+
+@end
@@ -0,0 +1,46 @@
+//
+//  TalkBoard Engine
+//
+//  Objective-C face of talkboard::rtc::SessionRegistry for Swift.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Names one registration; 0 names nothing. */
+typedef uint64_t TBSessionHandle;
+
+/** The sessions of a channel, one object per uid, in join order.
+
+ Lookup, add and remove by uid take constant time. A handle finds its
+ object until the uid is removed, even if someone else takes its place
+ later. revision changes with every add and remove, so a burst of joins
+ and leaves can be laid out once. Use from one thread.
+ */
+@interface TBSessionRegistry<ObjectType> : NSObject
+
+@property (nonatomic, readonly) NSUInteger count;
+@property (nonatomic, readonly) uint64_t revision;
+/** Every object, in the order they were added. */
+@property (nonatomic, readonly) NSArray<ObjectType> *allObjects;
+
+/** Adds `object` for `uid` after the others.
+
+ @return Its handle; 0 if `uid` already has an object, which is kept.
+ */
+- (TBSessionHandle)addObject:(ObjectType)object forUid:(NSUInteger)uid NS_SWIFT_NAME(add(_:forUid:));
+
+- (nullable ObjectType)objectForUid:(NSUInteger)uid NS_SWIFT_NAME(object(forUid:));
+/** Handle of `uid`; 0 if it has no object. */
+- (TBSessionHandle)handleForUid:(NSUInteger)uid NS_SWIFT_NAME(handle(forUid:));
+/** The object `handle` was given for; nil once its uid was removed. */
+- (nullable ObjectType)objectForHandle:(TBSessionHandle)handle NS_SWIFT_NAME(object(forHandle:));
+
+/** @return The object that was removed, or nil. */
+- (nullable ObjectType)removeObjectForUid:(NSUInteger)uid NS_SWIFT_NAME(removeObject(forUid:));
+- (void)removeAllObjects;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,79 @@
+//
+//  TalkBoard Engine
+//
+
+#import "TBSessionRegistry.h"
+
+#include "SessionRegistry.h"
+
+@implementation TBSessionRegistry
+{
+    talkboard::rtc::SessionRegistry<id>* _registry;
+}
+
+- (instancetype)init
+{
+    if ((self = [super init]))
+        _registry = new talkboard::rtc::SessionRegistry<id>();
+    return self;
+}
+
+- (void)dealloc
+{
+    delete _registry;
+}
+
+- (NSUInteger)count
+{
+    return _registry->size();
+}
+
+- (uint64_t)revision
+{
+    return _registry->revision();
+}
+
+- (NSArray *)allObjects
+{
+    NSMutableArray* objects = [NSMutableArray arrayWithCapacity:_registry->size()];
+    _registry->forEach([objects](agora::rtc::uid_t, id object) {
+        [objects addObject:object];
+    });
+    return objects;
+}
+
+- (TBSessionHandle)addObject:(id)object forUid:(NSUInteger)uid
+{
+    return _registry->insert(static_cast<agora::rtc::uid_t>(uid), object);
+}
+
+- (id)objectForUid:(NSUInteger)uid
+{
+    id* object = _registry->find(static_cast<agora::rtc::uid_t>(uid));
+    return object ? *object : nil;
+}
+
+- (TBSessionHandle)handleForUid:(NSUInteger)uid
+{
+    return _registry->handle(static_cast<agora::rtc::uid_t>(uid));
+}
+
+- (id)objectForHandle:(TBSessionHandle)handle
+{
+    id* object = _registry->get(handle);
+    return object ? *object : nil;
+}
+
+- (id)removeObjectForUid:(NSUInteger)uid
+{
+    id removed = nil;
+    _registry->remove(static_cast<agora::rtc::uid_t>(uid), &removed);
+    return removed;
+}
+
+- (void)removeAllObjects
+{
+    _registry->clear();
+}
+
+@end
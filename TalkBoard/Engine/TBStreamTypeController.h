@@ -0,0 +1,52 @@
+//
+//  TalkBoard Engine
+//
+//  Objective-C face of talkboard::rtc::StreamTypeController for Swift.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import <AgoraRtcEngineKit/AgoraRtcEngineKit.h>
+
+#import "TBParameterTransaction.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Chooses the high stream, the low stream or no video for each remote uid
+ from its tile size, the measured bitrates, network quality and CPU load,
+ within a downlink budget and with hysteresis. Off-screen uids are muted
+ except for a few next to the viewport, and at most 20 videos are decoded
+ at once. Use from one thread.
+ */
+@interface TBStreamTypeController : NSObject
+
+- (instancetype)init;
+- (instancetype)initWithDownlinkBudgetKbps:(NSInteger)budgetKbps NS_DESIGNATED_INITIALIZER;
+
+/** Size in pixels of the tile showing `uid`; CGSizeZero when it is not on screen. */
+- (void)setTileSize:(CGSize)size forUid:(NSUInteger)uid;
+/** Pages or strip widths between the tile of `uid` and the screen (see
+ TBTileChange.viewportDistance); NSNotFound when it has no tile. Muted
+ uids close to the screen are prefetched on the low stream. */
+- (void)setViewportDistance:(NSInteger)distance forUid:(NSUInteger)uid;
+- (void)removeUid:(NSUInteger)uid NS_SWIFT_NAME(removeUid(_:));
+- (void)reset;
+
+- (void)updateRemoteVideoStats:(AgoraRtcRemoteVideoStats *)stats NS_SWIFT_NAME(updateRemoteVideoStats(_:));
+- (void)updateNetworkQuality:(NSUInteger)uid txQuality:(AgoraNetworkQuality)txQuality rxQuality:(AgoraNetworkQuality)rxQuality NS_SWIFT_NAME(updateNetworkQuality(_:txQuality:rxQuality:));
+- (void)updateRtcStats:(AgoraChannelStats *)stats NS_SWIFT_NAME(updateRtcStats(_:));
+
+/** Decides the subscriptions at `time` (seconds, monotonic) and stages the
+ changes in `transaction`.
+
+ @return Number of changes staged; the transaction still has to be committed.
+ */
+- (NSInteger)evaluateAtTime:(NSTimeInterval)time transaction:(TBParameterTransaction *)transaction NS_SWIFT_NAME(evaluate(atTime:transaction:));
+
+/** Expected video downlink of the current plan, and the budget it was made for. */
+@property (nonatomic, readonly) NSInteger plannedKbps;
+@property (nonatomic, readonly) NSInteger budgetKbps;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,105 @@
+//
+//  TalkBoard Engine
+//
+
+#import "TBStreamTypeController.h"
+
+#include <limits.h>
+#include <string.h>
+
+#include "StreamTypeController.h"
+
+@implementation TBStreamTypeController
+{
+    talkboard::rtc::StreamTypeController* _controller;
+}
+
+- (instancetype)init
+{
+    return [self initWithDownlinkBudgetKbps:talkboard::rtc::StreamTypeConfig().downlinkBudgetKbps];
+}
+
+- (instancetype)initWithDownlinkBudgetKbps:(NSInteger)budgetKbps
+{
+    if ((self = [super init])) {
+        talkboard::rtc::StreamTypeConfig config;
+        config.downlinkBudgetKbps = static_cast<int>(budgetKbps);
+        _controller = new talkboard::rtc::StreamTypeController(config);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    delete _controller;
+}
+
+- (void)setTileSize:(CGSize)size forUid:(NSUInteger)uid
+{
+    _controller->setTileSize(static_cast<agora::rtc::uid_t>(uid), static_cast<int>(size.width), static_cast<int>(size.height));
+}
+
+- (void)setViewportDistance:(NSInteger)distance forUid:(NSUInteger)uid
+{
+    _controller->setViewportDistance(static_cast<agora::rtc::uid_t>(uid), distance == NSNotFound || distance > INT_MAX ? INT_MAX : static_cast<int>(distance));
+}
+
+- (void)removeUid:(NSUInteger)uid
+{
+    _controller->removeUid(static_cast<agora::rtc::uid_t>(uid));
+}
+
+- (void)reset
+{
+    _controller->reset();
+}
+
+- (void)updateRemoteVideoStats:(AgoraRtcRemoteVideoStats *)stats
+{
+    agora::rtc::RemoteVideoStats native;
+    memset(&native, 0, sizeof(native));
+    native.uid = static_cast<agora::rtc::uid_t>(stats.uid);
+    native.width = static_cast<int>(stats.width);
+    native.height = static_cast<int>(stats.height);
+    native.receivedBitrate = static_cast<int>(stats.receivedBitrate);
+    native.receivedFrameRate = static_cast<int>(stats.receivedFrameRate);
+    native.rxStreamType = static_cast<agora::rtc::REMOTE_VIDEO_STREAM_TYPE>(stats.rxStreamType);
+    _controller->updateRemoteVideoStats(native);
+}
+
+- (void)updateNetworkQuality:(NSUInteger)uid txQuality:(AgoraNetworkQuality)txQuality rxQuality:(AgoraNetworkQuality)rxQuality
+{
+    _controller->updateNetworkQuality(static_cast<agora::rtc::uid_t>(uid), static_cast<int>(txQuality), static_cast<int>(rxQuality));
+}
+
+- (void)updateRtcStats:(AgoraChannelStats *)stats
+{
+    agora::rtc::RtcStats native;
+    memset(&native, 0, sizeof(native));
+    native.rxVideoKBitRate = static_cast<unsigned short>(stats.rxVideoKBitrate);
+    native.lastmileDelay = static_cast<unsigned short>(stats.lastmileDelay);
+    native.userCount = static_cast<unsigned int>(stats.userCount);
+    native.cpuAppUsage = stats.cpuAppUsage;
+    native.cpuTotalUsage = stats.cpuTotalUsage;
+    _controller->updateRtcStats(native);
+}
+
+- (NSInteger)evaluateAtTime:(NSTimeInterval)time transaction:(TBParameterTransaction *)transaction
+{
+    int changes = _controller->evaluate(static_cast<int64_t>(time * 1000));
+    if (changes > 0)
+        _controller->apply(*transaction.nativeTransaction);
+    return changes;
+}
+
+- (NSInteger)plannedKbps
+{
+    return _controller->plannedKbps();
+}
+
+- (NSInteger)budgetKbps
+{
+    return _controller->budgetKbps();
+}
+
+@end
@@ -0,0 +1,92 @@
+//
+//  TalkBoard Engine
+//
+//  Objective-C face of talkboard::media::TileLayout for Swift.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import <AgoraRtcEngineKit/AgoraRtcEngineKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, TBTileLayoutMode) {
+    /** Every participant in one grid that fills the container. */
+    TBTileLayoutModeGrid = 0,
+    /** The speaker fills the container; the others are thumbnails in a strip over it. */
+    TBTileLayoutModeSpeaker = 1,
+    /** A grid of at most pageSize tiles per page; one page is on screen. */
+    TBTileLayoutModePaged = 2,
+};
+
+typedef NS_OPTIONS(NSUInteger, TBTileChangeFlags) {
+    TBTileChangeAdded = 1 << 0,
+    TBTileChangeRemoved = 1 << 1,
+    TBTileChangeMoved = 1 << 2,
+    TBTileChangeShown = 1 << 3,
+    TBTileChangeHidden = 1 << 4,
+};
+
+/** A tile that differs from the previous layout. */
+@interface TBTileChange : NSObject
+
+@property (nonatomic, readonly) NSUInteger uid;
+@property (nonatomic, readonly) TBTileChangeFlags flags;
+/** In the container's coordinates; the last frame for a removed tile. */
+@property (nonatomic, readonly) CGRect frame;
+/** 0 for grid tiles and the speaker, 1 for strip thumbnails. */
+@property (nonatomic, readonly) NSInteger zOrder;
+/** NO for tiles on other pages or scrolled out of the strip: they need no view. */
+@property (nonatomic, readonly, getter=isVisible) BOOL visible;
+/** Pages or strip widths between the tile and the screen; 0 when it is on screen. */
+@property (nonatomic, readonly) NSInteger viewportDistance;
+
+@end
+
+/** Lays out any number of participants as a grid, a speaker with a strip
+ of thumbnails, or pages of a grid, and reports only the tiles that changed.
+ Use from one thread.
+ */
+@interface TBTileLayout : NSObject
+
+@property (nonatomic) TBTileLayoutMode mode;
+/** Gap between tiles, in points. */
+@property (nonatomic) NSInteger spacing;
+/** Width / height of the video the grid sizes tiles for. */
+@property (nonatomic) CGFloat tileAspect;
+/** Speaker mode: the uid shown full size; the first one if it is not laid out. */
+@property (nonatomic) NSUInteger speakerUid;
+@property (nonatomic) NSInteger stripTileSize;
+@property (nonatomic) NSInteger stripTop;
+/** Speaker mode: how far the strip is scrolled. Clamped by the next layout. */
+@property (nonatomic) NSInteger stripOffset;
+@property (nonatomic) NSInteger pageSize;
+/** Paged mode: the page on screen. Clamped by the next layout. */
+@property (nonatomic) NSInteger page;
+@property (nonatomic, readonly) NSInteger pageCount;
+
+/** Lays out `uids` in order in a container of `size` points.
+
+ @return The tiles that were added, removed, moved, shown or hidden since
+ the previous layout; nil if the size is empty, a parameter is out of
+ range or a uid is listed twice.
+ */
+- (nullable NSArray<TBTileChange *> *)layoutUids:(NSArray<NSNumber *> *)uids inSize:(CGSize)size NS_SWIFT_NAME(layout(uids:in:));
+
+/** Current frame of `uid`; CGRectNull if it is not laid out. */
+- (CGRect)frameForUid:(NSUInteger)uid NS_SWIFT_NAME(frame(forUid:));
+
+/** How far the tile of `uid` is from the screen, see TBTileChange;
+ NSNotFound if it is not laid out. */
+- (NSInteger)viewportDistanceForUid:(NSUInteger)uid NS_SWIFT_NAME(viewportDistance(forUid:));
+
+/** The visible tiles scaled to a CDN canvas of `size` pixels, for
+ AgoraLiveTranscoding.transcodingUsers, so the stream matches the screen. */
+- (NSArray<AgoraLiveTranscodingUser *> *)transcodingUsersForCanvasSize:(CGSize)size NS_SWIFT_NAME(transcodingUsers(canvasSize:));
+
+/** Forgets the previous layout; the next one reports every tile as added. */
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,135 @@
+//
+//  TalkBoard Engine
+//
+
+#import "TBTileLayout.h"
+
+#include <math.h>
+#include <vector>
+
+#include "TileLayout.h"
+
+@interface TBTileChange ()
+- (instancetype)initWithChange:(const talkboard::media::TileChange&)change;
+@end
+
+@implementation TBTileChange
+
+- (instancetype)initWithChange:(const talkboard::media::TileChange&)change
+{
+    if ((self = [super init])) {
+        _uid = change.tile.uid;
+        _flags = static_cast<TBTileChangeFlags>(change.flags);
+        _frame = CGRectMake(change.tile.x, change.tile.y, change.tile.width, change.tile.height);
+        _zOrder = change.tile.zOrder;
+        _visible = change.tile.visible;
+        _viewportDistance = change.tile.viewportDistance;
+    }
+    return self;
+}
+
+@end
+
+@implementation TBTileLayout
+{
+    talkboard::media::TileLayout* _layout;
+    std::vector<agora::rtc::uid_t>* _uids;
+}
+
+- (instancetype)init
+{
+    if ((self = [super init])) {
+        talkboard::media::TileLayoutConfig defaults;
+        _mode = static_cast<TBTileLayoutMode>(defaults.mode);
+        _spacing = defaults.spacing;
+        _tileAspect = defaults.tileAspect;
+        _speakerUid = defaults.speaker;
+        _stripTileSize = defaults.stripTileSize;
+        _stripTop = defaults.stripTop;
+        _stripOffset = defaults.stripOffset;
+        _pageSize = defaults.pageSize;
+        _page = defaults.page;
+        _layout = new talkboard::media::TileLayout();
+        _uids = new std::vector<agora::rtc::uid_t>();
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    delete _layout;
+    delete _uids;
+}
+
+- (NSArray<TBTileChange *> *)layoutUids:(NSArray<NSNumber *> *)uids inSize:(CGSize)size
+{
+    talkboard::media::TileLayoutConfig config;
+    config.mode = static_cast<talkboard::media::TILE_LAYOUT_MODE>(_mode);
+    config.width = static_cast<int>(lround(size.width));
+    config.height = static_cast<int>(lround(size.height));
+    config.spacing = static_cast<int>(_spacing);
+    config.tileAspect = _tileAspect;
+    config.speaker = static_cast<agora::rtc::uid_t>(_speakerUid);
+    config.stripTileSize = static_cast<int>(_stripTileSize);
+    config.stripTop = static_cast<int>(_stripTop);
+    config.stripOffset = static_cast<int>(_stripOffset);
+    config.pageSize = static_cast<int>(_pageSize);
+    config.page = static_cast<int>(_page);
+
+    _uids->clear();
+    for (NSNumber* uid in uids)
+        _uids->push_back(static_cast<agora::rtc::uid_t>(uid.unsignedIntegerValue));
+
+    int count = _layout->update(config, _uids->empty() ? NULL : &(*_uids)[0], _uids->size());
+    if (count < 0)
+        return nil;
+    _page = _layout->page();
+    _stripOffset = _layout->stripOffset();
+
+    const std::vector<talkboard::media::TileChange>& changes = _layout->changes();
+    NSMutableArray<TBTileChange *>* result = [NSMutableArray arrayWithCapacity:changes.size()];
+    for (size_t i = 0; i < changes.size(); ++i)
+        [result addObject:[[TBTileChange alloc] initWithChange:changes[i]]];
+    return result;
+}
+
+- (CGRect)frameForUid:(NSUInteger)uid
+{
+    const talkboard::media::Tile* tile = _layout->find(static_cast<agora::rtc::uid_t>(uid));
+    return tile ? CGRectMake(tile->x, tile->y, tile->width, tile->height) : CGRectNull;
+}
+
+- (NSInteger)viewportDistanceForUid:(NSUInteger)uid
+{
+    const talkboard::media::Tile* tile = _layout->find(static_cast<agora::rtc::uid_t>(uid));
+    return tile ? tile->viewportDistance : NSNotFound;
+}
+
+- (NSInteger)pageCount
+{
+    return _layout->pageCount();
+}
+
+- (NSArray<AgoraLiveTranscodingUser *> *)transcodingUsersForCanvasSize:(CGSize)size
+{
+    std::vector<agora::rtc::TranscodingUser> users;
+    if (_layout->transcodingUsers(static_cast<int>(lround(size.width)), static_cast<int>(lround(size.height)), users) < 0)
+        return @[];
+    NSMutableArray<AgoraLiveTranscodingUser *>* result = [NSMutableArray arrayWithCapacity:users.size()];
+    for (size_t i = 0; i < users.size(); ++i) {
+        AgoraLiveTranscodingUser* user = [[AgoraLiveTranscodingUser alloc] init];
+        user.uid = users[i].uid;
+        user.rect = CGRectMake(users[i].x, users[i].y, users[i].width, users[i].height);
+        user.zOrder = users[i].zOrder;
+        user.alpha = users[i].alpha;
+        [result addObject:user];
+    }
+    return result;
+}
+
+- (void)reset
+{
+    _layout->reset();
+}
+
+@end
@@ -0,0 +1,95 @@
+//
+//  TalkBoard Engine
+//
+
+#include "ThreadPool.h"
+
+namespace talkboard {
+namespace util {
+
+ThreadPool::ThreadPool(int workers)
+    : m_task(NULL)
+    , m_count(0)
+    , m_next(0)
+    , m_pending(0)
+    , m_generation(0)
+    , m_stop(false)
+{
+    if (workers <= 0) {
+        int cores = (int)std::thread::hardware_concurrency();
+        workers = cores > 1 ? cores - 1 : 0;
+    }
+    for (int i = 0; i < workers; ++i)
+        m_workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+        m_workers[i].join();
+}
+
+void ThreadPool::run(int count, const std::function<void(int)>& task)
+{
+    if (count <= 0)
+        return;
+    if (m_workers.empty() || count == 1) {
+        for (int i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_count = count;
+        m_next = 0;
+        m_pending = count;
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending == 0; });
+    m_task = NULL;
+}
+
+void ThreadPool::drain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_task && m_next < m_count) {
+        int index = m_next++;
+        const std::function<void(int)>* task = m_task;
+        lock.unlock();
+        (*task)(index);
+        lock.lock();
+        if (--m_pending == 0)
+            m_done.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, seen] { return m_stop || m_generation != seen; });
+            if (m_stop)
+                return;
+            seen = m_generation;
+        }
+        drain();
+    }
+}
+
+} // namespace util
+} // namespace talkboard
@@ -0,0 +1,62 @@
+//
+//  TalkBoard Engine
+//
+//  Fixed-size worker pool for data-parallel frame work.
+//
+
+#ifndef TALKBOARD_THREAD_POOL_H
+#define TALKBOARD_THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace talkboard {
+namespace util {
+
+/** Runs batches of indexed tasks on a fixed set of threads.
+
+ run() blocks until every task of the batch has finished; the calling thread
+ takes tasks too, so a pool of N workers uses N + 1 cores. Batches from
+ different threads are serialized.
+ */
+class ThreadPool
+{
+public:
+    /** @param workers Number of extra threads. 0 picks hardware_concurrency() - 1. */
+    explicit ThreadPool(int workers = 0);
+    ~ThreadPool();
+
+    /** Calls task(i) for every i in [0, count) and waits for all of them.
+     */
+    void run(int count, const std::function<void(int)>& task);
+
+    /** Number of threads that take part in run(), the caller included. */
+    int concurrency() const { return (int)m_workers.size() + 1; }
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void workerLoop();
+    void drain();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_runMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const std::function<void(int)>* m_task;
+    int m_count;
+    int m_next;
+    int m_pending;
+    unsigned m_generation;
+    bool m_stop;
+};
+
+} // namespace util
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,260 @@
+//
+//  TalkBoard Engine
+//
+
+#include "TileChangeDetector.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TALKBOARD_TILE_HASH_NEON 1
+#endif
+
+namespace talkboard {
+namespace media {
+
+namespace {
+
+// Per 16-byte chunk, eight 16-bit lanes run two bijective steps,
+// a = (a ^ v) * K1 and b = (b + v) * K2. A change confined to one chunk
+// therefore always changes the tile hash; the second lane set makes
+// multi-chunk cancellations vanishingly unlikely.
+const uint16_t kSeedA = 0x2545;
+const uint16_t kSeedB = 0x1f83;
+const uint16_t kMulA = 0x9e37;
+const uint16_t kMulB = 0x85eb;
+
+uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t fold(const uint16_t a[8], const uint16_t b[8])
+{
+    uint64_t words[4];
+    memcpy(&words[0], a, 16);
+    memcpy(&words[2], b, 16);
+    return mix64(words[0] ^ mix64(words[1] ^ mix64(words[2] ^ mix64(words[3]))));
+}
+
+#if defined(__SSE2__)
+
+uint64_t hashTile(const uint8_t* p, int stride, int rowBytes, int rows)
+{
+    __m128i a = _mm_set1_epi16((short)kSeedA);
+    __m128i b = _mm_set1_epi16((short)kSeedB);
+    const __m128i ka = _mm_set1_epi16((short)kMulA);
+    const __m128i kb = _mm_set1_epi16((short)kMulB);
+    int chunks = rowBytes / 16;
+    int tail = rowBytes % 16;
+
+    for (int y = 0; y < rows; ++y, p += stride) {
+        for (int c = 0; c < chunks; ++c) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + c * 16));
+            a = _mm_mullo_epi16(_mm_xor_si128(a, v), ka);
+            b = _mm_mullo_epi16(_mm_add_epi16(b, v), kb);
+        }
+        if (tail) {
+            uint8_t last[16] = { 0 };
+            memcpy(last, p + chunks * 16, tail);
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last));
+            a = _mm_mullo_epi16(_mm_xor_si128(a, v), ka);
+            b = _mm_mullo_epi16(_mm_add_epi16(b, v), kb);
+        }
+    }
+
+    uint16_t la[8];
+    uint16_t lb[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(la), a);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lb), b);
+    return fold(la, lb);
+}
+
+#elif defined(TALKBOARD_TILE_HASH_NEON)
+
+uint64_t hashTile(const uint8_t* p, int stride, int rowBytes, int rows)
+{
+    uint16x8_t a = vdupq_n_u16(kSeedA);
+    uint16x8_t b = vdupq_n_u16(kSeedB);
+    const uint16x8_t ka = vdupq_n_u16(kMulA);
+    const uint16x8_t kb = vdupq_n_u16(kMulB);
+    int chunks = rowBytes / 16;
+    int tail = rowBytes % 16;
+
+    for (int y = 0; y < rows; ++y, p += stride) {
+        for (int c = 0; c < chunks; ++c) {
+            uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(p + c * 16));
+            a = vmulq_u16(veorq_u16(a, v), ka);
+            b = vmulq_u16(vaddq_u16(b, v), kb);
+        }
+        if (tail) {
+            uint8_t last[16] = { 0 };
+            memcpy(last, p + chunks * 16, tail);
+            uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(last));
+            a = vmulq_u16(veorq_u16(a, v), ka);
+            b = vmulq_u16(vaddq_u16(b, v), kb);
+        }
+    }
+
+    uint16_t la[8];
+    uint16_t lb[8];
+    vst1q_u16(la, a);
+    vst1q_u16(lb, b);
+    return fold(la, lb);
+}
+
+#else
+
+uint64_t hashTile(const uint8_t* p, int stride, int rowBytes, int rows)
+{
+    uint16_t a[8];
+    uint16_t b[8];
+    for (int i = 0; i < 8; ++i) {
+        a[i] = kSeedA;
+        b[i] = kSeedB;
+    }
+
+    for (int y = 0; y < rows; ++y, p += stride) {
+        for (int c = 0; c < rowBytes; c += 16) {
+            uint8_t chunk[16] = { 0 };
+            memcpy(chunk, p + c, rowBytes - c < 16 ? rowBytes - c : 16);
+            for (int i = 0; i < 8; ++i) {
+                uint16_t v = (uint16_t)(chunk[2 * i] | (chunk[2 * i + 1] << 8));
+                a[i] = (uint16_t)((a[i] ^ v) * kMulA);
+                b[i] = (uint16_t)((uint16_t)(b[i] + v) * kMulB);
+            }
+        }
+    }
+    return fold(a, b);
+}
+
+#endif
+
+} // namespace
+
+TileChangeDetector::TileChangeDetector(int tileSize)
+    : m_tileSize(tileSize > 0 ? tileSize : 16)
+    , m_width(0)
+    , m_height(0)
+    , m_bytesPerPixel(0)
+    , m_columns(0)
+    , m_rows(0)
+    , m_frames(0)
+    , m_staticFrames(0)
+{
+}
+
+void TileChangeDetector::reset()
+{
+    m_width = 0;
+    m_height = 0;
+    m_hashes.clear();
+}
+
+int TileChangeDetector::detect(const uint8_t* pixels, int stride, int width, int height, int bytesPerPixel,
+                               std::vector<agora::rtc::Rect>& dirty)
+{
+    dirty.clear();
+    m_bounds = agora::rtc::Rect();
+    if (!pixels || width <= 0 || height <= 0 || bytesPerPixel <= 0 || stride < width * bytesPerPixel)
+        return -1;
+
+    bool fresh = width != m_width || height != m_height || bytesPerPixel != m_bytesPerPixel || m_hashes.empty();
+    if (fresh) {
+        m_width = width;
+        m_height = height;
+        m_bytesPerPixel = bytesPerPixel;
+        m_columns = (width + m_tileSize - 1) / m_tileSize;
+        m_rows = (height + m_tileSize - 1) / m_tileSize;
+        m_hashes.assign((size_t)m_columns * m_rows, 0);
+    }
+    m_changed.assign((size_t)m_columns * m_rows, 0);
+
+    int changed = 0;
+    for (int ty = 0; ty < m_rows; ++ty) {
+        int y = ty * m_tileSize;
+        int rows = height - y < m_tileSize ? height - y : m_tileSize;
+        for (int tx = 0; tx < m_columns; ++tx) {
+            int x = tx * m_tileSize;
+            int columns = width - x < m_tileSize ? width - x : m_tileSize;
+            uint64_t hash = hashTile(pixels + (size_t)y * stride + (size_t)x * bytesPerPixel, stride,
+                                     columns * bytesPerPixel, rows);
+            size_t index = (size_t)ty * m_columns + tx;
+            if (fresh || hash != m_hashes[index]) {
+                m_hashes[index] = hash;
+                m_changed[index] = 1;
+                ++changed;
+            }
+        }
+    }
+
+    ++m_frames;
+    if (changed == 0)
+        ++m_staticFrames;
+    else
+        mergeTiles(dirty);
+    return changed;
+}
+
+void TileChangeDetector::mergeTiles(std::vector<agora::rtc::Rect>& dirty)
+{
+    // Horizontal runs of changed tiles, extended downwards while the next tile
+    // row has a run with exactly the same span.
+    std::vector<agora::rtc::Rect> open;
+    std::vector<agora::rtc::Rect> next;
+
+    for (int ty = 0; ty <= m_rows; ++ty) {
+        next.clear();
+        int tx = 0;
+        while (ty < m_rows && tx < m_columns) {
+            if (!m_changed[(size_t)ty * m_columns + tx]) {
+                ++tx;
+                continue;
+            }
+            int begin = tx;
+            while (tx < m_columns && m_changed[(size_t)ty * m_columns + tx])
+                ++tx;
+
+            int left = begin * m_tileSize;
+            int right = tx * m_tileSize < m_width ? tx * m_tileSize : m_width;
+            int top = ty * m_tileSize;
+            int bottom = top + m_tileSize < m_height ? top + m_tileSize : m_height;
+
+            bool extended = false;
+            for (size_t i = 0; i < open.size(); ++i) {
+                if (open[i].left == left && open[i].right == right) {
+                    open[i].bottom = bottom;
+                    next.push_back(open[i]);
+                    open[i] = open.back();
+                    open.pop_back();
+                    extended = true;
+                    break;
+                }
+            }
+            if (!extended)
+                next.push_back(agora::rtc::Rect(top, left, bottom, right));
+        }
+        dirty.insert(dirty.end(), open.begin(), open.end());
+        open.swap(next);
+    }
+
+    m_bounds = dirty.front();
+    for (size_t i = 1; i < dirty.size(); ++i) {
+        const agora::rtc::Rect& r = dirty[i];
+        if (r.top < m_bounds.top) m_bounds.top = r.top;
+        if (r.left < m_bounds.left) m_bounds.left = r.left;
+        if (r.bottom > m_bounds.bottom) m_bounds.bottom = r.bottom;
+        if (r.right > m_bounds.right) m_bounds.right = r.right;
+    }
+}
+
+} // namespace media
+} // namespace talkboard
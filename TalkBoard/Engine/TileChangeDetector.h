@@ -0,0 +1,79 @@
+//
+//  TalkBoard Engine
+//
+//  Finds the tiles of a shared board/screen frame that changed since the last frame.
+//
+
+#ifndef TALKBOARD_TILE_CHANGE_DETECTOR_H
+#define TALKBOARD_TILE_CHANGE_DETECTOR_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+namespace talkboard {
+namespace media {
+
+/** Hashes fixed-size tiles of consecutive frames and reports the changed ones.
+
+ Each tile is reduced to a 64-bit hash with a vectorized multiply/xor hash
+ (SSE2 or NEON, with a scalar build of the same function), and only the
+ hashes of the previous frame are kept. Changed tiles are merged into
+ rectangles that can drive IRtcEngine::updateScreenCaptureRegion, and a frame
+ with no changed tile does not need to be pushed at all.
+ */
+class TileChangeDetector
+{
+public:
+    /** @param tileSize Tile edge in pixels, typically 16 or 64. */
+    explicit TileChangeDetector(int tileSize = 16);
+
+    /** Compares a frame with the previous one.
+
+     The first frame, and any frame after a size change or reset(), reports
+     the whole frame as changed.
+
+     @param pixels First byte of the frame (a luma plane or a packed RGB plane).
+     @param stride Bytes between two rows.
+     @param width Width in pixels.
+     @param height Height in pixels.
+     @param bytesPerPixel 1 for a luma plane, 4 for BGRA/RGBA.
+     @param dirty Receives the changed regions in pixels; cleared first.
+     @return Number of changed tiles, or < 0 on invalid arguments.
+     */
+    int detect(const uint8_t* pixels, int stride, int width, int height, int bytesPerPixel,
+               std::vector<agora::rtc::Rect>& dirty);
+
+    /** Smallest rectangle covering every region of the last detect(). Empty if nothing changed. */
+    agora::rtc::Rect boundingRect() const { return m_bounds; }
+
+    /** Forgets the previous frame. */
+    void reset();
+
+    int tileSize() const { return m_tileSize; }
+    /** Frames passed to detect(). */
+    uint64_t frames() const { return m_frames; }
+    /** Frames in which no tile changed. */
+    uint64_t staticFrames() const { return m_staticFrames; }
+
+private:
+    void mergeTiles(std::vector<agora::rtc::Rect>& dirty);
+
+    int m_tileSize;
+    int m_width;
+    int m_height;
+    int m_bytesPerPixel;
+    int m_columns;
+    int m_rows;
+    std::vector<uint64_t> m_hashes;
+    std::vector<uint8_t> m_changed;
+    agora::rtc::Rect m_bounds;
+    uint64_t m_frames;
+    uint64_t m_staticFrames;
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,353 @@
+//
+//  TalkBoard Engine
+//
+
+#include "TileLayout.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+
+namespace talkboard {
+namespace media {
+
+namespace {
+
+/** zOrder of strip thumbnails, above the speaker. */
+const int kStripZOrder = 1;
+
+struct Grid
+{
+    int columns;
+    int rows;
+};
+
+/** Start of cell `index` of `count` cells splitting `length` with `spacing`
+ between them. Cell i spans [edge(i), edge(i + 1) - spacing): the remainder
+ pixels are spread over the cells instead of piling up in the last one.
+ */
+int edge(int index, int count, int length, int spacing)
+{
+    int64_t available = (int64_t)length - (int64_t)(count - 1) * spacing;
+    return (int)(available * index / count) + index * spacing;
+}
+
+/** The column count that shows a video of aspect `aspect` biggest in
+ `cells` tiles. Wider grids only get narrower, so the search stops at the
+ first column count without any width left.
+ */
+Grid chooseGrid(int cells, int width, int height, int spacing, double aspect)
+{
+    Grid best = { 1, std::max(cells, 1) };
+    double bestArea = -1;
+    for (int columns = 1; columns <= cells; ++columns) {
+        int rows = (cells + columns - 1) / columns;
+        double w = (double)(width - (columns - 1) * spacing) / columns;
+        double h = (double)(height - (rows - 1) * spacing) / rows;
+        if (w <= 0)
+            break;
+        if (h <= 0)
+            continue;
+        double area = w / h > aspect ? h * h * aspect : w * w / aspect;
+        if (area > bestArea) {
+            bestArea = area;
+            best.columns = columns;
+            best.rows = rows;
+        }
+    }
+    if (bestArea < 0 && cells > 0) {
+        // Too dense for any tile to have area; keep a square-ish grid of empty tiles.
+        best.columns = (int)ceil(sqrt((double)cells));
+        best.rows = (cells + best.columns - 1) / best.columns;
+    }
+    return best;
+}
+
+bool sameRect(const Tile& a, const Tile& b)
+{
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height && a.zOrder == b.zOrder;
+}
+
+} // namespace
+
+TileLayout::TileLayout()
+    : m_pageCount(1)
+    , m_page(0)
+    , m_stripOffset(0)
+{
+}
+
+int TileLayout::update(const TileLayoutConfig& config, const agora::rtc::uid_t* uids, size_t count)
+{
+    if (config.width <= 0 || config.height <= 0 || config.spacing < 0 || !(config.tileAspect > 0)
+        || config.pageSize < 1 || config.stripTileSize < 1 || (count && !uids))
+        return -agora::ERR_INVALID_ARGUMENT;
+    if (config.mode != TILE_LAYOUT_GRID && config.mode != TILE_LAYOUT_SPEAKER && config.mode != TILE_LAYOUT_PAGED)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    // The common relayout (resize, speaker or page change) keeps the uid
+    // list; tiles then pair up by position and the index stays valid.
+    bool sameUids = count == m_tiles.size();
+    for (size_t i = 0; sameUids && i < count; ++i)
+        sameUids = m_tiles[i].uid == uids[i];
+    if (!sameUids) {
+        m_nextIndex.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (!m_nextIndex.insert(std::make_pair(uids[i], i)).second)
+                return -agora::ERR_INVALID_ARGUMENT;
+        }
+    }
+
+    m_config = config;
+    m_pageCount = 1;
+    m_page = 0;
+    m_stripOffset = 0;
+    m_next.clear();
+    switch (config.mode) {
+    case TILE_LAYOUT_SPEAKER:
+        layoutSpeaker(uids, count);
+        break;
+    case TILE_LAYOUT_PAGED:
+        layoutPaged(uids, count);
+        break;
+    default: {
+        Grid grid = chooseGrid((int)count, config.width, config.height, config.spacing, config.tileAspect);
+        layoutGrid(uids, count, grid.columns, grid.rows, 0, 0);
+        break;
+    }
+    }
+
+    m_changes.clear();
+    if (sameUids) {
+        for (size_t i = 0; i < count; ++i)
+            diff(m_tiles[i], m_next[i]);
+    } else {
+        m_matched.assign(m_tiles.size(), false);
+        for (size_t i = 0; i < m_next.size(); ++i) {
+            std::unordered_map<agora::rtc::uid_t, size_t>::const_iterator it = m_index.find(m_next[i].uid);
+            if (it == m_index.end()) {
+                TileChange change = { TILE_ADDED | (m_next[i].visible ? TILE_SHOWN : 0), m_next[i] };
+                m_changes.push_back(change);
+            } else {
+                m_matched[it->second] = true;
+                diff(m_tiles[it->second], m_next[i]);
+            }
+        }
+        for (size_t i = 0; i < m_tiles.size(); ++i) {
+            if (!m_matched[i]) {
+                TileChange change = { TILE_REMOVED, m_tiles[i] };
+                m_changes.push_back(change);
+            }
+        }
+        m_index.swap(m_nextIndex);
+    }
+    m_tiles.swap(m_next);
+    return (int)m_changes.size();
+}
+
+const Tile* TileLayout::find(agora::rtc::uid_t uid) const
+{
+    std::unordered_map<agora::rtc::uid_t, size_t>::const_iterator it = m_index.find(uid);
+    return it != m_index.end() ? &m_tiles[it->second] : NULL;
+}
+
+int TileLayout::regions(std::vector<agora::rtc::VideoCompositingLayout::Region>& regions) const
+{
+    regions.clear();
+    for (size_t i = 0; i < m_tiles.size(); ++i) {
+        const Tile& tile = m_tiles[i];
+        int x, y, width, height;
+        if (!tile.visible || !clip(tile, x, y, width, height))
+            continue;
+        agora::rtc::VideoCompositingLayout::Region region;
+        region.uid = tile.uid;
+        region.x = (double)x / m_config.width;
+        region.y = (double)y / m_config.height;
+        region.width = (double)width / m_config.width;
+        region.height = (double)height / m_config.height;
+        region.zOrder = tile.zOrder;
+        regions.push_back(region);
+    }
+    return (int)regions.size();
+}
+
+int TileLayout::transcodingUsers(int canvasWidth, int canvasHeight, std::vector<agora::rtc::TranscodingUser>& users) const
+{
+    if (canvasWidth <= 0 || canvasHeight <= 0)
+        return -agora::ERR_INVALID_ARGUMENT;
+    users.clear();
+    for (size_t i = 0; i < m_tiles.size(); ++i) {
+        const Tile& tile = m_tiles[i];
+        int x, y, width, height;
+        if (!tile.visible || !clip(tile, x, y, width, height))
+            continue;
+        // Scale the edges, not the sizes, so tiles that touch on screen touch on the canvas.
+        int left = (int)((int64_t)x * canvasWidth / m_config.width);
+        int top = (int)((int64_t)y * canvasHeight / m_config.height);
+        int right = (int)((int64_t)(x + width) * canvasWidth / m_config.width);
+        int bottom = (int)((int64_t)(y + height) * canvasHeight / m_config.height);
+        if (right <= left || bottom <= top)
+            continue;
+        agora::rtc::TranscodingUser user;
+        user.uid = tile.uid;
+        user.x = left;
+        user.y = top;
+        user.width = right - left;
+        user.height = bottom - top;
+        user.zOrder = tile.zOrder;
+        users.push_back(user);
+    }
+    return (int)users.size();
+}
+
+void TileLayout::reset()
+{
+    m_tiles.clear();
+    m_changes.clear();
+    m_index.clear();
+    m_pageCount = 1;
+    m_page = 0;
+    m_stripOffset = 0;
+}
+
+void TileLayout::layoutGrid(const agora::rtc::uid_t* uids, size_t count, int columns, int gridRows, int originX, int viewportDistance)
+{
+    if (!count)
+        return;
+    const int width = m_config.width;
+    const int height = m_config.height;
+    const int spacing = m_config.spacing;
+    const int n = (int)count;
+    const int rows = (n + columns - 1) / columns;
+    const int lastRowCount = n - (rows - 1) * columns;
+
+    // Cell edges once per grid rather than per tile; they are the only divisions.
+    m_columnEdges.resize(columns + 1);
+    for (int c = 0; c <= columns; ++c)
+        m_columnEdges[c] = edge(c, columns, width, spacing);
+    m_rowEdges.resize(gridRows + 1);
+    for (int r = 0; r <= gridRows; ++r)
+        m_rowEdges[r] = edge(r, gridRows, height, spacing);
+
+    // A short last row, or a short last page, is centered rather than left in a corner.
+    const int top = (height - (m_rowEdges[rows] - spacing)) / 2;
+    const int lastRowLeft = (width - (m_columnEdges[lastRowCount] - spacing)) / 2;
+
+    size_t first = m_next.size();
+    m_next.resize(first + count);
+    Tile* tile = &m_next[0] + first;
+    for (int i = 0, row = 0, column = 0; i < n; ++i, ++tile) {
+        tile->uid = uids[i];
+        tile->x = originX + (row == rows - 1 ? lastRowLeft : 0) + m_columnEdges[column];
+        tile->y = top + m_rowEdges[row];
+        tile->width = std::max(0, m_columnEdges[column + 1] - spacing - m_columnEdges[column]);
+        tile->height = std::max(0, m_rowEdges[row + 1] - spacing - m_rowEdges[row]);
+        tile->zOrder = 0;
+        tile->visible = viewportDistance == 0 && tile->width > 0 && tile->height > 0;
+        tile->viewportDistance = viewportDistance;
+        if (++column == columns) {
+            column = 0;
+            ++row;
+        }
+    }
+}
+
+void TileLayout::layoutSpeaker(const agora::rtc::uid_t* uids, size_t count)
+{
+    if (!count)
+        return;
+    size_t speaker = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (uids[i] == m_config.speaker) {
+            speaker = i;
+            break;
+        }
+    }
+
+    const int size = m_config.stripTileSize;
+    const int spacing = m_config.spacing;
+    const int64_t stripLength = spacing + (int64_t)(count - 1) * (size + spacing);
+    const int64_t maxOffset = std::max<int64_t>(0, stripLength - m_config.width);
+    m_stripOffset = (int)std::min<int64_t>(std::max(0, m_config.stripOffset), maxOffset);
+
+    int thumbnail = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Tile tile;
+        tile.uid = uids[i];
+        if (i == speaker) {
+            tile.x = 0;
+            tile.y = 0;
+            tile.width = m_config.width;
+            tile.height = m_config.height;
+            tile.zOrder = 0;
+            tile.visible = true;
+            tile.viewportDistance = 0;
+        } else {
+            // Thumbnails scrolled out of the strip are laid out but not visible.
+            tile.x = spacing + thumbnail++ * (size + spacing) - m_stripOffset;
+            tile.y = m_config.stripTop;
+            tile.width = size;
+            tile.height = size;
+            tile.zOrder = kStripZOrder;
+            tile.visible = tile.x < m_config.width && tile.x + size > 0
+                && tile.y < m_config.height && tile.y + size > 0;
+            if (tile.x >= m_config.width)
+                tile.viewportDistance = 1 + (tile.x - m_config.width) / m_config.width;
+            else if (tile.x + size <= 0)
+                tile.viewportDistance = 1 - (tile.x + size) / m_config.width;
+            else
+                tile.viewportDistance = 0;
+        }
+        m_next.push_back(tile);
+    }
+}
+
+void TileLayout::layoutPaged(const agora::rtc::uid_t* uids, size_t count)
+{
+    const size_t pageSize = (size_t)m_config.pageSize;
+    m_pageCount = std::max(1, (int)((count + pageSize - 1) / pageSize));
+    m_page = std::min(std::max(0, m_config.page), m_pageCount - 1);
+
+    // Every page uses the geometry of a full page, so tiles keep their size when paging.
+    int cells = (int)std::min(count, pageSize);
+    Grid grid = chooseGrid(cells, m_config.width, m_config.height, m_config.spacing, m_config.tileAspect);
+    for (int page = 0; page < m_pageCount; ++page) {
+        size_t begin = page * pageSize;
+        if (begin >= count)
+            break;
+        int originX = (page - m_page) * (m_config.width + m_config.spacing);
+        layoutGrid(uids + begin, std::min(pageSize, count - begin), grid.columns, grid.rows, originX, abs(page - m_page));
+    }
+}
+
+void TileLayout::diff(const Tile& previous, const Tile& next)
+{
+    int flags = 0;
+    if (!sameRect(previous, next))
+        flags |= TILE_MOVED;
+    if (previous.visible != next.visible)
+        flags |= next.visible ? TILE_SHOWN : TILE_HIDDEN;
+    if (flags) {
+        TileChange change = { flags, next };
+        m_changes.push_back(change);
+    }
+}
+
+bool TileLayout::clip(const Tile& tile, int& x, int& y, int& width, int& height) const
+{
+    int left = std::max(tile.x, 0);
+    int top = std::max(tile.y, 0);
+    int right = std::min(tile.x + tile.width, m_config.width);
+    int bottom = std::min(tile.y + tile.height, m_config.height);
+    if (right <= left || bottom <= top)
+        return false;
+    x = left;
+    y = top;
+    width = right - left;
+    height = bottom - top;
+    return true;
+}
+
+} // namespace media
+} // namespace talkboard
@@ -0,0 +1,197 @@
+//
+//  TalkBoard Engine
+//
+//  Tile rects for any number of participants: grid, speaker + strip, and paged layouts.
+//
+
+#ifndef TALKBOARD_TILE_LAYOUT_H
+#define TALKBOARD_TILE_LAYOUT_H
+
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+namespace talkboard {
+namespace media {
+
+enum TILE_LAYOUT_MODE
+{
+    /** Every participant in one grid that fills the container. */
+    TILE_LAYOUT_GRID = 0,
+    /** The speaker fills the container; the others are thumbnails in a strip over it. */
+    TILE_LAYOUT_SPEAKER = 1,
+    /** A grid of at most pageSize tiles per page; one page is on screen. */
+    TILE_LAYOUT_PAGED = 2,
+};
+
+/** Container and layout parameters. All lengths are in one unit chosen by
+ the caller: points for views, pixels for a transcoding canvas.
+ */
+struct TileLayoutConfig
+{
+    TILE_LAYOUT_MODE mode;
+    int width;
+    int height;
+    /** Gap between neighbouring tiles. */
+    int spacing;
+    /** Width / height of the video the grid sizes tiles for; the column count
+     is the one that shows such a video biggest. */
+    double tileAspect;
+    /** Speaker mode: uid of the full tile. The first uid if it is not in the list. */
+    agora::rtc::uid_t speaker;
+    /** Speaker mode: side of the square thumbnails and their distance from the top. */
+    int stripTileSize;
+    int stripTop;
+    /** Speaker mode: how far the strip is scrolled; clamped to its length. */
+    int stripOffset;
+    /** Paged mode: tiles per page, and the page on screen (clamped). */
+    int pageSize;
+    int page;
+
+    TileLayoutConfig()
+        : mode(TILE_LAYOUT_GRID)
+        , width(0)
+        , height(0)
+        , spacing(1)
+        , tileAspect(1.0)
+        , speaker(0)
+        , stripTileSize(100)
+        , stripTop(65)
+        , stripOffset(0)
+        , pageSize(9)
+        , page(0)
+    {}
+};
+
+/** Where a participant is drawn, relative to the container's top left corner.
+
+ Tiles that are laid out but not on screen (other pages, thumbnails
+ scrolled out of the strip, or grids too dense to give a tile any area)
+ keep their would-be position and have `visible` cleared; they need no view
+ and no video.
+ */
+struct Tile
+{
+    agora::rtc::uid_t uid;
+    int x;
+    int y;
+    int width;
+    int height;
+    /** 0 for grid tiles and the speaker, 1 for strip thumbnails. */
+    int zOrder;
+    bool visible;
+    /** Pages (paged mode) or strip widths (speaker mode) between the tile and
+     the screen; 0 when it is on screen. Lets subscriptions prefetch the
+     neighbours of the viewport. */
+    int viewportDistance;
+};
+
+enum TILE_CHANGE_FLAGS
+{
+    TILE_ADDED = 1 << 0,
+    TILE_REMOVED = 1 << 1,
+    /** Rect or zOrder differs from the previous layout. */
+    TILE_MOVED = 1 << 2,
+    TILE_SHOWN = 1 << 3,
+    TILE_HIDDEN = 1 << 4,
+};
+
+/** A tile that differs from the previous TileLayout::update(). */
+struct TileChange
+{
+    /** TILE_CHANGE_FLAGS. */
+    int flags;
+    /** The new tile; the last one for TILE_REMOVED. */
+    Tile tile;
+};
+
+/** Lays out tiles for a list of uids and reports only those that changed.
+
+ Every update is O(N): the grid tries each column count once, and the
+ previous layout is matched by position when the uid list is unchanged and
+ through a uid index otherwise. A view layer applies changes() instead of
+ rebuilding every view, so a relayout that moves nothing touches nothing.
+
+ regions() and transcodingUsers() turn the same tiles into
+ VideoCompositingLayout regions and LiveTranscoding users, so the CDN
+ stream is composed like the screen.
+
+ Not thread-safe; use from one thread.
+ */
+class TileLayout
+{
+public:
+    TileLayout();
+
+    /** Lays out `uids` in order and diffs the result against the previous layout.
+
+     @return
+
+     - >= 0: Number of changes, available from changes() until the next call.
+     - < 0: -ERR_INVALID_ARGUMENT for an empty container, a negative
+     spacing, tileAspect or pageSize below the minimum, or a uid listed
+     twice. The previous layout is kept.
+     */
+    int update(const TileLayoutConfig& config, const agora::rtc::uid_t* uids, size_t count);
+
+    const std::vector<Tile>& tiles() const { return m_tiles; }
+    const std::vector<TileChange>& changes() const { return m_changes; }
+    /** The tile of `uid`, or NULL. */
+    const Tile* find(agora::rtc::uid_t uid) const;
+
+    /** Paged mode: number of pages; 1 otherwise. */
+    int pageCount() const { return m_pageCount; }
+    /** Page and strip offset after clamping. */
+    int page() const { return m_page; }
+    int stripOffset() const { return m_stripOffset; }
+
+    /** Visible tiles, clipped to the container, as fractions of it.
+
+     @return Number of regions.
+     */
+    int regions(std::vector<agora::rtc::VideoCompositingLayout::Region>& regions) const;
+
+    /** Visible tiles, clipped to the container, scaled to a canvas of
+     `canvasWidth` x `canvasHeight` pixels.
+
+     @return Number of users, or -ERR_INVALID_ARGUMENT for an empty canvas.
+     */
+    int transcodingUsers(int canvasWidth, int canvasHeight, std::vector<agora::rtc::TranscodingUser>& users) const;
+
+    /** Forgets the previous layout; the next update() reports every tile as added. */
+    void reset();
+
+private:
+    TileLayout(const TileLayout&);
+    TileLayout& operator=(const TileLayout&);
+
+    /** Places `count` tiles in a `columns` x `rows` grid shifted right by
+     `originX`, `viewportDistance` pages away from the screen. */
+    void layoutGrid(const agora::rtc::uid_t* uids, size_t count, int columns, int rows, int originX, int viewportDistance);
+    void layoutSpeaker(const agora::rtc::uid_t* uids, size_t count);
+    void layoutPaged(const agora::rtc::uid_t* uids, size_t count);
+    void diff(const Tile& previous, const Tile& next);
+    /** Visible part of `tile` inside the container; false if none. */
+    bool clip(const Tile& tile, int& x, int& y, int& width, int& height) const;
+
+    TileLayoutConfig m_config;
+    std::vector<Tile> m_tiles;
+    std::vector<Tile> m_next;
+    std::vector<TileChange> m_changes;
+    /** uid to index in m_tiles; rebuilt only when the uid list changes. */
+    std::unordered_map<agora::rtc::uid_t, size_t> m_index;
+    std::unordered_map<agora::rtc::uid_t, size_t> m_nextIndex;
+    std::vector<bool> m_matched;
+    std::vector<int> m_columnEdges;
+    std::vector<int> m_rowEdges;
+    int m_pageCount;
+    int m_page;
+    int m_stripOffset;
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,347 @@
+//
+//  TalkBoard Engine
+//
+
+#include "VideoCompositor.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+namespace talkboard {
+namespace media {
+
+namespace {
+
+const int kBandRows = 16;
+
+bool byZOrder(const CompositorRegion& a, const CompositorRegion& b)
+{
+    return a.zOrder < b.zOrder;
+}
+
+int clampInt(int value, int low, int high)
+{
+    return value < low ? low : (value > high ? high : value);
+}
+
+uint8_t clampByte(int value)
+{
+    return (uint8_t)clampInt(value, 0, 255);
+}
+
+void rgbToYuv(uint32_t rgb, uint8_t yuv[3])
+{
+    int r = (rgb >> 16) & 0xff;
+    int g = (rgb >> 8) & 0xff;
+    int b = rgb & 0xff;
+    // BT.601, limited range.
+    yuv[0] = clampByte(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    yuv[1] = clampByte(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    yuv[2] = clampByte(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+/** Source column and 8-bit weight for every destination column of a region. */
+void buildColumnMap(int srcWidth, int dstWidth, std::vector<int>& index, std::vector<int>& weight)
+{
+    index.resize(dstWidth);
+    weight.resize(dstWidth);
+    int64_t step = ((int64_t)srcWidth << 16) / dstWidth;
+    int64_t pos = step / 2 - 32768;
+    for (int x = 0; x < dstWidth; ++x, pos += step) {
+        if (pos <= 0) {
+            index[x] = 0;
+            weight[x] = 0;
+        } else {
+            int i = (int)(pos >> 16);
+            index[x] = i < srcWidth - 1 ? i : srcWidth - 1;
+            weight[x] = i < srcWidth - 1 ? (int)((pos >> 8) & 0xff) : 0;
+        }
+    }
+}
+
+/** Bilinearly scales rows [rowBegin, rowEnd) of a region and blends them into the canvas plane. */
+void blendPlane(uint8_t* dst, int dstStride, int regionX, int regionY, int regionHeight, int rowBegin, int rowEnd,
+                const uint8_t* src, int srcWidth, int srcHeight,
+                const std::vector<int>& xIndex, const std::vector<int>& xWeight, int alpha)
+{
+    int regionWidth = (int)xIndex.size();
+    int64_t step = ((int64_t)srcHeight << 16) / regionHeight;
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        int64_t pos = (y - regionY) * step + step / 2 - 32768;
+        int y0 = 0;
+        int wy = 0;
+        if (pos > 0) {
+            y0 = (int)(pos >> 16);
+            wy = (int)((pos >> 8) & 0xff);
+            if (y0 >= srcHeight - 1) {
+                y0 = srcHeight - 1;
+                wy = 0;
+            }
+        }
+        const uint8_t* row0 = src + (size_t)y0 * srcWidth;
+        const uint8_t* row1 = wy ? row0 + srcWidth : row0;
+        uint8_t* out = dst + (size_t)y * dstStride + regionX;
+
+        for (int x = 0; x < regionWidth; ++x) {
+            int i = xIndex[x];
+            int wx = xWeight[x];
+            int j = wx ? i + 1 : i;
+            int top = row0[i] * (256 - wx) + row0[j] * wx;
+            int bottom = row1[i] * (256 - wx) + row1[j] * wx;
+            int value = (top * (256 - wy) + bottom * wy + 32768) >> 16;
+            if (alpha < 256)
+                value = (value * alpha + out[x] * (256 - alpha) + 128) >> 8;
+            out[x] = (uint8_t)value;
+        }
+    }
+}
+
+void copyPlane(std::vector<uint8_t>& dst, const void* src, int srcStride, int width, int height)
+{
+    dst.resize((size_t)width * height);
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    for (int y = 0; y < height; ++y)
+        memcpy(&dst[(size_t)y * width], in + (size_t)y * srcStride, width);
+}
+
+} // namespace
+
+VideoCompositor::VideoCompositor(util::ThreadPool* pool)
+    : m_pool(pool)
+    , m_canvasWidth(0)
+    , m_canvasHeight(0)
+{
+    rgbToYuv(0, m_background);
+}
+
+VideoCompositor::~VideoCompositor()
+{
+    for (size_t i = 0; i < m_sources.size(); ++i)
+        delete m_sources[i];
+}
+
+int VideoCompositor::setLayout(const agora::rtc::VideoCompositingLayout& layout, int canvasWidth, int canvasHeight)
+{
+    if (canvasWidth <= 0 || canvasHeight <= 0 || layout.regionCount < 0 || (layout.regionCount && !layout.regions))
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    std::vector<CompositorRegion> regions;
+    for (int i = 0; i < layout.regionCount; ++i) {
+        const agora::rtc::VideoCompositingLayout::Region& in = layout.regions[i];
+        CompositorRegion region;
+        region.uid = in.uid;
+        region.x = (int)(in.x * canvasWidth + 0.5);
+        region.y = (int)(in.y * canvasHeight + 0.5);
+        region.width = (int)(in.width * canvasWidth + 0.5);
+        region.height = (int)(in.height * canvasHeight + 0.5);
+        region.zOrder = in.zOrder;
+        region.alpha = in.alpha;
+        regions.push_back(region);
+    }
+
+    uint32_t rgb = 0;
+    if (layout.backgroundColor) {
+        const char* hex = layout.backgroundColor;
+        if (*hex == '#')
+            ++hex;
+        rgb = (uint32_t)strtoul(hex, NULL, 16);
+    }
+    setRegions(regions, canvasWidth, canvasHeight, rgb);
+    return 0;
+}
+
+int VideoCompositor::setLayout(const agora::rtc::LiveTranscoding& transcoding)
+{
+    if (transcoding.width <= 0 || transcoding.height <= 0 || (transcoding.userCount && !transcoding.transcodingUsers))
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    std::vector<CompositorRegion> regions;
+    for (unsigned int i = 0; i < transcoding.userCount; ++i) {
+        const agora::rtc::TranscodingUser& user = transcoding.transcodingUsers[i];
+        CompositorRegion region;
+        region.uid = user.uid;
+        region.x = user.x;
+        region.y = user.y;
+        region.width = user.width;
+        region.height = user.height;
+        region.zOrder = user.zOrder;
+        region.alpha = user.alpha;
+        regions.push_back(region);
+    }
+    setRegions(regions, transcoding.width, transcoding.height, transcoding.backgroundColor & 0xffffff);
+    return 0;
+}
+
+void VideoCompositor::setRegions(std::vector<CompositorRegion>& regions, int width, int height, uint32_t rgb)
+{
+    // Snap to even coordinates so every luma region maps onto whole chroma samples.
+    for (size_t i = 0; i < regions.size(); ++i) {
+        CompositorRegion& r = regions[i];
+        int left = clampInt(r.x, 0, width) & ~1;
+        int top = clampInt(r.y, 0, height) & ~1;
+        int right = clampInt(r.x + r.width, 0, width) & ~1;
+        int bottom = clampInt(r.y + r.height, 0, height) & ~1;
+        r.x = left;
+        r.y = top;
+        r.width = right - left;
+        r.height = bottom - top;
+        r.alpha = r.alpha < 0 ? 0 : (r.alpha > 1 ? 1 : r.alpha);
+    }
+    std::stable_sort(regions.begin(), regions.end(), byZOrder);
+
+    std::lock_guard<std::mutex> lock(m_layoutMutex);
+    m_regions.swap(regions);
+    m_canvasWidth = width;
+    m_canvasHeight = height;
+    rgbToYuv(rgb, m_background);
+}
+
+VideoCompositor::Source* VideoCompositor::findSource(agora::rtc::uid_t uid)
+{
+    for (size_t i = 0; i < m_sources.size(); ++i) {
+        if (m_sources[i]->uid == uid)
+            return m_sources[i];
+    }
+    return NULL;
+}
+
+int VideoCompositor::submitFrame(agora::rtc::uid_t uid, const agora::media::IVideoFrameObserver::VideoFrame& frame)
+{
+    if (frame.type != agora::media::IVideoFrameObserver::FRAME_TYPE_YUV420 || frame.width <= 0 || frame.height <= 0)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    Source* source;
+    int slot = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_sourceMutex);
+        source = findSource(uid);
+        if (!source) {
+            source = new Source();
+            source->uid = uid;
+            source->front = 0;
+            source->reading = -1;
+            source->valid = false;
+            m_sources.push_back(source);
+        }
+        // Three images: the published one, the one compose() may be reading and a free one.
+        while (slot == source->front || slot == source->reading)
+            ++slot;
+    }
+
+    Image& image = source->images[slot];
+    int chromaWidth = (frame.width + 1) / 2;
+    int chromaHeight = (frame.height + 1) / 2;
+    image.width = frame.width;
+    image.height = frame.height;
+    copyPlane(image.planes[0].pixels, frame.yBuffer, frame.yStride, frame.width, frame.height);
+    copyPlane(image.planes[1].pixels, frame.uBuffer, frame.uStride, chromaWidth, chromaHeight);
+    copyPlane(image.planes[2].pixels, frame.vBuffer, frame.vStride, chromaWidth, chromaHeight);
+
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    source->front = slot;
+    source->valid = true;
+    return 0;
+}
+
+void VideoCompositor::removeSource(agora::rtc::uid_t uid)
+{
+    // The slot is kept: a render callback may still be copying into it.
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    Source* source = findSource(uid);
+    if (source)
+        source->valid = false;
+}
+
+int VideoCompositor::compose(PackedVideoFrame& canvas)
+{
+    std::lock_guard<std::mutex> layoutLock(m_layoutMutex);
+    if (canvas.format != PACKED_FRAME_FORMAT_I420 || canvas.width() != m_canvasWidth || canvas.visibleHeight() != m_canvasHeight)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    m_jobs.resize(m_regions.size());
+    size_t jobCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_sourceMutex);
+        for (size_t i = 0; i < m_regions.size(); ++i) {
+            const CompositorRegion& region = m_regions[i];
+            if (region.width <= 0 || region.height <= 0 || region.alpha <= 0)
+                continue;
+            Source* source = findSource(region.uid);
+            if (!source || !source->valid)
+                continue;
+            source->reading = source->front;
+            Job& job = m_jobs[jobCount++];
+            job.region = region;
+            job.source = source;
+            job.image = source->front;
+            job.alpha = (int)(region.alpha * 256 + 0.5);
+        }
+    }
+    m_jobs.resize(jobCount);
+
+    for (size_t i = 0; i < m_jobs.size(); ++i) {
+        Job& job = m_jobs[i];
+        const Image& image = job.source->images[job.image];
+        buildColumnMap(image.width, job.region.width, job.xIndex[0], job.xWeight[0]);
+        buildColumnMap((image.width + 1) / 2, job.region.width / 2, job.xIndex[1], job.xWeight[1]);
+    }
+
+    int bands = (m_canvasHeight + kBandRows - 1) / kBandRows;
+    if (m_pool) {
+        m_pool->run(bands, [this, &canvas](int band) {
+            composeRows(canvas, band * kBandRows, std::min((band + 1) * kBandRows, m_canvasHeight));
+        });
+    } else {
+        composeRows(canvas, 0, m_canvasHeight);
+    }
+
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    for (size_t i = 0; i < m_jobs.size(); ++i)
+        m_jobs[i].source->reading = -1;
+    return 0;
+}
+
+void VideoCompositor::composeRows(PackedVideoFrame& canvas, int rowBegin, int rowEnd)
+{
+    // rowBegin is always even; an odd canvas height only leaves a partial last chroma row.
+    int chromaBegin = rowBegin / 2;
+    int chromaEnd = (rowEnd + 1) / 2;
+    int chromaWidth = (m_canvasWidth + 1) / 2;
+
+    for (int y = rowBegin; y < rowEnd; ++y)
+        memset(canvas.planes[0] + (size_t)y * canvas.planeStrides[0], m_background[0], m_canvasWidth);
+    for (int p = 1; p < 3; ++p) {
+        for (int y = chromaBegin; y < chromaEnd; ++y)
+            memset(canvas.planes[p] + (size_t)y * canvas.planeStrides[p], m_background[p], chromaWidth);
+    }
+
+    for (size_t i = 0; i < m_jobs.size(); ++i) {
+        const Job& job = m_jobs[i];
+        const CompositorRegion& r = job.region;
+        int top = std::max(r.y, rowBegin);
+        int bottom = std::min(r.y + r.height, rowEnd);
+        if (top >= bottom)
+            continue;
+
+        const Image& image = job.source->images[job.image];
+        blendPlane(canvas.planes[0], canvas.planeStrides[0], r.x, r.y, r.height, top, bottom,
+                   &image.planes[0].pixels[0], image.width, image.height,
+                   job.xIndex[0], job.xWeight[0], job.alpha);
+
+        if (job.xIndex[1].empty())
+            continue;
+        int srcChromaWidth = (image.width + 1) / 2;
+        int srcChromaHeight = (image.height + 1) / 2;
+        for (int p = 1; p < 3; ++p) {
+            blendPlane(canvas.planes[p], canvas.planeStrides[p], r.x / 2, r.y / 2, r.height / 2, top / 2, bottom / 2,
+                       &image.planes[p].pixels[0], srcChromaWidth, srcChromaHeight,
+                       job.xIndex[1], job.xWeight[1], job.alpha);
+        }
+    }
+}
+
+} // namespace media
+} // namespace talkboard
@@ -0,0 +1,123 @@
+//
+//  TalkBoard Engine
+//
+//  Local software compositor for VideoCompositingLayout / LiveTranscoding layouts.
+//
+
+#ifndef TALKBOARD_VIDEO_COMPOSITOR_H
+#define TALKBOARD_VIDEO_COMPOSITOR_H
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraMediaEngine.h>
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+#include "ThreadPool.h"
+#include "VideoFramePacker.h"
+
+namespace talkboard {
+namespace media {
+
+/** A region of the canvas in pixels, as produced from either layout description.
+ */
+struct CompositorRegion
+{
+    agora::rtc::uid_t uid;
+    int x;
+    int y;
+    int width;
+    int height;
+    int zOrder;
+    double alpha;
+};
+
+/** Composites the latest I420 frame of every uid into one canvas.
+
+ Frames arrive through submitFrame() from IVideoFrameObserver callbacks and are
+ copied into per-uid triple buffers, so the callback never waits for compose().
+ compose() blends the regions bottom-up by zOrder, scales every frame to its
+ region and splits the canvas rows across the ThreadPool.
+ */
+class VideoCompositor
+{
+public:
+    /** @param pool Pool used to split the canvas rows. NULL composes on the calling thread. */
+    explicit VideoCompositor(util::ThreadPool* pool = NULL);
+    ~VideoCompositor();
+
+    /** Uses a VideoCompositingLayout on a `canvasWidth` x `canvasHeight` canvas.
+
+     Region coordinates are fractions of the canvas; backgroundColor is an RGB
+     hex string such as "C0C0C0".
+     */
+    int setLayout(const agora::rtc::VideoCompositingLayout& layout, int canvasWidth, int canvasHeight);
+
+    /** Uses the canvas size, background color and users of a LiveTranscoding.
+     */
+    int setLayout(const agora::rtc::LiveTranscoding& transcoding);
+
+    /** Stores a copy of `frame` as the latest frame of `uid`. Safe to call from SDK threads.
+     */
+    int submitFrame(agora::rtc::uid_t uid, const agora::media::IVideoFrameObserver::VideoFrame& frame);
+
+    /** Drops the stored frame of `uid`, e.g. after onUserOffline.
+     */
+    void removeSource(agora::rtc::uid_t uid);
+
+    /** Renders the current layout into `canvas`, which must be an I420 frame of the canvas size.
+     */
+    int compose(PackedVideoFrame& canvas);
+
+    int canvasWidth() const { return m_canvasWidth; }
+    int canvasHeight() const { return m_canvasHeight; }
+
+private:
+    VideoCompositor(const VideoCompositor&);
+    VideoCompositor& operator=(const VideoCompositor&);
+
+    struct Plane {
+        std::vector<uint8_t> pixels;
+    };
+    struct Image {
+        int width;
+        int height;
+        Plane planes[3];
+        Image() : width(0), height(0) {}
+    };
+    struct Source {
+        agora::rtc::uid_t uid;
+        Image images[3];
+        int front;
+        int reading;
+        bool valid;
+    };
+    struct Job {
+        CompositorRegion region;
+        Source* source;
+        int image;
+        int alpha;
+        std::vector<int> xIndex[2];
+        std::vector<int> xWeight[2];
+    };
+
+    Source* findSource(agora::rtc::uid_t uid);
+    void setRegions(std::vector<CompositorRegion>& regions, int width, int height, uint32_t rgb);
+    void composeRows(PackedVideoFrame& canvas, int rowBegin, int rowEnd);
+
+    util::ThreadPool* m_pool;
+    std::mutex m_layoutMutex;
+    std::mutex m_sourceMutex;
+    std::vector<Source*> m_sources;
+    std::vector<CompositorRegion> m_regions;
+    std::vector<Job> m_jobs;
+    int m_canvasWidth;
+    int m_canvasHeight;
+    uint8_t m_background[3];
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,145 @@
+//
+//  TalkBoard Engine
+//
+
+#include "VideoFramePacker.h"
+
+#include <string.h>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+namespace talkboard {
+namespace media {
+
+namespace {
+
+int roundUp(int value, int alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void copyPlane(unsigned char* dst, int dstStride, const unsigned char* src, int srcStride, int rowBytes, int rows)
+{
+    if (dstStride == srcStride && rowBytes == srcStride) {
+        memcpy(dst, src, (size_t)rowBytes * rows);
+        return;
+    }
+    for (int y = 0; y < rows; ++y)
+        memcpy(dst + (size_t)y * dstStride, src + (size_t)y * srcStride, rowBytes);
+}
+
+} // namespace
+
+VideoFramePacker::VideoFramePacker(util::BufferPool& pool, int strideAlignment)
+    : m_pool(pool)
+    , m_alignment(strideAlignment >= 16 ? strideAlignment : 16)
+{
+}
+
+int VideoFramePacker::alignedStride(int format, int width, int strideAlignment)
+{
+    switch (format) {
+    case PACKED_FRAME_FORMAT_I420:
+        // The chroma planes use half the luma stride, so the luma stride has to
+        // be aligned twice as coarsely for the chroma rows to stay aligned.
+        return roundUp(width, strideAlignment * 2);
+    case PACKED_FRAME_FORMAT_NV12:
+        return roundUp(width, strideAlignment);
+    case PACKED_FRAME_FORMAT_BGRA:
+    case PACKED_FRAME_FORMAT_RGBA:
+        return roundUp(width * 4, strideAlignment) / 4;
+    default:
+        return 0;
+    }
+}
+
+int VideoFramePacker::acquire(int format, int width, int height, PackedVideoFrame& frame)
+{
+    if (width <= 0 || height <= 0)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    int stride = alignedStride(format, width, m_alignment);
+    if (stride == 0)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    bool subsampled = format == PACKED_FRAME_FORMAT_I420 || format == PACKED_FRAME_FORMAT_NV12;
+    int rows = subsampled ? roundUp(height, 2) : height;
+
+    size_t lumaBytes = (size_t)stride * rows;
+    size_t size = 0;
+    switch (format) {
+    case PACKED_FRAME_FORMAT_I420:
+    case PACKED_FRAME_FORMAT_NV12:
+        size = lumaBytes + lumaBytes / 2;
+        break;
+    default:
+        size = lumaBytes * 4;
+        break;
+    }
+
+    unsigned char* data = m_pool.acquire(size);
+    if (!data)
+        return -agora::ERR_RESOURCE_LIMITED;
+
+    frame = PackedVideoFrame();
+    frame.format = format;
+    frame.strideInPixels = stride;
+    frame.height = rows;
+    frame.cropRight = stride - width;
+    frame.cropBottom = rows - height;
+    frame.data = data;
+    frame.size = size;
+
+    switch (format) {
+    case PACKED_FRAME_FORMAT_I420:
+        frame.planeCount = 3;
+        frame.planes[0] = data;
+        frame.planes[1] = data + lumaBytes;
+        frame.planes[2] = data + lumaBytes + lumaBytes / 4;
+        frame.planeStrides[0] = stride;
+        frame.planeStrides[1] = stride / 2;
+        frame.planeStrides[2] = stride / 2;
+        break;
+    case PACKED_FRAME_FORMAT_NV12:
+        frame.planeCount = 2;
+        frame.planes[0] = data;
+        frame.planes[1] = data + lumaBytes;
+        frame.planeStrides[0] = stride;
+        frame.planeStrides[1] = stride;
+        break;
+    default:
+        frame.planeCount = 1;
+        frame.planes[0] = data;
+        frame.planeStrides[0] = stride * 4;
+        break;
+    }
+    return 0;
+}
+
+void VideoFramePacker::release(PackedVideoFrame& frame)
+{
+    m_pool.release(frame.data);
+    frame = PackedVideoFrame();
+}
+
+int VideoFramePacker::copyFrom(const agora::media::IVideoFrameObserver::VideoFrame& src, PackedVideoFrame& dst)
+{
+    if (src.type != agora::media::IVideoFrameObserver::FRAME_TYPE_YUV420)
+        return -agora::ERR_NOT_SUPPORTED;
+
+    int ret = acquire(PACKED_FRAME_FORMAT_I420, src.width, src.height, dst);
+    if (ret != 0)
+        return ret;
+
+    int chromaWidth = (src.width + 1) / 2;
+    int chromaHeight = (src.height + 1) / 2;
+    copyPlane(dst.planes[0], dst.planeStrides[0], static_cast<const unsigned char*>(src.yBuffer), src.yStride, src.width, src.height);
+    copyPlane(dst.planes[1], dst.planeStrides[1], static_cast<const unsigned char*>(src.uBuffer), src.uStride, chromaWidth, chromaHeight);
+    copyPlane(dst.planes[2], dst.planeStrides[2], static_cast<const unsigned char*>(src.vBuffer), src.vStride, chromaWidth, chromaHeight);
+    dst.rotation = src.rotation;
+    dst.timestampMs = src.renderTimeMs;
+    return 0;
+}
+
+} // namespace media
+} // namespace talkboard
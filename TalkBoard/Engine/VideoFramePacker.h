@@ -0,0 +1,130 @@
+//
+//  TalkBoard Engine
+//
+//  Builds frames for AgoraRtcEngineKit pushExternalVideoFrame: directly from
+//  pooled, stride-aligned buffers.
+//
+
+#ifndef TALKBOARD_VIDEO_FRAME_PACKER_H
+#define TALKBOARD_VIDEO_FRAME_PACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <AgoraRtcEngineKit/IAgoraMediaEngine.h>
+
+#include "BufferPool.h"
+
+namespace talkboard {
+namespace media {
+
+/** Pixel formats accepted by AgoraVideoFrame::format.
+ */
+enum PACKED_FRAME_FORMAT
+{
+    PACKED_FRAME_FORMAT_I420 = 1,
+    PACKED_FRAME_FORMAT_BGRA = 2,
+    PACKED_FRAME_FORMAT_RGBA = 4,
+    PACKED_FRAME_FORMAT_NV12 = 8,
+};
+
+/** A frame laid out the way AgoraVideoFrame describes its dataBuf.
+
+ The buffer holds `height` rows of `strideInPixels` pixels per plane. Alignment
+ padding on the right and bottom is reported through cropRight/cropBottom so
+ the SDK never encodes it. Sources render straight into `planes`, which is
+ what avoids the extra repack copy.
+ */
+struct PackedVideoFrame
+{
+    int format;
+    /** Pixels between two consecutive rows of the first plane. */
+    int strideInPixels;
+    /** Rows in the buffer, padding included. */
+    int height;
+    int cropLeft;
+    int cropTop;
+    int cropRight;
+    int cropBottom;
+    /** 0, 90, 180 or 270. */
+    int rotation;
+    int64_t timestampMs;
+
+    unsigned char* data;
+    /** Bytes of data to hand to the SDK. */
+    size_t size;
+    /** Plane starts inside data: Y/U/V for I420, Y/UV for NV12, one plane for RGB formats. */
+    unsigned char* planes[3];
+    /** Byte stride of each plane. */
+    int planeStrides[3];
+    int planeCount;
+
+    PackedVideoFrame()
+        : format(0)
+        , strideInPixels(0)
+        , height(0)
+        , cropLeft(0)
+        , cropTop(0)
+        , cropRight(0)
+        , cropBottom(0)
+        , rotation(0)
+        , timestampMs(0)
+        , data(NULL)
+        , size(0)
+        , planeCount(0)
+    {
+        for (int i = 0; i < 3; ++i) {
+            planes[i] = NULL;
+            planeStrides[i] = 0;
+        }
+    }
+
+    int width() const { return strideInPixels - cropLeft - cropRight; }
+    int visibleHeight() const { return height - cropTop - cropBottom; }
+};
+
+/** Hands out push-ready frames backed by a BufferPool.
+
+ Every plane stride is a multiple of the alignment passed to the constructor
+ (16 or 32 bytes), so row loops in the writers can use aligned vector stores.
+ */
+class VideoFramePacker
+{
+public:
+    explicit VideoFramePacker(util::BufferPool& pool, int strideAlignment = 32);
+
+    /** Fills `frame` with a pooled buffer for a `width` x `height` image.
+
+     @return
+
+     - 0: Success.
+     - < 0: Failure, -ERR_INVALID_ARGUMENT or -ERR_RESOURCE_LIMITED.
+     */
+    int acquire(int format, int width, int height, PackedVideoFrame& frame);
+
+    /** Returns the buffer of `frame` to the pool and clears it.
+     */
+    void release(PackedVideoFrame& frame);
+
+    /** Copies an I420 frame from IVideoFrameObserver into a packed I420 frame.
+
+     This is the fallback for sources that cannot render in place, such as
+     frames handed to us by the SDK.
+     */
+    int copyFrom(const agora::media::IVideoFrameObserver::VideoFrame& src, PackedVideoFrame& dst);
+
+    /** The stride in pixels `acquire` picks for `width`, or 0 for an unknown format.
+     */
+    static int alignedStride(int format, int width, int strideAlignment);
+
+    int strideAlignment() const { return m_alignment; }
+
+private:
+    util::BufferPool& m_pool;
+    int m_alignment;
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
@@ -0,0 +1,373 @@
+//
+//  TalkBoard Engine
+//
+
+#include "VoiceActivityDetector.h"
+
+#include <math.h>
+
+#include <AgoraRtcEngineKit/AgoraBase.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TALKBOARD_VAD_NEON 1
+#endif
+
+namespace talkboard {
+namespace media {
+
+namespace {
+
+const uint64_t kFreeKey = 0;
+const uint64_t kRemovedKey = 1;
+const int kMaxFftSize = 512;
+const int kMinFftSize = 64;
+const float kSilenceDb = -96.0f;
+const float kPi = 3.14159265f;
+const float kNoiseFloorRiseDbPerSecond = 3.0f;
+const float kSpeechBandLowHz = 300.0f;
+const float kSpeechBandHighHz = 4000.0f;
+/** Weight of the newest frame in the smoothed flatness. */
+const float kFlatnessSmoothing = 0.5f;
+
+// Published word: bits 0-15 RMS and 16-31 peak as centi-dB below full
+// scale, bits 32-47 flatness * 10000, bit 48 speaking, bit 49 valid.
+const uint64_t kSpeakingBit = 1ULL << 48;
+const uint64_t kValidBit = 1ULL << 49;
+
+inline uint64_t keyOf(agora::rtc::uid_t uid)
+{
+    return (uint64_t)uid | (1ULL << 32);
+}
+
+inline uint32_t hashOf(agora::rtc::uid_t uid)
+{
+    return (uint32_t)uid * 2654435761u;
+}
+
+uint64_t pack(float rmsDb, float peakDb, float flatness, bool speaking)
+{
+    uint64_t rms = (uint64_t)(-rmsDb * 100 + 0.5f);
+    uint64_t peak = (uint64_t)(-peakDb * 100 + 0.5f);
+    uint64_t flat = (uint64_t)(flatness * 10000 + 0.5f);
+    return rms | peak << 16 | flat << 32 | (speaking ? kSpeakingBit : 0) | kValidBit;
+}
+
+AudioLevel unpack(uint64_t key, uint64_t word)
+{
+    AudioLevel level;
+    level.uid = (agora::rtc::uid_t)key;
+    level.rmsDb = -(float)(word & 0xffff) / 100;
+    level.peakDb = -(float)((word >> 16) & 0xffff) / 100;
+    level.flatness = (float)((word >> 32) & 0xffff) / 10000;
+    level.speaking = (word & kSpeakingBit) != 0;
+    return level;
+}
+
+/** Sum of squares and largest magnitude of `count` samples. */
+void measure(const int16_t* in, int count, uint64_t& energy, int& peak)
+{
+    uint64_t sum = 0;
+    int hi = 0, lo = 0;
+    int i = 0;
+#if defined(__SSE2__)
+    // madd sums two squares per 32-bit lane; at most 2^31, so it is exact as
+    // an unsigned value and is widened to 64 bits before accumulating.
+    __m128i acc = _mm_setzero_si128();
+    __m128i vmax = _mm_setzero_si128();
+    __m128i vmin = _mm_setzero_si128();
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i sq = _mm_madd_epi16(v, v);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+        vmax = _mm_max_epi16(vmax, v);
+        vmin = _mm_min_epi16(vmin, v);
+    }
+    uint64_t lanes[2];
+    int16_t maxs[8], mins[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), vmax);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), vmin);
+    sum = lanes[0] + lanes[1];
+    for (int k = 0; k < 8; ++k) {
+        hi = maxs[k] > hi ? maxs[k] : hi;
+        lo = mins[k] < lo ? mins[k] : lo;
+    }
+#elif defined(TALKBOARD_VAD_NEON)
+    uint64x2_t acc = vdupq_n_u64(0);
+    int16x8_t vmax = vdupq_n_s16(0);
+    int16x8_t vmin = vdupq_n_s16(0);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        int32x4_t s0 = vmull_s16(vget_low_s16(v), vget_low_s16(v));
+        int32x4_t s1 = vmull_s16(vget_high_s16(v), vget_high_s16(v));
+        acc = vpadalq_u32(acc, vreinterpretq_u32_s32(s0));
+        acc = vpadalq_u32(acc, vreinterpretq_u32_s32(s1));
+        vmax = vmaxq_s16(vmax, v);
+        vmin = vminq_s16(vmin, v);
+    }
+    sum = vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1);
+    int16_t maxs[8], mins[8];
+    vst1q_s16(maxs, vmax);
+    vst1q_s16(mins, vmin);
+    for (int k = 0; k < 8; ++k) {
+        hi = maxs[k] > hi ? maxs[k] : hi;
+        lo = mins[k] < lo ? mins[k] : lo;
+    }
+#endif
+    for (; i < count; ++i) {
+        int v = in[i];
+        sum += (uint64_t)(v * v);
+        hi = v > hi ? v : hi;
+        lo = v < lo ? v : lo;
+    }
+    energy = sum;
+    peak = hi > -lo ? hi : -lo;
+}
+
+inline float toDb(double magnitude)
+{
+    if (magnitude <= 0)
+        return kSilenceDb;
+    float db = (float)(20 * log10(magnitude / 32768));
+    return db < kSilenceDb ? kSilenceDb : db;
+}
+
+} // namespace
+
+VoiceActivityDetector::VoiceActivityDetector(const VoiceActivityConfig& config)
+    : m_config(config)
+    , m_cos(kMaxFftSize)
+    , m_re(kMaxFftSize)
+    , m_im(kMaxFftSize)
+{
+    for (int i = 0; i < MAX_STREAMS; ++i) {
+        m_slots[i].key.store(kFreeKey, std::memory_order_relaxed);
+        m_slots[i].published.store(0, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < kMaxFftSize; ++i)
+        m_cos[i] = cosf(2 * kPi * i / kMaxFftSize);
+}
+
+VoiceActivityDetector::Slot* VoiceActivityDetector::slotFor(agora::rtc::uid_t uid)
+{
+    uint64_t key = keyOf(uid);
+    uint32_t start = hashOf(uid);
+    Slot* reusable = NULL;
+    for (int probe = 0; probe < MAX_STREAMS; ++probe) {
+        Slot& slot = m_slots[(start + probe) % MAX_STREAMS];
+        uint64_t current = slot.key.load(std::memory_order_acquire);
+        if (current == key)
+            return &slot;
+        if (current == kRemovedKey && !reusable)
+            reusable = &slot;
+        if (current == kFreeKey) {
+            if (!reusable)
+                reusable = &slot;
+            break;
+        }
+    }
+    if (!reusable)
+        return NULL;
+
+    // Only this thread inserts, and removeUid() only touches slots holding its
+    // own uid, so the key can be stored once the state is reset.
+    reusable->published.store(0, std::memory_order_relaxed);
+    reusable->noiseFloorDb = m_config.minSpeechDb - m_config.noiseMarginDb;
+    reusable->flatness = 1.0f;
+    reusable->speechMs = 0;
+    reusable->silenceMs = 0;
+    reusable->speaking = false;
+    reusable->key.store(key, std::memory_order_release);
+    return reusable;
+}
+
+const VoiceActivityDetector::Slot* VoiceActivityDetector::find(agora::rtc::uid_t uid) const
+{
+    uint64_t key = keyOf(uid);
+    uint32_t start = hashOf(uid);
+    for (int probe = 0; probe < MAX_STREAMS; ++probe) {
+        const Slot& slot = m_slots[(start + probe) % MAX_STREAMS];
+        uint64_t current = slot.key.load(std::memory_order_acquire);
+        if (current == key)
+            return &slot;
+        if (current == kFreeKey)
+            break;
+    }
+    return NULL;
+}
+
+float VoiceActivityDetector::flatness(const int16_t* samples, int frames, int channels, int sampleRate)
+{
+    int n = kMaxFftSize;
+    while (n > frames)
+        n >>= 1;
+    if (n < kMinFftSize)
+        return 0;
+
+    // Hann-windowed mono mix of the newest n frames.
+    const int step = kMaxFftSize / n;
+    const int16_t* tail = samples + (size_t)(frames - n) * channels;
+    float* re = &m_re[0];
+    float* im = &m_im[0];
+    for (int i = 0; i < n; ++i) {
+        float x = channels == 2 ? 0.5f * (tail[2 * i] + tail[2 * i + 1]) : tail[i];
+        re[i] = x * (0.5f - 0.5f * m_cos[i * step]);
+        im[i] = 0;
+    }
+
+    // In-place radix-2 FFT.
+    for (int i = 1, j = 0; i < n; ++i) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j |= bit;
+        if (i < j) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+        }
+    }
+    const int quarter = kMaxFftSize / 4;
+    for (int len = 2; len <= n; len <<= 1) {
+        int twiddleStep = kMaxFftSize / len;
+        for (int i = 0; i < n; i += len) {
+            for (int k = 0; k < len / 2; ++k) {
+                int index = k * twiddleStep;
+                float wr = m_cos[index];
+                float wi = -m_cos[(index + kMaxFftSize - quarter) % kMaxFftSize];
+                int a = i + k, b = a + len / 2;
+                float xr = re[b] * wr - im[b] * wi;
+                float xi = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - xr;
+                im[b] = im[a] - xi;
+                re[a] += xr;
+                im[a] += xi;
+            }
+        }
+    }
+
+    int low = (int)ceilf(kSpeechBandLowHz * n / sampleRate);
+    int high = (int)(kSpeechBandHighHz * n / sampleRate);
+    if (high > n / 2 - 1)
+        high = n / 2 - 1;
+    if (low < 1)
+        low = 1;
+    if (high <= low)
+        return 0;
+
+    double logSum = 0, sum = 0;
+    for (int k = low; k <= high; ++k) {
+        double power = (double)re[k] * re[k] + (double)im[k] * im[k] + 1e-3;
+        logSum += log(power);
+        sum += power;
+    }
+    int bins = high - low + 1;
+    return (float)(exp(logSum / bins) / (sum / bins));
+}
+
+int VoiceActivityDetector::process(agora::rtc::uid_t uid, const agora::media::IAudioFrameObserver::AudioFrame& frame)
+{
+    if (frame.type != agora::media::IAudioFrameObserver::FRAME_TYPE_PCM16 || frame.bytesPerSample != 2
+        || !frame.buffer || frame.samples <= 0 || frame.channels < 1 || frame.channels > 2
+        || frame.samplesPerSec <= 0)
+        return -agora::ERR_INVALID_ARGUMENT;
+
+    Slot* slot = slotFor(uid);
+    if (!slot)
+        return -agora::ERR_RESOURCE_LIMITED;
+
+    const int16_t* samples = static_cast<const int16_t*>(frame.buffer);
+    const int count = frame.samples * frame.channels;
+    uint64_t energy;
+    int peak;
+    measure(samples, count, energy, peak);
+    float rmsDb = toDb(sqrt((double)energy / count));
+    float peakDb = toDb(peak);
+
+    // Spectral analysis only for frames loud enough to be speech.
+    bool loud = rmsDb >= m_config.minSpeechDb && rmsDb >= slot->noiseFloorDb + m_config.noiseMarginDb;
+    if (loud) {
+        float flat = flatness(samples, frame.samples, frame.channels, frame.samplesPerSec);
+        slot->flatness += (flat - slot->flatness) * kFlatnessSmoothing;
+    }
+    bool speech = loud && slot->flatness <= m_config.maxFlatness;
+
+    int frameMs = (int)((int64_t)frame.samples * 1000 / frame.samplesPerSec);
+    if (rmsDb < slot->noiseFloorDb) {
+        slot->noiseFloorDb = rmsDb;
+    } else if (!speech) {
+        float rise = kNoiseFloorRiseDbPerSecond * frameMs / 1000;
+        float gap = rmsDb - slot->noiseFloorDb;
+        slot->noiseFloorDb += gap < rise ? gap : rise;
+    }
+
+    if (speech) {
+        slot->speechMs += frameMs;
+        slot->silenceMs = 0;
+        if (slot->speechMs >= m_config.attackMs)
+            slot->speaking = true;
+    } else {
+        slot->silenceMs += frameMs;
+        slot->speechMs = 0;
+        if (slot->silenceMs >= m_config.releaseMs)
+            slot->speaking = false;
+    }
+
+    slot->published.store(pack(rmsDb, peakDb, slot->flatness, slot->speaking), std::memory_order_relaxed);
+    return slot->speaking ? 1 : 0;
+}
+
+void VoiceActivityDetector::removeUid(agora::rtc::uid_t uid)
+{
+    Slot* slot = const_cast<Slot*>(find(uid));
+    if (!slot)
+        return;
+    uint64_t expected = keyOf(uid);
+    slot->key.compare_exchange_strong(expected, kRemovedKey, std::memory_order_acq_rel);
+}
+
+bool VoiceActivityDetector::isSpeaking(agora::rtc::uid_t uid) const
+{
+    const Slot* slot = find(uid);
+    return slot && (slot->published.load(std::memory_order_relaxed) & kSpeakingBit);
+}
+
+agora::rtc::uid_t VoiceActivityDetector::activeSpeaker() const
+{
+    agora::rtc::uid_t speaker = 0;
+    uint64_t quietest = ~0ULL;
+    for (int i = 0; i < MAX_STREAMS; ++i) {
+        uint64_t key = m_slots[i].key.load(std::memory_order_acquire);
+        if (key == kFreeKey || key == kRemovedKey)
+            continue;
+        uint64_t word = m_slots[i].published.load(std::memory_order_relaxed);
+        // The low bits are attenuation, so the loudest speaker has the smallest value.
+        if ((word & kSpeakingBit) && (word & 0xffff) < quietest) {
+            quietest = word & 0xffff;
+            speaker = (agora::rtc::uid_t)key;
+        }
+    }
+    return speaker;
+}
+
+int VoiceActivityDetector::levels(AudioLevel* levels, int capacity) const
+{
+    if (!levels)
+        return 0;
+    int n = 0;
+    for (int i = 0; i < MAX_STREAMS && n < capacity; ++i) {
+        uint64_t key = m_slots[i].key.load(std::memory_order_acquire);
+        if (key == kFreeKey || key == kRemovedKey)
+            continue;
+        uint64_t word = m_slots[i].published.load(std::memory_order_relaxed);
+        if (word & kValidBit)
+            levels[n++] = unpack(key, word);
+    }
+    return n;
+}
+
+} // namespace media
+} // namespace talkboard
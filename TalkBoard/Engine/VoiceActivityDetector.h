@@ -0,0 +1,139 @@
+//
+//  TalkBoard Engine
+//
+//  Per-uid level meter and voice activity detection on onPlaybackAudioFrameBeforeMixing frames.
+//
+
+#ifndef TALKBOARD_VOICE_ACTIVITY_DETECTOR_H
+#define TALKBOARD_VOICE_ACTIVITY_DETECTOR_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include <AgoraRtcEngineKit/IAgoraMediaEngine.h>
+#include <AgoraRtcEngineKit/IAgoraRtcEngine.h>
+
+namespace talkboard {
+namespace media {
+
+/** Detection parameters.
+ */
+struct VoiceActivityConfig
+{
+    /** Frames quieter than this (dBFS) are never speech. */
+    float minSpeechDb;
+    /** Margin above the tracked noise floor a frame needs to count as speech. */
+    float noiseMarginDb;
+    /** Smoothed spectral flatness above which audio counts as noise: 0 is a
+     pure tone, white noise averages about 0.56. */
+    float maxFlatness;
+    /** Speech needed before a uid becomes active. */
+    int attackMs;
+    /** Non-speech needed before an active uid becomes inactive. */
+    int releaseMs;
+
+    VoiceActivityConfig()
+        : minSpeechDb(-50)
+        , noiseMarginDb(9)
+        , maxFlatness(0.35f)
+        , attackMs(30)
+        , releaseMs(400)
+    {}
+};
+
+/** Latest measurement of one uid.
+ */
+struct AudioLevel
+{
+    agora::rtc::uid_t uid;
+    /** RMS level of the last frame in dBFS, -96 for digital silence. */
+    float rmsDb;
+    /** Peak level of the last frame in dBFS. */
+    float peakDb;
+    /** Smoothed spectral flatness in the speech band. */
+    float flatness;
+    bool speaking;
+};
+
+/** Meters remote audio and decides who is speaking, one frame at a time.
+
+ onAudioVolumeIndication and onActiveSpeaker report at the interval given to
+ enableAudioVolumeIndication; this reacts within attackMs. Every frame gets an
+ RMS and peak measurement (SSE2/NEON) and, when it is loud enough, the
+ spectral flatness of its speech band: voice is harmonic and scores low,
+ broadband noise scores high. Flatness is averaged over a few frames because
+ a single short periodogram of noise is too erratic to threshold. The
+ per-uid noise floor adapts, and the speaking state only changes after
+ attackMs of speech or releaseMs of non-speech.
+
+ process() must be called from a single audio thread. The query functions
+ and removeUid() may be called from any thread without locking; each uid's
+ result is published as a single atomic word.
+ */
+class VoiceActivityDetector
+{
+public:
+    /** Number of uids tracked at the same time. */
+    enum { MAX_STREAMS = 64 };
+
+    explicit VoiceActivityDetector(const VoiceActivityConfig& config = VoiceActivityConfig());
+
+    /** Analyzes a PCM16 frame of `uid`. Audio thread only.
+
+     @return
+
+     - 1: `uid` is speaking.
+     - 0: `uid` is not speaking.
+     - < 0: -ERR_INVALID_ARGUMENT for a frame that is not PCM16, or
+     -ERR_RESOURCE_LIMITED when MAX_STREAMS uids are already tracked.
+     */
+    int process(agora::rtc::uid_t uid, const agora::media::IAudioFrameObserver::AudioFrame& frame);
+
+    /** Forgets `uid`, e.g. from onUserOffline. */
+    void removeUid(agora::rtc::uid_t uid);
+
+    bool isSpeaking(agora::rtc::uid_t uid) const;
+
+    /** The loudest uid that is speaking, or 0 if nobody is. */
+    agora::rtc::uid_t activeSpeaker() const;
+
+    /** Copies up to `capacity` tracked uids into `levels`.
+
+     @return Number of entries written.
+     */
+    int levels(AudioLevel* levels, int capacity) const;
+
+private:
+    VoiceActivityDetector(const VoiceActivityDetector&);
+    VoiceActivityDetector& operator=(const VoiceActivityDetector&);
+
+    struct Slot {
+        /** uid with bit 32 set; 0 marks a free slot, 1 a removed one. */
+        std::atomic<uint64_t> key;
+        /** Packed AudioLevel, see the .cpp. */
+        std::atomic<uint64_t> published;
+        // Audio thread only.
+        float noiseFloorDb;
+        float flatness;
+        int speechMs;
+        int silenceMs;
+        bool speaking;
+    };
+
+    Slot* slotFor(agora::rtc::uid_t uid);
+    const Slot* find(agora::rtc::uid_t uid) const;
+    float flatness(const int16_t* samples, int frames, int channels, int sampleRate);
+
+    VoiceActivityConfig m_config;
+    Slot m_slots[MAX_STREAMS];
+    /** One period of cosine at the largest FFT size, for the twiddles and the Hann window. */
+    std::vector<float> m_cos;
+    std::vector<float> m_re;
+    std::vector<float> m_im;
+};
+
+} // namespace media
+} // namespace talkboard
+
+#endif
@@ -36,23 +36,26 @@ class LiveRoomViewController: UIViewController {
     
     //MARK: - engine & session view
     var rtcEngine: AgoraRtcEngineKit!
+    fileprivate var parameterTransaction: TBParameterTransaction?
+    fileprivate var isCommitScheduled = false
     fileprivate var isBroadcaster: Bool {
         return clientRole == .broadcaster
     }
     fileprivate var isMuted = false {
         didSet {
-            rtcEngine?.muteLocalAudioStream(isMuted)
+            parameterTransaction?.muteLocalAudioStream(isMuted)
+            parameterTransaction?.commit()
             audioMuteButton?.setImage(UIImage(named: isMuted ? "btn_mute_cancel" : "btn_mute"), for: .normal)
         }
     }
     
-    fileprivate var videoSessions = [VideoSession]() {
-        didSet {
-            guard remoteContainerView != nil else {
-                return
-            }
-            updateInterface(withAnimation: true)
-        }
+    // Sessions by uid in join order. Joins and leaves only schedule a
+    // relayout, so a burst of them is laid out once.
+    fileprivate let sessions = TBSessionRegistry<VideoSession>()
+    fileprivate var laidOutRevision: UInt64 = 0
+    fileprivate var isRelayoutScheduled = false
+    fileprivate var videoSessions: [VideoSession] {
+        return sessions.allObjects
     }
     fileprivate var fullSession: VideoSession? {
         didSet {
@@ -63,6 +66,8 @@ class LiveRoomViewController: UIViewController {
     }
     
     fileprivate let viewLayouter = VideoViewLayouter()
+    fileprivate var laidOutContainerSize = CGSize.zero
+    fileprivate let streamTypeController = TBStreamTypeController()
     
     override func viewDidLoad() {
         super.viewDidLoad()
@@ -70,10 +75,19 @@ class LiveRoomViewController: UIViewController {
         roomNameLabel.text = roomName
         
         updateButtonsVisiablity()
+        addSwipeRecognizers()
         
         loadAgoraKit()
     }
     
+    override func viewDidLayoutSubviews() {
+        super.viewDidLayoutSubviews()
+        // Tiles are placed by frame, so a new container size (rotation) needs a relayout.
+        if remoteContainerView.bounds.size != laidOutContainerSize {
+            updateInterface()
+        }
+    }
+    
     //MARK: - user action
     @IBAction func doSwitchCameraPressed(_ sender: UIButton) {
         rtcEngine?.switchCamera()
@@ -110,9 +124,22 @@ class LiveRoomViewController: UIViewController {
     @IBAction func doLeavePressed(_ sender: UIButton) {
         leaveChannel()
     }
+    
+    func doSwiped(_ sender: UISwipeGestureRecognizer) {
+        viewLayouter.scroll(by: sender.direction == .left ? 1 : -1, inContainerView: remoteContainerView)
+        updateInterface(withAnimation: true)
+    }
 }
 
 private extension LiveRoomViewController {
+    func addSwipeRecognizers() {
+        for direction in [UISwipeGestureRecognizerDirection.left, .right] {
+            let swipe = UISwipeGestureRecognizer(target: self, action: #selector(LiveRoomViewController.doSwiped(_:)))
+            swipe.direction = direction
+            remoteContainerView.addGestureRecognizer(swipe)
+        }
+    }
+    
     func updateButtonsVisiablity() {
         guard let sessionButtons = sessionButtons else {
             return
@@ -130,6 +157,9 @@ private extension LiveRoomViewController {
     func leaveChannel() {
         setIdleTimerActive(true)
         
+        parameterTransaction?.rollback()
+        parameterTransaction?.invalidateCache()
+        streamTypeController.reset()
         rtcEngine.setupLocalVideo(nil)
         rtcEngine.leaveChannel(nil)
         if isBroadcaster {
@@ -139,7 +169,8 @@ private extension LiveRoomViewController {
         for session in videoSessions {
             session.hostingView.removeFromSuperview()
         }
-        videoSessions.removeAll()
+        sessions.removeAllObjects()
+        scheduleRelayout()
         
         delegate?.liveVCNeedClose(self)
     }
@@ -178,35 +209,85 @@ private extension LiveRoomViewController {
             displaySessions.removeFirst()
         }
         viewLayouter.layout(sessions: displaySessions, fullSession: fullSession, inContainer: remoteContainerView)
-        setStreamType(forSessions: displaySessions, fullSession: fullSession)
+        laidOutContainerSize = remoteContainerView.bounds.size
+        laidOutRevision = sessions.revision
+        updateTileSizes()
+        evaluateStreamTypes()
     }
     
-    func setStreamType(forSessions sessions: [VideoSession], fullSession: VideoSession?) {
-        if let fullSession = fullSession {
-            for session in sessions {
-                rtcEngine.setRemoteVideoStream(UInt(session.uid), type: (session == fullSession ? .high : .low))
+    // The stream type follows the size a session is drawn at; sessions the
+    // layouter left out report zero and get no video at all, unless they are
+    // on the page or strip next to the screen and worth prefetching.
+    func updateTileSizes() {
+        remoteContainerView.layoutIfNeeded()
+        let scale = UIScreen.main.scale
+        for session in videoSessions where session.uid != 0 {
+            var size = CGSize.zero
+            if session.hostingView.superview != nil {
+                size = session.hostingView.bounds.size
+                size.width *= scale
+                size.height *= scale
             }
-        } else {
-            for session in sessions {
-                rtcEngine.setRemoteVideoStream(UInt(session.uid), type: .high)
+            streamTypeController.setTileSize(size, forUid: UInt(session.uid))
+            streamTypeController.setViewportDistance(viewLayouter.viewportDistance(ofUid: UInt(session.uid)) ?? NSNotFound, forUid: UInt(session.uid))
+        }
+    }
+    
+    func evaluateStreamTypes() {
+        guard let transaction = parameterTransaction else {
+            return
+        }
+        
+        if streamTypeController.evaluate(atTime: CACurrentMediaTime(), transaction: transaction) > 0 {
+            scheduleParameterCommit()
+        }
+    }
+    
+    // One layout change can run updateInterface several times (sessions and
+    // fullSession both change); commit once per run loop pass so only the
+    // final stream types reach the engine.
+    func scheduleParameterCommit() {
+        guard !isCommitScheduled else {
+            return
+        }
+        
+        isCommitScheduled = true
+        DispatchQueue.main.async { [weak self] in
+            guard let strongSelf = self else {
+                return
+            }
+            strongSelf.isCommitScheduled = false
+            strongSelf.parameterTransaction?.commit()
+        }
+    }
+    
+    // Lays out the sessions once the current burst of joins and leaves is
+    // over, unless something else laid them out in the meantime.
+    func scheduleRelayout() {
+        guard !isRelayoutScheduled else {
+            return
+        }
+        isRelayoutScheduled = true
+        DispatchQueue.main.async { [weak self] in
+            guard let strongSelf = self else {
+                return
+            }
+            strongSelf.isRelayoutScheduled = false
+            if strongSelf.remoteContainerView != nil && strongSelf.sessions.revision != strongSelf.laidOutRevision {
+                strongSelf.updateInterface(withAnimation: true)
             }
         }
     }
     
     func addLocalSession() {
         let localSession = VideoSession.localSession()
-        videoSessions.append(localSession)
+        sessions.add(localSession, forUid: 0)
+        scheduleRelayout()
         rtcEngine.setupLocalVideo(localSession.canvas)
     }
     
     func fetchSession(ofUid uid: Int64) -> VideoSession? {
-        for session in videoSessions {
-            if session.uid == uid {
-                return session
-            }
-        }
-        
-        return nil
+        return sessions.object(forUid: UInt(uid))
     }
     
     func videoSession(ofUid uid: Int64) -> VideoSession {
@@ -214,7 +295,8 @@ private extension LiveRoomViewController {
             return fetchedSession
         } else {
             let newSession = VideoSession(uid: uid)
-            videoSessions.append(newSession)
+            sessions.add(newSession, forUid: UInt(uid))
+            scheduleRelayout()
             return newSession
         }
     }
@@ -224,6 +306,7 @@ private extension LiveRoomViewController {
 private extension LiveRoomViewController {
     func loadAgoraKit() {
         rtcEngine = AgoraRtcEngineKit.sharedEngine(withAppId: KeyCenter.AppId, delegate: self)
+        parameterTransaction = TBParameterTransaction(engine: rtcEngine)
         rtcEngine.setChannelProfile(.liveBroadcasting)
         rtcEngine.enableDualStreamMode(true)
         rtcEngine.enableVideo()
@@ -253,31 +336,49 @@ private extension LiveRoomViewController {
 
 extension LiveRoomViewController: AgoraRtcEngineDelegate {
     func rtcEngine(_ engine: AgoraRtcEngineKit, didJoinedOfUid uid: UInt, elapsed: Int) {
+        parameterTransaction?.invalidateCache(forUid: uid)
         let userSession = videoSession(ofUid: Int64(uid))
         rtcEngine.setupRemoteVideo(userSession.canvas)
     }
     
     func rtcEngine(_ engine: AgoraRtcEngineKit, firstLocalVideoFrameWith size: CGSize, elapsed: Int) {
-        if let _ = videoSessions.first {
+        if sessions.count > 0 {
             updateInterface(withAnimation: true)
         }
     }
     
+    func rtcEngine(_ engine: AgoraRtcEngineKit, didRejoinChannel channel: String, withUid uid: UInt, elapsed: Int) {
+        // The engine may have dropped per-user state while reconnecting.
+        parameterTransaction?.invalidateCache()
+        streamTypeController.reset()
+        updateInterface()
+    }
+    
     func rtcEngine(_ engine: AgoraRtcEngineKit, didOfflineOfUid uid: UInt, reason: AgoraUserOfflineReason) {
-        var indexToDelete: Int?
-        for (index, session) in videoSessions.enumerated() {
-            if session.uid == Int64(uid) {
-                indexToDelete = index
-            }
-        }
-        
-        if let indexToDelete = indexToDelete {
-            let deletedSession = videoSessions.remove(at: indexToDelete)
+        parameterTransaction?.invalidateCache(forUid: uid)
+        streamTypeController.removeUid(uid)
+        if let deletedSession = sessions.removeObject(forUid: uid) {
             deletedSession.hostingView.removeFromSuperview()
+            scheduleRelayout()
             
             if deletedSession == fullSession {
                 fullSession = nil
             }
         }
     }
+    
+    func rtcEngine(_ engine: AgoraRtcEngineKit, remoteVideoStats stats: AgoraRtcRemoteVideoStats) {
+        streamTypeController.updateRemoteVideoStats(stats)
+    }
+    
+    func rtcEngine(_ engine: AgoraRtcEngineKit, networkQuality uid: UInt, txQuality: AgoraNetworkQuality, rxQuality: AgoraNetworkQuality) {
+        streamTypeController.updateNetworkQuality(uid, txQuality: txQuality, rxQuality: rxQuality)
+    }
+    
+    // Stats arrive every two seconds; that is when measured bitrates, network
+    // quality and CPU load get a chance to change the stream types.
+    func rtcEngine(_ engine: AgoraRtcEngineKit, reportRtcStats stats: AgoraChannelStats) {
+        streamTypeController.updateRtcStats(stats)
+        evaluateStreamTypes()
+    }
 }
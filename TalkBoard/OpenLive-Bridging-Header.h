@@ -4,3 +4,9 @@
 
 #import "Firebase/Firebase.h"
 #import "FirebaseAuth/FIRAuth.h"
+#import "TBPacketCapture.h"
+#import "TBPacketCrypto.h"
+#import "TBParameterTransaction.h"
+#import "TBSessionRegistry.h"
+#import "TBStreamTypeController.h"
+#import "TBTileLayout.h"
@@ -4,10 +4,13 @@ import UIKit
 class SNSPoint:NSObject{
     var x:CGFloat?
     var y:CGFloat?
+    // Capture time in ms on the sender's uptime clock (UITouch.timestamp), nil for strokes from older clients
+    var t:Int64?
     
-    init(point:CGPoint) {
+    init(point:CGPoint, time:Int64? = nil) {
         x = point.x
         y = point.y
+        t = time
         print("New point created")
     }
     
@@ -18,17 +21,17 @@ class SNSPath: NSObject {
     var points:Array<SNSPoint>
     var color: UIColor
     
-    init(point:CGPoint, color:UIColor) {
+    init(point:CGPoint, color:UIColor, time:Int64? = nil) {
         self.color = color
         self.points = Array<SNSPoint>()
-        let newPoint = SNSPoint(point:point)
+        let newPoint = SNSPoint(point:point, time:time)
         points.append(newPoint)
         print("Start track point in SNSPath")
         super.init()
     }
     
-    func addPoint(point:CGPoint){
-        let newPoint = SNSPoint(point: point)
+    func addPoint(point:CGPoint, time:Int64? = nil){
+        let newPoint = SNSPoint(point: point, time: time)
         points.append(newPoint)
         print("New Point appended")
     }
@@ -42,6 +45,9 @@ class SNSPath: NSObject {
             let pointDictionary = NSMutableDictionary()
             pointDictionary["x"] = Int(point.x!)
             pointDictionary["y"] = Int(point.y!)
+            if let t = point.t{
+                pointDictionary["t"] = NSNumber(value: t)
+            }
             pointsofPath.add(_:pointDictionary)
         }
         dictionary["points"] = pointsofPath;
@@ -10,7 +10,6 @@ class VideoSession: NSObject {
         self.uid = uid
         
         hostingView = UIView(frame: CGRect(x: 0, y: 0, width: 100, height: 100))
-        hostingView.translatesAutoresizingMaskIntoConstraints = false
         
         canvas = AgoraRtcVideoCanvas()
         canvas.uid = UInt(uid)
@@ -2,168 +2,91 @@ import UIKit
 
 class VideoViewLayouter {
     
-    fileprivate var layoutConstraints = [NSLayoutConstraint]()
+    // Grids denser than this are split into pages the user swipes through.
+    fileprivate let maxGridCount = 16
+    fileprivate let tileLayout = TBTileLayout()
+    fileprivate var hostedViews = [UInt: UIView]()
+    
+    init() {
+        tileLayout.spacing = 1
+        tileLayout.stripTileSize = 100
+        tileLayout.stripTop = 65
+        tileLayout.pageSize = maxGridCount
+    }
     
     func layout(sessions: [VideoSession], fullSession: VideoSession?, inContainer container: UIView) {
-        
-        guard !sessions.isEmpty else {
-            return
+        if let fullSession = fullSession {
+            tileLayout.mode = .speaker
+            tileLayout.speakerUid = UInt(fullSession.uid)
+        } else {
+            tileLayout.mode = sessions.count > maxGridCount ? .paged : .grid
         }
         
-        NSLayoutConstraint.deactivate(layoutConstraints)
-        layoutConstraints.removeAll()
-        
+        var sessionsByUid = [UInt: VideoSession]()
         for session in sessions {
-            session.hostingView.removeFromSuperview()
+            sessionsByUid[UInt(session.uid)] = session
         }
-        
-        if let fullSession = fullSession {
-            layoutConstraints.append(contentsOf: layoutFullScreenView(fullSession.hostingView, inContainerView: container))
-            let smallViews = viewList(from: sessions, maxCount: 3, ignorSession: fullSession)
-            layoutConstraints.append(contentsOf: layoutSmallViews(smallViews, inContainerView: container))
-        } else {
-            let allViews = viewList(from: sessions, maxCount: 4, ignorSession: nil)
-            layoutConstraints.append(contentsOf: layoutGridViews(allViews, inContainerView: container))
+        let uids = sessions.map { NSNumber(value: UInt($0.uid)) }
+        guard let changes = tileLayout.layout(uids: uids, in: container.bounds.size) else {
+            return
         }
         
-        if !layoutConstraints.isEmpty {
-            NSLayoutConstraint.activate(layoutConstraints)
-        }
-    }
-    
-    func responseSession(of gesture: UIGestureRecognizer, inSessions sessions: [VideoSession], inContainerView container: UIView) -> VideoSession? {
-        let location = gesture.location(in: container)
-        for session in sessions {
-            if let view = session.hostingView , view.frame.contains(location) {
-                return session
+        // Only tiles that changed are touched. Tiles on other pages or
+        // scrolled out of the strip lose their view, so they render nothing
+        // and report no size to the stream type controller.
+        for change in changes {
+            if change.flags.contains(.removed) {
+                if let view = hostedViews.removeValue(forKey: change.uid), view.superview === container {
+                    view.removeFromSuperview()
+                }
+                continue
             }
-        }
-        return nil
-    }
-}
-
-//MARK: - layouts
-private extension VideoViewLayouter {
-    func viewList(from sessions: [VideoSession], maxCount: Int, ignorSession: VideoSession?) -> [UIView] {
-        var views = [UIView]()
-        for session in sessions {
-            if session == ignorSession {
+            guard let view = sessionsByUid[change.uid]?.hostingView else {
+                continue
+            }
+            hostedViews[change.uid] = view
+            
+            guard change.isVisible else {
+                view.removeFromSuperview()
                 continue
             }
-            views.append(session.hostingView)
-            if views.count >= maxCount {
-                break
+            view.frame = change.frame
+            if view.superview !== container {
+                container.addSubview(view)
+            }
+            if change.zOrder > 0 {
+                container.bringSubview(toFront: view)
+            } else {
+                container.sendSubview(toBack: view)
             }
         }
-        return views
     }
     
-    func layoutFullScreenView(_ view: UIView, inContainerView container: UIView) -> [NSLayoutConstraint] {
-        container.addSubview(view)
-        var layouts = [NSLayoutConstraint]()
-        
-        let constraintsH = NSLayoutConstraint.constraints(withVisualFormat: "H:|[view]|", options: [], metrics: nil, views: ["view": view])
-        let constraintsV = NSLayoutConstraint.constraints(withVisualFormat: "V:|[view]|", options: [], metrics: nil, views: ["view": view])
-        layouts.append(contentsOf: constraintsH)
-        layouts.append(contentsOf: constraintsV)
-        
-        return layouts
+    // Pages or strip widths between the tile of `uid` and the screen; nil if it has no tile.
+    func viewportDistance(ofUid uid: UInt) -> Int? {
+        let distance = tileLayout.viewportDistance(forUid: uid)
+        return distance == NSNotFound ? nil : distance
     }
     
-    func layoutSmallViews(_ smallViews: [UIView], inContainerView container: UIView) -> [NSLayoutConstraint] {
-        var layouts = [NSLayoutConstraint]()
-        var lastView: UIView?
-        
-        let itemSpace: CGFloat = 5
-        
-        for view in smallViews {
-            container.addSubview(view)
-            let viewWidth = NSLayoutConstraint(item: view, attribute: .width, relatedBy: .equal, toItem: nil, attribute: .notAnAttribute, multiplier: 1, constant: 100)
-            let viewHeight = NSLayoutConstraint(item: view, attribute: .height, relatedBy: .equal, toItem: nil, attribute: .notAnAttribute, multiplier: 1, constant: 100)
-            
-            let viewTop = NSLayoutConstraint(item: view, attribute: .top, relatedBy: .equal, toItem: container, attribute: .top, multiplier: 1, constant: 60 + itemSpace)
-            let viewLeft: NSLayoutConstraint
-            if let lastView = lastView {
-                viewLeft = NSLayoutConstraint(item: view, attribute: .left, relatedBy: .equal, toItem: lastView, attribute: .right, multiplier: 1, constant: itemSpace)
-            } else {
-                viewLeft = NSLayoutConstraint(item: view, attribute: .left, relatedBy: .equal, toItem: container, attribute: .left, multiplier: 1, constant: itemSpace)
-            }
-            
-            layouts.append(contentsOf: [viewWidth, viewHeight, viewLeft, viewTop])
-            lastView = view
+    // Moves a paged grid by `pages` pages, or the speaker strip by as many container widths.
+    func scroll(by pages: Int, inContainerView container: UIView) {
+        switch tileLayout.mode {
+        case .paged:
+            tileLayout.page += pages
+        case .speaker:
+            tileLayout.stripOffset += pages * Int(container.bounds.width)
+        default:
+            break
         }
-        
-        return layouts
     }
     
-    func layoutGridViews(_ allViews: [UIView], inContainerView container: UIView) -> [NSLayoutConstraint] {
-        let viewInset: CGFloat = 0.5
-        var layouts = [NSLayoutConstraint]()
-        
-        switch allViews.count {
-        case 0: break
-        case 1:
-            layouts.append(contentsOf: layoutFullScreenView(allViews.first!, inContainerView: container))
-        case 2:
-            let firstView = allViews.first!
-            let lastView = allViews.last!
-            container.addSubview(firstView)
-            container.addSubview(lastView)
-            
-            let h1 = NSLayoutConstraint.constraints(withVisualFormat: "H:|[view]|", options: [], metrics: nil, views: ["view": firstView])
-            let h2 = NSLayoutConstraint.constraints(withVisualFormat: "H:|[view]|", options: [], metrics: nil, views: ["view": lastView])
-            let v = NSLayoutConstraint.constraints(withVisualFormat: "V:|[view1]-(\(viewInset))-[view2]|", options: [], metrics: nil, views: ["view1": firstView, "view2": lastView])
-            let equal = NSLayoutConstraint(item: firstView, attribute: .height, relatedBy: .equal, toItem: lastView, attribute: .height, multiplier: 1, constant: 0)
-            layouts.append(contentsOf: h1)
-            layouts.append(contentsOf: h2)
-            layouts.append(contentsOf: v)
-            layouts.append(equal)
-        case 3:
-            let firstView = allViews.first!
-            let secondView = allViews[1]
-            let lastView = allViews.last!
-            container.addSubview(firstView)
-            container.addSubview(secondView)
-            container.addSubview(lastView)
-            
-            let h1 = NSLayoutConstraint.constraints(withVisualFormat: "H:|[view1]-\(viewInset)-[view2]|", options: [], metrics: nil, views: ["view1": firstView, "view2": secondView])
-            let v1 = NSLayoutConstraint.constraints(withVisualFormat: "V:|[view1]-\(viewInset)-[view2]|", options: [], metrics: nil, views: ["view1": firstView, "view2": lastView])
-            let left = NSLayoutConstraint(item: lastView, attribute: .left, relatedBy: .equal, toItem: container, attribute: .left, multiplier: 1, constant: 0)
-            let top = NSLayoutConstraint(item: secondView, attribute: .top, relatedBy: .equal, toItem: container, attribute: .top, multiplier: 1, constant: 0)
-            let equalWidth1 = NSLayoutConstraint(item: firstView, attribute: .width, relatedBy: .equal, toItem: secondView, attribute: .width, multiplier: 1, constant: 0)
-            let equalWidth2 = NSLayoutConstraint(item: firstView, attribute: .width, relatedBy: .equal, toItem: lastView, attribute: .width, multiplier: 1, constant: 0)
-            let equalHeight1 = NSLayoutConstraint(item: firstView, attribute: .height, relatedBy: .equal, toItem: secondView, attribute: .height, multiplier: 1, constant: 0)
-            let equalHeight2 = NSLayoutConstraint(item: firstView, attribute: .height, relatedBy: .equal, toItem: lastView, attribute: .height, multiplier: 1, constant: 0)
-            layouts.append(contentsOf: h1)
-            layouts.append(contentsOf: v1)
-            layouts.append(contentsOf: [left, top, equalWidth1, equalWidth2, equalHeight1, equalHeight2])
-        default:
-            let firstView = allViews.first!
-            let secondView = allViews[1]
-            let thirdView = allViews[2]
-            let lastView = allViews[3]
-            container.addSubview(firstView)
-            container.addSubview(secondView)
-            container.addSubview(thirdView)
-            container.addSubview(lastView)
-            
-            let h1 = NSLayoutConstraint.constraints(withVisualFormat: "H:|[view1]-\(viewInset)-[view2]|", options: [], metrics: nil, views: ["view1": firstView, "view2": secondView])
-            let h2 = NSLayoutConstraint.constraints(withVisualFormat: "H:|[view1]-\(viewInset)-[view2]|", options: [], metrics: nil, views: ["view1": thirdView, "view2": lastView])
-            let v1 = NSLayoutConstraint.constraints(withVisualFormat: "V:|[view1]-\(viewInset)-[view2]|", options: [], metrics: nil, views: ["view1": firstView, "view2": thirdView])
-            let v2 = NSLayoutConstraint.constraints(withVisualFormat: "V:|[view1]-\(viewInset)-[view2]|", options: [], metrics: nil, views: ["view1": secondView, "view2": lastView])
-            
-            let equalWidth1 = NSLayoutConstraint(item: firstView, attribute: .width, relatedBy: .equal, toItem: secondView, attribute: .width, multiplier: 1, constant: 0)
-            let equalWidth2 = NSLayoutConstraint(item: firstView, attribute: .width, relatedBy: .equal, toItem: thirdView, attribute: .width, multiplier: 1, constant: 0)
-            let equalHeight1 = NSLayoutConstraint(item: firstView, attribute: .height, relatedBy: .equal, toItem: secondView, attribute: .height, multiplier: 1, constant: 0)
-            let equalHeight2 = NSLayoutConstraint(item: firstView, attribute: .height, relatedBy: .equal, toItem: thirdView, attribute: .height, multiplier: 1, constant: 0)
-            
-            layouts.append(contentsOf: h1)
-            layouts.append(contentsOf: v1)
-            layouts.append(contentsOf: h2)
-            layouts.append(contentsOf: v2)
-            layouts.append(contentsOf: [equalWidth1, equalWidth2, equalHeight1, equalHeight2])
+    func responseSession(of gesture: UIGestureRecognizer, inSessions sessions: [VideoSession], inContainerView container: UIView) -> VideoSession? {
+        let location = gesture.location(in: container)
+        for session in sessions {
+            if let view = session.hostingView , view.superview === container, view.frame.contains(location) {
+                return session
+            }
         }
-        
-        return layouts
+        return nil
     }
 }
@@ -47,11 +47,13 @@ func addFromFirebase(sender: NSNotification){
                     let firstPoint = points.firstObject! as! NSObject
                     let currentPoint = CGPoint(x: firstPoint.value(forKey: "x") as! Double,
                                                y: firstPoint.value(forKey: "y") as! Double)
-                    currentSNSPath = SNSPath(point: currentPoint, color: UIColor.black)
+                    currentSNSPath = SNSPath(point: currentPoint, color: UIColor.black,
+                                             time: (firstPoint.value(forKey: "t") as? NSNumber)?.int64Value)
                     for point in points{
                         let p = CGPoint(x: (point as AnyObject).value(forKey: "x") as! Double,
                                         y: (point as AnyObject).value(forKey: "y") as! Double)
-                        currentSNSPath?.addPoint(point: p)
+                        let t = ((point as AnyObject).value(forKey: "t") as? NSNumber)?.int64Value
+                        currentSNSPath?.addPoint(point: p, time: t)
                     }
                 }
                 resetPatch(SendToFirebase: false)
@@ -118,10 +120,11 @@ func addFromFirebase(sender: NSNotification){
                 currentPath?.append(currentPoint)
                 print("Start a new path with point \(currentPoint)")
                 
+                let time = drawningView.boardTime(touch: currentTouch!)
                 if let currentColor = currentColor{
-                    currentSNSPath = SNSPath(point: currentPoint, color: currentColor)
+                    currentSNSPath = SNSPath(point: currentPoint, color: currentColor, time: time)
                 }else{
-                    currentSNSPath = SNSPath(point: currentPoint, color: UIColor.black)
+                    currentSNSPath = SNSPath(point: currentPoint, color: UIColor.black, time: time)
                 }
                 
             }else{
@@ -169,6 +172,11 @@ func addFromFirebase(sender: NSNotification){
     }
     
 
+    // Board time of a touch: UITouch.timestamp in ms, the uptime clock the session clock runs on
+    static func boardTime(touch: UITouch) -> Int64{
+        return Int64(touch.timestamp * 1000)
+    }
+
     func addTouch(touches: Set<UITouch>){
         if currentPath != nil{
             for touch in touches{
@@ -176,7 +184,7 @@ func addFromFirebase(sender: NSNotification){
                     let currentPoint = currentTouch?.location(in: self)
                     if let currentPoint = currentPoint{
                         currentPath?.append(currentPoint)
-                        currentSNSPath?.addPoint(point: currentPoint)
+                        currentSNSPath?.addPoint(point: currentPoint, time: drawningView.boardTime(touch: touch))
                         print("End path with point \(currentPoint)")
                     }else{
                         print("Find empty touch")